@@ -0,0 +1,529 @@
+/**
+ * @file ison_benchmarks.cpp
+ * @brief Throughput benchmarks for the ISON C++ parser, serializers and isonantic
+ *
+ * Build with CMake (requires Google Benchmark):
+ *   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release -DISON_BUILD_BENCHMARKS=ON
+ *   cmake --build build --target ison_benchmarks
+ *   ./build/ison_benchmarks --benchmark_filter=parse/
+ *
+ * Every benchmark runs over generated corpora (users, wide, text, graph, logs)
+ * at the sizes listed in ISON_BENCH_SIZES (default "64K,1M,16M"; K/M/G
+ * suffixes, e.g. ISON_BENCH_SIZES=1G). Reported counters:
+ *   bytes_per_second  input (or output) bytes per second
+ *   rows/s            table rows per second
+ *   allocs/row        heap allocations per row, counted by operator new
+ */
+
+#include "ison_parser.hpp"
+
+#ifdef ISON_BENCH_HAVE_ISONANTIC
+#include "isonantic_ison.hpp"
+#endif
+
+#ifdef ISON_BENCH_HAVE_JSONCPP
+#include <json/json.h>
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Allocation Counting
+// =============================================================================
+
+namespace {
+std::atomic<uint64_t> g_allocations(0);
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// =============================================================================
+// Corpora
+// =============================================================================
+
+/** Deterministic generator so every run measures the same bytes */
+class Lcg {
+public:
+    explicit Lcg(uint64_t seed) : state_(seed) {}
+
+    uint32_t next() {
+        state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(state_ >> 33);
+    }
+
+    uint32_t below(uint32_t n) { return next() % n; }
+
+private:
+    uint64_t state_;
+};
+
+const char* const kWords[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+    "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa"
+};
+
+std::string word(Lcg& rng) { return kWords[rng.below(16)]; }
+
+std::string sentence(Lcg& rng, size_t min_length) {
+    std::string s = "\"";
+    while (s.size() < min_length) {
+        if (s.size() > 1) s += ' ';
+        s += word(rng);
+    }
+    return s + "\"";
+}
+
+/** Realistic user table, matched by the isonantic schema below */
+size_t gen_users(std::string& out, size_t target, Lcg& rng) {
+    out += "table.users\nid:int name:string email:string age:int score:float active:bool team:ref\n";
+    size_t rows = 0;
+    while (out.size() < target) {
+        std::string name = word(rng) + std::to_string(rows);
+        out += std::to_string(rows + 1) + ' ' + name + ' ' + name + "@example.com " +
+               std::to_string(18 + rng.below(60)) + ' ' + std::to_string(rng.below(10000) / 100.0) + ' ' +
+               (rng.below(2) ? "true" : "false") + " :team:" + std::to_string(rng.below(50)) + '\n';
+        ++rows;
+    }
+    return rows;
+}
+
+/** 48 columns cycling through int, float, bool and short strings */
+size_t gen_wide(std::string& out, size_t target, Lcg& rng) {
+    const size_t columns = 48;
+    out += "table.wide\n";
+    for (size_t c = 0; c < columns; ++c) out += (c ? " c" : "c") + std::to_string(c);
+    out += '\n';
+    size_t rows = 0;
+    while (out.size() < target) {
+        for (size_t c = 0; c < columns; ++c) {
+            if (c) out += ' ';
+            switch (c % 4) {
+                case 0: out += std::to_string(rng.below(1000000)); break;
+                case 1: out += std::to_string(rng.below(100000) / 8.0); break;
+                case 2: out += rng.below(2) ? "true" : "false"; break;
+                default: out += word(rng); break;
+            }
+        }
+        out += '\n';
+        ++rows;
+    }
+    return rows;
+}
+
+/** Long quoted strings with embedded escapes */
+size_t gen_text(std::string& out, size_t target, Lcg& rng) {
+    out += "table.documents\nid title body\n";
+    size_t rows = 0;
+    while (out.size() < target) {
+        std::string body = sentence(rng, 512 + rng.below(1024));
+        body.insert(body.size() / 2, "\\\"quoted\\\" \\n");
+        out += std::to_string(rows + 1) + ' ' + sentence(rng, 24) + ' ' + body + '\n';
+        ++rows;
+    }
+    return rows;
+}
+
+/** Node table plus an edge table made of references and relationships */
+size_t gen_graph(std::string& out, size_t target, Lcg& rng) {
+    size_t nodes = target / 160 + 16;
+    out += "table.nodes\nid name kind\n";
+    for (size_t i = 0; i < nodes; ++i) {
+        out += std::to_string(i) + ' ' + word(rng) + ' ' + (rng.below(2) ? "person" : "company") + '\n';
+    }
+    size_t rows = nodes;
+    out += "\ntable.edges\nid src dst rel weight\n";
+    const char* const rels[] = { ":KNOWS:", ":WORKS_AT:", ":OWNS:" };
+    while (out.size() < target) {
+        out += std::to_string(rows) + " :node:" + std::to_string(rng.below(static_cast<uint32_t>(nodes))) +
+               " :node:" + std::to_string(rng.below(static_cast<uint32_t>(nodes))) + ' ' + rels[rng.below(3)] +
+               std::to_string(rng.below(100)) + ' ' + std::to_string(rng.below(1000) / 1000.0) + '\n';
+        ++rows;
+    }
+    return rows;
+}
+
+/** Application log rows, the typical ISONL workload */
+size_t gen_logs(std::string& out, size_t target, Lcg& rng) {
+    const char* const levels[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+    out += "table.logs\nts level service message latency_ms\n";
+    size_t rows = 0;
+    while (out.size() < target) {
+        out += std::to_string(1700000000000ULL + rows * 7) + ' ' + levels[rng.below(4)] + ' ' + word(rng) +
+               "-svc " + sentence(rng, 40) + ' ' + std::to_string(rng.below(5000) / 10.0) + '\n';
+        ++rows;
+    }
+    return rows;
+}
+
+typedef size_t (*Generator)(std::string&, size_t, Lcg&);
+
+struct CorpusKind {
+    const char* name;
+    Generator generate;
+};
+
+const CorpusKind kCorpora[] = {
+    { "users", gen_users },
+    { "wide", gen_wide },
+    { "text", gen_text },
+    { "graph", gen_graph },
+    { "logs", gen_logs },
+};
+
+/** One generated corpus and its derived forms, built on first use */
+struct Corpus {
+    std::string ison;
+    size_t rows = 0;
+    ison::Document doc;
+
+    const std::string& isonl() {
+        if (isonl_.empty()) isonl_ = ison::dumps_isonl(doc);
+        return isonl_;
+    }
+
+    const std::string& segmented() {
+        if (segmented_.empty()) segmented_ = ison::compress_isonl(isonl());
+        return segmented_;
+    }
+
+    const std::string& json() {
+        if (json_.empty()) json_ = doc.to_json(0);
+        return json_;
+    }
+
+private:
+    std::string isonl_;
+    std::string segmented_;
+    std::string json_;
+};
+
+Corpus& corpus(const CorpusKind& kind, size_t bytes) {
+    static std::map<std::string, std::unique_ptr<Corpus> > cache;
+    std::unique_ptr<Corpus>& slot = cache[std::string(kind.name) + '/' + std::to_string(bytes)];
+    if (!slot) {
+        slot.reset(new Corpus());
+        Lcg rng(bytes * 31 + kind.name[0]);
+        slot->ison.reserve(bytes + 4096);
+        slot->rows = kind.generate(slot->ison, bytes, rng);
+        slot->doc = ison::parse(slot->ison);
+    }
+    return *slot;
+}
+
+// =============================================================================
+// Harness
+// =============================================================================
+
+/** Time body() and report bytes/s, rows/s and allocations per row */
+template <typename F>
+void measure(benchmark::State& state, size_t bytes, size_t rows, F body) {
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        uint64_t before = g_allocations.load(std::memory_order_relaxed);
+        body();
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    }
+    double iterations = static_cast<double>(state.iterations());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["rows/s"] = benchmark::Counter(iterations * static_cast<double>(rows),
+                                                  benchmark::Counter::kIsRate);
+    state.counters["allocs/row"] = rows ? static_cast<double>(allocations) / (iterations * rows) : 0.0;
+}
+
+void bench_parse(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    measure(state, c.ison.size(), c.rows, [&] {
+        ison::Document doc = ison::Parser(c.ison.data(), c.ison.size()).parse();
+        benchmark::DoNotOptimize(doc);
+    });
+}
+
+void bench_isonl(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    const std::string& text = c.isonl();
+    measure(state, text.size(), c.rows, [&] {
+        ison::Document doc = ison::ISONLParser().parse_to_document(text.data(), text.size());
+        benchmark::DoNotOptimize(doc);
+    });
+}
+
+void bench_isonl_segmented(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    ison::SegmentedISONL archive(c.segmented());
+    state.counters["ratio"] = static_cast<double>(c.isonl().size()) / static_cast<double>(c.segmented().size());
+    measure(state, c.isonl().size(), c.rows, [&] {
+        ison::Document doc = archive.read_all(1);
+        benchmark::DoNotOptimize(doc);
+    });
+}
+
+// One-byte edit in the middle of the text, applied and undone; rates are relative to the whole document
+void bench_incremental_edit(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    ison::IncrementalDocument doc(c.ison);
+    size_t offset = c.ison.find('\n', c.ison.size() / 2) + 1;
+    bool inserted = false;
+    size_t reparsed = 0;
+    measure(state, c.ison.size(), c.rows, [&] {
+        ison::DocumentDiff diff = inserted ? doc.edit(offset, 1, "") : doc.edit(offset, 0, "9");
+        inserted = !inserted;
+        reparsed += doc.reparsed_bytes();
+        benchmark::DoNotOptimize(diff);
+    });
+    state.counters["reparsed"] = static_cast<double>(reparsed) / static_cast<double>(state.iterations());
+}
+
+// Hands out a string in chunk-sized reads, standing in for a file
+class StringSource : public ison::ChunkSource {
+public:
+    explicit StringSource(const std::string& text) : text_(text), pos_(0) {}
+
+    size_t read(char* buffer, size_t capacity) {
+        size_t n = std::min(capacity, text_.size() - pos_);
+        std::memcpy(buffer, text_.data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+
+private:
+    const std::string& text_;
+    size_t pos_;
+};
+
+// Reads on a background thread while the previous chunks are parsed
+void bench_parse_pipelined(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    measure(state, c.ison.size(), c.rows, [&] {
+        StringSource source(c.ison);
+        ison::ReadAheadSource chunks(source, 256 * 1024);
+        ison::Document doc = ison::Parser::parse_chunks(chunks);
+        benchmark::DoNotOptimize(doc);
+    });
+}
+
+void bench_dumps(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    measure(state, c.ison.size(), c.rows, [&] {
+        std::string out = ison::Serializer::dumps(c.doc, false);
+        benchmark::DoNotOptimize(out);
+    });
+}
+
+void bench_to_json(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    measure(state, c.json().size(), c.rows, [&] {
+        std::string out = c.doc.to_json(0);
+        benchmark::DoNotOptimize(out);
+    });
+}
+
+#ifdef ISON_BENCH_HAVE_JSONCPP
+// Baselines: the same data as compact JSON, through JsonCpp
+
+void bench_jsoncpp_parse(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    const std::string& text = c.json();
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    measure(state, text.size(), c.rows, [&] {
+        Json::Value root;
+        std::string errors;
+        if (!reader->parse(text.data(), text.data() + text.size(), &root, &errors)) {
+            state.SkipWithError(errors.c_str());
+        }
+        benchmark::DoNotOptimize(root);
+    });
+}
+
+void bench_jsoncpp_write(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    Json::Value root;
+    Json::CharReaderBuilder reader_builder;
+    std::unique_ptr<Json::CharReader> reader(reader_builder.newCharReader());
+    reader->parse(c.json().data(), c.json().data() + c.json().size(), &root, NULL);
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    measure(state, c.json().size(), c.rows, [&] {
+        std::string out = Json::writeString(writer, root);
+        benchmark::DoNotOptimize(out);
+    });
+}
+#endif
+
+#ifdef ISON_BENCH_HAVE_ISONANTIC
+// isonantic validation of the users corpus
+
+const isonantic::TableSchema& users_schema() {
+    using namespace isonantic;
+    static const TableSchema schema = table("users")
+        .field("id", integer().required().positive())
+        .field("name", string().min(2).max(64))
+        .field("email", string().email())
+        .field("age", integer().min(0).max(150))
+        .field("score", floating().min(0.0).max(100.0))
+        .field("active", boolean())
+        .field("team", reference());
+    return schema;
+}
+
+isonantic::TableSchema::Document to_isonantic(const ison::Document& doc) {
+    isonantic::TableSchema::Document out;
+    for (size_t b = 0; b < doc.blocks.size(); ++b) {
+        isonantic::TableSchema::Rows& rows = out[doc.blocks[b].name];
+        rows.reserve(doc.blocks[b].rows.size());
+        for (size_t r = 0; r < doc.blocks[b].rows.size(); ++r) {
+            std::map<std::string, isonantic::Value> row;
+            const ison::Row& source = doc.blocks[b].rows[r];
+            for (ison::Row::const_iterator it = source.begin(); it != source.end(); ++it) {
+                row[it->first] = isonantic::detail::from_ison(it->second);
+            }
+            rows.push_back(std::move(row));
+        }
+    }
+    return out;
+}
+
+void bench_validate(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    isonantic::TableSchema::Document doc = to_isonantic(c.doc);
+    measure(state, c.ison.size(), c.rows, [&] {
+        isonantic::ValidatedTable table = users_schema().validate(doc);
+        benchmark::DoNotOptimize(table);
+    });
+}
+
+void bench_validate_document(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    measure(state, c.ison.size(), c.rows, [&] {
+        isonantic::ValidatedTable table = isonantic::validate(users_schema(), c.doc);
+        benchmark::DoNotOptimize(table);
+    });
+}
+
+void bench_check(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    measure(state, c.ison.size(), c.rows, [&] {
+        isonantic::ValidationErrors errors;
+        bool ok = isonantic::check(users_schema(), c.doc, errors);
+        benchmark::DoNotOptimize(ok);
+    });
+}
+
+void bench_parse_validated(benchmark::State& state, const CorpusKind* kind, size_t bytes) {
+    Corpus& c = corpus(*kind, bytes);
+    measure(state, c.ison.size(), c.rows, [&] {
+        isonantic::ValidationErrors errors;
+        ison::Document doc = isonantic::parse_validated(c.ison, users_schema(), errors);
+        benchmark::DoNotOptimize(doc);
+    });
+}
+#endif
+
+// =============================================================================
+// Registration
+// =============================================================================
+
+/** Parse "64K,1M,1G" into byte counts */
+std::vector<size_t> corpus_sizes() {
+    const char* env = std::getenv("ISON_BENCH_SIZES");
+    std::string spec = env && *env ? env : "64K,1M,16M";
+    std::vector<size_t> sizes;
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        if (!item.empty()) {
+            size_t scale = 1;
+            switch (item[item.size() - 1]) {
+                case 'K': case 'k': scale = size_t(1) << 10; break;
+                case 'M': case 'm': scale = size_t(1) << 20; break;
+                case 'G': case 'g': scale = size_t(1) << 30; break;
+                default: break;
+            }
+            size_t value = static_cast<size_t>(std::strtoull(item.c_str(), NULL, 10));
+            if (value) sizes.push_back(value * scale);
+        }
+        start = end + 1;
+    }
+    return sizes;
+}
+
+std::string size_label(size_t bytes) {
+    if (bytes % (size_t(1) << 30) == 0) return std::to_string(bytes >> 30) + "G";
+    if (bytes % (size_t(1) << 20) == 0) return std::to_string(bytes >> 20) + "M";
+    if (bytes % (size_t(1) << 10) == 0) return std::to_string(bytes >> 10) + "K";
+    return std::to_string(bytes);
+}
+
+typedef void (*BenchFn)(benchmark::State&, const CorpusKind*, size_t);
+
+void add(const char* name, BenchFn fn, const CorpusKind& kind, size_t bytes) {
+    std::string label = std::string(name) + '/' + kind.name + '/' + size_label(bytes);
+    benchmark::RegisterBenchmark(label.c_str(), fn, &kind, bytes)->Unit(benchmark::kMillisecond);
+}
+
+void register_benchmarks() {
+    std::vector<size_t> sizes = corpus_sizes();
+    for (size_t s = 0; s < sizes.size(); ++s) {
+        for (size_t k = 0; k < sizeof(kCorpora) / sizeof(kCorpora[0]); ++k) {
+            const CorpusKind& kind = kCorpora[k];
+            add("parse", bench_parse, kind, sizes[s]);
+            add("parse_pipelined", bench_parse_pipelined, kind, sizes[s]);
+            add("isonl", bench_isonl, kind, sizes[s]);
+            add("isonl_segmented", bench_isonl_segmented, kind, sizes[s]);
+            add("incremental_edit", bench_incremental_edit, kind, sizes[s]);
+            add("dumps", bench_dumps, kind, sizes[s]);
+            add("to_json", bench_to_json, kind, sizes[s]);
+#ifdef ISON_BENCH_HAVE_JSONCPP
+            add("jsoncpp_parse", bench_jsoncpp_parse, kind, sizes[s]);
+            add("jsoncpp_write", bench_jsoncpp_write, kind, sizes[s]);
+#endif
+        }
+#ifdef ISON_BENCH_HAVE_ISONANTIC
+        add("validate", bench_validate, kCorpora[0], sizes[s]);
+        add("validate_document", bench_validate_document, kCorpora[0], sizes[s]);
+        add("check", bench_check, kCorpora[0], sizes[s]);
+        add("parse_validated", bench_parse_validated, kCorpora[0], sizes[s]);
+#endif
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    register_benchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
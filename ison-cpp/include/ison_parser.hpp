@@ -18,23 +18,126 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <deque>
+#include <unordered_map>
 #include <memory>
 #include <stdexcept>
 #include <sstream>
 #include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 // C++17 detection
 #if __cplusplus >= 201703L
     #define ISON_HAS_CPP17 1
     #include <optional>
+    #include <string_view>
+    #if defined(__has_include)
+        #if __has_include(<charconv>)
+            #include <charconv>
+        #endif
+    #endif
 #else
     #define ISON_HAS_CPP17 0
 #endif
 
+// Floating-point std::from_chars / std::to_chars (library support lags the C++17 standard)
+#if ISON_HAS_CPP17 && defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    #define ISON_HAS_FROM_CHARS 1
+    #define ISON_HAS_TO_CHARS 1
+#else
+    #define ISON_HAS_FROM_CHARS 0
+    #define ISON_HAS_TO_CHARS 0
+#endif
+
+// Memory-mapped file loading (define ISON_NO_MMAP to always use std::ifstream)
+#if !defined(ISON_NO_MMAP) && defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+        #define ISON_UNDEF_WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+        #define ISON_UNDEF_NOMINMAX
+    #endif
+    #include <windows.h>
+    #ifdef ISON_UNDEF_WIN32_LEAN_AND_MEAN
+        #undef WIN32_LEAN_AND_MEAN
+        #undef ISON_UNDEF_WIN32_LEAN_AND_MEAN
+    #endif
+    #ifdef ISON_UNDEF_NOMINMAX
+        #undef NOMINMAX
+        #undef ISON_UNDEF_NOMINMAX
+    #endif
+    #define ISON_HAS_MMAP 1
+#elif !defined(ISON_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #define ISON_HAS_MMAP 1
+#else
+    #define ISON_HAS_MMAP 0
+#endif
+
+// Flushing written files to stable storage
+#if defined(_WIN32)
+    #include <io.h>
+    #define ISON_HAS_FSYNC 1
+#elif defined(__unix__) || defined(__APPLE__)
+    #include <unistd.h>
+    #define ISON_HAS_FSYNC 1
+#else
+    #define ISON_HAS_FSYNC 0
+#endif
+
+// SIMD line scanning (define ISON_DISABLE_SIMD to always use the scalar scanners)
+#if !defined(ISON_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64) || \
+    (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #include <immintrin.h>
+    #define ISON_SIMD_SSE2 1
+    #define ISON_SIMD_AVX2 1
+    #if defined(__GNUC__) || defined(__clang__)
+        #define ISON_TARGET_AVX2 __attribute__((target("avx2")))
+    #else
+        #define ISON_TARGET_AVX2
+    #endif
+#elif !defined(ISON_DISABLE_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+    #include <arm_neon.h>
+    #define ISON_SIMD_NEON 1
+#endif
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+#ifndef ISON_SIMD_SSE2
+    #define ISON_SIMD_SSE2 0
+#endif
+#ifndef ISON_SIMD_AVX2
+    #define ISON_SIMD_AVX2 0
+#endif
+#ifndef ISON_SIMD_NEON
+    #define ISON_SIMD_NEON 0
+#endif
+
 namespace ison {
 
 // Version info
@@ -84,6 +187,210 @@ static const char* VERSION = "1.0.1";
     static const NoneType None = NoneType();
 #endif
 
+// =============================================================================
+// StringView implementation for C++11/14
+// =============================================================================
+
+#if ISON_HAS_CPP17
+    using StringView = std::string_view;
+#else
+    // Minimal non-owning string view for C++11 (subset of std::string_view)
+    class StringView {
+    public:
+        static const size_t npos = static_cast<size_t>(-1);
+
+        StringView() : data_(""), size_(0) {}
+        StringView(const char* s) : data_(s), size_(std::strlen(s)) {}
+        StringView(const char* s, size_t n) : data_(s), size_(n) {}
+        StringView(const std::string& s) : data_(s.data()), size_(s.size()) {}
+
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+        size_t length() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        const char* begin() const { return data_; }
+        const char* end() const { return data_ + size_; }
+        char operator[](size_t i) const { return data_[i]; }
+        char front() const { return data_[0]; }
+        char back() const { return data_[size_ - 1]; }
+
+        void remove_prefix(size_t n) { data_ += n; size_ -= n; }
+        void remove_suffix(size_t n) { size_ -= n; }
+
+        StringView substr(size_t pos, size_t n = npos) const {
+            if (pos > size_) throw std::out_of_range("StringView::substr");
+            size_t rlen = size_ - pos;
+            return StringView(data_ + pos, n < rlen ? n : rlen);
+        }
+
+        size_t find(char c, size_t pos = 0) const {
+            if (pos >= size_) return npos;
+            const void* p = std::memchr(data_ + pos, c, size_ - pos);
+            return p ? static_cast<size_t>(static_cast<const char*>(p) - data_) : npos;
+        }
+
+        int compare(StringView other) const {
+            size_t n = size_ < other.size_ ? size_ : other.size_;
+            int r = n ? std::memcmp(data_, other.data_, n) : 0;
+            if (r != 0) return r;
+            return size_ < other.size_ ? -1 : (size_ > other.size_ ? 1 : 0);
+        }
+
+    private:
+        const char* data_;
+        size_t size_;
+    };
+
+    inline bool operator==(StringView a, StringView b) {
+        return a.size() == b.size() && (a.size() == 0 || std::memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+    inline bool operator!=(StringView a, StringView b) { return !(a == b); }
+    inline bool operator<(StringView a, StringView b) { return a.compare(b) < 0; }
+
+    inline std::ostream& operator<<(std::ostream& os, StringView sv) {
+        return os.write(sv.data(), static_cast<std::streamsize>(sv.size()));
+    }
+#endif
+
+// =============================================================================
+// Arena Allocation
+// =============================================================================
+
+/**
+ * @brief Monotonic bump allocator that releases all of its memory at once
+ *
+ * Objects made with create() are destroyed in reverse order of creation when
+ * the arena is reset or destroyed. An arena is not thread-safe; parallel
+ * parsers give each worker its own arena and adopt() them into the result's.
+ *
+ * Values stored in an arena pin it with retain()/release(), once per cell
+ * that has any. Arenas shared with values must come from Arena::shared(),
+ * whose handle holds one such pin, so the arena outlives both the handle
+ * and every value inside it.
+ */
+class Arena {
+public:
+    explicit Arena(size_t block_size = 64 * 1024)
+        : block_size_(block_size < 256 ? 256 : block_size), blocks_(NULL), cur_(NULL), end_(NULL),
+          destructors_(NULL), bytes_used_(0), bytes_reserved_(0), refs_(1) {}
+
+    ~Arena() { reset(); }
+
+    static std::shared_ptr<Arena> shared(size_t block_size = 64 * 1024) {
+        return std::shared_ptr<Arena>(new Arena(block_size), &Arena::release_handle);
+    }
+
+    void retain() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        bytes_used_ += size;
+        if (cur_ != NULL) {
+            size_t pad = padding(cur_, align);
+            if (static_cast<size_t>(end_ - cur_) >= pad + size) {
+                char* p = cur_ + pad;
+                cur_ = p + size;
+                return p;
+            }
+        }
+        // Large allocations get a block of their own and leave the current one in use
+        if (size + align > block_size_ / 2) {
+            char* start = push_block(size + align);
+            return start + padding(start, align);
+        }
+        cur_ = push_block(block_size_);
+        end_ = cur_ + block_size_;
+        char* p = cur_ + padding(cur_, align);
+        cur_ = p + size;
+        return p;
+    }
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            Destructor* d = static_cast<Destructor*>(allocate(sizeof(Destructor), alignof(Destructor)));
+            d->destroy = &destroy<T>;
+            d->object = object;
+            d->next = destructors_;
+            destructors_ = d;
+        }
+        return object;
+    }
+
+    /**
+     * @brief Keep another arena alive for as long as this one
+     */
+    void adopt(const std::shared_ptr<Arena>& other) {
+        if (other && other.get() != this) adopted_.push_back(other);
+    }
+
+    /**
+     * @brief Destroy all objects and free all blocks
+     */
+    void reset() {
+        for (Destructor* d = destructors_; d != NULL; d = d->next) d->destroy(d->object);
+        destructors_ = NULL;
+        while (blocks_ != NULL) {
+            BlockHeader* next = blocks_->next;
+            ::operator delete(blocks_);
+            blocks_ = next;
+        }
+        cur_ = end_ = NULL;
+        bytes_used_ = bytes_reserved_ = 0;
+        adopted_.clear();
+    }
+
+    size_t bytes_used() const { return bytes_used_; }
+    size_t bytes_reserved() const { return bytes_reserved_; }
+
+private:
+    struct BlockHeader {
+        BlockHeader* next;
+    };
+
+    struct Destructor {
+        void (*destroy)(void*);
+        void* object;
+        Destructor* next;
+    };
+
+    size_t block_size_;
+    BlockHeader* blocks_;
+    char* cur_;
+    char* end_;
+    Destructor* destructors_;
+    size_t bytes_used_;
+    size_t bytes_reserved_;
+    std::vector<std::shared_ptr<Arena> > adopted_;
+    std::atomic<long> refs_;
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    static void release_handle(Arena* arena) { arena->release(); }
+
+    template<typename T>
+    static void destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+    static size_t padding(const char* p, size_t align) {
+        return (align - reinterpret_cast<uintptr_t>(p) % align) % align;
+    }
+
+    char* push_block(size_t payload) {
+        const size_t header = (sizeof(BlockHeader) + alignof(std::max_align_t) - 1) &
+                              ~(alignof(std::max_align_t) - 1);
+        BlockHeader* block = static_cast<BlockHeader*>(::operator new(header + payload));
+        block->next = blocks_;
+        blocks_ = block;
+        bytes_reserved_ += header + payload;
+        return reinterpret_cast<char*>(block) + header;
+    }
+};
+
 // =============================================================================
 // Value Type (tagged union for C++11 compatibility)
 // =============================================================================
@@ -91,6 +398,7 @@ static const char* VERSION = "1.0.1";
 // Forward declarations
 class Reference;
 class Value;
+class InternPool;
 
 /**
  * @brief Value type enumeration
@@ -104,17 +412,75 @@ enum class ValueType {
     Reference
 };
 
+namespace detail {
+
+/**
+ * @brief Shared, immutable payload of a string or reference Value
+ *
+ * Every cell counts the Values that point to it. Heap cells start with the
+ * one reference of the Value made with them and are deleted with the last.
+ * Arena cells are owned by their arena and start with none: the first
+ * reference pins the arena and the last unpins it, so the arena lives as
+ * long as any value that points into it, and copying a value only touches
+ * its own cell.
+ */
+struct ValueCell {
+    std::atomic<int32_t> refs;
+    Arena* arena;
+
+    explicit ValueCell(Arena* arena) : refs(arena ? 0 : 1), arena(arena) {}
+
+    /** Count a reference to an arena cell, pinning the arena on the first */
+    void retain_arena() {
+        if (refs.fetch_add(1, std::memory_order_relaxed) == 0) arena->retain();
+    }
+
+    /** Drop a reference to an arena cell, unpinning the arena on the last */
+    void release_arena() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) arena->release();
+    }
+};
+
+struct StringCell : ValueCell {
+    std::string value;
+
+    StringCell(Arena* arena, std::string&& value) : ValueCell(arena), value(std::move(value)) {}
+};
+
+struct ReferenceCell : ValueCell {
+    const Reference* ref;
+    std::shared_ptr<Reference> owner;   // empty for arena cells
+
+    ReferenceCell(Arena* arena, const Reference* ref) : ValueCell(arena), ref(ref) {}
+    explicit ReferenceCell(const std::shared_ptr<Reference>& owner)
+        : ValueCell(NULL), ref(owner.get()), owner(owner) {}
+};
+
+// Keeps an arena cell, and with it its arena, alive for a shared_ptr handed out by as_reference_ptr()
+struct ArenaPin {
+    ValueCell* cell;
+    void operator()(const Reference*) const { cell->release_arena(); }
+};
+
+struct ValueFactory;
+
+} // namespace detail
+
 /**
- * @brief Represents any ISON value using tagged union
+ * @brief Represents any ISON value using a 16-byte tagged union
+ *
+ * Null, bool, int and float values are stored inline. Strings and
+ * references point to a shared, reference-counted cell, so copying a Value
+ * never copies its text.
  */
 class Value {
 public:
-    Value() : type_(ValueType::Null) {}
+    Value() : type_(ValueType::Null) { data_.int_val = 0; }
 
     // Constructors for each type
-    Value(std::nullptr_t) : type_(ValueType::Null) {}
+    Value(std::nullptr_t) : type_(ValueType::Null) { data_.int_val = 0; }
 
-    Value(bool b) : type_(ValueType::Bool) { data_.bool_val = b; }
+    Value(bool b) : type_(ValueType::Bool) { data_.int_val = 0; data_.bool_val = b; }
 
     Value(int i) : type_(ValueType::Int) { data_.int_val = static_cast<int64_t>(i); }
     Value(long i) : type_(ValueType::Int) { data_.int_val = static_cast<int64_t>(i); }
@@ -123,41 +489,48 @@ public:
     Value(float f) : type_(ValueType::Float) { data_.float_val = static_cast<double>(f); }
     Value(double f) : type_(ValueType::Float) { data_.float_val = f; }
 
-    Value(const char* s) : type_(ValueType::String), str_val_(s) {}
-    Value(const std::string& s) : type_(ValueType::String), str_val_(s) {}
-    Value(std::string&& s) : type_(ValueType::String), str_val_(std::move(s)) {}
+    Value(const char* s) : type_(ValueType::String) { data_.cell = new detail::StringCell(NULL, std::string(s)); }
+    Value(const std::string& s) : type_(ValueType::String) { data_.cell = new detail::StringCell(NULL, std::string(s)); }
+    Value(std::string&& s) : type_(ValueType::String) { data_.cell = new detail::StringCell(NULL, std::move(s)); }
 
-    Value(const std::shared_ptr<Reference>& r) : type_(ValueType::Reference), ref_val_(r) {}
-    Value(std::shared_ptr<Reference>&& r) : type_(ValueType::Reference), ref_val_(std::move(r)) {}
+    Value(const std::shared_ptr<Reference>& r) : type_(ValueType::Reference) {
+        data_.cell = new detail::ReferenceCell(r);
+    }
 
     // Copy and move
-    Value(const Value& other) : type_(other.type_), data_(other.data_),
-                                 str_val_(other.str_val_), ref_val_(other.ref_val_) {}
+    Value(const Value& other) : type_(other.type_), data_(other.data_) { retain(); }
 
-    Value(Value&& other) : type_(other.type_), data_(other.data_),
-                           str_val_(std::move(other.str_val_)),
-                           ref_val_(std::move(other.ref_val_)) {}
+    Value(Value&& other) noexcept : type_(other.type_), data_(other.data_) {
+        other.type_ = ValueType::Null;
+        other.data_.int_val = 0;
+    }
 
     Value& operator=(const Value& other) {
         if (this != &other) {
-            type_ = other.type_;
-            data_ = other.data_;
-            str_val_ = other.str_val_;
-            ref_val_ = other.ref_val_;
+            Value copy(other);
+            swap(copy);
         }
         return *this;
     }
 
-    Value& operator=(Value&& other) {
+    Value& operator=(Value&& other) noexcept {
         if (this != &other) {
+            release();
             type_ = other.type_;
             data_ = other.data_;
-            str_val_ = std::move(other.str_val_);
-            ref_val_ = std::move(other.ref_val_);
+            other.type_ = ValueType::Null;
+            other.data_.int_val = 0;
         }
         return *this;
     }
 
+    ~Value() { release(); }
+
+    void swap(Value& other) noexcept {
+        std::swap(type_, other.type_);
+        std::swap(data_, other.data_);
+    }
+
     // Type checking
     ValueType type() const { return type_; }
     bool is_null() const { return type_ == ValueType::Null; }
@@ -185,26 +558,75 @@ public:
 
     const std::string& as_string() const {
         if (type_ != ValueType::String) throw std::runtime_error("Value is not a string");
-        return str_val_;
+        return static_cast<const detail::StringCell*>(data_.cell)->value;
     }
 
-    const std::shared_ptr<Reference>& as_reference_ptr() const {
-        if (type_ != ValueType::Reference) throw std::runtime_error("Value is not a reference");
-        return ref_val_;
+    std::shared_ptr<Reference> as_reference_ptr() const {
+        const detail::ReferenceCell* cell = reference_cell();
+        if (!cell->arena) return cell->owner;
+        data_.cell->retain_arena();
+        detail::ArenaPin pin = { data_.cell };
+        return std::shared_ptr<Reference>(const_cast<Reference*>(cell->ref), pin);
     }
 
+    /**
+     * @brief The referenced record, or NULL for a null reference pointer
+     *
+     * Unlike as_reference_ptr() this does not share ownership; the pointer
+     * is valid while this Value (or a copy of it) is alive.
+     */
+    const Reference* get_reference() const { return reference_cell()->ref; }
+
 private:
+    friend struct detail::ValueFactory;
+
     ValueType type_;
     union Data {
         bool bool_val;
         int64_t int_val;
         double float_val;
-        Data() : int_val(0) {}
+        detail::ValueCell* cell;
     } data_;
-    std::string str_val_;
-    std::shared_ptr<Reference> ref_val_;
+
+    // Adopts a heap cell created with a reference count of one, or references an arena cell
+    Value(ValueType type, detail::ValueCell* cell) : type_(type) {
+        data_.cell = cell;
+        if (cell->arena) cell->retain_arena();
+    }
+
+    bool has_cell() const { return type_ == ValueType::String || type_ == ValueType::Reference; }
+
+    const detail::ReferenceCell* reference_cell() const {
+        if (type_ != ValueType::Reference) throw std::runtime_error("Value is not a reference");
+        return static_cast<const detail::ReferenceCell*>(data_.cell);
+    }
+
+    void retain() {
+        if (!has_cell()) return;
+        if (data_.cell->arena) {
+            data_.cell->retain_arena();
+        } else {
+            data_.cell->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void release() {
+        if (!has_cell()) return;
+        detail::ValueCell* cell = data_.cell;
+        if (cell->arena) {
+            cell->release_arena();
+        } else if (cell->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (type_ == ValueType::String) {
+                delete static_cast<detail::StringCell*>(cell);
+            } else {
+                delete static_cast<detail::ReferenceCell*>(cell);
+            }
+        }
+    }
 };
 
+static_assert(sizeof(Value) <= 16, "Value should stay within 16 bytes");
+
 // =============================================================================
 // Exceptions
 // =============================================================================
@@ -233,6 +655,94 @@ public:
 // Reference Class
 // =============================================================================
 
+namespace detail {
+
+// Relationship types are upper case: MEMBER_OF, REPORTS_TO
+inline bool is_relationship_name(StringView type) {
+    for (size_t i = 0; i < type.size(); ++i) {
+        char c = type[i];
+        if ((c < 'A' || c > 'Z') && c != '_') return false;
+    }
+    return !type.empty();
+}
+
+} // namespace detail
+
+/**
+ * @brief The type of a Reference ("user", "MEMBER_OF"), or none
+ *
+ * Reads like an Optional<std::string>. Whether the type names a
+ * relationship is decided once, when it is set. A type usually keeps its
+ * own copy of the text; an interned one (InternPool::reference_type())
+ * points to text shared by every reference of that type.
+ */
+class ReferenceType {
+public:
+    ReferenceType() : state_(NONE), relationship_(false) {}
+
+    ReferenceType(const std::string& text)
+        : text_(text), state_(OWNED), relationship_(detail::is_relationship_name(text_)) {}
+
+    ReferenceType(std::string&& text)
+        : text_(std::move(text)), state_(OWNED), relationship_(detail::is_relationship_name(text_)) {}
+
+    ReferenceType(const char* text)
+        : text_(text), state_(OWNED), relationship_(detail::is_relationship_name(text_)) {}
+
+    ReferenceType(const Optional<std::string>& text) : state_(NONE), relationship_(false) {
+        if (text.has_value()) *this = ReferenceType(text.value());
+    }
+
+    /** @brief A type whose text is shared with other references */
+    static ReferenceType shared(StringView text) {
+        ReferenceType type;
+        type.shared_ = std::make_shared<const std::string>(text.data(), text.size());
+        type.state_ = SHARED;
+        type.relationship_ = detail::is_relationship_name(text);
+        return type;
+    }
+
+    bool has_value() const { return state_ != NONE; }
+    explicit operator bool() const { return has_value(); }
+
+    const std::string& value() const {
+        if (state_ == NONE) throw std::runtime_error("Optional has no value");
+        return state_ == SHARED ? *shared_ : text_;
+    }
+
+    const std::string& operator*() const { return value(); }
+    const std::string* operator->() const { return &value(); }
+
+    std::string value_or(const std::string& default_value) const {
+        return has_value() ? value() : default_value;
+    }
+
+    void reset() {
+        text_.clear();
+        shared_.reset();
+        state_ = NONE;
+        relationship_ = false;
+    }
+
+    bool is_relationship() const { return relationship_; }
+
+    /** @brief True when this type's text is shared (interned) */
+    bool is_shared() const { return state_ == SHARED; }
+
+    bool operator==(const ReferenceType& other) const {
+        return has_value() == other.has_value() && (!has_value() || value() == other.value());
+    }
+    bool operator!=(const ReferenceType& other) const { return !(*this == other); }
+
+private:
+    enum State { NONE, OWNED, SHARED };
+
+    std::string text_;
+    std::shared_ptr<const std::string> shared_;
+    State state_;
+    bool relationship_;
+};
+
 /**
  * @brief Represents a reference to another record
  *
@@ -244,11 +754,11 @@ public:
 class Reference {
 public:
     std::string id;
-    Optional<std::string> type;
+    ReferenceType type;
 
     Reference() {}
     explicit Reference(const std::string& id) : id(id) {}
-    Reference(const std::string& id, const std::string& type) : id(id), type(type) {}
+    Reference(const std::string& id, const ReferenceType& type) : id(id), type(type) {}
 
     std::string to_ison() const {
         if (type.has_value()) {
@@ -257,33 +767,24 @@ public:
         return ":" + id;
     }
 
-    bool is_relationship() const {
-        if (!type.has_value()) return false;
-        const std::string& t = type.value();
-        for (size_t i = 0; i < t.size(); ++i) {
-            if (!std::isupper(static_cast<unsigned char>(t[i])) && t[i] != '_') {
-                return false;
-            }
-        }
-        return !t.empty();
-    }
+    bool is_relationship() const { return type.is_relationship(); }
 
     Optional<std::string> relationship_type() const {
-        if (is_relationship()) return type;
+        if (is_relationship()) return type.value();
         return Optional<std::string>();
     }
 
     Optional<std::string> get_namespace() const {
-        if (type.has_value() && !is_relationship()) return type;
+        if (type.has_value() && !is_relationship()) return type.value();
         return Optional<std::string>();
     }
 };
 
 // Reference accessor for Value
 inline const Reference& as_reference(const Value& v) {
-    auto ptr = v.as_reference_ptr();
-    if (!ptr) throw ISONTypeError("Reference is null");
-    return *ptr;
+    const Reference* ref = v.get_reference();
+    if (!ref) throw ISONTypeError("Reference is null");
+    return *ref;
 }
 
 // =============================================================================
@@ -301,18 +802,18 @@ public:
     FieldInfo(const std::string& name, const std::string& type)
         : name(name), type(type), is_computed(type == "computed") {}
 
-    static FieldInfo parse(const std::string& field_str) {
+    static FieldInfo parse(StringView field_str) {
         size_t colon_pos = field_str.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string name = field_str.substr(0, colon_pos);
-            std::string type_hint = field_str.substr(colon_pos + 1);
+        if (colon_pos != StringView::npos) {
+            std::string name(field_str.data(), colon_pos);
+            std::string type_hint(field_str.data() + colon_pos + 1, field_str.size() - colon_pos - 1);
             // Convert to lowercase
             for (size_t i = 0; i < type_hint.size(); ++i) {
                 type_hint[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(type_hint[i])));
             }
             return FieldInfo(name, type_hint);
         }
-        return FieldInfo(field_str);
+        return FieldInfo(std::string(field_str.data(), field_str.size()));
     }
 };
 
@@ -322,6 +823,112 @@ public:
 
 typedef std::map<std::string, Value> Row;
 
+// =============================================================================
+// Name Index
+// =============================================================================
+
+namespace detail {
+
+struct SelfName {
+    const std::string& operator()(const std::string& s) const { return s; }
+};
+
+struct MemberName {
+    template<typename T>
+    const std::string& operator()(const T& item) const { return item.name; }
+};
+
+struct PointeeName {
+    template<typename P>
+    const std::string& operator()(const P& item) const { return item->name; }
+};
+
+struct StringViewHash {
+    size_t operator()(StringView s) const {
+        uint64_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < s.size(); ++i) {
+            h ^= static_cast<unsigned char>(s[i]);
+            h *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+/**
+ * @brief Hash index from name to position over a vector the owner exposes
+ *
+ * The first element with a name wins, as with a linear scan. The index is
+ * only a fast path: a hit is used when the element there still has the
+ * name, and a miss, a stale hit or a change in the vector's size falls
+ * back to a scan, so direct edits to the vector never hide an element.
+ * Lookups of absent names scan; reindex after bulk edits to keep present
+ * names on the fast path. Names are hashed in place, without building a
+ * key string.
+ */
+class NameIndex {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    NameIndex() : size_(0), duplicates_(false) {}
+
+    template<typename Vec, typename NameOf>
+    void rebuild(const Vec& items, NameOf name_of) {
+        map_.clear();
+        map_.reserve(items.size());
+        duplicates_ = false;
+        size_ = 0;
+        for (size_t i = 0; i < items.size(); ++i) add(items, name_of, i);
+    }
+
+    // Record the element just appended to items
+    template<typename Vec, typename NameOf>
+    void appended(const Vec& items, NameOf name_of) {
+        if (size_ + 1 != items.size()) {
+            rebuild(items, name_of);
+            return;
+        }
+        add(items, name_of, size_);
+    }
+
+    template<typename Vec, typename NameOf, typename Name>
+    size_t find(const Vec& items, NameOf name_of, const Name& name) const {
+        // With repeated names an edit can move a later duplicate into an
+        // indexed slot, so only a scan finds the first one reliably
+        if (size_ == items.size() && size_ > 0 && !duplicates_) {
+            std::pair<Map::const_iterator, Map::const_iterator> range =
+                map_.equal_range(StringViewHash()(StringView(name.data(), name.size())));
+            for (; range.first != range.second; ++range.first) {
+                if (name_of(items[range.first->second]) == name) return range.first->second;
+            }
+        }
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (name_of(items[i]) == name) return i;
+        }
+        return npos;
+    }
+
+private:
+    typedef std::unordered_multimap<size_t, size_t> Map;
+
+    template<typename Vec, typename NameOf>
+    void add(const Vec& items, NameOf name_of, size_t index) {
+        const std::string& name = name_of(items[index]);
+        size_t hash = StringViewHash()(StringView(name.data(), name.size()));
+        std::pair<Map::const_iterator, Map::const_iterator> range = map_.equal_range(hash);
+        for (; range.first != range.second; ++range.first) {
+            if (name_of(items[range.first->second]) == name) duplicates_ = true;
+        }
+        map_.insert(std::make_pair(hash, index));
+        size_ = index + 1;
+    }
+
+    Map map_;
+    size_t size_;
+    bool duplicates_;
+};
+
+} // namespace detail
+
 // =============================================================================
 // Block Class
 // =============================================================================
@@ -338,8 +945,39 @@ public:
     Block() {}
     Block(const std::string& kind, const std::string& name) : kind(kind), name(name) {}
 
+    static const size_t npos = static_cast<size_t>(-1);
+
+    /**
+     * @brief Position of a field in fields, or npos
+     *
+     * Hash lookup once the field list is indexed (parsers do this); call
+     * reindex_fields() after editing fields in place.
+     */
+    size_t field_index(const std::string& field_name) const {
+        return field_index_.find(fields, detail::SelfName(), field_name);
+    }
+
+    void reindex_fields() { field_index_.rebuild(fields, detail::SelfName()); }
+
+    /**
+     * @brief Value of a field in a row by position from field_index()
+     *
+     * Resolving the position once skips the field-name search on every row;
+     * the Row map lookup itself remains. Missing values read as null.
+     */
+    const Value& get(size_t row, size_t field) const {
+        static const Value null_value;
+        const Row& r = rows[row];
+        Row::const_iterator it = r.find(fields[field]);
+        return it != r.end() ? it->second : null_value;
+    }
+
     Optional<std::string> get_field_type(const std::string& field_name) const {
-        for (size_t i = 0; i < field_info.size(); ++i) {
+        size_t i = field_index(field_name);
+        if (i != npos && i < field_info.size() && field_info[i].name == field_name) {
+            return field_info[i].type;
+        }
+        for (i = 0; i < field_info.size(); ++i) {
             if (field_info[i].name == field_name) {
                 return field_info[i].type;
             }
@@ -360,6 +998,9 @@ public:
     size_t size() const { return rows.size(); }
     Row& operator[](size_t index) { return rows[index]; }
     const Row& operator[](size_t index) const { return rows[index]; }
+
+private:
+    detail::NameIndex field_index_;
 };
 
 // =============================================================================
@@ -370,20 +1011,45 @@ class Document {
 public:
     std::vector<Block> blocks;
 
+    /** Arena holding the parsed strings and references when ParseOptions::use_arena is set */
+    std::shared_ptr<Arena> arena;
+
+    /** Pool the document's short strings and references were interned in, if any */
+    std::shared_ptr<InternPool> intern_pool;
+
     Document() {}
 
+    /**
+     * @brief Block lookup by name (hash index, see reindex())
+     */
     Block* get(const std::string& name) {
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            if (blocks[i].name == name) return &blocks[i];
-        }
-        return NULL;
+        size_t i = index_.find(blocks, detail::MemberName(), name);
+        return i != detail::NameIndex::npos ? &blocks[i] : NULL;
     }
 
     const Block* get(const std::string& name) const {
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            if (blocks[i].name == name) return &blocks[i];
-        }
-        return NULL;
+        size_t i = index_.find(blocks, detail::MemberName(), name);
+        return i != detail::NameIndex::npos ? &blocks[i] : NULL;
+    }
+
+    /**
+     * @brief Append a block and keep the name index current
+     */
+    Block& add_block(const Block& block) {
+        blocks.push_back(block);
+        index_.appended(blocks, detail::MemberName());
+        return blocks.back();
+    }
+
+    /**
+     * @brief Rebuild the name index after editing blocks directly
+     *
+     * Lookups stay correct without it when blocks are only appended or
+     * removed (they fall back to a scan); renaming blocks in place needs it.
+     */
+    void reindex() {
+        index_.rebuild(blocks, detail::MemberName());
+        for (size_t i = 0; i < blocks.size(); ++i) blocks[i].reindex_fields();
     }
 
     Block& operator[](const std::string& name) {
@@ -402,820 +1068,7827 @@ public:
     size_t size() const { return blocks.size(); }
 
     std::string to_json(int indent = 2) const;
+
+private:
+    detail::NameIndex index_;
 };
 
 // =============================================================================
-// Tokenizer
+// Reference Index
 // =============================================================================
 
-class Tokenizer {
-public:
-    Tokenizer(const std::string& line, int line_num = 0)
-        : line_(line), line_num_(line_num), pos_(0) {}
+/**
+ * @brief A row of a Document block, or nothing (found() == false)
+ */
+struct RowRef {
+    const Block* block;
+    size_t row;
 
-    std::vector<std::string> tokenize() {
-        std::vector<std::string> tokens;
-        pos_ = 0;
+    RowRef() : block(NULL), row(0) {}
+    RowRef(const Block* block, size_t row) : block(block), row(row) {}
 
-        while (pos_ < line_.size()) {
-            skip_whitespace();
-            if (pos_ >= line_.size()) break;
+    bool found() const { return block != NULL; }
+    const Row& get() const { return block->rows[row]; }
+};
 
-            if (line_[pos_] == '"') {
-                tokens.push_back(read_quoted_string());
-            } else {
-                tokens.push_back(read_unquoted_token());
+/**
+ * @brief A relationship-typed reference held by a row, and the row it points at
+ */
+struct Relationship {
+    const std::string* field;
+    const Reference* ref;
+    RowRef target;
+};
+
+/**
+ * @brief Resolves references to the rows they point at
+ *
+ * Rows are keyed by a key column ("id" unless set_key_field() says
+ * otherwise); int and string keys both match the reference id. A
+ * namespaced reference such as :user:101 looks in the block the namespace
+ * maps to: an explicit map_namespace(), else the block named like the
+ * namespace or its plural ("users"). References without a known namespace,
+ * including relationships like :MEMBER_OF:10, try every block in document
+ * order.
+ *
+ * Each block's keys are indexed on first use (or all at once by build()).
+ * Configure the index before sharing it; resolving is thread-safe. The
+ * Document must outlive the index and not change while it is in use.
+ */
+class ReferenceIndex {
+public:
+    explicit ReferenceIndex(const Document& doc, const std::string& key_field = "id")
+        : doc_(&doc) {
+        for (size_t i = 0; i < doc.blocks.size(); ++i) {
+            keys_.push_back(std::unique_ptr<BlockKeys>(new BlockKeys(key_field)));
+            const std::string& name = doc.blocks[i].name;
+            namespaces_.insert(std::make_pair(name, i));
+        }
+        // Plural block names also answer to the singular namespace
+        for (size_t i = 0; i < doc.blocks.size(); ++i) {
+            const std::string& name = doc.blocks[i].name;
+            if (name.size() > 1 && name[name.size() - 1] == 's') {
+                namespaces_.insert(std::make_pair(name.substr(0, name.size() - 1), i));
             }
         }
-        return tokens;
     }
 
-private:
-    std::string line_;
-    int line_num_;
-    size_t pos_;
+    void set_key_field(const std::string& block, const std::string& field) {
+        for (size_t i = 0; i < doc_->blocks.size(); ++i) {
+            if (doc_->blocks[i].name == block) keys_[i].reset(new BlockKeys(field));
+        }
+    }
 
-    void skip_whitespace() {
-        while (pos_ < line_.size() && (line_[pos_] == ' ' || line_[pos_] == '\t')) {
-            ++pos_;
+    void map_namespace(const std::string& ns, const std::string& block) {
+        for (size_t i = 0; i < doc_->blocks.size(); ++i) {
+            if (doc_->blocks[i].name == block) {
+                namespaces_[ns] = i;
+                return;
+            }
         }
+        throw ISONError("Block not found: " + block);
     }
 
-    std::string read_quoted_string() {
-        size_t start_pos = pos_;
-        ++pos_;
-        std::string result;
+    /**
+     * @brief Index every block now instead of on first use
+     */
+    void build() {
+        for (size_t i = 0; i < keys_.size(); ++i) keys(i);
+    }
 
-        while (pos_ < line_.size()) {
-            char c = line_[pos_];
+    RowRef resolve(const Reference& ref) const {
+        if (ref.type.has_value()) {
+            std::unordered_map<std::string, size_t>::const_iterator ns = namespaces_.find(ref.type.value());
+            if (ns != namespaces_.end()) return find(ns->second, ref.id);
+        }
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            RowRef row = find(i, ref.id);
+            if (row.found()) return row;
+        }
+        return RowRef();
+    }
 
-            if (c == '"') {
-                ++pos_;
-                return result;
-            }
+    /**
+     * @brief Resolve a reference Value; other values resolve to nothing
+     */
+    RowRef resolve(const Value& value) const {
+        if (!value.is_reference() || !value.get_reference()) return RowRef();
+        return resolve(*value.get_reference());
+    }
 
-            if (c == '\\') {
-                ++pos_;
-                if (pos_ >= line_.size()) {
-                    throw ISONSyntaxError("Unexpected end of line after backslash", line_num_, static_cast<int>(pos_));
-                }
-                char escape_char = line_[pos_];
-                switch (escape_char) {
-                    case '"': result += '"'; break;
-                    case '\\': result += '\\'; break;
-                    case 'n': result += '\n'; break;
-                    case 't': result += '\t'; break;
-                    case 'r': result += '\r'; break;
-                    default: result += escape_char; break;
-                }
-            } else {
-                result += c;
+    /**
+     * @brief Row of a block by key, e.g. find("users", "101")
+     */
+    RowRef find(const std::string& block, const std::string& key) const {
+        for (size_t i = 0; i < doc_->blocks.size(); ++i) {
+            if (doc_->blocks[i].name == block) return find(i, key);
+        }
+        return RowRef();
+    }
+
+    /**
+     * @brief Call fn(const Relationship&) for each relationship-typed reference in a row
+     *
+     * With a non-empty type only relationships of that type (e.g. "MEMBER_OF")
+     * are visited. Targets that do not resolve have target.found() == false.
+     */
+    template<typename F>
+    void for_each_relationship(const RowRef& source, F fn, const std::string& type = std::string()) const {
+        if (!source.found()) return;
+        const Row& row = source.get();
+        for (Row::const_iterator it = row.begin(); it != row.end(); ++it) {
+            if (!it->second.is_reference()) continue;
+            const Reference* ref = it->second.get_reference();
+            if (!ref || !ref->is_relationship()) continue;
+            if (!type.empty() && ref->type.value() != type) continue;
+            Relationship rel = { &it->first, ref, resolve(*ref) };
+            fn(rel);
+        }
+    }
+
+    std::vector<Relationship> relationships(const RowRef& source, const std::string& type = std::string()) const {
+        std::vector<Relationship> result;
+        Collect collect = { &result };
+        for_each_relationship(source, collect, type);
+        return result;
+    }
+
+private:
+    struct BlockKeys {
+        std::string field;
+        std::atomic<bool> built;
+        std::unordered_map<std::string, size_t> rows;
+
+        explicit BlockKeys(const std::string& field) : field(field), built(false) {}
+    };
+
+    struct Collect {
+        std::vector<Relationship>* out;
+        void operator()(const Relationship& rel) const { out->push_back(rel); }
+    };
+
+    const Document* doc_;
+    std::vector<std::unique_ptr<BlockKeys> > keys_;
+    std::unordered_map<std::string, size_t> namespaces_;
+    mutable std::mutex build_mutex_;
+
+    RowRef find(size_t block, const std::string& key) const {
+        const BlockKeys& k = keys(block);
+        std::unordered_map<std::string, size_t>::const_iterator it = k.rows.find(key);
+        if (it == k.rows.end()) return RowRef();
+        return RowRef(&doc_->blocks[block], it->second);
+    }
+
+    const BlockKeys& keys(size_t block) const {
+        BlockKeys& k = *keys_[block];
+        if (k.built.load(std::memory_order_acquire)) return k;
+
+        std::lock_guard<std::mutex> lock(build_mutex_);
+        if (k.built.load(std::memory_order_relaxed)) return k;
+        const Block& b = doc_->blocks[block];
+        k.rows.reserve(b.rows.size());
+        size_t field = b.field_index(k.field);
+        if (field != Block::npos) {
+            std::string key;
+            for (size_t r = 0; r < b.rows.size(); ++r) {
+                if (key_text(b.get(r, field), key)) k.rows.insert(std::make_pair(key, r));
             }
-            ++pos_;
         }
-        throw ISONSyntaxError("Unterminated quoted string", line_num_, static_cast<int>(start_pos));
+        k.built.store(true, std::memory_order_release);
+        return k;
     }
 
-    std::string read_unquoted_token() {
-        size_t start = pos_;
-        while (pos_ < line_.size() && line_[pos_] != ' ' && line_[pos_] != '\t') {
-            ++pos_;
+    static bool key_text(const Value& v, std::string& out) {
+        if (v.is_string()) {
+            out = v.as_string();
+            return true;
         }
-        return line_.substr(start, pos_ - start);
+        if (v.is_int()) {
+            out = std::to_string(v.as_int());
+            return true;
+        }
+        return false;
     }
 };
 
 // =============================================================================
-// Type Inferrer
+// Columnar Storage
 // =============================================================================
 
-class TypeInferrer {
+/**
+ * @brief Physical storage type of a Column
+ *
+ * A column keeps the type of its first non-null value. Null cells never
+ * change the type; a cell of any other type turns the column into Mixed,
+ * which falls back to one Value per row.
+ */
+enum class ColumnType {
+    Null,
+    Bool,
+    Int,
+    Float,
+    String,
+    Reference,
+    Mixed
+};
+
+namespace detail {
+struct ColumnCodec;
+}
+
+/**
+ * @brief A single column of a ColumnarBlock
+ *
+ * Values live in one contiguous vector for the column type, strings and
+ * reference ids share one character buffer addressed by offsets, and nulls
+ * are tracked in a bitmap. Null cells still occupy a (default) slot so every
+ * row is addressed directly by index.
+ */
+class Column {
 public:
-    static Value infer(const std::string& token, bool was_quoted = false) {
-        if (was_quoted) {
-            return Value(token);
-        }
+    Column() : type_(ColumnType::Null), size_(0) {}
 
-        if (token == "true") return Value(true);
-        if (token == "false") return Value(false);
-        if (token == "null" || token == "~") return Value(nullptr);
+    ColumnType type() const { return type_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
 
-        if (is_integer(token)) {
-            return Value(static_cast<int64_t>(std::stoll(token)));
-        }
+    bool is_null(size_t row) const {
+        return ((nulls_[row >> 6] >> (row & 63)) & 1) != 0;
+    }
 
-        if (is_float(token)) {
-            return Value(std::stod(token));
+    size_t null_count() const {
+        size_t count = 0;
+        for (size_t i = 0; i < size_; ++i) {
+            if (is_null(i)) ++count;
         }
+        return count;
+    }
 
-        if (token.size() > 1 && token[0] == ':') {
-            std::string ref_value = token.substr(1);
-            size_t colon_pos = ref_value.find(':');
-            if (colon_pos != std::string::npos) {
-                std::string type = ref_value.substr(0, colon_pos);
-                std::string id = ref_value.substr(colon_pos + 1);
-                return Value(std::make_shared<Reference>(id, type));
-            }
-            return Value(std::make_shared<Reference>(ref_value));
-        }
+    // Typed access (null cells read as 0 / false / empty)
+    bool bool_at(size_t row) const {
+        if (type_ == ColumnType::Mixed) return mixed_[row].as_bool();
+        expect(ColumnType::Bool);
+        return bools_[row] != 0;
+    }
 
-        return Value(token);
+    int64_t int_at(size_t row) const {
+        if (type_ == ColumnType::Mixed) return mixed_[row].as_int();
+        expect(ColumnType::Int);
+        return ints_[row];
     }
 
-private:
-    static bool is_integer(const std::string& s) {
-        if (s.empty()) return false;
-        size_t start = (s[0] == '-') ? 1 : 0;
-        if (start == s.size()) return false;
-        for (size_t i = start; i < s.size(); ++i) {
-            if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
+    double float_at(size_t row) const {
+        if (type_ == ColumnType::Mixed) return mixed_[row].as_float();
+        expect(ColumnType::Float);
+        return floats_[row];
+    }
+
+    /** View into the column buffer; invalidated when the column grows */
+    StringView string_at(size_t row) const {
+        if (type_ == ColumnType::Mixed) return StringView(mixed_[row].as_string());
+        expect(ColumnType::String);
+        return text_at(row);
+    }
+
+    StringView reference_id_at(size_t row) const {
+        if (type_ == ColumnType::Mixed) return StringView(as_reference(mixed_[row]).id);
+        expect(ColumnType::Reference);
+        return text_at(row);
+    }
+
+    /** Reference namespace / relationship type, NULL when the reference has none */
+    const std::string* reference_type_at(size_t row) const {
+        if (type_ == ColumnType::Mixed) {
+            const Reference& ref = as_reference(mixed_[row]);
+            return ref.type.has_value() ? &ref.type.value() : NULL;
         }
-        return true;
+        expect(ColumnType::Reference);
+        int32_t t = ref_types_[row];
+        return t < 0 ? NULL : &ref_type_dict_[static_cast<size_t>(t)];
     }
 
-    static bool is_float(const std::string& s) {
-        if (s.empty()) return false;
-        size_t start = (s[0] == '-') ? 1 : 0;
-        bool has_dot = false;
-        bool has_digit = false;
-        for (size_t i = start; i < s.size(); ++i) {
-            if (s[i] == '.') {
-                if (has_dot) return false;
-                has_dot = true;
-            } else if (std::isdigit(static_cast<unsigned char>(s[i]))) {
-                has_digit = true;
-            } else {
-                return false;
+    /** Materialize a cell as a Value */
+    Value get(size_t row) const {
+        if (type_ == ColumnType::Mixed) return mixed_[row];
+        if (is_null(row)) return Value(nullptr);
+        switch (type_) {
+            case ColumnType::Bool: return Value(bools_[row] != 0);
+            case ColumnType::Int: return Value(static_cast<int64_t>(ints_[row]));
+            case ColumnType::Float: return Value(floats_[row]);
+            case ColumnType::String: {
+                StringView s = text_at(row);
+                return Value(std::string(s.data(), s.size()));
+            }
+            case ColumnType::Reference: {
+                StringView id = text_at(row);
+                const std::string* t = reference_type_at(row);
+                std::string id_str(id.data(), id.size());
+                return Value(t ? std::make_shared<Reference>(id_str, *t) : std::make_shared<Reference>(id_str));
             }
+            default: break;
         }
-        return has_dot && has_digit;
+        return Value(nullptr);
     }
-};
 
-// =============================================================================
-// Parser
-// =============================================================================
+    void reserve(size_t rows) {
+        nulls_.reserve((rows + 63) / 64);
+        switch (type_) {
+            case ColumnType::Bool: bools_.reserve(rows); break;
+            case ColumnType::Int: ints_.reserve(rows); break;
+            case ColumnType::Float: floats_.reserve(rows); break;
+            case ColumnType::String: offsets_.reserve(rows + 1); break;
+            case ColumnType::Reference: offsets_.reserve(rows + 1); ref_types_.reserve(rows); break;
+            case ColumnType::Mixed: mixed_.reserve(rows); break;
+            default: break;
+        }
+    }
 
-class Parser {
-public:
-    explicit Parser(const std::string& text) : line_num_(0) {
-        std::istringstream stream(text);
-        std::string line;
-        while (std::getline(stream, line)) {
-            lines_.push_back(line);
+    void push_null() {
+        push_slot(true);
+        switch (type_) {
+            case ColumnType::Bool: bools_.push_back(0); break;
+            case ColumnType::Int: ints_.push_back(0); break;
+            case ColumnType::Float: floats_.push_back(0.0); break;
+            case ColumnType::String: offsets_.push_back(chars_.size()); break;
+            case ColumnType::Reference: offsets_.push_back(chars_.size()); ref_types_.push_back(-1); break;
+            case ColumnType::Mixed: mixed_.push_back(Value()); break;
+            default: break;
         }
     }
 
-    Document parse() {
-        Document doc;
-        while (line_num_ < lines_.size()) {
-            skip_empty_and_comments();
-            if (line_num_ >= lines_.size()) break;
+    void push_bool(bool b) {
+        if (!adopt(ColumnType::Bool)) { push_mixed(Value(b)); return; }
+        push_slot(false);
+        bools_.push_back(b ? 1 : 0);
+    }
 
-            Block block = parse_block();
-            doc.blocks.push_back(block);
-        }
-        return doc;
+    void push_int(int64_t i) {
+        if (!adopt(ColumnType::Int)) { push_mixed(Value(i)); return; }
+        push_slot(false);
+        ints_.push_back(i);
     }
 
-private:
-    std::vector<std::string> lines_;
-    size_t line_num_;
+    void push_float(double d) {
+        if (!adopt(ColumnType::Float)) { push_mixed(Value(d)); return; }
+        push_slot(false);
+        floats_.push_back(d);
+    }
 
-    std::string current_line() const {
-        return (line_num_ < lines_.size()) ? lines_[line_num_] : "";
+    void push_string(StringView s) {
+        if (!adopt(ColumnType::String)) { push_mixed(Value(std::string(s.data(), s.size()))); return; }
+        push_slot(false);
+        chars_.append(s.data(), s.size());
+        offsets_.push_back(chars_.size());
     }
 
-    static std::string trim(const std::string& s) {
-        size_t start = s.find_first_not_of(" \t\r\n");
-        if (start == std::string::npos) return "";
-        size_t end = s.find_last_not_of(" \t\r\n");
-        return s.substr(start, end - start + 1);
+    void push_reference(const Reference& ref) {
+        if (!adopt(ColumnType::Reference)) { push_mixed(Value(std::make_shared<Reference>(ref))); return; }
+        push_slot(false);
+        chars_.append(ref.id);
+        offsets_.push_back(chars_.size());
+        ref_types_.push_back(ref.type.has_value() ? type_index(ref.type.value()) : -1);
     }
 
-    void skip_empty_and_comments() {
-        while (line_num_ < lines_.size()) {
-            std::string line = trim(current_line());
-            if (line.empty() || line[0] == '#') {
-                ++line_num_;
-            } else {
+    void push_back(const Value& v) {
+        switch (v.type()) {
+            case ValueType::Null: push_null(); break;
+            case ValueType::Bool: push_bool(v.as_bool()); break;
+            case ValueType::Int: push_int(v.as_int()); break;
+            case ValueType::Float: push_float(v.as_float()); break;
+            case ValueType::String: push_string(StringView(v.as_string())); break;
+            case ValueType::Reference: {
+                if (!v.get_reference()) { push_null(); break; }
+                push_reference(*v.get_reference());
                 break;
             }
         }
     }
 
-    Block parse_block() {
-        std::string header_line = trim(current_line());
-        size_t dot_pos = header_line.find('.');
-        if (dot_pos == std::string::npos) {
-            throw ISONSyntaxError("Invalid block header: '" + header_line + "'", static_cast<int>(line_num_ + 1), 0);
+private:
+    friend struct detail::ColumnCodec;
+
+    ColumnType type_;
+    size_t size_;
+    std::vector<uint64_t> nulls_;           // bit set = null
+    std::vector<uint8_t> bools_;
+    std::vector<int64_t> ints_;
+    std::vector<double> floats_;
+    std::vector<uint64_t> offsets_;         // size_ + 1 entries for String / Reference
+    std::string chars_;
+    std::vector<int32_t> ref_types_;        // index into ref_type_dict_, -1 = untyped
+    std::vector<std::string> ref_type_dict_;
+    std::vector<Value> mixed_;
+
+    void expect(ColumnType t) const {
+        if (type_ != t && type_ != ColumnType::Null) {
+            throw ISONTypeError("Column type mismatch");
+        }
+        if (type_ == ColumnType::Null) {
+            throw ISONTypeError("Column has no values");
         }
+    }
 
-        std::string kind = header_line.substr(0, dot_pos);
-        std::string name = header_line.substr(dot_pos + 1);
-        ++line_num_;
+    StringView text_at(size_t row) const {
+        size_t begin = static_cast<size_t>(offsets_[row]);
+        size_t end = static_cast<size_t>(offsets_[row + 1]);
+        return StringView(chars_.data() + begin, end - begin);
+    }
+
+    void push_slot(bool null) {
+        if ((size_ & 63) == 0) nulls_.push_back(0);
+        if (null) nulls_[size_ >> 6] |= (static_cast<uint64_t>(1) << (size_ & 63));
+        ++size_;
+    }
 
-        skip_empty_and_comments();
-        if (line_num_ >= lines_.size()) {
-            throw ISONSyntaxError("Block '" + kind + "." + name + "' missing field definitions", static_cast<int>(line_num_ + 1), 0);
+    int32_t type_index(const std::string& type) {
+        for (size_t i = 0; i < ref_type_dict_.size(); ++i) {
+            if (ref_type_dict_[i] == type) return static_cast<int32_t>(i);
         }
+        ref_type_dict_.push_back(type);
+        return static_cast<int32_t>(ref_type_dict_.size() - 1);
+    }
 
-        std::string fields_line = current_line();
-        Tokenizer tokenizer(fields_line, static_cast<int>(line_num_ + 1));
-        std::vector<std::string> raw_fields = tokenizer.tokenize();
-        ++line_num_;
+    // Returns false when the column must fall back to Mixed storage
+    bool adopt(ColumnType t) {
+        if (type_ == t) return true;
+        if (type_ == ColumnType::Mixed) return false;
+        if (type_ != ColumnType::Null) {
+            to_mixed();
+            return false;
+        }
+        // First non-null value: give the preceding null rows default slots
+        type_ = t;
+        switch (t) {
+            case ColumnType::Bool: bools_.assign(size_, 0); break;
+            case ColumnType::Int: ints_.assign(size_, 0); break;
+            case ColumnType::Float: floats_.assign(size_, 0.0); break;
+            case ColumnType::String: offsets_.assign(size_ + 1, 0); break;
+            case ColumnType::Reference: offsets_.assign(size_ + 1, 0); ref_types_.assign(size_, -1); break;
+            default: break;
+        }
+        return true;
+    }
 
-        Block block(kind, name);
-        for (size_t i = 0; i < raw_fields.size(); ++i) {
-            FieldInfo fi = FieldInfo::parse(raw_fields[i]);
-            block.field_info.push_back(fi);
-            block.fields.push_back(fi.name);
-        }
-
-        while (line_num_ < lines_.size()) {
-            std::string line = current_line();
-            std::string stripped = trim(line);
-
-            if (stripped.empty()) break;
-            if (stripped[0] == '#') { ++line_num_; continue; }
-
-            if (stripped.size() >= 3 && stripped.substr(0, 3) == "---") {
-                ++line_num_;
-                while (line_num_ < lines_.size()) {
-                    std::string summary_line = trim(current_line());
-                    if (!summary_line.empty() && summary_line[0] != '#') {
-                        block.summary = summary_line;
-                        ++line_num_;
-                        break;
-                    } else if (summary_line.empty()) {
-                        break;
-                    }
-                    ++line_num_;
-                }
-                continue;
-            }
+    void to_mixed() {
+        std::vector<Value> values;
+        values.reserve(size_ + 1);
+        for (size_t i = 0; i < size_; ++i) values.push_back(get(i));
+        type_ = ColumnType::Mixed;
+        mixed_.swap(values);
+        std::vector<uint8_t>().swap(bools_);
+        std::vector<int64_t>().swap(ints_);
+        std::vector<double>().swap(floats_);
+        std::vector<uint64_t>().swap(offsets_);
+        std::string().swap(chars_);
+        std::vector<int32_t>().swap(ref_types_);
+        std::vector<std::string>().swap(ref_type_dict_);
+    }
 
-            if (looks_like_header(stripped)) break;
+    void push_mixed(const Value& v) {
+        push_slot(v.is_null());
+        mixed_.push_back(v);
+    }
+};
 
-            Row row = parse_data_row(block.fields, line);
-            block.rows.push_back(row);
-            ++line_num_;
-        }
+/**
+ * @brief Column-oriented block: field names stored once, one Column per field
+ *
+ * Rows can still be read as Row maps through row() and to_block().
+ */
+class ColumnarBlock {
+public:
+    std::string kind;
+    std::string name;
+    std::vector<std::string> fields;
+    std::vector<FieldInfo> field_info;
+    std::vector<Column> columns;
+    Optional<std::string> summary;
 
-        return block;
+    ColumnarBlock() : rows_(0) {}
+    ColumnarBlock(const std::string& kind, const std::string& name) : kind(kind), name(name), rows_(0) {}
+
+    size_t size() const { return rows_; }
+    size_t column_count() const { return columns.size(); }
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    /** Index of a field's column, or npos; resolve once and use get(row, col) per row */
+    size_t column_index(StringView field) const {
+        return field_index_.find(fields, detail::SelfName(), field);
     }
 
-    bool looks_like_header(const std::string& line) const {
-        size_t dot_pos = line.find('.');
-        if (dot_pos == std::string::npos) return false;
-        if (line.find(' ') != std::string::npos) return false;
+    void reindex_fields() { field_index_.rebuild(fields, detail::SelfName()); }
 
-        std::string kind = line.substr(0, dot_pos);
-        std::string name = line.substr(dot_pos + 1);
-        return is_valid_id(kind) && is_valid_id(name);
+    const Column& column(size_t index) const { return columns[index]; }
+
+    const Column& column(const std::string& field) const {
+        size_t index = column_index(field);
+        if (index == npos) throw ISONError("Field not found: " + field);
+        return columns[index];
     }
 
-    static bool is_valid_id(const std::string& s) {
-        if (s.empty()) return false;
-        if (!std::isalpha(static_cast<unsigned char>(s[0])) && s[0] != '_') return false;
-        for (size_t i = 0; i < s.size(); ++i) {
-            char c = s[i];
-            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') return false;
+    Value get(size_t row, size_t col) const { return columns[col].get(row); }
+
+    /** Set the schema; resets all columns */
+    void set_fields(const std::vector<FieldInfo>& infos) {
+        field_info = infos;
+        fields.clear();
+        for (size_t i = 0; i < infos.size(); ++i) fields.push_back(infos[i].name);
+        columns.assign(fields.size(), Column());
+        rows_ = 0;
+        reindex_fields();
+    }
+
+    /** Append a row with one value per column (missing trailing values become null) */
+    void append_row(const std::vector<Value>& values) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (i < values.size()) columns[i].push_back(values[i]);
+            else columns[i].push_null();
         }
-        return true;
+        ++rows_;
     }
 
-    Row parse_data_row(const std::vector<std::string>& fields, const std::string& line) {
-        Tokenizer tokenizer(line, static_cast<int>(line_num_ + 1));
-        std::vector<std::string> raw_tokens = tokenizer.tokenize();
+    /** Account for a row whose cells were pushed into the columns directly */
+    void commit_row() { ++rows_; }
 
-        std::vector<Value> values;
-        size_t pos = 0;
+    /** Row compatibility view (materialized) */
+    Row row(size_t index) const {
+        Row result;
+        for (size_t i = 0; i < columns.size(); ++i) {
+            result[fields[i]] = columns[i].get(index);
+        }
+        return result;
+    }
 
-        for (size_t i = 0; i < raw_tokens.size(); ++i) {
-            while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) {
-                ++pos;
-            }
-            bool was_quoted = pos < line.size() && line[pos] == '"';
-            values.push_back(TypeInferrer::infer(raw_tokens[i], was_quoted));
+    Block to_block() const {
+        Block block(kind, name);
+        block.fields = fields;
+        block.reindex_fields();
+        block.field_info = field_info;
+        block.summary = summary;
+        block.rows.reserve(rows_);
+        for (size_t r = 0; r < rows_; ++r) block.rows.push_back(row(r));
+        return block;
+    }
 
-            if (was_quoted) {
-                ++pos;
-                while (pos < line.size() && line[pos] != '"') {
-                    if (line[pos] == '\\') ++pos;
-                    ++pos;
-                }
-                if (pos < line.size()) ++pos;
-            } else {
-                pos += raw_tokens[i].size();
-            }
+    static ColumnarBlock from_block(const Block& block) {
+        ColumnarBlock result(block.kind, block.name);
+        result.fields = block.fields;
+        result.reindex_fields();
+        result.field_info = block.field_info;
+        result.summary = block.summary;
+        result.columns.assign(block.fields.size(), Column());
+        for (size_t c = 0; c < result.columns.size(); ++c) {
+            result.columns[c].reserve(block.rows.size());
         }
-
-        Row row;
-        for (size_t i = 0; i < fields.size(); ++i) {
-            if (i < values.size()) {
-                row[fields[i]] = values[i];
-            } else {
-                row[fields[i]] = Value(nullptr);
+        for (size_t r = 0; r < block.rows.size(); ++r) {
+            const Row& row = block.rows[r];
+            for (size_t c = 0; c < block.fields.size(); ++c) {
+                Row::const_iterator it = row.find(block.fields[c]);
+                if (it != row.end()) result.columns[c].push_back(it->second);
+                else result.columns[c].push_null();
             }
+            ++result.rows_;
         }
-        return row;
+        return result;
     }
-};
 
-// =============================================================================
-// Serializer
-// =============================================================================
+private:
+    friend struct detail::ColumnCodec;
 
-class Serializer {
+    size_t rows_;
+    detail::NameIndex field_index_;
+};
+
+/**
+ * @brief Document made of ColumnarBlocks
+ */
+class ColumnarDocument {
 public:
-    static std::string dumps(const Document& doc, bool align_columns = true) {
-        std::string result;
+    std::vector<ColumnarBlock> blocks;
+
+    ColumnarDocument() {}
+
+    ColumnarBlock* get(const std::string& name) {
+        size_t i = index_.find(blocks, detail::MemberName(), name);
+        return i != detail::NameIndex::npos ? &blocks[i] : NULL;
+    }
+
+    const ColumnarBlock* get(const std::string& name) const {
+        size_t i = index_.find(blocks, detail::MemberName(), name);
+        return i != detail::NameIndex::npos ? &blocks[i] : NULL;
+    }
+
+    ColumnarBlock& add_block(const ColumnarBlock& block) {
+        blocks.push_back(block);
+        index_.appended(blocks, detail::MemberName());
+        return blocks.back();
+    }
+
+    void reindex() {
+        index_.rebuild(blocks, detail::MemberName());
+        for (size_t i = 0; i < blocks.size(); ++i) blocks[i].reindex_fields();
+    }
+
+    ColumnarBlock& operator[](const std::string& name) {
+        ColumnarBlock* b = get(name);
+        if (!b) throw ISONError("Block not found: " + name);
+        return *b;
+    }
+
+    const ColumnarBlock& operator[](const std::string& name) const {
+        const ColumnarBlock* b = get(name);
+        if (!b) throw ISONError("Block not found: " + name);
+        return *b;
+    }
+
+    bool has(const std::string& name) const { return get(name) != NULL; }
+    size_t size() const { return blocks.size(); }
+
+    Document to_document() const {
+        Document doc;
+        doc.blocks.reserve(blocks.size());
+        for (size_t i = 0; i < blocks.size(); ++i) doc.blocks.push_back(blocks[i].to_block());
+        doc.reindex();
+        return doc;
+    }
+
+    static ColumnarDocument from_document(const Document& doc) {
+        ColumnarDocument result;
+        result.blocks.reserve(doc.blocks.size());
         for (size_t i = 0; i < doc.blocks.size(); ++i) {
-            if (i > 0) result += "\n\n";
-            result += serialize_block(doc.blocks[i], align_columns);
+            result.blocks.push_back(ColumnarBlock::from_block(doc.blocks[i]));
         }
+        result.reindex();
         return result;
     }
 
 private:
-    static std::string serialize_block(const Block& block, bool align_columns) {
-        std::vector<std::string> lines;
-        lines.push_back(block.kind + "." + block.name);
-
-        std::string fields_line;
-        for (size_t i = 0; i < block.field_info.size(); ++i) {
-            if (i > 0) fields_line += " ";
-            const FieldInfo& fi = block.field_info[i];
-            if (fi.type.has_value()) {
-                fields_line += fi.name + ":" + fi.type.value();
-            } else {
-                fields_line += fi.name;
-            }
-        }
-        if (fields_line.empty() && !block.fields.empty()) {
-            for (size_t i = 0; i < block.fields.size(); ++i) {
-                if (i > 0) fields_line += " ";
-                fields_line += block.fields[i];
-            }
-        }
-        lines.push_back(fields_line);
+    detail::NameIndex index_;
+};
 
-        std::vector<size_t> col_widths;
-        if (align_columns && !block.rows.empty()) {
-            col_widths = calculate_column_widths(block);
-        }
+// =============================================================================
+// SIMD Scanning
+// =============================================================================
 
-        for (size_t ri = 0; ri < block.rows.size(); ++ri) {
-            const Row& row = block.rows[ri];
-            std::string row_line;
-            for (size_t i = 0; i < block.fields.size(); ++i) {
-                if (i > 0) row_line += " ";
+/**
+ * @brief Instruction set used by the tokenizer's byte scanners
+ */
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
 
-                std::string str_value = "null";
-                Row::const_iterator it = row.find(block.fields[i]);
-                if (it != row.end()) {
-                    str_value = value_to_ison(it->second);
-                }
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::NEON: return "neon";
+        default: return "scalar";
+    }
+}
 
-                if (!col_widths.empty() && i < col_widths.size()) {
-                    while (str_value.size() < col_widths[i]) {
-                        str_value += " ";
-                    }
-                }
-                row_line += str_value;
-            }
-            // Trim trailing whitespace
-            while (!row_line.empty() && (row_line[row_line.size()-1] == ' ' || row_line[row_line.size()-1] == '\t')) {
-                row_line.erase(row_line.size()-1);
-            }
-            lines.push_back(row_line);
-        }
+namespace detail {
 
-        if (block.summary.has_value()) {
-            lines.push_back("---");
-            lines.push_back(block.summary.value());
-        }
+inline unsigned count_trailing_zeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    unsigned n = 0;
+    while (!(bits & 1)) { bits >>= 1; ++n; }
+    return n;
+#endif
+}
 
-        std::string result;
-        for (size_t i = 0; i < lines.size(); ++i) {
-            if (i > 0) result += "\n";
-            result += lines[i];
-        }
-        return result;
+inline const char* find_either_scalar(const char* p, const char* end, char a, char b) {
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
     }
+    return end;
+}
 
-    static std::vector<size_t> calculate_column_widths(const Block& block) {
-        std::vector<size_t> widths(block.fields.size());
-        for (size_t i = 0; i < block.fields.size(); ++i) {
-            widths[i] = block.fields[i].size();
-        }
+#if ISON_SIMD_SSE2
+inline const char* find_either_sse2(const char* p, const char* end, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask) return p + count_trailing_zeros(mask);
+        p += 16;
+    }
+    return find_either_scalar(p, end, a, b);
+}
+#endif
 
-        for (size_t ri = 0; ri < block.rows.size(); ++ri) {
-            const Row& row = block.rows[ri];
-            for (size_t i = 0; i < block.fields.size(); ++i) {
-                Row::const_iterator it = row.find(block.fields[i]);
-                if (it != row.end()) {
-                    std::string str_value = value_to_ison(it->second);
-                    if (str_value.size() > widths[i]) {
-                        widths[i] = str_value.size();
-                    }
-                }
-            }
-        }
-        return widths;
+#if ISON_SIMD_AVX2
+ISON_TARGET_AVX2
+inline const char* find_either_avx2(const char* p, const char* end, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask) return p + count_trailing_zeros(mask);
+        p += 32;
     }
+    return find_either_sse2(p, end, a, b);
+}
+#endif
 
-    static std::string value_to_ison(const Value& v) {
-        switch (v.type()) {
-            case ValueType::Null: return "null";
-            case ValueType::Bool: return v.as_bool() ? "true" : "false";
-            case ValueType::Int: return std::to_string(v.as_int());
-            case ValueType::Float: {
-                std::ostringstream oss;
-                oss << v.as_float();
-                return oss.str();
-            }
-            case ValueType::String: return quote_if_needed(v.as_string());
-            case ValueType::Reference: {
-                std::shared_ptr<Reference> r = v.as_reference_ptr();
-                return r ? r->to_ison() : "null";
-            }
-        }
-        return "null";
+#if ISON_SIMD_NEON
+inline const char* find_either_neon(const char* p, const char* end, char a, char b) {
+    const uint8x16_t va = vdupq_n_u8(static_cast<uint8_t>(a));
+    const uint8x16_t vb = vdupq_n_u8(static_cast<uint8_t>(b));
+    while (end - p >= 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint8x16_t hits = vorrq_u8(vceqq_u8(chunk, va), vceqq_u8(chunk, vb));
+        // Narrow each byte lane to a nibble so the mask fits in 64 bits
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+        if (mask) return p + (count_trailing_zeros(mask) >> 2);
+        p += 16;
     }
+    return find_either_scalar(p, end, a, b);
+}
+#endif
 
-    static std::string quote_if_needed(const std::string& s) {
-        if (s.empty()) return "\"\"";
+inline SimdLevel detect_simd_level() {
+#if ISON_SIMD_AVX2
+    #if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    if (os_saves_ymm) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) return SimdLevel::AVX2;
+    }
+    #else
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    #endif
+#endif
+#if ISON_SIMD_SSE2
+    return SimdLevel::SSE2;
+#elif ISON_SIMD_NEON
+    return SimdLevel::NEON;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
 
-        bool needs_quote = (s == "true" || s == "false" || s == "null" || s[0] == ':');
+inline SimdLevel detected_simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
 
-        if (!needs_quote) {
-            for (size_t i = 0; i < s.size(); ++i) {
-                char c = s[i];
-                if (c == ' ' || c == '\t' || c == '"' || c == '\n' || c == '\r') {
-                    needs_quote = true;
-                    break;
-                }
-            }
-        }
+inline std::atomic<int>& active_simd_level() {
+    static std::atomic<int> level(static_cast<int>(detected_simd_level()));
+    return level;
+}
+
+/**
+ * @brief Returns the first byte in [p, end) equal to a or b, or end
+ */
+inline const char* find_either(const char* p, const char* end, char a, char b) {
+    if (end - p < 16) return find_either_scalar(p, end, a, b);
+    switch (static_cast<SimdLevel>(active_simd_level().load(std::memory_order_relaxed))) {
+#if ISON_SIMD_AVX2
+        case SimdLevel::AVX2: return find_either_avx2(p, end, a, b);
+#endif
+#if ISON_SIMD_SSE2
+        case SimdLevel::SSE2: return find_either_sse2(p, end, a, b);
+#endif
+#if ISON_SIMD_NEON
+        case SimdLevel::NEON: return find_either_neon(p, end, a, b);
+#endif
+        default: return find_either_scalar(p, end, a, b);
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Returns the instruction set the scanners currently use
+ */
+inline SimdLevel simd_level() {
+    return static_cast<SimdLevel>(detail::active_simd_level().load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Overrides the scanner instruction set, e.g. for benchmarking
+ *
+ * Levels the CPU or build does not support fall back to the detected level.
+ */
+inline void set_simd_level(SimdLevel level) {
+    SimdLevel detected = detail::detected_simd_level();
+    bool supported = level == SimdLevel::Scalar || level == detected ||
+                     (level == SimdLevel::SSE2 && detected == SimdLevel::AVX2);
+    detail::active_simd_level().store(static_cast<int>(supported ? level : detected),
+                                      std::memory_order_relaxed);
+}
+
+// =============================================================================
+// Tokenizer
+// =============================================================================
+
+/**
+ * @brief A single token of a line
+ *
+ * The text points into the tokenized line, or into the tokenizer's scratch
+ * buffer for quoted strings that contained escape sequences. It stays valid
+ * until the tokenizer is reset or destroyed and the line buffer is alive.
+ */
+struct Token {
+    StringView text;
+    bool quoted;
+
+    Token() : quoted(false) {}
+    Token(StringView text, bool quoted) : text(text), quoted(quoted) {}
+};
+
+/**
+ * @brief Splits a line into whitespace-separated tokens
+ *
+ * The tokenizer does not copy the line; the caller keeps the buffer alive
+ * while tokens are in use.
+ */
+class Tokenizer {
+public:
+    Tokenizer(StringView line = StringView(), int line_num = 0)
+        : line_(line), line_num_(line_num), pos_(0) {}
+
+    void reset(StringView line, int line_num = 0) {
+        line_ = line;
+        line_num_ = line_num;
+        pos_ = 0;
+    }
+
+    std::vector<std::string> tokenize() {
+        std::vector<Token> tokens;
+        tokenize(tokens);
+        std::vector<std::string> result;
+        result.reserve(tokens.size());
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            result.push_back(std::string(tokens[i].text.data(), tokens[i].text.size()));
+        }
+        return result;
+    }
+
+    /**
+     * @brief Zero-copy tokenization into a reusable token vector
+     *
+     * Stops after max_tokens tokens; the rest of the line is not scanned.
+     */
+    void tokenize(std::vector<Token>& tokens, size_t max_tokens = static_cast<size_t>(-1)) {
+        tokens.clear();
+        // Unescaped text is never longer than the line, so reserving up front
+        // keeps views into scratch_ stable while the line is decoded.
+        scratch_.clear();
+        scratch_.reserve(line_.size());
+        pos_ = 0;
+
+        while (pos_ < line_.size() && tokens.size() < max_tokens) {
+            skip_whitespace();
+            if (pos_ >= line_.size()) break;
+
+            if (line_[pos_] == '"') {
+                tokens.push_back(read_quoted_string());
+            } else {
+                tokens.push_back(Token(read_unquoted_token(), false));
+            }
+        }
+    }
+
+private:
+    StringView line_;
+    int line_num_;
+    size_t pos_;
+    std::string scratch_;
+
+    void skip_whitespace() {
+        while (pos_ < line_.size() && (line_[pos_] == ' ' || line_[pos_] == '\t')) {
+            ++pos_;
+        }
+    }
+
+    Token read_quoted_string() {
+        size_t start_pos = pos_;
+        const char* begin = line_.data();
+        const char* end = begin + line_.size();
+        const char* chunk = begin + pos_ + 1;
+        const char* p = detail::find_either(chunk, end, '"', '\\');
+
+        // Fast path: no escape sequences, point straight into the line
+        if (p < end && *p == '"') {
+            pos_ = static_cast<size_t>(p - begin) + 1;
+            return Token(StringView(chunk, static_cast<size_t>(p - chunk)), true);
+        }
+
+        size_t out_start = scratch_.size();
+        while (p < end) {
+            scratch_.append(chunk, static_cast<size_t>(p - chunk));
+
+            if (*p == '"') {
+                pos_ = static_cast<size_t>(p - begin) + 1;
+                return Token(StringView(scratch_.data() + out_start, scratch_.size() - out_start), true);
+            }
+
+            if (++p >= end) {
+                throw ISONSyntaxError("Unexpected end of line after backslash", line_num_, static_cast<int>(p - begin));
+            }
+            switch (*p) {
+                case '"': scratch_ += '"'; break;
+                case '\\': scratch_ += '\\'; break;
+                case 'n': scratch_ += '\n'; break;
+                case 't': scratch_ += '\t'; break;
+                case 'r': scratch_ += '\r'; break;
+                default: scratch_ += *p; break;
+            }
+            chunk = p + 1;
+            p = detail::find_either(chunk, end, '"', '\\');
+        }
+        throw ISONSyntaxError("Unterminated quoted string", line_num_, static_cast<int>(start_pos));
+    }
+
+    StringView read_unquoted_token() {
+        size_t start = pos_;
+        const char* begin = line_.data();
+        pos_ = static_cast<size_t>(detail::find_either(begin + pos_, begin + line_.size(), ' ', '\t') - begin);
+        return line_.substr(start, pos_ - start);
+    }
+};
+
+// =============================================================================
+// Interning
+// =============================================================================
+
+namespace detail {
+
+/**
+ * @brief Split the text after ':' of a reference into type and id
+ */
+inline bool split_reference(StringView ref_value, StringView& type, StringView& id) {
+    size_t colon_pos = ref_value.find(':');
+    if (colon_pos == StringView::npos) {
+        id = ref_value;
+        return false;
+    }
+    type = ref_value.substr(0, colon_pos);
+    id = ref_value.substr(colon_pos + 1);
+    return true;
+}
+
+} // namespace detail
+
+/**
+ * @brief Shares equal short strings and reference types between values
+ *
+ * Interned strings with equal text point to one cell, so they cost one
+ * allocation and compare by pointer (as_string() addresses). References
+ * share their type instead: every :user:... or :MEMBER_OF:... reference
+ * points to one copy of "user" or "MEMBER_OF", whatever its id, and ids
+ * never take a pool entry. The pool is thread-safe and can be shared by
+ * several documents and parser threads. Text longer than max_length is not
+ * interned, and once max_entries symbols are stored new text is left
+ * alone, so unique values cannot grow the pool without bound.
+ */
+class InternPool {
+public:
+    explicit InternPool(size_t max_length = 32, size_t max_entries = 1 << 20)
+        : max_length_(max_length), max_entries_(max_entries), size_(0) {}
+
+    /**
+     * @brief The shared string value for text, or a null Value if not interned
+     */
+    Value string(StringView text) { return lookup(text); }
+
+    /**
+     * @brief A reference for the text after ':' ("user:101") with an interned type
+     *
+     * Returns null if the type is not interned (too long, or the pool is full).
+     */
+    Value reference(StringView text) {
+        StringView type, id;
+        if (!detail::split_reference(text, type, id)) {
+            return Value(std::make_shared<Reference>(std::string(id.data(), id.size())));
+        }
+        ReferenceType shared = reference_type(type);
+        if (!shared.has_value()) return Value();
+        return Value(std::make_shared<Reference>(std::string(id.data(), id.size()), shared));
+    }
+
+    /**
+     * @brief The shared type for type text ("user"), or no type if not interned
+     */
+    ReferenceType reference_type(StringView text) {
+        if (text.size() > max_length_) return ReferenceType();
+        size_t hash = detail::StringViewHash()(text);
+        Shard& shard = shards_[hash % SHARDS];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        TypeTable::iterator it = shard.types.find(text);
+        if (it != shard.types.end()) return it->second;
+        if (size_.load(std::memory_order_relaxed) >= max_entries_) return ReferenceType();
+
+        ReferenceType type = ReferenceType::shared(text);
+        shard.types.insert(std::make_pair(StringView(type.value()), type));
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return type;
+    }
+
+    size_t max_length() const { return max_length_; }
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t SHARDS = 16;
+    typedef std::unordered_map<StringView, Value, detail::StringViewHash> Table;
+    typedef std::unordered_map<StringView, ReferenceType, detail::StringViewHash> TypeTable;
+
+    struct Shard {
+        std::mutex mutex;
+        Table strings;
+        TypeTable types;   // keys point into the shared type text
+        Arena keys;
+
+        Shard() : keys(4096) {}
+    };
+
+    size_t max_length_;
+    size_t max_entries_;
+    std::atomic<size_t> size_;
+    Shard shards_[SHARDS];
+
+    InternPool(const InternPool&);
+    InternPool& operator=(const InternPool&);
+
+    Value lookup(StringView text) {
+        if (text.size() > max_length_) return Value();
+        size_t hash = detail::StringViewHash()(text);
+        Shard& shard = shards_[hash % SHARDS];
+        Table& table = shard.strings;
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Table::iterator it = table.find(text);
+        if (it != table.end()) return it->second;
+        if (size_.load(std::memory_order_relaxed) >= max_entries_) return Value();
+
+        char* key = static_cast<char*>(shard.keys.allocate(text.size() > 0 ? text.size() : 1, 1));
+        if (!text.empty()) std::memcpy(key, text.data(), text.size());
+        Value value(std::string(text.data(), text.size()));
+        table.insert(std::make_pair(StringView(key, text.size()), value));
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return value;
+    }
+};
+
+// =============================================================================
+// Type Inferrer
+// =============================================================================
+
+namespace detail {
+
+enum class NumberKind {
+    None,
+    Integer,
+    Float
+};
+
+inline double pow10_exact(unsigned exponent) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    return powers[exponent];
+}
+
+// Correctly rounded conversion for decimals the fast path cannot handle
+inline double parse_double_slow(const char* p, size_t n) {
+#if ISON_HAS_FROM_CHARS
+    double value = 0.0;
+    std::from_chars(p, p + n, value);
+    return value;
+#else
+    char stack_buf[64];
+    std::string heap_buf;
+    char* buf = stack_buf;
+    if (n >= sizeof(stack_buf)) {
+        heap_buf.assign(p, n);
+        buf = &heap_buf[0];
+    } else {
+        std::memcpy(buf, p, n);
+        buf[n] = '\0';
+    }
+    return std::strtod(buf, NULL);
+#endif
+}
+
+/**
+ * @brief Classifies and converts -?digits or -?digits.digits in one pass
+ *
+ * Integers that overflow int64 are returned as floats. Decimals whose digits
+ * fit in 53 bits with at most 22 fraction digits are converted with a single
+ * exact division; longer ones fall back to a correctly rounded parse.
+ */
+inline NumberKind parse_number(StringView token, int64_t& int_value, double& float_value) {
+    const char* begin = token.data();
+    const char* p = begin;
+    const char* end = p + token.size();
+    bool negative = p < end && *p == '-';
+    if (negative) ++p;
+
+    uint64_t mantissa = 0;
+    unsigned significant = 0;
+    unsigned fraction_digits = 0;
+    bool has_digit = false;
+    bool has_dot = false;
+    bool overflow = false;
+
+    for (; p < end; ++p) {
+        unsigned digit = static_cast<unsigned char>(*p) - '0';
+        if (digit <= 9) {
+            has_digit = true;
+            if (has_dot) ++fraction_digits;
+            if (mantissa == 0 && digit == 0) continue;
+            if (++significant > 19) {
+                overflow = true;
+            } else {
+                mantissa = mantissa * 10 + digit;
+            }
+        } else if (*p == '.' && !has_dot) {
+            has_dot = true;
+        } else {
+            return NumberKind::None;
+        }
+    }
+    if (!has_digit) return NumberKind::None;
+
+    if (!has_dot) {
+        uint64_t limit = negative ? static_cast<uint64_t>(INT64_MAX) + 1 : static_cast<uint64_t>(INT64_MAX);
+        if (!overflow && mantissa <= limit) {
+            int_value = negative ? static_cast<int64_t>(0 - mantissa) : static_cast<int64_t>(mantissa);
+            return NumberKind::Integer;
+        }
+    } else if (!overflow && mantissa <= (static_cast<uint64_t>(1) << 53) && fraction_digits <= 22) {
+        double value = static_cast<double>(mantissa) / pow10_exact(fraction_digits);
+        float_value = negative ? -value : value;
+        return NumberKind::Float;
+    }
+
+    float_value = parse_double_slow(begin, token.size());
+    return NumberKind::Float;
+}
+
+/**
+ * @brief Parses a token of decimal digits into the full uint64_t range
+ */
+inline bool parse_uint(StringView token, uint64_t& value) {
+    if (token.empty()) return false;
+    const uint64_t limit = std::numeric_limits<uint64_t>::max();
+    value = 0;
+    for (size_t i = 0; i < token.size(); ++i) {
+        unsigned digit = static_cast<unsigned char>(token[i]) - '0';
+        if (digit > 9 || value > (limit - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+/**
+ * @brief Creates string and reference values from a pool, an arena or the heap
+ *
+ * Arena values pin the arena, so a Value copied out of a Document keeps
+ * the memory it points to alive. The arena must come from Arena::shared().
+ */
+struct ValueFactory {
+    std::shared_ptr<Arena> arena;
+    InternPool* pool;
+
+    ValueFactory() : pool(NULL) {}
+    ValueFactory(const std::shared_ptr<Arena>& arena, InternPool* pool) : arena(arena), pool(pool) {}
+
+    Value string(StringView text) const {
+        if (pool) {
+            Value interned = pool->string(text);
+            if (!interned.is_null()) return interned;
+        }
+        if (!arena) return Value(std::string(text.data(), text.size()));
+        return Value(ValueType::String, arena->create<StringCell>(arena.get(), std::string(text.data(), text.size())));
+    }
+
+    template<typename... Args>
+    Value reference(Args&&... args) const {
+        if (!arena) return Value(std::make_shared<Reference>(std::forward<Args>(args)...));
+        const Reference* ref = arena->create<Reference>(std::forward<Args>(args)...);
+        return Value(ValueType::Reference, arena->create<ReferenceCell>(arena.get(), ref));
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Cell decoder selected by a field's declared type ("id:int", "owner:ref")
+ */
+enum class TypeHint {
+    None,       ///< No usable declaration: infer each cell
+    Int,        ///< int, integer
+    Float,      ///< float, number (integers are widened)
+    Bool,       ///< bool, boolean
+    String,     ///< string, str, text (unquoted cells are taken verbatim)
+    Reference   ///< ref, reference
+};
+
+/**
+ * @brief Whether declared field types ("id:int") select the cell decoders
+ */
+enum class TypeHintMode {
+    Ignore,     ///< Infer every cell (default)
+    Fallback,   ///< Decode by declared type; infer cells that do not fit
+    Strict      ///< Decode by declared type; throw ISONSyntaxError on a mismatch
+};
+
+inline const char* type_hint_name(TypeHint hint) {
+    switch (hint) {
+        case TypeHint::Int: return "int";
+        case TypeHint::Float: return "float";
+        case TypeHint::Bool: return "bool";
+        case TypeHint::String: return "string";
+        case TypeHint::Reference: return "ref";
+        default: return "any";
+    }
+}
+
+inline TypeHint type_hint(const FieldInfo& field) {
+    if (!field.type.has_value()) return TypeHint::None;
+    const std::string& t = field.type.value();
+    if (t == "int" || t == "integer") return TypeHint::Int;
+    if (t == "float" || t == "number") return TypeHint::Float;
+    if (t == "bool" || t == "boolean") return TypeHint::Bool;
+    if (t == "string" || t == "str" || t == "text") return TypeHint::String;
+    if (t == "ref" || t == "reference") return TypeHint::Reference;
+    return TypeHint::None;
+}
+
+class TypeInferrer {
+public:
+    static Value infer(StringView token, bool was_quoted = false) {
+        return infer(token, was_quoted, detail::ValueFactory());
+    }
+
+    static Value infer(StringView token, bool was_quoted, const detail::ValueFactory& factory) {
+        if (was_quoted || token.empty()) {
+            return factory.string(token);
+        }
+
+        switch (token[0]) {
+            case 't':
+                if (token == "true") return Value(true);
+                break;
+            case 'f':
+                if (token == "false") return Value(false);
+                break;
+            case 'n':
+                if (token == "null") return Value(nullptr);
+                break;
+            case '~':
+                if (token.size() == 1) return Value(nullptr);
+                break;
+            case ':':
+                if (token.size() > 1) return infer_reference(token.substr(1), factory);
+                break;
+            default: {
+                int64_t int_value;
+                double float_value;
+                switch (detail::parse_number(token, int_value, float_value)) {
+                    case detail::NumberKind::Integer: return Value(int_value);
+                    case detail::NumberKind::Float: return Value(float_value);
+                    default: break;
+                }
+                break;
+            }
+        }
+
+        return factory.string(token);
+    }
+
+    /**
+     * @brief Decode a token as a declared type, skipping inference
+     *
+     * Unquoted null and ~ are accepted for every type. Returns false, leaving
+     * out unchanged, when the token does not fit the type.
+     */
+    static bool infer_hinted(StringView token, bool was_quoted, TypeHint hint,
+                             const detail::ValueFactory& factory, Value& out) {
+        if (!was_quoted && (token == "null" || token == "~")) {
+            out = Value(nullptr);
+            return true;
+        }
+        switch (hint) {
+            case TypeHint::None:
+                out = infer(token, was_quoted, factory);
+                return true;
+            case TypeHint::String:
+                out = factory.string(token);
+                return true;
+            case TypeHint::Bool:
+                if (was_quoted) return false;
+                if (token == "true") { out = Value(true); return true; }
+                if (token == "false") { out = Value(false); return true; }
+                return false;
+            case TypeHint::Int:
+            case TypeHint::Float: {
+                if (was_quoted) return false;
+                int64_t int_value;
+                double float_value;
+                switch (detail::parse_number(token, int_value, float_value)) {
+                    case detail::NumberKind::Integer:
+                        out = hint == TypeHint::Int ? Value(int_value) : Value(static_cast<double>(int_value));
+                        return true;
+                    case detail::NumberKind::Float:
+                        if (hint != TypeHint::Float) return false;
+                        out = Value(float_value);
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+            case TypeHint::Reference:
+                if (was_quoted || token.size() < 2 || token[0] != ':') return false;
+                out = infer_reference(token.substr(1), factory);
+                return true;
+        }
+        return false;
+    }
+
+private:
+    static Value infer_reference(StringView ref_value, const detail::ValueFactory& factory) {
+        StringView type, id;
+        if (detail::split_reference(ref_value, type, id)) {
+            ReferenceType shared = factory.pool ? factory.pool->reference_type(type) : ReferenceType();
+            if (shared.has_value()) return factory.reference(std::string(id.data(), id.size()), shared);
+            return factory.reference(std::string(id.data(), id.size()), std::string(type.data(), type.size()));
+        }
+        return factory.reference(std::string(id.data(), id.size()));
+    }
+};
+
+// =============================================================================
+// Block Line Parser
+// =============================================================================
+
+namespace detail {
+
+inline bool is_line_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline StringView trim_line(StringView s) {
+    size_t start = 0;
+    size_t end = s.size();
+    while (start < end && is_line_space(s[start])) ++start;
+    while (end > start && is_line_space(s[end - 1])) --end;
+    return s.substr(start, end - start);
+}
+
+inline bool is_valid_id(StringView s) {
+    if (s.empty()) return false;
+    if (!std::isalpha(static_cast<unsigned char>(s[0])) && s[0] != '_') return false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') return false;
+    }
+    return true;
+}
+
+inline bool looks_like_header(StringView line) {
+    size_t dot_pos = line.find('.');
+    if (dot_pos == StringView::npos) return false;
+    if (line.find(' ') != StringView::npos) return false;
+    return is_valid_id(line.substr(0, dot_pos)) && is_valid_id(line.substr(dot_pos + 1));
+}
+
+/**
+ * @brief Call fn(line) for each line of a buffer (terminators and a trailing CR removed)
+ */
+template<typename F>
+inline void for_each_line(const char* data, size_t size, F& fn) {
+    size_t pos = 0;
+    while (pos < size) {
+        const char* begin = data + pos;
+        const void* nl = std::memchr(begin, '\n', size - pos);
+        size_t len = nl ? static_cast<size_t>(static_cast<const char*>(nl) - begin) : size - pos;
+        pos += len + (nl ? 1 : 0);
+        if (len > 0 && begin[len - 1] == '\r') --len;
+        fn(StringView(begin, len));
+    }
+}
+
+/**
+ * @brief for_each_line() over text that arrives in chunks; returns the bytes read
+ *
+ * chunks.next(data, size) yields each chunk in turn and returns false at the
+ * end. Lines are passed in place; only a line split between chunks is copied.
+ */
+template<typename Chunks, typename F>
+inline size_t for_each_chunk_line(Chunks& chunks, F& fn) {
+    std::string carry;
+    const char* data;
+    size_t size;
+    size_t total = 0;
+    while (chunks.next(data, size)) {
+        total += size;
+        const char* end = data + size;
+        const char* rest = data;
+        if (!carry.empty()) {
+            const void* nl = std::memchr(data, '\n', size);
+            if (!nl) {
+                carry.append(data, size);
+                continue;
+            }
+            carry.append(data, static_cast<size_t>(static_cast<const char*>(nl) - data));
+            for_each_line(carry.data(), carry.size(), fn);
+            carry.clear();
+            rest = static_cast<const char*>(nl) + 1;
+        }
+        const char* last = end;
+        while (last > rest && last[-1] != '\n') --last;
+        for_each_line(rest, static_cast<size_t>(last - rest), fn);
+        carry.assign(last, static_cast<size_t>(end - last));
+    }
+    if (!carry.empty()) for_each_line(carry.data(), carry.size(), fn);
+    return total;
+}
+
+/**
+ * @brief Fill a Row from a data row's tokens (missing values become null)
+ */
+inline void fill_row(const std::vector<std::string>& fields, const std::vector<Token>& tokens, Row& row,
+                     const ValueFactory& factory) {
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (i < tokens.size()) {
+            row[fields[i]] = TypeInferrer::infer(tokens[i].text, tokens[i].quoted, factory);
+        } else {
+            row[fields[i]] = Value(nullptr);
+        }
+    }
+}
+
+/**
+ * @brief Per-block cell decoders chosen from the declared field types
+ *
+ * Empty when hints are ignored or no field declares a known type; cells are
+ * then inferred as usual.
+ */
+struct HintedFields {
+    std::vector<TypeHint> hints;
+    TypeHintMode mode;
+
+    HintedFields() : mode(TypeHintMode::Ignore) {}
+
+    void set(const std::vector<FieldInfo>& field_info, TypeHintMode hint_mode) {
+        mode = hint_mode;
+        hints.clear();
+        if (mode == TypeHintMode::Ignore) return;
+        bool any = false;
+        for (size_t i = 0; i < field_info.size(); ++i) {
+            hints.push_back(type_hint(field_info[i]));
+            any = any || hints.back() != TypeHint::None;
+        }
+        if (!any) hints.clear();
+    }
+
+    bool active() const { return !hints.empty(); }
+
+    TypeHint hint(size_t field) const { return field < hints.size() ? hints[field] : TypeHint::None; }
+
+    /** Fallback: infer the cell as usual; Strict: throw with its position */
+    Value mismatch(size_t field, const std::string& name, const Token& token, const ValueFactory& factory,
+                   StringView line, size_t line_num) const {
+        if (mode != TypeHintMode::Strict) return TypeInferrer::infer(token.text, token.quoted, factory);
+        const char* at = token.text.data();
+        bool in_line = at >= line.data() && at <= line.data() + line.size();
+        throw ISONSyntaxError("Field '" + name + "' expects " + type_hint_name(hints[field]) + ", got '" +
+                              std::string(token.text.data(), token.text.size()) + "'",
+                              static_cast<int>(line_num), in_line ? static_cast<int>(at - line.data()) : 0);
+    }
+};
+
+// Pushes a typed cell straight into a column; false when it does not fit
+inline bool push_hinted(Column& column, TypeHint hint, const Token& token) {
+    StringView text = token.text;
+    if (!token.quoted && (text == "null" || text == "~")) {
+        column.push_null();
+        return true;
+    }
+    switch (hint) {
+        case TypeHint::String:
+            column.push_string(text);
+            return true;
+        case TypeHint::Bool:
+            if (token.quoted) return false;
+            if (text == "true") { column.push_bool(true); return true; }
+            if (text == "false") { column.push_bool(false); return true; }
+            return false;
+        case TypeHint::Int:
+        case TypeHint::Float: {
+            if (token.quoted) return false;
+            int64_t int_value;
+            double float_value;
+            switch (parse_number(text, int_value, float_value)) {
+                case NumberKind::Integer:
+                    if (hint == TypeHint::Int) column.push_int(int_value);
+                    else column.push_float(static_cast<double>(int_value));
+                    return true;
+                case NumberKind::Float:
+                    if (hint != TypeHint::Float) return false;
+                    column.push_float(float_value);
+                    return true;
+                default:
+                    return false;
+            }
+        }
+        default: {
+            Value value;
+            if (!TypeInferrer::infer_hinted(text, token.quoted, hint, ValueFactory(), value)) return false;
+            column.push_back(value);
+            return true;
+        }
+    }
+}
+
+inline void fill_row(const std::vector<std::string>& fields, const HintedFields& hinted,
+                     const std::vector<Token>& tokens, Row& row, const ValueFactory& factory,
+                     StringView line, size_t line_num) {
+    if (!hinted.active()) {
+        fill_row(fields, tokens, row, factory);
+        return;
+    }
+    for (size_t i = 0; i < fields.size(); ++i) {
+        Value& cell = row[fields[i]];
+        if (i >= tokens.size()) {
+            cell = Value(nullptr);
+        } else if (!TypeInferrer::infer_hinted(tokens[i].text, tokens[i].quoted, hinted.hint(i), factory, cell)) {
+            cell = hinted.mismatch(i, fields[i], tokens[i], factory, line, line_num);
+        }
+    }
+}
+
+
+/**
+ * @brief Line-at-a-time ISON block state machine
+ *
+ * Recognizes block headers, field definitions, data rows and summaries, and
+ * calls the handler for each:
+ *
+ *   void begin_block(const std::string& kind, const std::string& name);
+ *   void fields(std::vector<FieldInfo>& field_info);
+ *   void row(StringView line, size_t line_num);
+ *   void summary(StringView summary);
+ *   void end_block();
+ *
+ * Lines are passed without their terminator; line numbers are 1-based.
+ */
+template<typename Handler>
+class BlockLineParser {
+public:
+    explicit BlockLineParser(Handler& handler)
+        : handler_(handler), state_(Between), line_num_(0) {}
+
+    void line(StringView line) {
+        ++line_num_;
+        StringView stripped = trim_line(line);
+
+        switch (state_) {
+            case Between:
+                if (stripped.empty() || stripped[0] == '#') return;
+                begin_block(stripped);
+                return;
+
+            case Fields: {
+                if (stripped.empty() || stripped[0] == '#') return;
+                tokenizer_.reset(line, static_cast<int>(line_num_));
+                tokenizer_.tokenize(tokens_);
+                std::vector<FieldInfo> field_info;
+                field_info.reserve(tokens_.size());
+                for (size_t i = 0; i < tokens_.size(); ++i) {
+                    field_info.push_back(FieldInfo::parse(tokens_[i].text));
+                }
+                state_ = Rows;
+                handler_.fields(field_info);
+                return;
+            }
+
+            case Rows:
+                if (stripped.empty()) { end_block(); return; }
+                if (stripped[0] == '#') return;
+                if (stripped.size() >= 3 && stripped.substr(0, 3) == "---") {
+                    state_ = Summary;
+                    return;
+                }
+                if (looks_like_header(stripped)) {
+                    end_block();
+                    begin_block(stripped);
+                    return;
+                }
+                handler_.row(line, line_num_);
+                return;
+
+            case Summary:
+                if (stripped.empty()) { end_block(); return; }
+                if (stripped[0] == '#') return;
+                state_ = Rows;
+                handler_.summary(stripped);
+                return;
+        }
+    }
+
+    void finish() {
+        if (state_ == Fields) {
+            throw ISONSyntaxError("Block '" + kind_ + "." + name_ + "' missing field definitions",
+                                  static_cast<int>(line_num_ + 1), 0);
+        }
+        if (state_ != Between) end_block();
+    }
+
+    size_t line_number() const { return line_num_; }
+
+private:
+    enum State { Between, Fields, Rows, Summary };
+
+    Handler& handler_;
+    State state_;
+    size_t line_num_;
+    std::string kind_;
+    std::string name_;
+    Tokenizer tokenizer_;
+    std::vector<Token> tokens_;
+
+    void begin_block(StringView header_line) {
+        size_t dot_pos = header_line.find('.');
+        if (dot_pos == StringView::npos) {
+            throw ISONSyntaxError("Invalid block header: '" + std::string(header_line.data(), header_line.size()) + "'",
+                                  static_cast<int>(line_num_), 0);
+        }
+        kind_.assign(header_line.data(), dot_pos);
+        name_.assign(header_line.data() + dot_pos + 1, header_line.size() - dot_pos - 1);
+        state_ = Fields;
+        handler_.begin_block(kind_, name_);
+    }
+
+    void end_block() {
+        state_ = Between;
+        handler_.end_block();
+    }
+};
+
+} // namespace detail
+
+// =============================================================================
+// Parser
+// =============================================================================
+
+/**
+ * @brief Row test on one column, checked before the rest of the row is decoded
+ *
+ * Equal / NotEqual compare with low; Range keeps low <= value <= high, where
+ * a null bound is open. Ints and floats compare with each other; values of
+ * other differing types never match. A predicate with an empty block applies
+ * to every block that has the field.
+ */
+struct RowPredicate {
+    enum Kind { Equal, NotEqual, Range };
+
+    std::string block;
+    std::string field;
+    Kind kind;
+    Value low;
+    Value high;
+
+    RowPredicate() : kind(Equal) {}
+};
+
+/**
+ * @brief Blocks, columns and rows a parse keeps
+ *
+ *   ParseFilter filter;
+ *   filter.keep_block("users")
+ *         .select("users", {"id", "name"})
+ *         .where_equal("users", "status", Value("active"));
+ *
+ * Skipped blocks are dropped line by line, and cells outside the projection
+ * are neither inferred nor allocated (the tokenizer stops after the last
+ * column it needs). Projected blocks have the selected fields, in the
+ * order given; those the block lacks are left out.
+ */
+struct ParseFilter {
+    /** Blocks to keep; empty keeps every block */
+    std::vector<std::string> blocks;
+    /** Block name -> fields to keep */
+    std::map<std::string, std::vector<std::string> > columns;
+    /** Row predicates, all of which must hold */
+    std::vector<RowPredicate> predicates;
+
+    ParseFilter& keep_block(const std::string& name) {
+        blocks.push_back(name);
+        return *this;
+    }
+
+    ParseFilter& select(const std::string& block, const std::vector<std::string>& fields) {
+        columns[block] = fields;
+        return *this;
+    }
+
+    ParseFilter& where_equal(const std::string& block, const std::string& field, const Value& value) {
+        return where(block, field, RowPredicate::Equal, value, Value());
+    }
+
+    ParseFilter& where_not_equal(const std::string& block, const std::string& field, const Value& value) {
+        return where(block, field, RowPredicate::NotEqual, value, Value());
+    }
+
+    /** Inclusive range; pass a null Value for an open bound */
+    ParseFilter& where_range(const std::string& block, const std::string& field, const Value& low, const Value& high) {
+        return where(block, field, RowPredicate::Range, low, high);
+    }
+
+    bool empty() const { return blocks.empty() && columns.empty() && predicates.empty(); }
+
+    bool keeps(const std::string& block) const {
+        return blocks.empty() || std::find(blocks.begin(), blocks.end(), block) != blocks.end();
+    }
+
+private:
+    ParseFilter& where(const std::string& block, const std::string& field, RowPredicate::Kind kind,
+                       const Value& low, const Value& high) {
+        predicates.push_back(RowPredicate());
+        RowPredicate& predicate = predicates.back();
+        predicate.block = block;
+        predicate.field = field;
+        predicate.kind = kind;
+        predicate.low = low;
+        predicate.high = high;
+        return *this;
+    }
+};
+
+/**
+ * @brief Per-block counts in ParseStats
+ */
+struct BlockStats {
+    std::string kind;
+    std::string name;
+    /** Rows kept in the result */
+    uint64_t rows;
+    /** Rows dropped by ParseFilter, including every row of a skipped block */
+    uint64_t skipped_rows;
+
+    BlockStats() : rows(0), skipped_rows(0) {}
+    BlockStats(const std::string& kind, const std::string& name)
+        : kind(kind), name(name), rows(0), skipped_rows(0) {}
+};
+
+/**
+ * @brief Counters and phase timings collected by an instrumented parse
+ *
+ * Attach one through ParseOptions::stats (Parser, parse(), load(),
+ * parse_columnar()) or the ISONLParser constructor. Without it the parser
+ * keeps its uninstrumented path; with it, each row is tokenized, inferred
+ * and stored in separately timed steps. Counts accumulate across parses
+ * until clear().
+ *
+ * allocations counts Row entries plus string and reference cells made
+ * without an intern pool (arena cells included). Columnar parses decode
+ * straight into columns, so their decoding time is reported as infer_ns
+ * and allocations stays 0.
+ */
+struct ParseStats {
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t rows;
+    uint64_t tokens;
+    uint64_t quoted_tokens;
+    uint64_t allocations;
+    uint64_t tokenize_ns;
+    uint64_t infer_ns;
+    uint64_t materialize_ns;
+    std::vector<BlockStats> blocks;
+
+    ParseStats() { clear(); }
+
+    void clear() {
+        bytes = lines = rows = tokens = quoted_tokens = allocations = 0;
+        tokenize_ns = infer_ns = materialize_ns = 0;
+        blocks.clear();
+    }
+
+    /** Share of value tokens that were quoted */
+    double quoted_ratio() const {
+        return tokens ? static_cast<double>(quoted_tokens) / static_cast<double>(tokens) : 0.0;
+    }
+
+    uint64_t total_ns() const { return tokenize_ns + infer_ns + materialize_ns; }
+};
+
+namespace detail {
+
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline void count_tokens(ParseStats& stats, const std::vector<Token>& tokens) {
+    stats.tokens += tokens.size();
+    for (size_t i = 0; i < tokens.size(); ++i) stats.quoted_tokens += tokens[i].quoted ? 1 : 0;
+}
+
+// Decodes a row's cells as fill_row() would, without storing them
+inline void decode_cells(const std::vector<std::string>& fields, const HintedFields& hinted,
+                         const std::vector<Token>& tokens, const ValueFactory& factory,
+                         StringView line, size_t line_num, std::vector<Value>& cells) {
+    cells.resize(fields.size());
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (i >= tokens.size()) {
+            cells[i] = Value(nullptr);
+        } else if (!hinted.active()) {
+            cells[i] = TypeInferrer::infer(tokens[i].text, tokens[i].quoted, factory);
+        } else if (!TypeInferrer::infer_hinted(tokens[i].text, tokens[i].quoted, hinted.hint(i), factory, cells[i])) {
+            cells[i] = hinted.mismatch(i, fields[i], tokens[i], factory, line, line_num);
+        }
+    }
+}
+
+// Moves decoded cells into a new row of block, counting its allocations
+inline void store_cells(Block& block, std::vector<Value>& cells, const ValueFactory& factory, ParseStats& stats) {
+    block.rows.push_back(Row());
+    Row& row = block.rows.back();
+    for (size_t i = 0; i < cells.size(); ++i) {
+        if ((!factory.pool && cells[i].is_string()) || cells[i].is_reference()) ++stats.allocations;
+        row[block.fields[i]] = std::move(cells[i]);
+    }
+    stats.allocations += row.size();
+}
+
+} // namespace detail
+
+/**
+ * @brief Options for parse() and load()
+ */
+struct ParseOptions {
+    /** Allocate strings and references in one arena owned by the Document */
+    bool use_arena;
+    /** Size in bytes of each arena block */
+    size_t arena_block_size;
+    /** Intern short strings and references so equal values share one cell */
+    bool intern;
+    /** Pool to intern into, e.g. one shared by many documents; created per document if null */
+    std::shared_ptr<InternPool> intern_pool;
+    /** Decode typed columns by their declared type instead of inferring */
+    TypeHintMode type_hints;
+    /** parse_lazy() / load_lazy(): keep decoded rows so later accesses reuse them */
+    bool cache_rows;
+    /** Blocks, columns and rows to keep (parse, parse_columnar and parse_parallel) */
+    ParseFilter filter;
+    /** Counters to fill in (parse and parse_columnar); not owned, null to disable */
+    ParseStats* stats;
+
+    ParseOptions() : use_arena(false), arena_block_size(64 * 1024), intern(false),
+                     type_hints(TypeHintMode::Ignore), cache_rows(true), stats(NULL) {}
+};
+
+namespace detail {
+
+// Sets up the arena and intern pool a parse allocates from
+inline ValueFactory init_document(Document& doc, const ParseOptions& options) {
+    if (options.use_arena) doc.arena = Arena::shared(options.arena_block_size);
+    doc.intern_pool = options.intern_pool;
+    if (!doc.intern_pool && options.intern) doc.intern_pool = std::make_shared<InternPool>();
+    return ValueFactory(doc.arena, doc.intern_pool.get());
+}
+
+// Orders two values: -1, 0 or 1, or 2 when they are not comparable
+inline int compare_values(const Value& a, const Value& b) {
+    if (a.is_int() && b.is_int()) {
+        return a.as_int() < b.as_int() ? -1 : (b.as_int() < a.as_int() ? 1 : 0);
+    }
+    if ((a.is_int() || a.is_float()) && (b.is_int() || b.is_float())) {
+        double x = a.is_int() ? static_cast<double>(a.as_int()) : a.as_float();
+        double y = b.is_int() ? static_cast<double>(b.as_int()) : b.as_float();
+        return x < y ? -1 : (y < x ? 1 : (x == y ? 0 : 2));
+    }
+    if (a.type() != b.type()) return 2;
+    switch (a.type()) {
+        case ValueType::Null: return 0;
+        case ValueType::Bool: return a.as_bool() == b.as_bool() ? 0 : (a.as_bool() ? 1 : -1);
+        case ValueType::String: {
+            int c = a.as_string().compare(b.as_string());
+            return c < 0 ? -1 : (c > 0 ? 1 : 0);
+        }
+        case ValueType::Reference: {
+            int c = a.get_reference()->to_ison().compare(b.get_reference()->to_ison());
+            return c < 0 ? -1 : (c > 0 ? 1 : 0);
+        }
+        default: return 2;
+    }
+}
+
+// A ParseFilter resolved against the fields of one block
+struct BlockFilter {
+    struct Test {
+        size_t column;              // npos: the block lacks the field, the cell is null
+        std::string field;
+        RowPredicate::Kind kind;
+        Value low;
+        Value high;
+    };
+
+    std::vector<size_t> columns;    // source column of each kept field, when projecting
+    bool projecting;
+    std::vector<Test> tests;
+    HintedFields source_hints;      // decodes predicate cells as the full row would
+    size_t needed;                  // tokens a row must be split into
+
+    BlockFilter() : projecting(false), needed(static_cast<size_t>(-1)) {}
+
+    bool active() const { return projecting || !tests.empty(); }
+
+    /** Resolve filter for a block; field_info becomes the projected fields */
+    void set(const ParseFilter& filter, const std::string& block, std::vector<FieldInfo>& field_info,
+             TypeHintMode hint_mode) {
+        static const size_t npos = static_cast<size_t>(-1);
+        columns.clear();
+        tests.clear();
+        projecting = false;
+        needed = npos;
+        if (filter.columns.empty() && filter.predicates.empty()) return;
+
+        size_t last = 0;
+        std::map<std::string, std::vector<std::string> >::const_iterator projection = filter.columns.find(block);
+        for (size_t p = 0; p < filter.predicates.size(); ++p) {
+            const RowPredicate& predicate = filter.predicates[p];
+            if (!predicate.block.empty() && predicate.block != block) continue;
+            size_t column = find_field(field_info, predicate.field);
+            if (column == npos && predicate.block.empty()) continue;
+            Test test = { column, predicate.field, predicate.kind, predicate.low, predicate.high };
+            tests.push_back(test);
+            if (column != npos && column + 1 > last) last = column + 1;
+        }
+        source_hints.set(field_info, hint_mode);
+        if (projection == filter.columns.end()) return;
+
+        projecting = true;
+        std::vector<FieldInfo> projected;
+        for (size_t i = 0; i < projection->second.size(); ++i) {
+            size_t column = find_field(field_info, projection->second[i]);
+            if (column == npos) continue;
+            columns.push_back(column);
+            projected.push_back(field_info[column]);
+            if (column + 1 > last) last = column + 1;
+        }
+        field_info.swap(projected);
+        needed = last;
+    }
+
+    /** Whether a row passes every predicate */
+    bool accept(const std::vector<Token>& tokens, StringView line, size_t line_num) const {
+        for (size_t t = 0; t < tests.size(); ++t) {
+            if (!passes(tests[t], tokens, line, line_num)) return false;
+        }
+        return true;
+    }
+
+    /** The tokens of the kept fields, in projection order */
+    void project(const std::vector<Token>& tokens, std::vector<Token>& out) const {
+        static const Token null_token(StringView("null", 4), false);
+        out.clear();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            out.push_back(columns[i] < tokens.size() ? tokens[columns[i]] : null_token);
+        }
+    }
+
+private:
+    static size_t find_field(const std::vector<FieldInfo>& field_info, const std::string& name) {
+        for (size_t i = 0; i < field_info.size(); ++i) {
+            if (field_info[i].name == name) return i;
+        }
+        return static_cast<size_t>(-1);
+    }
+
+    bool passes(const Test& test, const std::vector<Token>& tokens, StringView line, size_t line_num) const {
+        Value cell;
+        if (test.column < tokens.size()) {
+            const Token& token = tokens[test.column];
+            TypeHint hint = source_hints.hint(test.column);
+            // A string comparand can only equal a cell with the same text
+            if (test.kind != RowPredicate::Range && test.low.is_string() && hint == TypeHint::None &&
+                token.text != StringView(test.low.as_string())) {
+                return test.kind == RowPredicate::NotEqual;
+            }
+            ValueFactory plain;
+            if (hint == TypeHint::None) {
+                cell = TypeInferrer::infer(token.text, token.quoted);
+            } else if (!TypeInferrer::infer_hinted(token.text, token.quoted, hint, plain, cell)) {
+                cell = source_hints.mismatch(test.column, test.field, token, plain, line, line_num);
+            }
+        }
+        if (test.kind == RowPredicate::Equal) return compare_values(cell, test.low) == 0;
+        if (test.kind == RowPredicate::NotEqual) return compare_values(cell, test.low) != 0;
+        if (!test.low.is_null()) {
+            int c = compare_values(cell, test.low);
+            if (c != 0 && c != 1) return false;
+        }
+        if (!test.high.is_null()) {
+            int c = compare_values(cell, test.high);
+            if (c != 0 && c != -1) return false;
+        }
+        return true;
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Parses ISON text into a Document
+ *
+ * The std::string constructor keeps its own copy of the text. The
+ * (data, size) constructor borrows the buffer instead: lines and tokens are
+ * views into it, so it must outlive parse().
+ */
+class Parser {
+public:
+    explicit Parser(const std::string& text, const ParseOptions& options = ParseOptions())
+        : owned_(text), data_(NULL), size_(text.size()), owns_(true), options_(options) {}
+
+    Parser(const char* data, size_t size, const ParseOptions& options = ParseOptions())
+        : data_(data), size_(size), owns_(false), options_(options) {}
+
+    Document parse() {
+        Document doc;
+        BlockBuilder<Document> builder(doc, detail::init_document(doc, options_), options_);
+        run(builder);
+        doc.reindex();
+        return doc;
+    }
+
+    /**
+     * @brief Parse text that arrives in chunks, e.g. from a ReadAheadSource
+     *
+     * chunks.next(data, size) returns each chunk in turn and false at the end.
+     */
+    template<typename Chunks>
+    static Document parse_chunks(Chunks& chunks, const ParseOptions& options = ParseOptions()) {
+        Document doc;
+        BlockBuilder<Document> builder(doc, detail::init_document(doc, options), options);
+        detail::BlockLineParser<BlockBuilder<Document> > lines(builder);
+        LineFeeder<BlockBuilder<Document> > feed(lines);
+        size_t bytes = detail::for_each_chunk_line(chunks, feed);
+        lines.finish();
+        if (options.stats) {
+            options.stats->bytes += bytes;
+            options.stats->lines += lines.line_number();
+        }
+        doc.reindex();
+        return doc;
+    }
+
+    /**
+     * @brief Parse straight into column storage, without building Row maps
+     */
+    ColumnarDocument parse_columnar() {
+        ColumnarDocument doc;
+        BlockBuilder<ColumnarDocument> builder(doc, detail::ValueFactory(), options_);
+        run(builder);
+        doc.reindex();
+        return doc;
+    }
+
+private:
+    std::string owned_;
+    const char* data_;
+    size_t size_;
+    bool owns_;
+    ParseOptions options_;
+
+    const char* text_data() const { return owns_ ? owned_.data() : data_; }
+
+    template<typename Handler>
+    void run(Handler& handler) {
+        detail::BlockLineParser<Handler> lines(handler);
+        LineFeeder<Handler> feed(lines);
+        detail::for_each_line(text_data(), size_, feed);
+        lines.finish();
+        if (options_.stats) {
+            options_.stats->bytes += size_;
+            options_.stats->lines += lines.line_number();
+        }
+    }
+
+    template<typename Handler>
+    struct LineFeeder {
+        detail::BlockLineParser<Handler>& lines;
+        explicit LineFeeder(detail::BlockLineParser<Handler>& lines) : lines(lines) {}
+        void operator()(StringView line) { lines.line(line); }
+    };
+
+    // Builds the blocks of a Document or ColumnarDocument from line events
+    template<typename DocT>
+    struct BlockBuilder {
+        DocT& doc;
+        detail::ValueFactory factory;
+        TypeHintMode hint_mode;
+        detail::HintedFields hinted;
+        const ParseFilter& filter;
+        detail::BlockFilter block_filter;
+        bool skipping;
+        Tokenizer tokenizer;
+        std::vector<Token> tokens;
+        std::vector<Token> projected;
+        ParseStats* stats;
+        std::vector<Value> cells;
+
+        BlockBuilder(DocT& doc, const detail::ValueFactory& factory, const ParseOptions& options)
+            : doc(doc), factory(factory), hint_mode(options.type_hints), filter(options.filter), skipping(false),
+              stats(options.stats) {}
+
+        void begin_block(const std::string& kind, const std::string& name) {
+            if (stats) stats->blocks.push_back(BlockStats(kind, name));
+            skipping = !filter.keeps(name);
+            if (skipping) return;
+            doc.blocks.resize(doc.blocks.size() + 1);
+            doc.blocks.back().kind = kind;
+            doc.blocks.back().name = name;
+        }
+
+        void fields(std::vector<FieldInfo>& field_info) {
+            if (skipping) return;
+            block_filter.set(filter, doc.blocks.back().name, field_info, hint_mode);
+            set_fields(doc.blocks.back(), field_info);
+            hinted.set(doc.blocks.back().field_info, hint_mode);
+        }
+
+        void row(StringView line, size_t line_num) {
+            if (stats) {
+                instrumented_row(line, line_num);
+                return;
+            }
+            if (skipping) return;
+            tokenizer.reset(line, static_cast<int>(line_num));
+            tokenizer.tokenize(tokens, block_filter.needed);
+            if (!block_filter.active()) {
+                append_row(doc.blocks.back(), tokens, factory, hinted, line, line_num);
+                return;
+            }
+            if (!block_filter.accept(tokens, line, line_num)) return;
+            if (!block_filter.projecting) {
+                append_row(doc.blocks.back(), tokens, factory, hinted, line, line_num);
+                return;
+            }
+            block_filter.project(tokens, projected);
+            append_row(doc.blocks.back(), projected, factory, hinted, line, line_num);
+        }
+
+        void summary(StringView text) {
+            if (skipping) return;
+            doc.blocks.back().summary = std::string(text.data(), text.size());
+        }
+
+        void end_block() {}
+
+        // row() with each step timed and counted into stats
+        void instrumented_row(StringView line, size_t line_num) {
+            BlockStats& block_stats = stats->blocks.back();
+            if (skipping) {
+                ++block_stats.skipped_rows;
+                return;
+            }
+            uint64_t start = detail::now_ns();
+            tokenizer.reset(line, static_cast<int>(line_num));
+            tokenizer.tokenize(tokens, block_filter.needed);
+            detail::count_tokens(*stats, tokens);
+            uint64_t tokenized = detail::now_ns();
+            stats->tokenize_ns += tokenized - start;
+
+            const std::vector<Token>* kept = &tokens;
+            if (block_filter.active()) {
+                if (!block_filter.accept(tokens, line, line_num)) {
+                    ++block_stats.skipped_rows;
+                    stats->infer_ns += detail::now_ns() - tokenized;
+                    return;
+                }
+                if (block_filter.projecting) {
+                    block_filter.project(tokens, projected);
+                    kept = &projected;
+                }
+            }
+            store_row(doc.blocks.back(), *kept, line, line_num, tokenized);
+            ++block_stats.rows;
+            ++stats->rows;
+        }
+
+        void store_row(Block& block, const std::vector<Token>& row_tokens, StringView line, size_t line_num,
+                       uint64_t start) {
+            detail::decode_cells(block.fields, hinted, row_tokens, factory, line, line_num, cells);
+            uint64_t inferred = detail::now_ns();
+            stats->infer_ns += inferred - start;
+            detail::store_cells(block, cells, factory, *stats);
+            stats->materialize_ns += detail::now_ns() - inferred;
+        }
+
+        void store_row(ColumnarBlock& block, const std::vector<Token>& row_tokens, StringView line, size_t line_num,
+                       uint64_t start) {
+            append_row(block, row_tokens, factory, hinted, line, line_num);
+            stats->infer_ns += detail::now_ns() - start;
+        }
+    };
+
+    static void set_fields(Block& block, std::vector<FieldInfo>& field_info) {
+        block.fields.reserve(field_info.size());
+        for (size_t i = 0; i < field_info.size(); ++i) block.fields.push_back(field_info[i].name);
+        block.field_info.swap(field_info);
+    }
+
+    static void set_fields(ColumnarBlock& block, std::vector<FieldInfo>& field_info) {
+        block.set_fields(field_info);
+    }
+
+    static void append_row(Block& block, const std::vector<Token>& tokens, const detail::ValueFactory& factory,
+                           const detail::HintedFields& hinted, StringView line, size_t line_num) {
+        block.rows.push_back(Row());
+        detail::fill_row(block.fields, hinted, tokens, block.rows.back(), factory, line, line_num);
+    }
+
+    static void append_row(ColumnarBlock& block, const std::vector<Token>& tokens, const detail::ValueFactory& factory,
+                           const detail::HintedFields& hinted, StringView line, size_t line_num) {
+        for (size_t i = 0; i < block.columns.size(); ++i) {
+            Column& column = block.columns[i];
+            if (i >= tokens.size()) {
+                column.push_null();
+            } else if (hinted.hint(i) != TypeHint::None) {
+                if (!detail::push_hinted(column, hinted.hint(i), tokens[i])) {
+                    column.push_back(hinted.mismatch(i, block.fields[i], tokens[i], factory, line, line_num));
+                }
+            } else if (tokens[i].quoted) {
+                column.push_string(tokens[i].text);
+            } else {
+                column.push_back(TypeInferrer::infer(tokens[i].text, false));
+            }
+        }
+        block.commit_row();
+    }
+};
+
+// =============================================================================
+// Parallel Parsing
+// =============================================================================
+
+namespace detail {
+
+/**
+ * @brief Run fn(task) for task in [0, task_count) on up to thread_count threads
+ *
+ * The calling thread takes part. If tasks throw, the exception of the
+ * lowest-numbered failing task is rethrown once all threads have joined.
+ */
+template<typename F>
+inline void parallel_for(size_t task_count, size_t thread_count, F& fn) {
+    if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0) thread_count = 1;
+    if (thread_count > task_count) thread_count = task_count;
+
+    std::vector<std::exception_ptr> errors(task_count);
+    std::atomic<size_t> next(0);
+
+    struct Worker {
+        F& fn;
+        std::atomic<size_t>& next;
+        std::vector<std::exception_ptr>& errors;
+        size_t task_count;
+
+        void operator()() {
+            while (true) {
+                size_t task = next.fetch_add(1);
+                if (task >= task_count) return;
+                try {
+                    fn(task);
+                } catch (...) {
+                    errors[task] = std::current_exception();
+                }
+            }
+        }
+    };
+
+    Worker worker = { fn, next, errors, task_count };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) threads.push_back(std::thread(worker));
+    worker();
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+    for (size_t i = 0; i < errors.size(); ++i) {
+        if (errors[i]) std::rethrow_exception(errors[i]);
+    }
+}
+
+/**
+ * @brief Location of one data row inside the source text
+ */
+struct RowSpan {
+    size_t offset;
+    size_t length;
+    size_t line_num;
+};
+
+/**
+ * @brief Structure of one block: header, schema, summary and row locations
+ */
+struct BlockSpan {
+    std::string kind;
+    std::string name;
+    std::vector<FieldInfo> field_info;
+    Optional<std::string> summary;
+    std::vector<RowSpan> rows;
+};
+
+// Records block structure and row offsets without tokenizing rows
+struct BlockIndexer {
+    std::vector<BlockSpan>& blocks;
+    const char* base;
+
+    BlockIndexer(std::vector<BlockSpan>& blocks, const char* base) : blocks(blocks), base(base), lines(NULL) {}
+
+    void begin_block(const std::string& kind, const std::string& name) {
+        blocks.push_back(BlockSpan());
+        blocks.back().kind = kind;
+        blocks.back().name = name;
+    }
+    void fields(std::vector<FieldInfo>& field_info) { blocks.back().field_info.swap(field_info); }
+    void row(StringView line, size_t line_num) {
+        RowSpan span = { static_cast<size_t>(line.data() - base), line.size(), line_num };
+        blocks.back().rows.push_back(span);
+    }
+    void summary(StringView text) { blocks.back().summary = std::string(text.data(), text.size()); }
+    void end_block() {}
+
+    void operator()(StringView line) { lines->line(line); }
+    BlockLineParser<BlockIndexer>* lines;
+};
+
+/**
+ * @brief Scan a buffer for block boundaries and row line offsets
+ *
+ * If the text has a structural error, the blocks indexed before it are kept
+ * and the error is returned instead of thrown.
+ */
+inline std::exception_ptr index_blocks(const char* data, size_t size, std::vector<BlockSpan>& blocks) {
+    BlockIndexer indexer(blocks, data);
+    BlockLineParser<BlockIndexer> lines(indexer);
+    indexer.lines = &lines;
+    try {
+        for_each_line(data, size, indexer);
+        lines.finish();
+    } catch (...) {
+        return std::current_exception();
+    }
+    return std::exception_ptr();
+}
+
+// Decodes a range of rows of one block into preallocated Row slots
+struct RowRangeTask {
+    const char* data;
+    const std::vector<BlockSpan>* spans;
+    Document* doc;
+    struct Range { size_t block; size_t begin; size_t end; };
+    std::vector<Range> ranges;
+    // One arena per task when arena allocation is on, adopted by doc->arena
+    std::vector<std::shared_ptr<Arena> > arenas;
+    size_t arena_block_size;
+    InternPool* pool;
+    std::vector<HintedFields> hinted;    // per block
+    std::vector<BlockFilter> filters;    // per block
+    std::vector<std::vector<unsigned char> > rejected;   // per block row, when it has predicates
+
+    void operator()(size_t task) {
+        const Range& range = ranges[task];
+        const BlockSpan& span = (*spans)[range.block];
+        Block& block = doc->blocks[range.block];
+        ValueFactory factory(std::shared_ptr<Arena>(), pool);
+        if (!arenas.empty()) {
+            arenas[task] = Arena::shared(arena_block_size);
+            factory.arena = arenas[task];
+        }
+        const BlockFilter& filter = filters[range.block];
+        Tokenizer tokenizer;
+        std::vector<Token> tokens;
+        std::vector<Token> projected;
+        for (size_t r = range.begin; r < range.end; ++r) {
+            const RowSpan& row = span.rows[r];
+            StringView line(data + row.offset, row.length);
+            tokenizer.reset(line, static_cast<int>(row.line_num));
+            tokenizer.tokenize(tokens, filter.needed);
+            if (!filter.accept(tokens, line, row.line_num)) {
+                rejected[range.block][r] = 1;
+                continue;
+            }
+            if (filter.projecting) filter.project(tokens, projected);
+            fill_row(block.fields, hinted[range.block], filter.projecting ? projected : tokens, block.rows[r],
+                     factory, line, row.line_num);
+        }
+    }
+};
+
+inline Document parse_parallel(const char* data, size_t size, size_t thread_count, const ParseOptions& options) {
+    std::vector<BlockSpan> spans;
+    std::exception_ptr structure_error = index_blocks(data, size, spans);
+    if (!options.filter.blocks.empty()) {
+        size_t kept = 0;
+        for (size_t i = 0; i < spans.size(); ++i) {
+            if (!options.filter.keeps(spans[i].name)) continue;
+            if (kept != i) std::swap(spans[kept], spans[i]);
+            ++kept;
+        }
+        spans.resize(kept);
+    }
+
+    std::vector<BlockFilter> filters(spans.size());
+    for (size_t i = 0; i < spans.size(); ++i) {
+        filters[i].set(options.filter, spans[i].name, spans[i].field_info, options.type_hints);
+    }
+
+    Document doc;
+    ValueFactory factory = init_document(doc, options);
+    doc.blocks.resize(spans.size());
+    size_t total_rows = 0;
+    for (size_t i = 0; i < spans.size(); ++i) {
+        Block& block = doc.blocks[i];
+        block.kind = spans[i].kind;
+        block.name = spans[i].name;
+        block.field_info.swap(spans[i].field_info);
+        for (size_t f = 0; f < block.field_info.size(); ++f) block.fields.push_back(block.field_info[f].name);
+        block.summary = spans[i].summary;
+        block.rows.resize(spans[i].rows.size());
+        total_rows += spans[i].rows.size();
+    }
+
+    if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0) thread_count = 1;
+    size_t chunk = total_rows / (thread_count * 8);
+    if (chunk < 256) chunk = 256;
+
+    RowRangeTask task;
+    task.data = data;
+    task.spans = &spans;
+    task.doc = &doc;
+    for (size_t b = 0; b < spans.size(); ++b) {
+        size_t rows = spans[b].rows.size();
+        for (size_t begin = 0; begin < rows; begin += chunk) {
+            RowRangeTask::Range range = { b, begin, begin + chunk < rows ? begin + chunk : rows };
+            task.ranges.push_back(range);
+        }
+    }
+
+    task.arena_block_size = options.arena_block_size;
+    task.pool = factory.pool;
+    task.hinted.resize(doc.blocks.size());
+    for (size_t b = 0; b < doc.blocks.size(); ++b) task.hinted[b].set(doc.blocks[b].field_info, options.type_hints);
+    task.filters.swap(filters);
+    task.rejected.resize(doc.blocks.size());
+    for (size_t b = 0; b < doc.blocks.size(); ++b) {
+        if (!task.filters[b].tests.empty()) task.rejected[b].assign(doc.blocks[b].rows.size(), 0);
+    }
+    if (doc.arena) task.arenas.resize(task.ranges.size());
+
+    // Row errors come from lines before the structural error, so they win
+    parallel_for(task.ranges.size(), thread_count, task);
+    for (size_t i = 0; i < task.arenas.size(); ++i) doc.arena->adopt(task.arenas[i]);
+    for (size_t b = 0; b < doc.blocks.size(); ++b) {
+        const std::vector<unsigned char>& rejected = task.rejected[b];
+        if (rejected.empty()) continue;
+        std::vector<Row>& rows = doc.blocks[b].rows;
+        size_t kept = 0;
+        for (size_t r = 0; r < rows.size(); ++r) {
+            if (rejected[r]) continue;
+            if (kept != r) rows[kept].swap(rows[r]);
+            ++kept;
+        }
+        rows.resize(kept);
+    }
+    if (structure_error) std::rethrow_exception(structure_error);
+    doc.reindex();
+    return doc;
+}
+
+} // namespace detail
+
+// =============================================================================
+// Streaming Reader
+// =============================================================================
+
+/**
+ * @brief Receives blocks from a StreamParser or load_stream() one event at a time
+ *
+ * Row values arrive in field order, one per field (missing values are null).
+ * The vector is reused between rows.
+ */
+class BlockVisitor {
+public:
+    virtual ~BlockVisitor() {}
+    virtual void on_block(const std::string& /*kind*/, const std::string& /*name*/) {}
+    virtual void on_fields(const std::vector<FieldInfo>& /*field_info*/) {}
+    virtual void on_row(const std::vector<Value>& /*values*/) {}
+    virtual void on_summary(const std::string& /*summary*/) {}
+    virtual void on_block_end() {}
+};
+
+/**
+ * @brief Source of input chunks for StreamReader
+ */
+class ChunkSource {
+public:
+    virtual ~ChunkSource() {}
+    /** Fill up to capacity bytes; returns 0 at end of input */
+    virtual size_t read(char* buffer, size_t capacity) = 0;
+};
+
+class IStreamSource : public ChunkSource {
+public:
+    explicit IStreamSource(std::istream& in) : in_(in) {}
+
+    size_t read(char* buffer, size_t capacity) {
+        in_.read(buffer, static_cast<std::streamsize>(capacity));
+        return static_cast<size_t>(in_.gcount());
+    }
+
+private:
+    std::istream& in_;
+};
+
+namespace detail {
+
+// Reassembles lines from arbitrary chunk boundaries
+class LineBuffer {
+public:
+    LineBuffer() : pos_(0), scanned_(0) {}
+
+    void append(const char* data, size_t size) {
+        if (pos_ > 0) {
+            buffer_.erase(0, pos_);
+            scanned_ -= pos_;
+            pos_ = 0;
+        }
+        buffer_.append(data, size);
+    }
+
+    /** Next complete line, valid until the next append() */
+    bool next_line(StringView& line) {
+        size_t nl = buffer_.find('\n', scanned_);
+        if (nl == std::string::npos) {
+            scanned_ = buffer_.size();
+            return false;
+        }
+        line = make_line(pos_, nl);
+        pos_ = nl + 1;
+        scanned_ = pos_;
+        return true;
+    }
+
+    /** Trailing line without a terminator, at end of input */
+    bool take_rest(StringView& line) {
+        if (pos_ >= buffer_.size()) return false;
+        line = make_line(pos_, buffer_.size());
+        pos_ = scanned_ = buffer_.size();
+        return true;
+    }
+
+private:
+    std::string buffer_;
+    size_t pos_;
+    size_t scanned_;
+
+    StringView make_line(size_t begin, size_t end) const {
+        if (end > begin && buffer_[end - 1] == '\r') --end;
+        return StringView(buffer_.data() + begin, end - begin);
+    }
+};
+
+// Infers row values and records block state for the streaming readers
+struct StreamState {
+    std::string kind;
+    std::string name;
+    std::vector<FieldInfo> field_info;
+    std::vector<std::string> fields;
+    std::vector<Value> values;
+    Tokenizer tokenizer;
+    std::vector<Token> tokens;
+
+    void begin_block(const std::string& k, const std::string& n) {
+        kind = k;
+        name = n;
+        field_info.clear();
+        fields.clear();
+    }
+
+    void set_fields(std::vector<FieldInfo>& infos) {
+        field_info.swap(infos);
+        fields.clear();
+        for (size_t i = 0; i < field_info.size(); ++i) fields.push_back(field_info[i].name);
+    }
+
+    void decode_row(StringView line, size_t line_num) {
+        tokenizer.reset(line, static_cast<int>(line_num));
+        tokenizer.tokenize(tokens);
+        values.resize(fields.size());
+        for (size_t i = 0; i < fields.size(); ++i) {
+            values[i] = i < tokens.size() ? TypeInferrer::infer(tokens[i].text, tokens[i].quoted) : Value(nullptr);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Push-style incremental parser
+ *
+ * Feed chunks as they arrive (split anywhere, including inside a line) and
+ * events are delivered to the visitor as soon as each line is complete.
+ * Memory use is bounded by the longest line.
+ */
+class StreamParser {
+public:
+    explicit StreamParser(BlockVisitor& visitor)
+        : handler_(visitor), lines_(handler_), finished_(false) {}
+
+    void feed(const char* data, size_t size) {
+        buffer_.append(data, size);
+        StringView line;
+        while (buffer_.next_line(line)) lines_.line(line);
+    }
+
+    void feed(const std::string& chunk) { feed(chunk.data(), chunk.size()); }
+
+    /** Flush the last unterminated line and close the open block */
+    void finish() {
+        if (finished_) return;
+        finished_ = true;
+        StringView line;
+        if (buffer_.take_rest(line)) lines_.line(line);
+        lines_.finish();
+    }
+
+private:
+    struct Handler {
+        BlockVisitor& visitor;
+        detail::StreamState state;
+
+        explicit Handler(BlockVisitor& v) : visitor(v) {}
+
+        void begin_block(const std::string& kind, const std::string& name) {
+            state.begin_block(kind, name);
+            visitor.on_block(kind, name);
+        }
+        void fields(std::vector<FieldInfo>& infos) {
+            state.set_fields(infos);
+            visitor.on_fields(state.field_info);
+        }
+        void row(StringView line, size_t line_num) {
+            state.decode_row(line, line_num);
+            visitor.on_row(state.values);
+        }
+        void summary(StringView text) { visitor.on_summary(std::string(text.data(), text.size())); }
+        void end_block() { visitor.on_block_end(); }
+    };
+
+    Handler handler_;
+    detail::BlockLineParser<Handler> lines_;
+    detail::LineBuffer buffer_;
+    bool finished_;
+};
+
+/**
+ * @brief Pull-style streaming reader
+ *
+ *   IStreamSource source(file);
+ *   StreamReader reader(source);
+ *   while (reader.next_row()) {
+ *       use(reader.name(), reader.values());
+ *   }
+ *
+ * Only rows are surfaced; blocks without rows are passed over.
+ */
+class StreamReader {
+public:
+    explicit StreamReader(ChunkSource& source, size_t chunk_size = 65536)
+        : source_(source), chunk_(chunk_size > 0 ? chunk_size : 1), handler_(*this),
+          lines_(handler_), row_ready_(false), eof_(false), finished_(false), block_index_(0) {}
+
+    bool next_row() {
+        row_ready_ = false;
+        StringView line;
+        while (true) {
+            if (buffer_.next_line(line)) {
+                lines_.line(line);
+                if (row_ready_) return true;
+                continue;
+            }
+            if (eof_) {
+                if (finished_) return false;
+                finished_ = true;
+                if (buffer_.take_rest(line)) lines_.line(line);
+                lines_.finish();
+                return row_ready_;
+            }
+            size_t n = source_.read(&chunk_[0], chunk_.size());
+            if (n == 0) eof_ = true;
+            else buffer_.append(chunk_.data(), n);
+        }
+    }
+
+    const std::string& kind() const { return handler_.state.kind; }
+    const std::string& name() const { return handler_.state.name; }
+    const std::vector<std::string>& fields() const { return handler_.state.fields; }
+    const std::vector<FieldInfo>& field_info() const { return handler_.state.field_info; }
+    const std::vector<Value>& values() const { return handler_.state.values; }
+
+    /** 1-based index of the block the current row belongs to */
+    size_t block_index() const { return block_index_; }
+
+    Row row() const {
+        Row result;
+        for (size_t i = 0; i < fields().size(); ++i) result[fields()[i]] = values()[i];
+        return result;
+    }
+
+private:
+    struct Handler {
+        StreamReader& reader;
+        detail::StreamState state;
+
+        explicit Handler(StreamReader& r) : reader(r) {}
+
+        void begin_block(const std::string& kind, const std::string& name) {
+            state.begin_block(kind, name);
+            ++reader.block_index_;
+        }
+        void fields(std::vector<FieldInfo>& infos) { state.set_fields(infos); }
+        void row(StringView line, size_t line_num) {
+            state.decode_row(line, line_num);
+            reader.row_ready_ = true;
+        }
+        void summary(StringView) {}
+        void end_block() {}
+    };
+
+    ChunkSource& source_;
+    std::vector<char> chunk_;
+    Handler handler_;
+    detail::BlockLineParser<Handler> lines_;
+    detail::LineBuffer buffer_;
+    bool row_ready_;
+    bool eof_;
+    bool finished_;
+    size_t block_index_;
+};
+
+// =============================================================================
+// ISON Writer
+// =============================================================================
+
+/**
+ * @brief Destination for serialized text
+ *
+ * Writers buffer their output and pass it to the sink in large chunks.
+ */
+class Sink {
+public:
+    virtual ~Sink() {}
+    virtual void write(const char* data, size_t size) = 0;
+
+    /** @brief Push written data to durable storage, where the sink has any */
+    virtual void sync() {}
+};
+
+class StreamSink : public Sink {
+public:
+    explicit StreamSink(std::ostream& out) : out_(out) {}
+    void write(const char* data, size_t size) { out_.write(data, static_cast<std::streamsize>(size)); }
+    void sync() { out_.flush(); }
+
+private:
+    std::ostream& out_;
+};
+
+/**
+ * @brief Unbuffered file sink; sync() flushes the file to disk (fsync)
+ */
+class FileSink : public Sink {
+public:
+    explicit FileSink(const std::string& path, bool append = true)
+        : path_(path), file_(std::fopen(path.c_str(), append ? "ab" : "wb")) {
+        if (!file_) {
+            throw ISONError("Could not open file for writing: " + path);
+        }
+        // Writers hand over large chunks already; skip stdio's own buffer
+        std::setvbuf(file_, NULL, _IONBF, 0);
+    }
+
+    ~FileSink() { std::fclose(file_); }
+
+    void write(const char* data, size_t size) {
+        if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+            throw ISONError("Could not write to file: " + path_);
+        }
+    }
+
+    void sync() {
+        bool ok = std::fflush(file_) == 0;
+#if ISON_HAS_FSYNC && defined(_WIN32)
+        ok = ok && _commit(_fileno(file_)) == 0;
+#elif ISON_HAS_FSYNC
+        ok = ok && fsync(fileno(file_)) == 0;
+#endif
+        if (!ok) {
+            throw ISONError("Could not sync file: " + path_);
+        }
+    }
+
+private:
+    std::string path_;
+    FILE* file_;
+
+    FileSink(const FileSink&);
+    FileSink& operator=(const FileSink&);
+};
+
+namespace detail {
+
+// Where a writer's text goes: straight into a caller's string, or into an
+// internal buffer that is drained into a Sink once it holds limit bytes
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::string& out) : out_(&out), sink_(NULL), limit_(0) {}
+
+    OutputBuffer(Sink& sink, size_t limit) : out_(&buffer_), sink_(&sink), limit_(limit) {
+        buffer_.reserve(limit + 4096);
+    }
+
+    OutputBuffer(std::ostream& out, size_t limit)
+        : out_(&buffer_), stream_sink_(new StreamSink(out)), sink_(stream_sink_.get()), limit_(limit) {
+        buffer_.reserve(limit + 4096);
+    }
+
+    std::string& text() { return *out_; }
+    Sink* sink() const { return sink_; }
+    bool full() const { return sink_ && buffer_.size() >= limit_; }
+
+    void maybe_flush() {
+        if (full()) flush();
+    }
+
+    void flush() {
+        if (!sink_ || buffer_.empty()) return;
+        sink_->write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+private:
+    std::string* out_;
+    std::string buffer_;
+    std::unique_ptr<StreamSink> stream_sink_;
+    Sink* sink_;
+    size_t limit_;
+
+    OutputBuffer(const OutputBuffer&);
+    OutputBuffer& operator=(const OutputBuffer&);
+};
+
+} // namespace detail
+
+namespace detail {
+
+inline void append_uint(std::string& out, uint64_t value) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    out.append(p, static_cast<size_t>(end - p));
+}
+
+inline void append_int(std::string& out, int64_t value) {
+    if (value < 0) out += '-';
+    append_uint(out, value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value));
+}
+
+/**
+ * @brief Shortest text that parses back to the same double, in fixed notation
+ *
+ * ISON has no exponent syntax, so 1e20 is written as 100000000000000000000.0;
+ * a ".0" is added to integral values so they read back as floats.
+ */
+inline void append_double(std::string& out, double value) {
+    if (value != value) { out += "nan"; return; }
+    if (value == HUGE_VAL) { out += "inf"; return; }
+    if (value == -HUGE_VAL) { out += "-inf"; return; }
+
+    char buf[400];
+    size_t start = out.size();
+#if ISON_HAS_TO_CHARS
+    std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed);
+    out.append(buf, static_cast<size_t>(res.ptr - buf));
+#else
+    // Fewest significant digits that round-trip, then laid out in fixed form
+    char sci[40];
+    for (int precision = 1; precision <= 17; ++precision) {
+        std::snprintf(sci, sizeof(sci), "%.*e", precision - 1, value);
+        if (std::strtod(sci, NULL) == value) break;
+    }
+    char digits[24];
+    size_t n = 0;
+    const char* p = sci;
+    if (*p == '-') out += *p++;
+    for (; *p && *p != 'e' && *p != 'E'; ++p) {
+        if (*p >= '0' && *p <= '9') digits[n++] = *p;
+    }
+    int exponent = *p ? std::atoi(p + 1) : 0;
+    while (n > 1 && digits[n - 1] == '0') --n;
+
+    int point = exponent + 1;
+    if (point <= 0) {
+        out += "0.";
+        out.append(static_cast<size_t>(-point), '0');
+        out.append(digits, n);
+    } else if (static_cast<size_t>(point) >= n) {
+        out.append(digits, n);
+        out.append(static_cast<size_t>(point) - n, '0');
+    } else {
+        out.append(digits, static_cast<size_t>(point));
+        out += '.';
+        out.append(digits + point, n - static_cast<size_t>(point));
+    }
+    (void)buf;
+#endif
+    if (out.find('.', start) == std::string::npos) out += ".0";
+}
+
+inline bool looks_like_number(StringView s) {
+    if (s.empty()) return false;
+    size_t start = (s[0] == '-') ? 1 : 0;
+    if (start == s.size()) return false;
+    for (size_t i = start; i < s.size(); ++i) {
+        if (s[i] != '.' && !std::isdigit(static_cast<unsigned char>(s[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Strings that would otherwise read back as another type or split the row;
+// ISONL lines also split on '|'
+inline bool needs_ison_quotes(StringView s, bool isonl = false) {
+    if (s.empty() || s == "true" || s == "false" || s == "null" || s == "~" || s[0] == ':') return true;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == ' ' || c == '\t' || c == '"' || c == '\n' || c == '\r') return true;
+        if (c == '|' && isonl) return true;
+    }
+    return looks_like_number(s);
+}
+
+inline void append_escaped(std::string& out, StringView s, bool isonl = false) {
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const char* escape = NULL;
+        switch (s[i]) {
+            case '\\': escape = "\\\\"; break;
+            case '"':  escape = "\\\""; break;
+            case '\n': escape = "\\n"; break;
+            case '\t': escape = "\\t"; break;
+            case '\r': escape = "\\r"; break;
+            case '|':  if (isonl) { escape = "\\|"; break; } continue;
+            default: continue;
+        }
+        out.append(s.data() + run, i - run);
+        out.append(escape, 2);
+        run = i + 1;
+    }
+    out.append(s.data() + run, s.size() - run);
+}
+
+inline void append_ison_string(std::string& out, StringView s, bool isonl = false) {
+    if (!needs_ison_quotes(s, isonl)) {
+        out.append(s.data(), s.size());
+        return;
+    }
+    out += '"';
+    append_escaped(out, s, isonl);
+    out += '"';
+}
+
+inline void append_reference(std::string& out, StringView id, const std::string* type) {
+    out += ':';
+    if (type) {
+        out += *type;
+        out += ':';
+    }
+    out.append(id.data(), id.size());
+}
+
+inline void append_ison_value(std::string& out, const Value& v, bool isonl = false) {
+    switch (v.type()) {
+        case ValueType::Null: out += "null"; break;
+        case ValueType::Bool: out += v.as_bool() ? "true" : "false"; break;
+        case ValueType::Int: append_int(out, v.as_int()); break;
+        case ValueType::Float: append_double(out, v.as_float()); break;
+        case ValueType::String: append_ison_string(out, v.as_string(), isonl); break;
+        case ValueType::Reference: {
+            const Reference* r = v.get_reference();
+            if (!r) {
+                out += "null";
+            } else {
+                append_reference(out, r->id, r->type.has_value() ? &r->type.value() : NULL);
+            }
+            break;
+        }
+    }
+}
+
+inline void append_column_cell(std::string& out, const Column& column, size_t row) {
+    if (column.is_null(row)) {
+        out += "null";
+        return;
+    }
+    switch (column.type()) {
+        case ColumnType::Bool: out += column.bool_at(row) ? "true" : "false"; break;
+        case ColumnType::Int: append_int(out, column.int_at(row)); break;
+        case ColumnType::Float: append_double(out, column.float_at(row)); break;
+        case ColumnType::String: append_ison_string(out, column.string_at(row)); break;
+        case ColumnType::Reference:
+            append_reference(out, column.reference_id_at(row), column.reference_type_at(row));
+            break;
+        case ColumnType::Mixed: append_ison_value(out, column.get(row)); break;
+        default: out += "null"; break;
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Serializes documents and blocks straight into an output buffer
+ *
+ * Text is appended to a caller's std::string, or collected in an internal
+ * buffer and handed to a Sink or std::ostream about every buffer_size
+ * bytes. Blocks written one after another are separated by a blank line,
+ * as in dumps(). With align_columns each cell is formatted once: the width
+ * pass keeps the text for the output pass.
+ */
+class IsonWriter {
+public:
+    explicit IsonWriter(std::string& out, bool align_columns = false)
+        : output_(out), align_(align_columns), blocks_(0) {}
+
+    explicit IsonWriter(Sink& sink, bool align_columns = false, size_t buffer_size = 64 * 1024)
+        : output_(sink, buffer_size), align_(align_columns), blocks_(0) {}
+
+    explicit IsonWriter(std::ostream& out, bool align_columns = false, size_t buffer_size = 64 * 1024)
+        : output_(out, buffer_size), align_(align_columns), blocks_(0) {}
+
+    ~IsonWriter() { flush(); }
+
+    void write(const Document& doc) {
+        for (size_t i = 0; i < doc.blocks.size(); ++i) write(doc.blocks[i]);
+    }
+
+    void write(const ColumnarDocument& doc) {
+        for (size_t i = 0; i < doc.blocks.size(); ++i) write(doc.blocks[i]);
+    }
+
+    void write(const Block& block) {
+        write_header(block.kind, block.name, block.fields, block.field_info);
+        RowCells cells = { &block };
+        write_rows(cells, block.fields, block.rows.size());
+        write_summary(block.summary);
+    }
+
+    void write(const ColumnarBlock& block) {
+        write_header(block.kind, block.name, block.fields, block.field_info);
+        ColumnCells cells = { &block };
+        write_rows(cells, block.fields, block.size());
+        write_summary(block.summary);
+    }
+
+    /**
+     * @brief Start a block whose rows follow one at a time (never aligned)
+     */
+    void begin_block(const std::string& kind, const std::string& name, const std::vector<FieldInfo>& field_info) {
+        static const std::vector<std::string> no_fields;
+        write_header(kind, name, no_fields, field_info);
+    }
+
+    void write_row(const Value* values, size_t count) {
+        std::string& out = output_.text();
+        out += '\n';
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) out += ' ';
+            detail::append_ison_value(out, values[i]);
+        }
+        output_.maybe_flush();
+    }
+
+    void write_row(const std::vector<Value>& values) {
+        write_row(values.empty() ? NULL : &values[0], values.size());
+    }
+
+    void end_block(const Optional<std::string>& summary = Optional<std::string>()) {
+        write_summary(summary);
+    }
+
+    /**
+     * @brief Hand buffered text to the sink (no-op when writing to a string)
+     */
+    void flush() { output_.flush(); }
+
+private:
+    struct RowCells {
+        const Block* block;
+        void operator()(std::string& out, size_t row, size_t col) const {
+            const Row& r = block->rows[row];
+            Row::const_iterator it = r.find(block->fields[col]);
+            if (it == r.end()) out += "null";
+            else detail::append_ison_value(out, it->second);
+        }
+    };
+
+    struct ColumnCells {
+        const ColumnarBlock* block;
+        void operator()(std::string& out, size_t row, size_t col) const {
+            detail::append_column_cell(out, block->columns[col], row);
+        }
+    };
+
+    detail::OutputBuffer output_;
+    bool align_;
+    size_t blocks_;
+    std::string cell_text_;
+    std::vector<size_t> cell_ends_;
+    std::vector<size_t> widths_;
+
+    IsonWriter(const IsonWriter&);
+    IsonWriter& operator=(const IsonWriter&);
+
+    void write_header(const std::string& kind, const std::string& name,
+                      const std::vector<std::string>& fields, const std::vector<FieldInfo>& field_info) {
+        std::string& out = output_.text();
+        if (blocks_++ > 0) out += "\n\n";
+        out += kind;
+        out += '.';
+        out += name;
+        out += '\n';
+        for (size_t i = 0; i < field_info.size(); ++i) {
+            if (i > 0) out += ' ';
+            out += field_info[i].name;
+            if (field_info[i].type.has_value()) {
+                out += ':';
+                out += field_info[i].type.value();
+            }
+        }
+        if (field_info.empty()) {
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (i > 0) out += ' ';
+                out += fields[i];
+            }
+        }
+    }
+
+    template<typename Cells>
+    void write_rows(const Cells& cells, const std::vector<std::string>& fields, size_t rows) {
+        std::string& out = output_.text();
+        size_t cols = fields.size();
+        if (!align_ || rows == 0) {
+            for (size_t r = 0; r < rows; ++r) {
+                out += '\n';
+                for (size_t c = 0; c < cols; ++c) {
+                    if (c > 0) out += ' ';
+                    cells(out, r, c);
+                }
+                output_.maybe_flush();
+            }
+            return;
+        }
+
+        widths_.resize(cols);
+        for (size_t c = 0; c < cols; ++c) widths_[c] = fields[c].size();
+        cell_text_.clear();
+        cell_ends_.clear();
+        cell_ends_.reserve(rows * cols);
+        for (size_t r = 0; r < rows; ++r) {
+            for (size_t c = 0; c < cols; ++c) {
+                size_t begin = cell_text_.size();
+                cells(cell_text_, r, c);
+                cell_ends_.push_back(cell_text_.size());
+                widths_[c] = std::max(widths_[c], cell_text_.size() - begin);
+            }
+        }
+
+        size_t begin = 0;
+        for (size_t r = 0; r < rows; ++r) {
+            out += '\n';
+            for (size_t c = 0; c < cols; ++c) {
+                size_t end = cell_ends_[r * cols + c];
+                if (c > 0) out += ' ';
+                out.append(cell_text_, begin, end - begin);
+                // The last column is not padded, so lines carry no trailing blanks
+                if (c + 1 < cols) out.append(widths_[c] - (end - begin), ' ');
+                begin = end;
+            }
+            output_.maybe_flush();
+        }
+    }
+
+    void write_summary(const Optional<std::string>& summary) {
+        if (summary.has_value()) {
+            output_.text() += "\n---\n";
+            output_.text() += summary.value();
+        }
+        output_.maybe_flush();
+    }
+};
+
+// =============================================================================
+// Serializer
+// =============================================================================
+
+/**
+ * @brief Output counters and timing filled in by Serializer::dumps()
+ *
+ * Counts accumulate across calls until clear().
+ */
+struct SerializeStats {
+    uint64_t bytes;
+    uint64_t blocks;
+    uint64_t rows;
+    uint64_t cells;
+    uint64_t write_ns;
+
+    SerializeStats() { clear(); }
+
+    void clear() { bytes = blocks = rows = cells = write_ns = 0; }
+};
+
+class Serializer {
+public:
+    static std::string dumps(const Document& doc, bool align_columns = true) {
+        std::string result;
+        IsonWriter writer(result, align_columns);
+        writer.write(doc);
+        return result;
+    }
+
+    /**
+     * @brief dumps(), counting what was written into stats
+     */
+    static std::string dumps(const Document& doc, bool align_columns, SerializeStats& stats) {
+        uint64_t start = detail::now_ns();
+        std::string result = dumps(doc, align_columns);
+        stats.write_ns += detail::now_ns() - start;
+        stats.bytes += result.size();
+        stats.blocks += doc.blocks.size();
+        for (size_t b = 0; b < doc.blocks.size(); ++b) {
+            stats.rows += doc.blocks[b].rows.size();
+            stats.cells += doc.blocks[b].rows.size() * doc.blocks[b].fields.size();
+        }
+        return result;
+    }
+};
+
+// =============================================================================
+// JSON Output
+// =============================================================================
+
+namespace detail {
+
+inline void append_json_string(std::string& out, StringView s) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xF];
+                break;
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out += '"';
+}
+
+inline void append_json_value(std::string& out, const Value& v) {
+    switch (v.type()) {
+        case ValueType::Null: out += "null"; break;
+        case ValueType::Bool: out += v.as_bool() ? "true" : "false"; break;
+        case ValueType::Int: append_int(out, v.as_int()); break;
+        case ValueType::Float: {
+            double d = v.as_float();
+            // JSON has no NaN or infinity
+            if (d - d == 0.0) append_double(out, d);
+            else out += "null";
+            break;
+        }
+        case ValueType::String: append_json_string(out, v.as_string()); break;
+        case ValueType::Reference: {
+            const Reference* r = v.get_reference();
+            if (!r) {
+                out += "null";
+            } else {
+                append_json_string(out, r->to_ison());
+            }
+            break;
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Writes blocks as a JSON object of row arrays
+ *
+ *   {"name": [{"field": value, ...}, ...], ...}
+ *
+ * Keys follow field order. References become ":type:id" strings and
+ * non-finite floats become null. Rows can be written one at a time, so a
+ * streaming transcoder holds at most one row; finish() closes the object.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out, int indent = 2)
+        : output_(out) { init(indent); }
+
+    explicit JsonWriter(Sink& sink, int indent = 2, size_t buffer_size = 64 * 1024)
+        : output_(sink, buffer_size) { init(indent); }
+
+    explicit JsonWriter(std::ostream& out, int indent = 2, size_t buffer_size = 64 * 1024)
+        : output_(out, buffer_size) { init(indent); }
+
+    ~JsonWriter() {
+        try {
+            output_.flush();
+        } catch (...) {
+        }
+    }
+
+    void begin_block(const std::string& name, const std::vector<std::string>& fields) {
+        std::string& out = output_.text();
+        out += blocks_++ > 0 ? ",\n" : "{\n";
+        out += indent_;
+        detail::append_json_string(out, name);
+        out += ": [\n";
+
+        // Keys are formatted once per block
+        keys_.resize(fields.size());
+        for (size_t i = 0; i < fields.size(); ++i) {
+            keys_[i].assign(indent_);
+            keys_[i] += indent_;
+            keys_[i] += indent_;
+            detail::append_json_string(keys_[i], fields[i]);
+            keys_[i] += ": ";
+        }
+        rows_ = 0;
+    }
+
+    /**
+     * @brief Write one row; values[i] belongs to the block's i-th field
+     */
+    void write_row(const Value* values, size_t count) {
+        std::string& out = output_.text();
+        if (rows_++ > 0) out += ",\n";
+        out += indent_;
+        out += indent_;
+        out += "{\n";
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            out += keys_[i];
+            if (i < count) detail::append_json_value(out, values[i]);
+            else out += "null";
+            out += i + 1 < keys_.size() ? ",\n" : "\n";
+        }
+        out += indent_;
+        out += indent_;
+        out += '}';
+        output_.maybe_flush();
+    }
+
+    void write_row(const std::vector<Value>& values) {
+        write_row(values.empty() ? NULL : &values[0], values.size());
+    }
+
+    void end_block() {
+        std::string& out = output_.text();
+        if (rows_ > 0) out += '\n';
+        out += indent_;
+        out += ']';
+        output_.maybe_flush();
+    }
+
+    void write(const Block& block) {
+        begin_block(block.name, block.fields);
+        for (size_t ri = 0; ri < block.rows.size(); ++ri) {
+            const Row& row = block.rows[ri];
+            row_.clear();
+            for (size_t i = 0; i < block.fields.size(); ++i) {
+                Row::const_iterator it = row.find(block.fields[i]);
+                row_.push_back(it != row.end() ? it->second : Value());
+            }
+            write_row(row_);
+        }
+        row_.clear();
+        end_block();
+    }
+
+    void write(const Document& doc) {
+        for (size_t i = 0; i < doc.blocks.size(); ++i) write(doc.blocks[i]);
+    }
+
+    /** @brief Close the top-level object and flush */
+    void finish() {
+        output_.text() += blocks_ > 0 ? "\n}" : "{\n}";
+        output_.flush();
+    }
+
+    void flush() { output_.flush(); }
+
+private:
+    detail::OutputBuffer output_;
+    std::string indent_;
+    std::vector<std::string> keys_;
+    std::vector<Value> row_;
+    size_t blocks_;
+    size_t rows_;
+
+    JsonWriter(const JsonWriter&);
+    JsonWriter& operator=(const JsonWriter&);
+
+    void init(int indent) {
+        indent_.assign(indent > 0 ? static_cast<size_t>(indent) : 0, ' ');
+        blocks_ = 0;
+        rows_ = 0;
+    }
+};
+
+inline std::string Document::to_json(int indent) const {
+    std::string result;
+    JsonWriter writer(result, indent);
+    writer.write(*this);
+    writer.finish();
+    return result;
+}
+
+// =============================================================================
+// ISONL Support
+// =============================================================================
+
+struct ISONLRecord {
+    std::string kind;
+    std::string name;
+    std::vector<std::string> fields;
+    Row values;
+
+    std::string to_block_key() const { return kind + "." + name; }
+};
+
+namespace detail {
+
+/**
+ * @brief Split an ISONL line into its header, fields and values sections
+ *
+ * Sections are trimmed views into the line. Pipes inside quoted strings do
+ * not split. Returns the number of sections found (stops counting at 4).
+ */
+inline size_t split_isonl_sections(StringView line, StringView sections[3]) {
+    size_t count = 0;
+    size_t start = 0;
+    bool in_quotes = false;
+    const char* begin = line.data();
+    const char* end = begin + line.size();
+
+    for (const char* p = find_either(begin, end, '"', '|'); p < end; p = find_either(p + 1, end, '"', '|')) {
+        size_t i = static_cast<size_t>(p - begin);
+        if (*p == '"') {
+            if (i == 0 || p[-1] != '\\') in_quotes = !in_quotes;
+        } else if (!in_quotes) {
+            if (count < 3) sections[count] = trim_line(line.substr(start, i - start));
+            if (++count > 3) return count;
+            start = i + 1;
+        }
+    }
+    if (count < 3) sections[count] = trim_line(line.substr(start));
+    return count + 1;
+}
+
+/**
+ * @brief Groups ISONL records into blocks in order of first appearance
+ *
+ * Consecutive records of the same block reuse the cached block lookup and
+ * tokenized field list, so a typical line costs one tokenization of its
+ * values and one Row.
+ */
+class ISONLBlockBuilder {
+public:
+    std::vector<Block> blocks;
+
+    explicit ISONLBlockBuilder(ParseStats* stats = NULL)
+        : last_block_(0), has_last_(false), line_num_(0), stats_(stats),
+          stats_base_(stats ? stats->blocks.size() : 0) {}
+
+    void add_line(StringView line, int line_num) {
+        StringView trimmed = trim_line(line);
+        if (trimmed.empty() || trimmed[0] == '#') return;
+        uint64_t start = stats_ ? now_ns() : 0;
+
+        StringView sections[3];
+        if (split_isonl_sections(trimmed, sections) != 3) {
+            throw ISONSyntaxError("ISONL line must have 3 pipe-separated sections", line_num, 0);
+        }
+        size_t dot_pos = sections[0].find('.');
+        if (dot_pos == StringView::npos) {
+            throw ISONSyntaxError("Invalid ISONL header", line_num, 0);
+        }
+
+        size_t index = block_index(sections[0], dot_pos);
+        BlockFields& cache = fields_[index];
+        if (!cache.valid || StringView(cache.text) != sections[1]) {
+            tokenizer_.reset(sections[1], line_num);
+            cache.names = tokenizer_.tokenize();
+            cache.text.assign(sections[1].data(), sections[1].size());
+            cache.valid = true;
+        }
+        Block& block = blocks[index];
+        if (block.rows.empty()) block.fields = cache.names;
+
+        tokenizer_.reset(sections[2], line_num);
+        tokenizer_.tokenize(tokens_);
+        if (stats_) {
+            instrumented_row(index, cache.names, start);
+            return;
+        }
+
+        block.rows.push_back(Row());
+        Row& row = block.rows.back();
+        for (size_t i = 0; i < cache.names.size() && i < tokens_.size(); ++i) {
+            row[cache.names[i]] = TypeInferrer::infer(tokens_[i].text, tokens_[i].quoted);
+        }
+    }
+
+    void operator()(StringView line) { add_line(line, ++line_num_); }
+
+    int line_number() const { return line_num_; }
+
+    void set_first_line(int line_num) { line_num_ = line_num - 1; }
+
+    /** Move this builder's blocks into out, appending rows to blocks it already has */
+    void merge_into(std::vector<Block>& out, std::map<std::string, size_t>& out_index) {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            std::string key = blocks[i].kind + "." + blocks[i].name;
+            std::map<std::string, size_t>::iterator it = out_index.find(key);
+            if (it == out_index.end()) {
+                out_index[key] = out.size();
+                out.push_back(std::move(blocks[i]));
+            } else {
+                std::vector<Row>& rows = out[it->second].rows;
+                // Grow geometrically: a block may be merged from many builders
+                size_t needed = rows.size() + blocks[i].rows.size();
+                if (needed > rows.capacity()) rows.reserve(std::max(needed, rows.capacity() * 2));
+                for (size_t r = 0; r < blocks[i].rows.size(); ++r) rows.push_back(std::move(blocks[i].rows[r]));
+            }
+        }
+        blocks.clear();
+    }
+
+private:
+    struct BlockFields {
+        std::string text;
+        std::vector<std::string> names;
+        bool valid;
+        BlockFields() : valid(false) {}
+    };
+
+    std::map<std::string, size_t> index_;
+    std::vector<BlockFields> fields_;
+    std::string last_key_;
+    size_t last_block_;
+    bool has_last_;
+    int line_num_;
+    Tokenizer tokenizer_;
+    std::vector<Token> tokens_;
+    ParseStats* stats_;
+    size_t stats_base_;
+    std::vector<Value> cells_;
+
+    // The end of add_line() with inference and row storage timed separately
+    void instrumented_row(size_t index, const std::vector<std::string>& names, uint64_t start) {
+        count_tokens(*stats_, tokens_);
+        uint64_t tokenized = now_ns();
+        stats_->tokenize_ns += tokenized - start;
+
+        size_t count = std::min(names.size(), tokens_.size());
+        cells_.resize(count);
+        for (size_t i = 0; i < count; ++i) cells_[i] = TypeInferrer::infer(tokens_[i].text, tokens_[i].quoted);
+        uint64_t inferred = now_ns();
+        stats_->infer_ns += inferred - tokenized;
+
+        Block& block = blocks[index];
+        block.rows.push_back(Row());
+        Row& row = block.rows.back();
+        for (size_t i = 0; i < count; ++i) {
+            if (cells_[i].is_string() || cells_[i].is_reference()) ++stats_->allocations;
+            row[names[i]] = std::move(cells_[i]);
+        }
+        stats_->allocations += row.size();
+        stats_->materialize_ns += now_ns() - inferred;
+        ++stats_->rows;
+        ++stats_->blocks[stats_base_ + index].rows;
+    }
+
+    size_t block_index(StringView header, size_t dot_pos) {
+        if (has_last_ && StringView(last_key_) == header) return last_block_;
+        last_key_.assign(header.data(), header.size());
+        has_last_ = true;
+
+        std::map<std::string, size_t>::iterator it = index_.find(last_key_);
+        if (it != index_.end()) return last_block_ = it->second;
+
+        last_block_ = blocks.size();
+        index_[last_key_] = last_block_;
+        blocks.push_back(Block(last_key_.substr(0, dot_pos), last_key_.substr(dot_pos + 1)));
+        fields_.push_back(BlockFields());
+        if (stats_) stats_->blocks.push_back(BlockStats(blocks.back().kind, blocks.back().name));
+        return last_block_;
+    }
+};
+
+// Parses one newline-aligned byte range of an ISONL buffer
+struct ISONLRangeTask {
+    const char* data;
+    std::vector<size_t> bounds;       // range i is [bounds[i], bounds[i + 1])
+    std::vector<int> first_lines;     // 1-based line number of each range's first line
+    std::vector<ISONLBlockBuilder> builders;
+    bool counting;
+
+    void operator()(size_t task) {
+        const char* begin = data + bounds[task];
+        size_t size = bounds[task + 1] - bounds[task];
+        if (counting) {
+            int lines = 0;
+            const char* p = begin;
+            const char* end = begin + size;
+            while (p < end) {
+                const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+                if (!nl) break;
+                ++lines;
+                p = static_cast<const char*>(nl) + 1;
+            }
+            first_lines[task + 1] = lines;
+            return;
+        }
+        builders[task].set_first_line(first_lines[task]);
+        for_each_line(begin, size, builders[task]);
+    }
+};
+
+} // namespace detail
+
+class ISONLParser {
+public:
+    /** @brief stats, if given, is filled in by parse_to_document() */
+    explicit ISONLParser(ParseStats* stats = NULL) : stats_(stats) {}
+
+    Optional<ISONLRecord> parse_line(StringView line, int line_num = 0) {
+        StringView trimmed = detail::trim_line(line);
+        if (trimmed.empty() || trimmed[0] == '#') return Optional<ISONLRecord>();
+
+        StringView sections[3];
+        if (detail::split_isonl_sections(trimmed, sections) != 3) {
+            throw ISONSyntaxError("ISONL line must have 3 pipe-separated sections", line_num, 0);
+        }
+
+        size_t dot_pos = sections[0].find('.');
+        if (dot_pos == StringView::npos) {
+            throw ISONSyntaxError("Invalid ISONL header", line_num, 0);
+        }
+
+        ISONLRecord record;
+        record.kind.assign(sections[0].data(), dot_pos);
+        record.name.assign(sections[0].data() + dot_pos + 1, sections[0].size() - dot_pos - 1);
+
+        Tokenizer field_tokenizer(sections[1], line_num);
+        record.fields = field_tokenizer.tokenize();
+
+        Tokenizer value_tokenizer(sections[2], line_num);
+        std::vector<Token> raw_values;
+        value_tokenizer.tokenize(raw_values);
+
+        for (size_t i = 0; i < record.fields.size() && i < raw_values.size(); ++i) {
+            record.values[record.fields[i]] = TypeInferrer::infer(raw_values[i].text, raw_values[i].quoted);
+        }
+
+        return record;
+    }
+
+    Document parse_to_document(const std::string& text) {
+        return parse_to_document(text.data(), text.size());
+    }
+
+    /**
+     * @brief Parse a borrowed buffer without copying it
+     */
+    Document parse_to_document(const char* data, size_t size) {
+        detail::ISONLBlockBuilder builder(stats_);
+        detail::for_each_line(data, size, builder);
+        if (stats_) {
+            stats_->bytes += size;
+            stats_->lines += static_cast<uint64_t>(builder.line_number());
+        }
+        Document doc;
+        doc.blocks.swap(builder.blocks);
+        doc.reindex();
+        return doc;
+    }
+
+    /**
+     * @brief Parse text that arrives in chunks (see Parser::parse_chunks())
+     */
+    template<typename Chunks>
+    Document parse_chunks(Chunks& chunks) {
+        detail::ISONLBlockBuilder builder(stats_);
+        size_t bytes = detail::for_each_chunk_line(chunks, builder);
+        if (stats_) {
+            stats_->bytes += bytes;
+            stats_->lines += static_cast<uint64_t>(builder.line_number());
+        }
+        Document doc;
+        doc.blocks.swap(builder.blocks);
+        doc.reindex();
+        return doc;
+    }
+
+    /**
+     * @brief Parse on multiple threads
+     *
+     * The buffer is cut into newline-aligned byte ranges, each parsed into
+     * thread-local blocks; the blocks are then merged in order of first
+     * appearance with rows in input order, exactly as parse_to_document().
+     */
+    Document parse_to_document_parallel(const char* data, size_t size, size_t thread_count = 0) {
+        if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+        if (thread_count == 0) thread_count = 1;
+
+        // Aim for a few ranges per thread, but keep ranges reasonably large
+        const size_t min_range = 1 << 16;
+        size_t ranges = thread_count * 4;
+        if (size / ranges < min_range) ranges = size / min_range;
+        if (ranges == 0) ranges = 1;
+
+        detail::ISONLRangeTask task;
+        task.data = data;
+        task.bounds.push_back(0);
+        for (size_t i = 1; i < ranges; ++i) {
+            size_t pos = size / ranges * i;
+            if (pos <= task.bounds.back()) continue;
+            const void* nl = std::memchr(data + pos, '\n', size - pos);
+            if (!nl) break;
+            pos = static_cast<size_t>(static_cast<const char*>(nl) - data) + 1;
+            if (pos > task.bounds.back() && pos < size) task.bounds.push_back(pos);
+        }
+        task.bounds.push_back(size);
+        ranges = task.bounds.size() - 1;
+
+        // Line numbers for error messages: count lines per range, then prefix sum
+        task.first_lines.assign(ranges + 1, 0);
+        task.counting = true;
+        detail::parallel_for(ranges, thread_count, task);
+        task.first_lines[0] = 1;
+        for (size_t i = 1; i <= ranges; ++i) task.first_lines[i] += task.first_lines[i - 1];
+
+        task.builders.resize(ranges);
+        task.counting = false;
+        detail::parallel_for(ranges, thread_count, task);
+
+        Document doc;
+        std::map<std::string, size_t> index;
+        for (size_t i = 0; i < ranges; ++i) task.builders[i].merge_into(doc.blocks, index);
+        doc.reindex();
+        return doc;
+    }
+
+private:
+    ParseStats* stats_;
+};
+
+/**
+ * @brief When ISONLWriter pushes written records to durable storage
+ */
+enum class SyncPolicy {
+    None,       ///< Leave it to the sink / operating system
+    OnFlush,    ///< After every flush (each batch)
+    OnClose     ///< Once, when the writer is closed
+};
+
+struct ISONLWriterOptions {
+    /** @brief Flush once this many bytes are buffered */
+    size_t buffer_size;
+
+    /** @brief Also flush after this many records (0 = only when the buffer fills) */
+    size_t flush_every;
+
+    /** @brief When flushed records are synced to storage */
+    SyncPolicy sync;
+
+    ISONLWriterOptions() : buffer_size(64 * 1024), flush_every(0), sync(SyncPolicy::None) {}
+};
+
+/**
+ * @brief Appends ISONL records one at a time
+ *
+ * Each distinct kind.name|fields| prefix is formatted once and reused for
+ * every record of that block; define_block() returns a handle that skips
+ * the lookup entirely. Records are batched in a buffer and handed to the
+ * sink when it fills, after flush_every records, on flush() and on close().
+ * Every record ends with a newline, so a file can be appended to across
+ * runs. A writer is not synchronized; use one per thread or guard it.
+ */
+class ISONLWriter {
+public:
+    explicit ISONLWriter(const std::string& path, const ISONLWriterOptions& options = ISONLWriterOptions(),
+                         bool append = true)
+        : file_sink_(new FileSink(path, append)), output_(*file_sink_, options.buffer_size), options_(options) {
+        init();
+    }
+
+    explicit ISONLWriter(Sink& sink, const ISONLWriterOptions& options = ISONLWriterOptions())
+        : output_(sink, options.buffer_size), options_(options) {
+        init();
+    }
+
+    explicit ISONLWriter(std::ostream& out, const ISONLWriterOptions& options = ISONLWriterOptions())
+        : output_(out, options.buffer_size), options_(options) {
+        init();
+    }
+
+    /**
+     * @brief Append straight to a caller's string (no buffering or syncing)
+     *
+     * Takes a pointer so it cannot be mistaken for the path constructor.
+     */
+    explicit ISONLWriter(std::string* out) : output_(*out), options_(ISONLWriterOptions()) {
+        init();
+    }
+
+    ~ISONLWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    /**
+     * @brief Register a block layout and return its handle for append()
+     */
+    size_t define_block(const std::string& kind, const std::string& name, const std::vector<std::string>& fields) {
+        if (last_ < prefixes_.size() && prefixes_[last_].matches(kind, name, fields)) return last_;
+
+        key_.assign(kind);
+        key_ += '.';
+        key_ += name;
+        std::pair<std::multimap<std::string, size_t>::iterator, std::multimap<std::string, size_t>::iterator>
+            range = by_header_.equal_range(key_);
+        for (std::multimap<std::string, size_t>::iterator it = range.first; it != range.second; ++it) {
+            if (prefixes_[it->second].fields == fields) return last_ = it->second;
+        }
+
+        Prefix prefix;
+        prefix.kind = kind;
+        prefix.name = name;
+        prefix.fields = fields;
+        prefix.text = key_;
+        prefix.text += '|';
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i > 0) prefix.text += ' ';
+            prefix.text += fields[i];
+        }
+        prefix.text += '|';
+        prefixes_.push_back(prefix);
+        by_header_.insert(std::make_pair(key_, prefixes_.size() - 1));
+        return last_ = prefixes_.size() - 1;
+    }
+
+    /**
+     * @brief Append one record of a defined block; missing trailing values are null
+     */
+    void append(size_t block, const Value* values, size_t count) {
+        if (closed_) {
+            throw ISONError("ISONLWriter is closed");
+        }
+        if (block >= prefixes_.size()) {
+            throw ISONError("Unknown ISONL block handle");
+        }
+        const Prefix& prefix = prefixes_[block];
+        if (count > prefix.fields.size()) {
+            throw ISONError("ISONL record has more values than fields: " + prefix.kind + "." + prefix.name);
+        }
+
+        std::string& out = output_.text();
+        out += prefix.text;
+        for (size_t i = 0; i < prefix.fields.size(); ++i) {
+            if (i > 0) out += ' ';
+            if (i < count) detail::append_ison_value(out, values[i], true);
+            else out += "null";
+        }
+        out += '\n';
+        ++records_;
+        ++pending_;
+        if (output_.full() || (options_.flush_every > 0 && pending_ >= options_.flush_every)) {
+            flush();
+        }
+    }
+
+    void append(size_t block, const std::vector<Value>& values) {
+        append(block, values.empty() ? NULL : &values[0], values.size());
+    }
+
+    void append(const std::string& kind, const std::string& name,
+                const std::vector<std::string>& fields, const std::vector<Value>& values) {
+        append(define_block(kind, name, fields), values);
+    }
+
+    void append(const ISONLRecord& record) {
+        size_t block = define_block(record.kind, record.name, record.fields);
+        row_.clear();
+        for (size_t i = 0; i < record.fields.size(); ++i) {
+            std::map<std::string, Value>::const_iterator it = record.values.find(record.fields[i]);
+            row_.push_back(it != record.values.end() ? it->second : Value());
+        }
+        append(block, row_);
+        row_.clear();
+    }
+
+    void append(const Block& block) {
+        size_t handle = define_block(block.kind, block.name, block.fields);
+        for (size_t ri = 0; ri < block.rows.size(); ++ri) {
+            const Row& row = block.rows[ri];
+            row_.clear();
+            for (size_t i = 0; i < block.fields.size(); ++i) {
+                Row::const_iterator it = row.find(block.fields[i]);
+                row_.push_back(it != row.end() ? it->second : Value());
+            }
+            append(handle, row_);
+        }
+        row_.clear();
+    }
+
+    void append(const Document& doc) {
+        for (size_t i = 0; i < doc.blocks.size(); ++i) append(doc.blocks[i]);
+    }
+
+    /**
+     * @brief Hand buffered records to the sink (and sync under SyncPolicy::OnFlush)
+     */
+    void flush() {
+        if (!output_.sink()) return;
+        output_.flush();
+        pending_ = 0;
+        if (options_.sync == SyncPolicy::OnFlush) output_.sink()->sync();
+    }
+
+    /**
+     * @brief Flush, sync unless SyncPolicy::None, and reject further appends
+     */
+    void close() {
+        if (closed_) return;
+        closed_ = true;
+        flush();
+        if (output_.sink() && options_.sync == SyncPolicy::OnClose) output_.sink()->sync();
+    }
+
+    size_t records_written() const { return records_; }
+
+private:
+    struct Prefix {
+        std::string kind;
+        std::string name;
+        std::vector<std::string> fields;
+        std::string text;
+
+        bool matches(const std::string& k, const std::string& n, const std::vector<std::string>& f) const {
+            return name == n && kind == k && fields == f;
+        }
+    };
+
+    std::unique_ptr<FileSink> file_sink_;
+    detail::OutputBuffer output_;
+    ISONLWriterOptions options_;
+    std::vector<Prefix> prefixes_;
+    std::multimap<std::string, size_t> by_header_;
+    std::string key_;
+    std::vector<Value> row_;
+    size_t last_;
+    size_t records_;
+    size_t pending_;
+    bool closed_;
+
+    ISONLWriter(const ISONLWriter&);
+    ISONLWriter& operator=(const ISONLWriter&);
+
+    void init() {
+        last_ = 0;
+        records_ = 0;
+        pending_ = 0;
+        closed_ = false;
+    }
+};
+
+class ISONLSerializer {
+public:
+    static std::string dumps(const Document& doc) {
+        std::string result;
+        {
+            ISONLWriter writer(&result);
+            writer.append(doc);
+        }
+        // Records are newline-terminated; dumps() joins them instead
+        if (!result.empty()) result.erase(result.size() - 1);
+        return result;
+    }
+};
+
+// =============================================================================
+// Transcoding
+// =============================================================================
+
+namespace detail {
+
+// Streams parsed ISON blocks into a JsonWriter
+class JsonTranscoder : public BlockVisitor {
+public:
+    explicit JsonTranscoder(JsonWriter& writer) : writer_(writer) {}
+
+    void on_block(const std::string& /*kind*/, const std::string& name) { name_ = name; }
+
+    void on_fields(const std::vector<FieldInfo>& field_info) {
+        fields_.clear();
+        for (size_t i = 0; i < field_info.size(); ++i) fields_.push_back(field_info[i].name);
+        writer_.begin_block(name_, fields_);
+    }
+
+    void on_row(const std::vector<Value>& values) { writer_.write_row(values); }
+    void on_block_end() { writer_.end_block(); }
+
+private:
+    JsonWriter& writer_;
+    std::string name_;
+    std::vector<std::string> fields_;
+};
+
+// Streams parsed ISON blocks into an ISONLWriter
+class ISONLTranscoder : public BlockVisitor {
+public:
+    explicit ISONLTranscoder(ISONLWriter& writer) : writer_(writer), handle_(0) {}
+
+    void on_block(const std::string& kind, const std::string& name) {
+        kind_ = kind;
+        name_ = name;
+    }
+
+    void on_fields(const std::vector<FieldInfo>& field_info) {
+        fields_.clear();
+        for (size_t i = 0; i < field_info.size(); ++i) fields_.push_back(field_info[i].name);
+        handle_ = writer_.define_block(kind_, name_, fields_);
+    }
+
+    void on_row(const std::vector<Value>& values) { writer_.append(handle_, values); }
+
+private:
+    ISONLWriter& writer_;
+    std::string kind_;
+    std::string name_;
+    std::vector<std::string> fields_;
+    size_t handle_;
+};
+
+inline void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+/**
+ * @brief Pull reader for JSON text held in memory or read from a ChunkSource
+ *
+ * Only the current token is buffered, so memory stays bounded by the chunk
+ * size plus the longest string.
+ */
+class JsonReader {
+public:
+    JsonReader(const char* data, size_t size)
+        : source_(NULL), base_(data), p_(data), end_(data + size), consumed_(0), line_(1), line_start_(0) {}
+
+    explicit JsonReader(ChunkSource& source, size_t chunk_size = 65536)
+        : source_(&source), chunk_(chunk_size > 0 ? chunk_size : 1), base_(NULL), p_(NULL), end_(NULL),
+          consumed_(0), line_(1), line_start_(0) {}
+
+    /** Next significant character without consuming it; '\0' at end of input */
+    char peek() {
+        while (true) {
+            if (p_ == end_ && !refill()) return '\0';
+            char c = *p_;
+            if (c == '\n') {
+                ++line_;
+                line_start_ = position() + 1;
+            } else if (c != ' ' && c != '\t' && c != '\r') {
+                return c;
+            }
+            ++p_;
+        }
+    }
+
+    bool consume(char c) {
+        if (peek() != c) return false;
+        ++p_;
+        return true;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) fail(std::string("Expected '") + c + "'");
+    }
+
+    void read_string(std::string& out) {
+        expect('"');
+        out.clear();
+        while (true) {
+            const char* start = p_;
+            while (p_ < end_ && *p_ != '"' && *p_ != '\\') ++p_;
+            out.append(start, static_cast<size_t>(p_ - start));
+            if (p_ == end_) {
+                if (!refill()) fail("Unterminated string");
+                continue;
+            }
+            if (*p_++ == '"') return;
+            char e = next_raw("Unterminated string");
+            switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t cp = read_hex4();
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        if (next_raw("Unpaired surrogate") != '\\' || next_raw("Unpaired surrogate") != 'u') {
+                            fail("Unpaired surrogate");
+                        }
+                        uint32_t low = read_hex4();
+                        if (low < 0xDC00 || low > 0xDFFF) fail("Unpaired surrogate");
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        fail("Unpaired surrogate");   // a low surrogate with no high one before it
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                default: fail("Invalid escape sequence");
+            }
+        }
+    }
+
+    /**
+     * @brief Read any value; objects and arrays are returned as compact JSON text
+     *
+     * With detect_references, strings in reference syntax (":id", ":type:id")
+     * become references, mirroring how to_json() writes them.
+     */
+    Value read_value(bool detect_references) {
+        char c = peek();
+        if (c == '"') {
+            read_string(text_);
+            if (detect_references && text_.size() > 1 && text_[0] == ':' &&
+                text_.find_first_of(" \t\n\r\"") == std::string::npos) {
+                return TypeInferrer::infer(text_);
+            }
+            return Value(text_);
+        }
+        if (c == '{' || c == '[') {
+            text_.clear();
+            copy_compact(text_);
+            return Value(text_);
+        }
+        if (c == 't') { expect_word("true"); return Value(true); }
+        if (c == 'f') { expect_word("false"); return Value(false); }
+        if (c == 'n') { expect_word("null"); return Value(nullptr); }
+        if (c == '-' || (c >= '0' && c <= '9')) return read_number();
+        fail(c ? "Unexpected character" : "Unexpected end of input");
+        return Value();
+    }
+
+    void fail(const std::string& message) const {
+        throw ISONSyntaxError("JSON: " + message, static_cast<int>(line_),
+                              static_cast<int>(position() - line_start_));
+    }
+
+private:
+    ChunkSource* source_;
+    std::vector<char> chunk_;
+    const char* base_;
+    const char* p_;
+    const char* end_;
+    size_t consumed_;
+    size_t line_;
+    size_t line_start_;
+    std::string text_;
+    std::string scratch_;
+    std::string closers_;   // copy_compact(): closing bracket expected at each open level
+
+    size_t position() const { return consumed_ + static_cast<size_t>(p_ - base_); }
+
+    bool refill() {
+        if (!source_) return false;
+        consumed_ += static_cast<size_t>(end_ - base_);
+        size_t n = source_->read(&chunk_[0], chunk_.size());
+        base_ = p_ = chunk_.data();
+        end_ = p_ + n;
+        return n > 0;
+    }
+
+    char next_raw(const char* message) {
+        if (p_ == end_ && !refill()) fail(message);
+        return *p_++;
+    }
+
+    uint32_t read_hex4() {
+        uint32_t cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            char h = next_raw("Invalid \\u escape");
+            cp <<= 4;
+            if (h >= '0' && h <= '9') cp |= static_cast<uint32_t>(h - '0');
+            else if (h >= 'a' && h <= 'f') cp |= static_cast<uint32_t>(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') cp |= static_cast<uint32_t>(h - 'A' + 10);
+            else fail("Invalid \\u escape");
+        }
+        return cp;
+    }
+
+    void expect_word(const char* word) {
+        for (const char* w = word; *w; ++w) {
+            if (next_raw("Unexpected end of input") != *w) fail("Invalid literal");
+        }
+    }
+
+    Value read_number() {
+        scratch_.clear();
+        bool exponent = false;
+        while (p_ < end_ || refill()) {
+            char c = *p_;
+            if (c == 'e' || c == 'E' || c == '+') exponent = true;
+            else if (c != '-' && c != '.' && (c < '0' || c > '9')) break;
+            scratch_ += c;
+            ++p_;
+        }
+        if (!is_json_number(scratch_)) fail("Invalid number");
+        int64_t int_value = 0;
+        double float_value = 0.0;
+        switch (exponent ? NumberKind::None : parse_number(scratch_, int_value, float_value)) {
+            case NumberKind::Integer: return Value(int_value);
+            case NumberKind::Float: return Value(float_value);
+            case NumberKind::None: break;
+        }
+        return Value(parse_double_slow(scratch_.c_str(), scratch_.size()));
+    }
+
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?, so leading zeros, "1." and
+    // ".5", which parse_number() would take, are rejected
+    static bool is_json_number(const std::string& text) {
+        const char* p = text.c_str();
+        if (*p == '-') ++p;
+        if (*p == '0') {
+            ++p;
+        } else if (*p >= '1' && *p <= '9') {
+            while (*p >= '0' && *p <= '9') ++p;
+        } else {
+            return false;
+        }
+        if (*p == '.') {
+            if (*++p < '0' || *p > '9') return false;
+            while (*p >= '0' && *p <= '9') ++p;
+        }
+        if (*p == 'e' || *p == 'E') {
+            if (*++p == '+' || *p == '-') ++p;
+            if (*p < '0' || *p > '9') return false;
+            while (*p >= '0' && *p <= '9') ++p;
+        }
+        return p == text.c_str() + text.size();
+    }
+
+    // Re-emits a nested object or array without insignificant whitespace
+    void copy_compact(std::string& out) {
+        closers_.clear();
+        do {
+            char c = peek();
+            if (c == '"') {
+                read_string(scratch_);
+                append_json_string(out, scratch_);
+                continue;
+            }
+            if (c == '\0') fail("Unexpected end of input");
+            if (c == '{') {
+                closers_ += '}';
+            } else if (c == '[') {
+                closers_ += ']';
+            } else if (c == '}' || c == ']') {
+                if (closers_.empty() || closers_[closers_.size() - 1] != c) fail("Mismatched bracket");
+                closers_.erase(closers_.size() - 1);
+            }
+            out += c;
+            ++p_;
+        } while (!closers_.empty());
+    }
+};
+
+// Feeds in-memory ISON to a StreamParser in pieces, so lines are reassembled
+// in a small buffer instead of a copy of the whole text
+inline void stream_text(const char* data, size_t size, BlockVisitor& visitor) {
+    const size_t piece = 65536;
+    StreamParser parser(visitor);
+    for (size_t pos = 0; pos < size; pos += piece) parser.feed(data + pos, std::min(piece, size - pos));
+    parser.finish();
+}
+
+// Streams a JSON object of row arrays into an IsonWriter
+inline void transcode_json(JsonReader& reader, IsonWriter& writer, bool detect_references) {
+    std::string name;
+    std::string key;
+    std::vector<std::string> fields;
+    std::vector<FieldInfo> field_info;
+    std::vector<Value> values;
+    NameIndex index;
+
+    reader.expect('{');
+    if (!reader.consume('}')) {
+        do {
+            reader.read_string(name);
+            reader.expect(':');
+            bool table = reader.consume('[');
+            if (!table && reader.peek() != '{') {
+                reader.fail("Expected an array or object for block: " + name);
+            }
+            if (table && reader.consume(']')) continue;  // no fields to write
+
+            bool first = true;
+            do {
+                reader.expect('{');
+                if (first) {
+                    fields.clear();
+                    values.clear();
+                    if (!reader.consume('}')) {
+                        do {
+                            reader.read_string(key);
+                            reader.expect(':');
+                            fields.push_back(key);
+                            values.push_back(reader.read_value(detect_references));
+                        } while (reader.consume(','));
+                        reader.expect('}');
+                    }
+                    if (fields.empty()) reader.fail("Empty object in block: " + name);
+                    index.rebuild(fields, SelfName());
+                    field_info.clear();
+                    for (size_t i = 0; i < fields.size(); ++i) field_info.push_back(FieldInfo(fields[i]));
+                    writer.begin_block(table ? "table" : "object", name, field_info);
+                    first = false;
+                } else {
+                    values.assign(fields.size(), Value());
+                    size_t position = 0;
+                    if (!reader.consume('}')) {
+                        do {
+                            reader.read_string(key);
+                            reader.expect(':');
+                            // Keys usually repeat the first object's order
+                            size_t i = position < fields.size() && fields[position] == key
+                                ? position : index.find(fields, SelfName(), key);
+                            if (i == NameIndex::npos) {
+                                reader.fail("Key '" + key + "' is not in the first object of block: " + name);
+                            }
+                            values[i] = reader.read_value(detect_references);
+                            position = i + 1;
+                        } while (reader.consume(','));
+                        reader.expect('}');
+                    }
+                }
+                writer.write_row(values);
+            } while (table && reader.consume(','));
+            if (table) reader.expect(']');
+            writer.end_block();
+        } while (reader.consume(','));
+        reader.expect('}');
+    }
+    if (reader.peek() != '\0') reader.fail("Unexpected data after the document");
+}
+
+} // namespace detail
+
+// =============================================================================
+// Compression
+// =============================================================================
+
+namespace detail {
+
+inline uint32_t load_u32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void put_lz_length(std::string& out, size_t length) {
+    for (; length >= 255; length -= 255) out += static_cast<char>(255);
+    out += static_cast<char>(length);
+}
+
+/**
+ * @brief Byte-oriented LZ77 block compressor (LZ4-style sequences)
+ *
+ * Each sequence is a token (high nibble: literal count, low nibble: match
+ * length - 4, 15 = more length bytes follow), the literals, a 2-byte
+ * little-endian offset and the extra match length bytes. The last sequence
+ * holds only literals. Appends to out.
+ *
+ * With history > 0, the history bytes just before src act as a dictionary:
+ * matches may reach back into them, and decompression must be given the
+ * same bytes (see lz_decompress()).
+ */
+inline void lz_compress(const char* src, size_t size, std::string& out, size_t history = 0) {
+    const unsigned hash_bits = 14;
+    std::vector<uint32_t> table(static_cast<size_t>(1) << hash_bits, 0);  // position + 1
+    const char* base = src - history;
+    const size_t total = history + size;
+
+    // Only the last 64 KiB of history are reachable
+    for (size_t j = history > 65535 ? history - 65535 : 0; j + 4 <= history; ++j) {
+        table[(load_u32(base + j) * 2654435761u) >> (32 - hash_bits)] = static_cast<uint32_t>(j + 1);
+    }
+
+    size_t anchor = history;
+    size_t i = history;
+
+    while (total >= 8 && i + 4 <= total - 4) {
+        uint32_t seq = load_u32(base + i);
+        uint32_t h = (seq * 2654435761u) >> (32 - hash_bits);
+        size_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(i + 1);
+        if (candidate == 0 || i - (candidate - 1) > 65535 || load_u32(base + candidate - 1) != seq) {
+            ++i;
+            continue;
+        }
+
+        size_t match = candidate - 1;
+        size_t length = 4;
+        while (i + length < total && base[match + length] == base[i + length]) ++length;
+
+        size_t literals = i - anchor;
+        size_t extra = length - 4;
+        out += static_cast<char>(((literals < 15 ? literals : 15) << 4) | (extra < 15 ? extra : 15));
+        if (literals >= 15) put_lz_length(out, literals - 15);
+        out.append(base + anchor, literals);
+        size_t offset = i - match;
+        out += static_cast<char>(offset & 0xFF);
+        out += static_cast<char>(offset >> 8);
+        if (extra >= 15) put_lz_length(out, extra - 15);
+
+        i += length;
+        anchor = i;
+    }
+
+    size_t literals = total - anchor;
+    out += static_cast<char>((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) put_lz_length(out, literals - 15);
+    out.append(base + anchor, literals);
+}
+
+/**
+ * @brief Inverse of lz_compress(); throws ISONError on corrupt input
+ *
+ * For data compressed with history, out must end with those history bytes;
+ * the expected_size decompressed bytes are appended after them.
+ */
+inline void lz_decompress(const char* src, size_t size, std::string& out, size_t expected_size,
+                          size_t history = 0) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* end = p + size;
+    if (history > out.size()) throw ISONError("Corrupt compressed data");
+    size_t start = out.size();
+    // A length byte expands to at most 255 output bytes
+    if (expected_size / 256 > size) throw ISONError("Corrupt compressed data");
+    out.resize(start + expected_size);
+    char* const first = &out[0] + start;
+    char* const last = first + expected_size;
+    char* w = first;
+
+    while (p < end) {
+        unsigned token = *p++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            unsigned char b;
+            do {
+                if (p >= end) throw ISONError("Corrupt compressed data");
+                b = *p++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > static_cast<size_t>(end - p) || literals > static_cast<size_t>(last - w)) {
+            throw ISONError("Corrupt compressed data");
+        }
+        std::memcpy(w, p, literals);
+        w += literals;
+        p += literals;
+        if (p == end) break;
+
+        if (end - p < 2) throw ISONError("Corrupt compressed data");
+        size_t offset = static_cast<size_t>(p[0]) | (static_cast<size_t>(p[1]) << 8);
+        p += 2;
+        size_t length = (token & 15) + 4;
+        if ((token & 15) == 15) {
+            unsigned char b;
+            do {
+                if (p >= end) throw ISONError("Corrupt compressed data");
+                b = *p++;
+                length += b;
+            } while (b == 255);
+        }
+        if (offset == 0 || offset > static_cast<size_t>(w - first) + history ||
+            length > static_cast<size_t>(last - w)) {
+            throw ISONError("Corrupt compressed data");
+        }
+        // Matches may overlap the bytes they produce
+        const char* from = w - offset;
+        if (offset >= length) {
+            std::memcpy(w, from, length);
+            w += length;
+        } else {
+            for (size_t k = 0; k < length; ++k) *w++ = from[k];
+        }
+    }
+    if (w != last) throw ISONError("Corrupt compressed data");
+}
+
+} // namespace detail
+
+// =============================================================================
+// Binary Format
+// =============================================================================
+
+/**
+ * @brief Options for the binary encoding
+ */
+struct BinaryOptions {
+    /** @brief Store repeated strings and reference ids once per column */
+    bool dictionary;
+
+    /** @brief LZ-compress column payloads of at least compress_min_size bytes */
+    bool compress;
+    size_t compress_min_size;
+
+    BinaryOptions() : dictionary(true), compress(false), compress_min_size(1024) {}
+};
+
+namespace detail {
+
+/*
+ * Layout (integers are little-endian, "varint" is unsigned LEB128, "str" is
+ * a varint length followed by the bytes):
+ *
+ *   "ISNB" u8 version, varint block count, then per block:
+ *     str kind, str name, u8 has_summary [str summary]
+ *     varint field count, per field: str name, u8 has_type [str type]
+ *     varint row count, then per column:
+ *       u8 ColumnType, u8 flags (1 = nulls, 2 = dictionary, 4 = compressed)
+ *       varint payload size [varint compressed size], payload
+ *
+ * Payloads: null bitmap (one bit per row) when flagged, then
+ *   Bool       bitmap
+ *   Int        zigzag varints
+ *   Float      IEEE 754 doubles
+ *   String     varint lengths then the bytes, or with a dictionary:
+ *              varint count, str entries, varint index per row
+ *   Reference  varint type count, str types, varint (type index + 1 | 0)
+ *              per row, then the ids encoded as a String column
+ *   Mixed      per row: u8 ValueType and the value
+ */
+const char binary_magic[4] = {'I', 'S', 'N', 'B'};
+const uint8_t binary_version = 1;
+
+enum BinaryColumnFlags {
+    BinaryNulls = 1,
+    BinaryDictionary = 2,
+    BinaryCompressed = 4
+};
+
+inline void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+inline void put_str(std::string& out, StringView s) {
+    put_varint(out, s.size());
+    out.append(s.data(), s.size());
+}
+
+inline void put_f64(std::string& out, double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    for (int i = 0; i < 8; ++i) out += static_cast<char>((bits >> (8 * i)) & 0xFF);
+}
+
+inline uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ (v < 0 ? ~static_cast<uint64_t>(0) : 0);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>((v >> 1) ^ (0 - (v & 1)));
+}
+
+// Bounds-checked cursor over encoded bytes
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t size, const char* format = "binary ISON")
+        : p_(data), end_(data + size), format_(format) {}
+
+    bool at_end() const { return p_ == end_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+
+    uint8_t u8() {
+        need(1);
+        return static_cast<uint8_t>(*p_++);
+    }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t b = u8();
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) return v;
+        }
+        fail("bad varint");
+    }
+
+    size_t size() {
+        uint64_t v = varint();
+        if (v > remaining()) fail("truncated");
+        return static_cast<size_t>(v);
+    }
+
+    // A count of items that each take at least one byte
+    size_t count() { return size(); }
+
+    double f64() {
+        need(8);
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= static_cast<uint64_t>(static_cast<uint8_t>(p_[i])) << (8 * i);
+        p_ += 8;
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    StringView bytes(size_t n) {
+        need(n);
+        StringView v(p_, n);
+        p_ += n;
+        return v;
+    }
+
+    StringView str() { return bytes(size()); }
+
+    std::string string() {
+        StringView v = str();
+        return std::string(v.data(), v.size());
+    }
+
+    [[noreturn]] void fail(const std::string& what) const { throw ISONError(std::string("Invalid ") + format_ + ": " + what); }
+
+private:
+    const char* p_;
+    const char* end_;
+    const char* format_;
+
+    void need(size_t n) const {
+        if (n > remaining()) fail("truncated");
+    }
+};
+
+struct ColumnCodec {
+    static void set_rows(ColumnarBlock& block, size_t rows) { block.rows_ = rows; }
+
+    static void encode(const Column& col, size_t rows, const BinaryOptions& options,
+                       std::string& payload, std::string& out) {
+        if (col.size_ != rows) throw ISONError("Column size does not match the block");
+        payload.clear();
+        uint8_t flags = 0;
+
+        // Null columns store their (all set) bitmap too, so every payload holds
+        // at least one bit per row and decoders can bound the row count
+        bool has_nulls = col.type_ == ColumnType::Null && rows > 0;
+        if (col.type_ != ColumnType::Null && col.type_ != ColumnType::Mixed) {
+            for (size_t w = 0; w < col.nulls_.size() && !has_nulls; ++w) has_nulls = col.nulls_[w] != 0;
+        }
+        if (has_nulls) {
+            flags |= BinaryNulls;
+            put_bits(payload, rows, NullBit(col));
+        }
+
+        switch (col.type_) {
+            case ColumnType::Null: break;
+            case ColumnType::Bool: put_bits(payload, rows, BoolBit(col)); break;
+            case ColumnType::Int:
+                for (size_t r = 0; r < rows; ++r) put_varint(payload, zigzag(col.ints_[r]));
+                break;
+            case ColumnType::Float:
+                for (size_t r = 0; r < rows; ++r) put_f64(payload, col.floats_[r]);
+                break;
+            case ColumnType::String:
+                if (put_texts(col, rows, options, payload)) flags |= BinaryDictionary;
+                break;
+            case ColumnType::Reference:
+                put_varint(payload, col.ref_type_dict_.size());
+                for (size_t i = 0; i < col.ref_type_dict_.size(); ++i) put_str(payload, col.ref_type_dict_[i]);
+                for (size_t r = 0; r < rows; ++r) put_varint(payload, static_cast<uint64_t>(col.ref_types_[r] + 1));
+                if (put_texts(col, rows, options, payload)) flags |= BinaryDictionary;
+                break;
+            case ColumnType::Mixed:
+                for (size_t r = 0; r < rows; ++r) put_value(payload, col.mixed_[r]);
+                break;
+        }
+
+        out += static_cast<char>(col.type_);
+        if (options.compress && payload.size() >= options.compress_min_size) {
+            size_t header = out.size();
+            out += static_cast<char>(flags | BinaryCompressed);
+            put_varint(out, payload.size());
+            std::string compressed;
+            lz_compress(payload.data(), payload.size(), compressed);
+            if (compressed.size() < payload.size()) {
+                put_varint(out, compressed.size());
+                out += compressed;
+                return;
+            }
+            out.resize(header);
+        }
+        out += static_cast<char>(flags);
+        put_varint(out, payload.size());
+        out += payload;
+    }
+
+    static void decode(ByteReader& in, size_t rows, Column& col, std::string& scratch) {
+        uint8_t type = in.u8();
+        uint8_t flags = in.u8();
+        if (type > static_cast<uint8_t>(ColumnType::Mixed)) throw ISONError("Invalid binary ISON: bad column type");
+
+        size_t size = static_cast<size_t>(in.varint());
+        StringView encoded;
+        if (flags & BinaryCompressed) {
+            StringView packed = in.str();
+            scratch.clear();
+            lz_decompress(packed.data(), packed.size(), scratch, size);
+            encoded = StringView(scratch);
+        } else {
+            if (size > in.remaining()) throw ISONError("Invalid binary ISON: truncated");
+            encoded = in.bytes(size);
+        }
+        if ((rows + 7) / 8 > encoded.size()) throw ISONError("Invalid binary ISON: bad row count");
+        ByteReader data(encoded.data(), encoded.size());
+
+        col = Column();
+        col.type_ = static_cast<ColumnType>(type);
+        col.size_ = rows;
+        col.nulls_.assign((rows + 63) / 64, 0);
+        if (flags & BinaryNulls) get_bits(data, rows, col.nulls_);
+
+        switch (col.type_) {
+            case ColumnType::Null: break;
+            case ColumnType::Bool: {
+                std::vector<uint64_t> bits((rows + 63) / 64, 0);
+                get_bits(data, rows, bits);
+                col.bools_.resize(rows);
+                for (size_t r = 0; r < rows; ++r) col.bools_[r] = static_cast<uint8_t>((bits[r >> 6] >> (r & 63)) & 1);
+                break;
+            }
+            case ColumnType::Int:
+                col.ints_.resize(rows);
+                for (size_t r = 0; r < rows; ++r) col.ints_[r] = unzigzag(data.varint());
+                break;
+            case ColumnType::Float:
+                if (data.remaining() / 8 < rows) throw ISONError("Invalid binary ISON: truncated");
+                col.floats_.resize(rows);
+                for (size_t r = 0; r < rows; ++r) col.floats_[r] = data.f64();
+                break;
+            case ColumnType::String:
+                get_texts(data, rows, (flags & BinaryDictionary) != 0, col);
+                break;
+            case ColumnType::Reference: {
+                size_t types = data.count();
+                for (size_t i = 0; i < types; ++i) col.ref_type_dict_.push_back(data.string());
+                col.ref_types_.resize(rows);
+                for (size_t r = 0; r < rows; ++r) {
+                    uint64_t t = data.varint();
+                    if (t > types) throw ISONError("Invalid binary ISON: bad reference type");
+                    col.ref_types_[r] = static_cast<int32_t>(t) - 1;
+                }
+                get_texts(data, rows, (flags & BinaryDictionary) != 0, col);
+                break;
+            }
+            case ColumnType::Mixed:
+                col.mixed_.reserve(rows);
+                for (size_t r = 0; r < rows; ++r) {
+                    col.mixed_.push_back(get_value(data));
+                    if (col.mixed_.back().is_null()) col.nulls_[r >> 6] |= static_cast<uint64_t>(1) << (r & 63);
+                }
+                break;
+        }
+        if (!data.at_end()) throw ISONError("Invalid binary ISON: column size mismatch");
+    }
+
+private:
+    struct NullBit {
+        const Column& col;
+        explicit NullBit(const Column& c) : col(c) {}
+        bool operator()(size_t r) const { return col.is_null(r); }
+    };
+
+    struct BoolBit {
+        const Column& col;
+        explicit BoolBit(const Column& c) : col(c) {}
+        bool operator()(size_t r) const { return col.bools_[r] != 0; }
+    };
+
+    template<typename Bit>
+    static void put_bits(std::string& out, size_t rows, Bit bit) {
+        for (size_t r = 0; r < rows; r += 8) {
+            unsigned byte = 0;
+            for (size_t k = 0; k < 8 && r + k < rows; ++k) {
+                if (bit(r + k)) byte |= 1u << k;
+            }
+            out += static_cast<char>(byte);
+        }
+    }
+
+    static void get_bits(ByteReader& in, size_t rows, std::vector<uint64_t>& words) {
+        StringView bytes = in.bytes((rows + 7) / 8);
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            words[i >> 3] |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * (i & 7));
+        }
+        // Ignore padding bits past the last row
+        if (rows & 63) words.back() &= (static_cast<uint64_t>(1) << (rows & 63)) - 1;
+    }
+
+    // Returns true when the dictionary form was written
+    static bool put_texts(const Column& col, size_t rows, const BinaryOptions& options, std::string& out) {
+        if (options.dictionary && rows >= 4) {
+            std::unordered_map<StringView, uint32_t, StringViewHash> ids;
+            std::vector<StringView> entries;
+            std::vector<uint32_t> indexes;
+            indexes.reserve(rows);
+            bool worthwhile = true;
+            for (size_t r = 0; r < rows && worthwhile; ++r) {
+                StringView text = col.text_at(r);
+                std::pair<std::unordered_map<StringView, uint32_t, StringViewHash>::iterator, bool> ins =
+                    ids.insert(std::make_pair(text, static_cast<uint32_t>(entries.size())));
+                if (ins.second) entries.push_back(text);
+                indexes.push_back(ins.first->second);
+                // Mostly unique columns are smaller without the indirection
+                worthwhile = entries.size() <= rows / 2 + 1;
+            }
+            if (worthwhile) {
+                put_varint(out, entries.size());
+                for (size_t i = 0; i < entries.size(); ++i) put_str(out, entries[i]);
+                for (size_t r = 0; r < rows; ++r) put_varint(out, indexes[r]);
+                return true;
+            }
+        }
+        for (size_t r = 0; r < rows; ++r) put_varint(out, col.offsets_[r + 1] - col.offsets_[r]);
+        size_t begin = static_cast<size_t>(col.offsets_[0]);
+        out.append(col.chars_, begin, static_cast<size_t>(col.offsets_[rows]) - begin);
+        return false;
+    }
+
+    static void get_texts(ByteReader& in, size_t rows, bool dictionary, Column& col) {
+        col.offsets_.resize(rows + 1);
+        col.offsets_[0] = 0;
+        if (dictionary) {
+            size_t count = in.count();
+            std::vector<StringView> entries;
+            entries.reserve(count);
+            for (size_t i = 0; i < count; ++i) entries.push_back(in.str());
+            for (size_t r = 0; r < rows; ++r) {
+                uint64_t index = in.varint();
+                if (index >= count) throw ISONError("Invalid binary ISON: bad dictionary index");
+                col.chars_.append(entries[static_cast<size_t>(index)].data(), entries[static_cast<size_t>(index)].size());
+                col.offsets_[r + 1] = col.chars_.size();
+            }
+            return;
+        }
+        uint64_t total = 0;
+        for (size_t r = 0; r < rows; ++r) {
+            total += in.varint();
+            col.offsets_[r + 1] = total;
+        }
+        if (total > in.remaining()) throw ISONError("Invalid binary ISON: truncated");
+        StringView chars = in.bytes(static_cast<size_t>(total));
+        col.chars_.assign(chars.data(), chars.size());
+    }
+
+    static void put_value(std::string& out, const Value& v) {
+        const Reference* ref = v.is_reference() ? v.get_reference() : NULL;
+        ValueType type = v.is_reference() && !ref ? ValueType::Null : v.type();
+        out += static_cast<char>(type);
+        switch (type) {
+            case ValueType::Null: break;
+            case ValueType::Bool: out += static_cast<char>(v.as_bool() ? 1 : 0); break;
+            case ValueType::Int: put_varint(out, zigzag(v.as_int())); break;
+            case ValueType::Float: put_f64(out, v.as_float()); break;
+            case ValueType::String: put_str(out, v.as_string()); break;
+            case ValueType::Reference:
+                out += static_cast<char>(ref->type.has_value() ? 1 : 0);
+                if (ref->type.has_value()) put_str(out, ref->type.value());
+                put_str(out, ref->id);
+                break;
+        }
+    }
+
+    static Value get_value(ByteReader& in) {
+        switch (in.u8()) {
+            case static_cast<uint8_t>(ValueType::Null): return Value(nullptr);
+            case static_cast<uint8_t>(ValueType::Bool): return Value(in.u8() != 0);
+            case static_cast<uint8_t>(ValueType::Int): return Value(unzigzag(in.varint()));
+            case static_cast<uint8_t>(ValueType::Float): return Value(in.f64());
+            case static_cast<uint8_t>(ValueType::String): return Value(in.string());
+            case static_cast<uint8_t>(ValueType::Reference): {
+                std::shared_ptr<Reference> ref = std::make_shared<Reference>();
+                if (in.u8() != 0) ref->type = in.string();
+                ref->id = in.string();
+                return Value(ref);
+            }
+            default: throw ISONError("Invalid binary ISON: bad value type");
+        }
+    }
+};
+
+inline void encode_block(const ColumnarBlock& block, const BinaryOptions& options,
+                         std::string& payload, std::string& out) {
+    put_str(out, block.kind);
+    put_str(out, block.name);
+    out += static_cast<char>(block.summary.has_value() ? 1 : 0);
+    if (block.summary.has_value()) put_str(out, block.summary.value());
+
+    // Field names come from field_info when present, as in the text form
+    bool infos = block.field_info.size() == block.fields.size();
+    put_varint(out, block.fields.size());
+    for (size_t i = 0; i < block.fields.size(); ++i) {
+        put_str(out, block.fields[i]);
+        bool typed = infos && block.field_info[i].type.has_value();
+        out += static_cast<char>(typed ? 1 : 0);
+        if (typed) put_str(out, block.field_info[i].type.value());
+    }
+
+    put_varint(out, block.size());
+    if (block.columns.size() != block.fields.size()) throw ISONError("Block columns do not match its fields");
+    for (size_t c = 0; c < block.columns.size(); ++c) {
+        ColumnCodec::encode(block.columns[c], block.size(), options, payload, out);
+    }
+}
+
+inline void decode_block(ByteReader& in, ColumnarBlock& block, std::string& scratch) {
+    block.kind = in.string();
+    block.name = in.string();
+    if (in.u8() != 0) block.summary = in.string();
+
+    size_t fields = in.count();
+    std::vector<FieldInfo> infos;
+    infos.reserve(fields);
+    for (size_t i = 0; i < fields; ++i) {
+        std::string name = in.string();
+        if (in.u8() != 0) infos.push_back(FieldInfo(name, in.string()));
+        else infos.push_back(FieldInfo(name));
+    }
+    block.set_fields(infos);
+
+    uint64_t rows = in.varint();
+    if (rows > 0 && block.columns.empty()) throw ISONError("Invalid binary ISON: rows without fields");
+    for (size_t c = 0; c < block.columns.size(); ++c) {
+        ColumnCodec::decode(in, static_cast<size_t>(rows), block.columns[c], scratch);
+    }
+    ColumnCodec::set_rows(block, static_cast<size_t>(rows));
+}
+
+} // namespace detail
+
+/**
+ * @brief Encode a columnar document in the binary format
+ */
+inline std::string dumps_binary(const ColumnarDocument& doc, const BinaryOptions& options = BinaryOptions()) {
+    std::string out(detail::binary_magic, sizeof(detail::binary_magic));
+    out += static_cast<char>(detail::binary_version);
+    detail::put_varint(out, doc.blocks.size());
+    std::string payload;
+    for (size_t i = 0; i < doc.blocks.size(); ++i) detail::encode_block(doc.blocks[i], options, payload, out);
+    return out;
+}
+
+inline std::string dumps_binary(const Document& doc, const BinaryOptions& options = BinaryOptions()) {
+    std::string out(detail::binary_magic, sizeof(detail::binary_magic));
+    out += static_cast<char>(detail::binary_version);
+    detail::put_varint(out, doc.blocks.size());
+    std::string payload;
+    for (size_t i = 0; i < doc.blocks.size(); ++i) {
+        detail::encode_block(ColumnarBlock::from_block(doc.blocks[i]), options, payload, out);
+    }
+    return out;
+}
+
+/**
+ * @brief Decode binary ISON straight into columns; throws ISONError on bad input
+ */
+inline ColumnarDocument loads_binary_columnar(const char* data, size_t size) {
+    detail::ByteReader in(data, size);
+    StringView magic = in.bytes(sizeof(detail::binary_magic));
+    if (std::memcmp(magic.data(), detail::binary_magic, sizeof(detail::binary_magic)) != 0) {
+        throw ISONError("Invalid binary ISON: bad magic");
+    }
+    if (in.u8() != detail::binary_version) throw ISONError("Unsupported binary ISON version");
+
+    ColumnarDocument doc;
+    size_t blocks = in.count();
+    doc.blocks.resize(blocks);
+    std::string scratch;
+    for (size_t i = 0; i < blocks; ++i) detail::decode_block(in, doc.blocks[i], scratch);
+    if (!in.at_end()) throw ISONError("Invalid binary ISON: trailing data");
+    doc.reindex();
+    return doc;
+}
+
+inline ColumnarDocument loads_binary_columnar(const std::string& data) {
+    return loads_binary_columnar(data.data(), data.size());
+}
+
+inline Document loads_binary(const char* data, size_t size) {
+    return loads_binary_columnar(data, size).to_document();
+}
+
+inline Document loads_binary(const std::string& data) {
+    return loads_binary(data.data(), data.size());
+}
+
+// =============================================================================
+// Struct Binding
+// =============================================================================
+
+/**
+ * @brief Decodes and encodes one bound struct member of type T
+ *
+ * Specialize it to bind members of your own types:
+ *
+ *   static const char* type_name();                   // header type hint, or NULL
+ *   static bool decode(const Token& token, T& out);   // false if the token does not fit
+ *   static void encode(std::string& out, const T& value);
+ */
+template<typename T, typename Enable = void>
+struct FieldCodec;
+
+template<typename T>
+struct FieldCodec<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static const char* type_name() { return "int"; }
+
+    static bool decode(const Token& token, T& out) {
+        return !token.quoted && decode(token.text, out, typename std::is_unsigned<T>::type());
+    }
+
+    static void encode(std::string& out, const T& value) {
+        if (value < T()) {
+            detail::append_int(out, static_cast<int64_t>(value));
+        } else {
+            detail::append_uint(out, static_cast<uint64_t>(value));
+        }
+    }
+
+private:
+    // Unsigned members are read as uint64_t, so values above INT64_MAX round-trip
+    static bool decode(StringView text, T& out, std::true_type) {
+        uint64_t value;
+        if (!detail::parse_uint(text, value) || value > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+            return false;
+        }
+        out = static_cast<T>(value);
+        return true;
+    }
+
+    static bool decode(StringView text, T& out, std::false_type) {
+        int64_t int_value;
+        double float_value;
+        if (detail::parse_number(text, int_value, float_value) != detail::NumberKind::Integer) return false;
+        T narrowed = static_cast<T>(int_value);
+        if (static_cast<int64_t>(narrowed) != int_value) return false;
+        out = narrowed;
+        return true;
+    }
+};
+
+template<typename T>
+struct FieldCodec<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static const char* type_name() { return "float"; }
+
+    static bool decode(const Token& token, T& out) {
+        int64_t int_value;
+        double float_value;
+        if (token.quoted) return false;
+        switch (detail::parse_number(token.text, int_value, float_value)) {
+            case detail::NumberKind::Integer: out = static_cast<T>(int_value); return true;
+            case detail::NumberKind::Float: out = static_cast<T>(float_value); return true;
+            default: return false;
+        }
+    }
+
+    static void encode(std::string& out, const T& value) { detail::append_double(out, static_cast<double>(value)); }
+};
+
+template<>
+struct FieldCodec<bool> {
+    static const char* type_name() { return "bool"; }
+
+    static bool decode(const Token& token, bool& out) {
+        if (token.quoted) return false;
+        if (token.text == "true") { out = true; return true; }
+        if (token.text == "false") { out = false; return true; }
+        return false;
+    }
+
+    static void encode(std::string& out, const bool& value) { out += value ? "true" : "false"; }
+};
+
+template<>
+struct FieldCodec<std::string> {
+    static const char* type_name() { return "string"; }
+
+    static bool decode(const Token& token, std::string& out) {
+        out.assign(token.text.data(), token.text.size());
+        return true;
+    }
+
+    static void encode(std::string& out, const std::string& value) { detail::append_ison_string(out, value); }
+};
+
+template<>
+struct FieldCodec<Reference> {
+    static const char* type_name() { return "ref"; }
+
+    static bool decode(const Token& token, Reference& out) {
+        if (token.quoted || token.text.empty() || token.text[0] != ':') return false;
+        StringView type, id;
+        bool typed = detail::split_reference(token.text.substr(1), type, id);
+        out.id.assign(id.data(), id.size());
+        if (typed) out.type = std::string(type.data(), type.size());
+        else out.type.reset();
+        return true;
+    }
+
+    static void encode(std::string& out, const Reference& value) {
+        detail::append_reference(out, value.id, value.type.has_value() ? &value.type.value() : NULL);
+    }
+};
+
+template<>
+struct FieldCodec<Value> {
+    static const char* type_name() { return NULL; }
+
+    static bool decode(const Token& token, Value& out) {
+        out = TypeInferrer::infer(token.text, token.quoted);
+        return true;
+    }
+
+    static void encode(std::string& out, const Value& value) { detail::append_ison_value(out, value); }
+};
+
+template<typename T>
+struct FieldCodec<Optional<T> > {
+    static const char* type_name() { return FieldCodec<T>::type_name(); }
+
+    static bool decode(const Token& token, Optional<T>& out) {
+        T value = T();
+        if (!FieldCodec<T>::decode(token, value)) return false;
+        out = value;
+        return true;
+    }
+
+    static void encode(std::string& out, const Optional<T>& value) {
+        if (value.has_value()) FieldCodec<T>::encode(out, value.value());
+        else out += "null";
+    }
+};
+
+namespace detail {
+
+// Decodes the cells of one row into the members of a bound struct
+struct MemberDecoder {
+    const std::vector<Token>* tokens;
+    const size_t* column_of;     // member index -> column, or npos
+    size_t member;
+    StringView line;
+    size_t line_num;
+
+    template<typename M>
+    void operator()(const char* name, M& value) {
+        size_t column = column_of[member++];
+        if (column == static_cast<size_t>(-1) || column >= tokens->size()) return;
+        const Token& token = (*tokens)[column];
+        if (!token.quoted && (token.text == "null" || token.text == "~")) {
+            value = M();
+            return;
+        }
+        if (FieldCodec<M>::decode(token, value)) return;
+
+        const char* type = FieldCodec<M>::type_name();
+        const char* at = token.text.data();
+        bool in_line = at >= line.data() && at <= line.data() + line.size();
+        throw ISONSyntaxError("Field '" + std::string(name) + "' expects " + (type ? type : "a value") +
+                              ", got '" + std::string(token.text.data(), token.text.size()) + "'",
+                              static_cast<int>(line_num), in_line ? static_cast<int>(at - line.data()) : 0);
+    }
+};
+
+struct MemberEncoder {
+    std::string* out;
+    bool first;
+
+    template<typename M>
+    void operator()(const char*, const M& value) {
+        if (!first) *out += ' ';
+        first = false;
+        FieldCodec<M>::encode(*out, value);
+    }
+};
+
+struct MemberHeader {
+    std::string* out;
+    bool first;
+
+    template<typename M>
+    void operator()(const char* name, const M&) {
+        if (!first) *out += ' ';
+        first = false;
+        *out += name;
+        if (const char* type = FieldCodec<M>::type_name()) {
+            *out += ':';
+            *out += type;
+        }
+    }
+};
+
+// BlockLineParser handler that decodes the rows of one block into a container
+template<typename Container>
+struct BoundBlockReader {
+    typedef typename Container::value_type T;
+
+    Container& out;
+    const std::string& wanted;
+    bool active;
+    bool found;
+    std::vector<size_t> column_of;
+    Tokenizer tokenizer;
+    std::vector<Token> tokens;
+
+    BoundBlockReader(Container& out, const std::string& wanted)
+        : out(out), wanted(wanted), active(false), found(false) {}
+
+    void begin_block(const std::string&, const std::string& name) {
+        active = !found && (wanted.empty() || name == wanted);
+        found = found || active;
+    }
+
+    void fields(std::vector<FieldInfo>& field_info) {
+        if (!active) return;
+        size_t count = 0;
+        const char* const* names = ison_bind_names(static_cast<const T*>(NULL), count);
+        column_of.assign(count, static_cast<size_t>(-1));
+        for (size_t m = 0; m < count; ++m) {
+            for (size_t c = 0; c < field_info.size(); ++c) {
+                if (field_info[c].name == names[m]) {
+                    column_of[m] = c;
+                    break;
+                }
+            }
+        }
+    }
+
+    void row(StringView line, size_t line_num) {
+        if (!active) return;
+        tokenizer.reset(line, static_cast<int>(line_num));
+        tokenizer.tokenize(tokens);
+        T item = T();
+        MemberDecoder decoder = { &tokens, column_of.empty() ? NULL : &column_of[0], 0, line, line_num };
+        ison_bind_fields(item, decoder);
+        out.push_back(item);
+    }
+
+    void summary(StringView) {}
+    void end_block() { active = false; }
+};
+
+template<typename Handler>
+struct BoundLineFeeder {
+    BlockLineParser<Handler>& lines;
+    explicit BoundLineFeeder(BlockLineParser<Handler>& lines) : lines(lines) {}
+    void operator()(StringView line) { lines.line(line); }
+};
+
+} // namespace detail
+
+/**
+ * @brief Decode the rows of one block straight into bound structs
+ *
+ * Columns are matched to members by name once per block; each cell is then
+ * decoded by the member's FieldCodec, with no Value or Row in between.
+ * Members without a column, and null cells, are left value-initialized.
+ * Reads the first block, or the first block called block_name (throws
+ * ISONError if there is none).
+ */
+template<typename Container>
+inline void parse_into(const char* data, size_t size, Container& out, const std::string& block_name = std::string()) {
+    detail::BoundBlockReader<Container> reader(out, block_name);
+    detail::BlockLineParser<detail::BoundBlockReader<Container> > lines(reader);
+    detail::BoundLineFeeder<detail::BoundBlockReader<Container> > feed(lines);
+    detail::for_each_line(data, size, feed);
+    lines.finish();
+    if (!reader.found && !block_name.empty()) {
+        throw ISONError("Block not found: " + block_name);
+    }
+}
+
+template<typename Container>
+inline Container parse_into(const std::string& text, const std::string& block_name = std::string()) {
+    Container out;
+    parse_into(text.data(), text.size(), out, block_name);
+    return out;
+}
+
+/**
+ * @brief Serialize bound structs as one block, with member types as field hints
+ */
+template<typename Container>
+inline std::string dumps_from(const Container& items, const std::string& name, const std::string& kind = "table") {
+    typedef typename Container::value_type T;
+    std::string out = kind + "." + name + "\n";
+    T prototype = T();
+    detail::MemberHeader header = { &out, true };
+    ison_bind_fields(prototype, header);
+    for (typename Container::const_iterator it = items.begin(); it != items.end(); ++it) {
+        out += '\n';
+        detail::MemberEncoder encoder = { &out, true };
+        ison_bind_fields(*it, encoder);
+    }
+    return out;
+}
+
+// =============================================================================
+// Memory-Mapped Files
+// =============================================================================
+
+/**
+ * @brief Read-only view of a whole file
+ *
+ * Maps the file with mmap (POSIX) or MapViewOfFile (Windows) so it can be
+ * handed to the parser without copying. Falls back to reading the file into
+ * memory when mapping is unavailable (ISON_NO_MMAP, pipes, special files).
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data_(NULL), size_(0), mapped_(false) {
+        open(path);
+    }
+
+    ~MappedFile() { release(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_ ? data_ : ""; }
+    size_t size() const { return size_; }
+    bool is_mapped() const { return mapped_; }
+    StringView view() const { return StringView(data(), size_); }
+
+private:
+    const char* data_;
+    size_t size_;
+    bool mapped_;
+    std::string fallback_;
+
+    void open(const std::string& path) {
+#if ISON_HAS_MMAP && defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw ISONError("Could not open file: " + path);
+        }
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(file, &file_size) && GetFileType(file) == FILE_TYPE_DISK) {
+            size_ = static_cast<size_t>(file_size.QuadPart);
+            if (size_ == 0) {
+                CloseHandle(file);
+                return;
+            }
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping != NULL) {
+                void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+                if (view != NULL) {
+                    CloseHandle(file);
+                    data_ = static_cast<const char*>(view);
+                    mapped_ = true;
+                    return;
+                }
+            }
+        }
+        CloseHandle(file);
+#elif ISON_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw ISONError("Could not open file: " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            size_ = static_cast<size_t>(st.st_size);
+            if (size_ == 0) {
+                ::close(fd);
+                return;
+            }
+            void* view = ::mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+    #ifdef MADV_SEQUENTIAL
+                ::madvise(view, size_, MADV_SEQUENTIAL);
+    #endif
+                ::close(fd);
+                data_ = static_cast<const char*>(view);
+                mapped_ = true;
+                return;
+            }
+        }
+        ::close(fd);
+#endif
+        read_fallback(path);
+    }
+
+    void read_fallback(const std::string& path) {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            throw ISONError("Could not open file: " + path);
+        }
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        fallback_ = buffer.str();
+        data_ = fallback_.data();
+        size_ = fallback_.size();
+    }
+
+    void release() {
+        if (!mapped_) return;
+#if ISON_HAS_MMAP && defined(_WIN32)
+        UnmapViewOfFile(data_);
+#elif ISON_HAS_MMAP
+        ::munmap(const_cast<char*>(data_), size_);
+#endif
+        mapped_ = false;
+    }
+};
+
+// =============================================================================
+// Lazy Documents
+// =============================================================================
+
+namespace detail {
+
+// Text a LazyDocument indexes (a copy, a borrowed buffer or a mapped file)
+// and what its rows allocate from
+struct LazySource {
+    std::string owned;
+    std::shared_ptr<MappedFile> file;
+    const char* data;
+    size_t size;
+    std::shared_ptr<Arena> arena;
+    std::shared_ptr<InternPool> intern_pool;
+
+    LazySource() : data(NULL), size(0) {}
+
+    ValueFactory factory() const { return ValueFactory(arena, intern_pool.get()); }
+};
+
+} // namespace detail
+
+/**
+ * @brief Block of a LazyDocument: its structure is indexed, its rows are
+ * tokenized and inferred on first access
+ *
+ * Not thread-safe: row() updates the block's cache.
+ */
+class LazyBlock {
+public:
+    LazyBlock() : cache_rows_(true), decoded_count_(0) {}
+
+    const std::string& kind() const { return span_.kind; }
+    const std::string& name() const { return span_.name; }
+    const std::vector<std::string>& fields() const { return fields_; }
+    const std::vector<FieldInfo>& field_info() const { return span_.field_info; }
+    const Optional<std::string>& summary() const { return span_.summary; }
+    size_t size() const { return span_.rows.size(); }
+    bool empty() const { return span_.rows.empty(); }
+
+    /**
+     * @brief Row i, decoded on first access
+     *
+     * With ParseOptions::cache_rows the row is kept and the reference stays
+     * valid until clear_cache(); otherwise it is valid until the next row()
+     * call on this block.
+     */
+    const Row& row(size_t i) {
+        if (i >= span_.rows.size()) throw ISONError("Row index out of range in block: " + span_.name);
+        if (!cache_rows_) {
+            decode_row(i, scratch_);
+            return scratch_;
+        }
+        if (cache_.empty()) cache_.resize(span_.rows.size());
+        if (!cache_[i]) {
+            std::unique_ptr<Row> decoded(new Row());
+            decode_row(i, *decoded);
+            cache_[i].swap(decoded);
+            ++decoded_count_;
+        }
+        return *cache_[i];
+    }
+
+    const Row& operator[](size_t i) { return row(i); }
+
+    /**
+     * @brief Decode row i into out, bypassing the cache
+     */
+    void decode_row(size_t i, Row& out) const {
+        const detail::RowSpan& span = span_.rows.at(i);
+        StringView line(source_->data + span.offset, span.length);
+        Tokenizer tokenizer(line, static_cast<int>(span.line_num));
+        std::vector<Token> tokens;
+        tokenizer.tokenize(tokens);
+        out.clear();
+        detail::fill_row(fields_, hinted_, tokens, out, source_->factory(), line, span.line_num);
+    }
+
+    bool is_decoded(size_t i) const { return i < cache_.size() && cache_[i]; }
+    size_t decoded_count() const { return decoded_count_; }
+
+    void clear_cache() {
+        cache_.clear();
+        decoded_count_ = 0;
+    }
+
+    /**
+     * @brief Decode every row into a regular Block (cached rows are reused)
+     */
+    Block to_block() const {
+        Block block;
+        block.kind = span_.kind;
+        block.name = span_.name;
+        block.fields = fields_;
+        block.field_info = span_.field_info;
+        block.summary = span_.summary;
+        block.rows.resize(span_.rows.size());
+        for (size_t i = 0; i < block.rows.size(); ++i) {
+            if (is_decoded(i)) block.rows[i] = *cache_[i];
+            else decode_row(i, block.rows[i]);
+        }
+        block.reindex_fields();
+        return block;
+    }
+
+private:
+    friend class LazyDocument;
+
+    std::shared_ptr<const detail::LazySource> source_;
+    detail::BlockSpan span_;
+    std::vector<std::string> fields_;
+    detail::HintedFields hinted_;
+    bool cache_rows_;
+    std::vector<std::unique_ptr<Row> > cache_;
+    size_t decoded_count_;
+    Row scratch_;
+};
+
+/**
+ * @brief Document whose rows are decoded only when read
+ *
+ * Construction (parse_lazy() / load_lazy()) scans block boundaries and row
+ * offsets without tokenizing rows, so the cost of a partially read document
+ * follows the rows actually touched. Structural errors are thrown up front;
+ * errors in a row's values are thrown when that row is decoded.
+ */
+class LazyDocument {
+public:
+    std::vector<LazyBlock> blocks;
+
+    LazyDocument() {}
+
+    LazyBlock* get(const std::string& name) {
+        size_t i = index_.find(blocks, LazyName(), name);
+        return i != detail::NameIndex::npos ? &blocks[i] : NULL;
+    }
+
+    const LazyBlock* get(const std::string& name) const {
+        size_t i = index_.find(blocks, LazyName(), name);
+        return i != detail::NameIndex::npos ? &blocks[i] : NULL;
+    }
+
+    LazyBlock& operator[](const std::string& name) {
+        LazyBlock* b = get(name);
+        if (!b) throw ISONError("Block not found: " + name);
+        return *b;
+    }
+
+    bool has(const std::string& name) const { return get(name) != NULL; }
+    size_t size() const { return blocks.size(); }
+
+    /**
+     * @brief Decode everything into a regular Document (sharing the arena and pool)
+     */
+    Document to_document() const {
+        Document doc;
+        if (!blocks.empty()) {
+            doc.arena = blocks[0].source_->arena;
+            doc.intern_pool = blocks[0].source_->intern_pool;
+        }
+        doc.blocks.reserve(blocks.size());
+        for (size_t i = 0; i < blocks.size(); ++i) doc.blocks.push_back(blocks[i].to_block());
+        doc.reindex();
+        return doc;
+    }
+
+    /**
+     * @brief Index a source's blocks; used by parse_lazy() and load_lazy()
+     */
+    static LazyDocument index(const std::shared_ptr<detail::LazySource>& source, const ParseOptions& options) {
+        if (options.use_arena) source->arena = Arena::shared(options.arena_block_size);
+        source->intern_pool = options.intern_pool;
+        if (!source->intern_pool && options.intern) source->intern_pool = std::make_shared<InternPool>();
+
+        std::vector<detail::BlockSpan> spans;
+        std::exception_ptr error = detail::index_blocks(source->data, source->size, spans);
+        if (error) std::rethrow_exception(error);
+
+        LazyDocument doc;
+        doc.blocks.resize(spans.size());
+        for (size_t b = 0; b < spans.size(); ++b) {
+            LazyBlock& block = doc.blocks[b];
+            block.source_ = source;
+            block.span_.kind.swap(spans[b].kind);
+            block.span_.name.swap(spans[b].name);
+            block.span_.field_info.swap(spans[b].field_info);
+            block.span_.summary = spans[b].summary;
+            block.span_.rows.swap(spans[b].rows);
+            for (size_t f = 0; f < block.span_.field_info.size(); ++f) {
+                block.fields_.push_back(block.span_.field_info[f].name);
+            }
+            block.hinted_.set(block.span_.field_info, options.type_hints);
+            block.cache_rows_ = options.cache_rows;
+        }
+        doc.index_.rebuild(doc.blocks, LazyName());
+        return doc;
+    }
+
+private:
+    struct LazyName {
+        const std::string& operator()(const LazyBlock& block) const { return block.name(); }
+    };
+
+    detail::NameIndex index_;
+};
+
+/**
+ * @brief Index ISON text for on-demand row decoding (the text is copied)
+ */
+inline LazyDocument parse_lazy(const std::string& text, const ParseOptions& options = ParseOptions()) {
+    std::shared_ptr<detail::LazySource> source = std::make_shared<detail::LazySource>();
+    source->owned = text;
+    source->data = source->owned.data();
+    source->size = source->owned.size();
+    return LazyDocument::index(source, options);
+}
+
+/**
+ * @brief Index a borrowed buffer, which must outlive the LazyDocument
+ */
+inline LazyDocument parse_lazy(const char* data, size_t size, const ParseOptions& options = ParseOptions()) {
+    std::shared_ptr<detail::LazySource> source = std::make_shared<detail::LazySource>();
+    source->data = data;
+    source->size = size;
+    return LazyDocument::index(source, options);
+}
+
+/**
+ * @brief Map a file and index it; the mapping lives as long as the document's blocks
+ */
+inline LazyDocument load_lazy(const std::string& path, const ParseOptions& options = ParseOptions()) {
+    std::shared_ptr<detail::LazySource> source = std::make_shared<detail::LazySource>();
+    source->file = std::make_shared<MappedFile>(path);
+    source->data = source->file->data();
+    source->size = source->file->size();
+    return LazyDocument::index(source, options);
+}
+
+// =============================================================================
+// Segmented ISONL
+// =============================================================================
+
+/**
+ * @brief Options for compress_isonl() and dumps_isonl_segmented()
+ */
+struct SegmentOptions {
+    /** @brief Uncompressed bytes per segment; segments end on a line boundary */
+    size_t segment_size;
+
+    /** @brief LZ-compress segments (a segment that does not shrink is stored as is) */
+    bool compress;
+
+    /** @brief Threads compressing segments (0 = one per hardware thread) */
+    size_t threads;
+
+    SegmentOptions() : segment_size(1 << 20), compress(true), threads(1) {}
+};
+
+/**
+ * @brief Rows of one block held by a segment
+ */
+struct SegmentBlock {
+    std::string kind;
+    std::string name;
+    /** Block row index of the segment's first row of this block */
+    uint64_t first_row;
+    uint64_t rows;
+
+    SegmentBlock() : first_row(0), rows(0) {}
+};
+
+/**
+ * @brief Footer entry of one segment
+ */
+struct SegmentInfo {
+    uint64_t offset;        ///< Payload position in the archive
+    uint64_t stored_size;   ///< Payload bytes
+    uint64_t raw_size;      ///< ISONL bytes once decompressed
+    uint64_t first_line;    ///< 1-based line number of the segment's first line
+    bool compressed;
+    std::vector<SegmentBlock> blocks;
+
+    SegmentInfo() : offset(0), stored_size(0), raw_size(0), first_line(1), compressed(false) {}
+
+    const SegmentBlock* block(const std::string& name) const {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (blocks[i].name == name) return &blocks[i];
+        }
+        return NULL;
+    }
+};
+
+namespace detail {
+
+/*
+ * Layout (varint and str as in the binary format):
+ *
+ *   "ISLZ" u8 version, then the segment payloads back to back, then the footer:
+ *     str dictionary
+ *     varint segment count, per segment:
+ *       varint offset, varint stored size, varint raw size, varint first line,
+ *       u8 flags (1 = compressed), varint block count, per block:
+ *         str kind, str name, varint first row, varint rows
+ *   and last, u32 little-endian footer size and "ISLZ" again.
+ *
+ * The dictionary holds each distinct "kind.name|fields|" prefix once; it is
+ * the LZ history of every compressed segment, so even a segment's first
+ * lines compress to back-references.
+ */
+const char segment_magic[4] = {'I', 'S', 'L', 'Z'};
+const uint8_t segment_version = 1;
+const size_t segment_trailer_size = 8;
+const size_t segment_dictionary_limit = 65535;
+
+struct SegmentPlan {
+    size_t begin;
+    size_t end;
+    SegmentInfo info;
+    std::string payload;
+};
+
+// Cuts ISONL text into segments on line boundaries and counts each segment's rows per block
+class SegmentPlanner {
+public:
+    SegmentPlanner(const char* data, size_t size, size_t segment_size)
+        : data_(data), size_(size), segment_size_(segment_size > 0 ? segment_size : 1) {}
+
+    void run(std::vector<SegmentPlan>& plans, std::string& dictionary) {
+        size_t pos = 0;
+        uint64_t line_num = 0;
+        while (pos < size_) {
+            if (plans.empty() || pos - plans.back().begin >= segment_size_) {
+                if (!plans.empty()) plans.back().end = pos;
+                plans.push_back(SegmentPlan());
+                plans.back().begin = pos;
+                plans.back().info.first_line = line_num + 1;
+                local_.clear();
+            }
+            const char* begin = data_ + pos;
+            const void* nl = std::memchr(begin, '\n', size_ - pos);
+            size_t len = nl ? static_cast<size_t>(static_cast<const char*>(nl) - begin) : size_ - pos;
+            pos += len + (nl ? 1 : 0);
+            if (len > 0 && begin[len - 1] == '\r') --len;
+            count_line(StringView(begin, len), static_cast<int>(++line_num), plans.back().info, dictionary);
+        }
+        if (!plans.empty()) plans.back().end = size_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t segment_size_;
+    std::map<std::string, uint64_t> totals_;         // kind.name -> rows so far
+    std::map<std::string, size_t> local_;            // kind.name -> index in the segment's blocks
+    std::set<std::string> prefixes_;
+    std::string key_;
+
+    void count_line(StringView line, int line_num, SegmentInfo& info, std::string& dictionary) {
+        StringView trimmed = trim_line(line);
+        if (trimmed.empty() || trimmed[0] == '#') return;
+
+        StringView sections[3];
+        if (split_isonl_sections(trimmed, sections) != 3) {
+            throw ISONSyntaxError("ISONL line must have 3 pipe-separated sections", line_num, 0);
+        }
+        size_t dot_pos = sections[0].find('.');
+        if (dot_pos == StringView::npos) {
+            throw ISONSyntaxError("Invalid ISONL header", line_num, 0);
+        }
+
+        key_.assign(sections[0].data(), sections[0].size());
+        std::map<std::string, size_t>::iterator it = local_.find(key_);
+        if (it == local_.end()) {
+            it = local_.insert(std::make_pair(key_, info.blocks.size())).first;
+            info.blocks.push_back(SegmentBlock());
+            SegmentBlock& block = info.blocks.back();
+            block.kind = key_.substr(0, dot_pos);
+            block.name = key_.substr(dot_pos + 1);
+            block.first_row = totals_[key_];
+        }
+        ++info.blocks[it->second].rows;
+        ++totals_[key_];
+
+        size_t prefix_size = static_cast<size_t>(sections[2].data() - trimmed.data());
+        std::string prefix(trimmed.data(), prefix_size);
+        if (dictionary.size() + prefix.size() + 1 <= segment_dictionary_limit && prefixes_.insert(prefix).second) {
+            dictionary += prefix;
+            dictionary += '\n';
+        }
+    }
+};
+
+struct SegmentCompressTask {
+    const char* data;
+    const std::string* dictionary;
+    std::vector<SegmentPlan>* plans;
+    bool compress;
+
+    void operator()(size_t task) {
+        SegmentPlan& plan = (*plans)[task];
+        size_t size = plan.end - plan.begin;
+        plan.info.raw_size = size;
+        if (compress && size > 0) {
+            std::string window;
+            window.reserve(dictionary->size() + size);
+            window += *dictionary;
+            window.append(data + plan.begin, size);
+            lz_compress(window.data() + dictionary->size(), size, plan.payload, dictionary->size());
+            if (plan.payload.size() < size) {
+                plan.info.compressed = true;
+                return;
+            }
+            plan.payload.clear();
+        }
+        plan.payload.assign(data + plan.begin, size);
+    }
+};
+
+inline void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+// Decompresses and parses the listed segments of an archive
+struct SegmentReadTask {
+    const char* data;
+    const std::string* dictionary;
+    const std::vector<SegmentInfo>* segments;
+    const std::vector<size_t>* selected;
+    const std::string* only;        // block name to keep, or null for every block
+    std::vector<ISONLBlockBuilder> builders;
+
+    // Feeds a builder the lines of one block, keeping line numbers of the whole segment
+    struct BlockLines {
+        ISONLBlockBuilder& builder;
+        const std::string& name;
+        int line_num;
+
+        void operator()(StringView line) {
+            ++line_num;
+            const char* bar = static_cast<const char*>(std::memchr(line.data(), '|', line.size()));
+            if (bar) {
+                StringView header = trim_line(StringView(line.data(), static_cast<size_t>(bar - line.data())));
+                size_t dot_pos = header.find('.');
+                if (dot_pos != StringView::npos && header.substr(dot_pos + 1) != StringView(name)) return;
+            }
+            builder.add_line(line, line_num);
+        }
+    };
+
+    void operator()(size_t task) {
+        const SegmentInfo& info = (*segments)[(*selected)[task]];
+        std::string window;
+        const char* text = data + info.offset;
+        if (info.compressed) {
+            window = *dictionary;
+            lz_decompress(text, static_cast<size_t>(info.stored_size), window, static_cast<size_t>(info.raw_size),
+                          dictionary->size());
+            text = window.data() + dictionary->size();
+        }
+        if (only) {
+            BlockLines lines = { builders[task], *only, static_cast<int>(info.first_line) - 1 };
+            for_each_line(text, static_cast<size_t>(info.raw_size), lines);
+            return;
+        }
+        builders[task].set_first_line(static_cast<int>(info.first_line));
+        for_each_line(text, static_cast<size_t>(info.raw_size), builders[task]);
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief ISONL text as independently compressed segments with a block index
+ *
+ * The text is cut on line boundaries into segments of about segment_size
+ * bytes. The footer records, for every segment, the blocks it holds and
+ * their row ranges, so SegmentedISONL can decompress only the segments a
+ * read needs. Throws ISONSyntaxError on malformed ISONL lines.
+ */
+inline std::string compress_isonl(const char* data, size_t size, const SegmentOptions& options = SegmentOptions()) {
+    std::vector<detail::SegmentPlan> plans;
+    std::string dictionary;
+    detail::SegmentPlanner(data, size, options.segment_size).run(plans, dictionary);
+
+    detail::SegmentCompressTask task;
+    task.data = data;
+    task.dictionary = &dictionary;
+    task.plans = &plans;
+    task.compress = options.compress;
+    detail::parallel_for(plans.size(), options.threads, task);
+
+    std::string out(detail::segment_magic, sizeof(detail::segment_magic));
+    out += static_cast<char>(detail::segment_version);
+    for (size_t i = 0; i < plans.size(); ++i) {
+        plans[i].info.offset = out.size();
+        plans[i].info.stored_size = plans[i].payload.size();
+        out += plans[i].payload;
+        std::string().swap(plans[i].payload);
+    }
+
+    size_t footer_start = out.size();
+    detail::put_str(out, dictionary);
+    detail::put_varint(out, plans.size());
+    for (size_t i = 0; i < plans.size(); ++i) {
+        const SegmentInfo& info = plans[i].info;
+        detail::put_varint(out, info.offset);
+        detail::put_varint(out, info.stored_size);
+        detail::put_varint(out, info.raw_size);
+        detail::put_varint(out, info.first_line);
+        out += static_cast<char>(info.compressed ? 1 : 0);
+        detail::put_varint(out, info.blocks.size());
+        for (size_t b = 0; b < info.blocks.size(); ++b) {
+            detail::put_str(out, info.blocks[b].kind);
+            detail::put_str(out, info.blocks[b].name);
+            detail::put_varint(out, info.blocks[b].first_row);
+            detail::put_varint(out, info.blocks[b].rows);
+        }
+    }
+    detail::put_u32(out, static_cast<uint32_t>(out.size() - footer_start));
+    out.append(detail::segment_magic, sizeof(detail::segment_magic));
+    return out;
+}
+
+inline std::string compress_isonl(const std::string& isonl_text, const SegmentOptions& options = SegmentOptions()) {
+    return compress_isonl(isonl_text.data(), isonl_text.size(), options);
+}
+
+/**
+ * @brief Reader over a compress_isonl() archive
+ *
+ * Opening reads only the footer. Reads decompress and parse the segments
+ * they need, optionally on several threads, and return the same blocks and
+ * rows, in the same order, as parsing that part of the original ISONL.
+ * Copies share the archive bytes. Throws ISONError on a corrupt archive.
+ */
+class SegmentedISONL {
+public:
+    /** @brief Read a borrowed buffer, which must outlive the reader */
+    SegmentedISONL(const char* data, size_t size) : data_(data), size_(size) { read_footer(); }
+
+    explicit SegmentedISONL(const std::string& archive)
+        : owned_(std::make_shared<std::string>(archive)), data_(owned_->data()), size_(owned_->size()) {
+        read_footer();
+    }
+
+    /** @brief Read a mapped file, kept open by the reader and its copies */
+    explicit SegmentedISONL(const std::shared_ptr<MappedFile>& file)
+        : file_(file), data_(file->data()), size_(file->size()) {
+        read_footer();
+    }
+
+    size_t segment_count() const { return segments_.size(); }
+    const SegmentInfo& segment(size_t index) const { return segments_.at(index); }
+    const std::vector<SegmentInfo>& segments() const { return segments_; }
+
+    /** @brief Indices of the segments holding rows of the named block */
+    std::vector<size_t> segments_with(const std::string& name) const {
+        std::vector<size_t> result;
+        for (size_t i = 0; i < segments_.size(); ++i) {
+            if (segments_[i].block(name)) result.push_back(i);
+        }
+        return result;
+    }
+
+    /** @brief One segment's ISONL text */
+    std::string segment_text(size_t index) const {
+        const SegmentInfo& info = segment(index);
+        if (!info.compressed) return std::string(data_ + info.offset, static_cast<size_t>(info.raw_size));
+        std::string window = dictionary_;
+        detail::lz_decompress(data_ + info.offset, static_cast<size_t>(info.stored_size), window,
+                              static_cast<size_t>(info.raw_size), dictionary_.size());
+        return window.substr(dictionary_.size());
+    }
+
+    /** @brief Parse the given segments (in the order given) into one Document */
+    Document read(const std::vector<size_t>& selected, size_t thread_count = 1) const {
+        return read(selected, thread_count, NULL);
+    }
+
+
+    /** @brief The whole archive, as ISONLParser::parse_to_document() of the original text */
+    Document read_all(size_t thread_count = 0) const {
+        std::vector<size_t> all(segments_.size());
+        for (size_t i = 0; i < all.size(); ++i) all[i] = i;
+        return read(all, thread_count);
+    }
+
+    /** @brief Only the named block, decompressing only the segments that hold it */
+    Document read_block(const std::string& name, size_t thread_count = 0) const {
+        return read(segments_with(name), thread_count, &name);
+    }
+
+    /**
+     * @brief Rows [first, first + count) of the named block
+     *
+     * Decompresses only the segments overlapping the range; the range is
+     * clamped to the block's rows.
+     */
+    Block read_rows(const std::string& name, uint64_t first, uint64_t count) const {
+        // Saturated, so a count like UINT64_MAX reads to the end instead of wrapping
+        const uint64_t last = count > std::numeric_limits<uint64_t>::max() - first
+                                  ? std::numeric_limits<uint64_t>::max() : first + count;
+        std::vector<size_t> selected;
+        uint64_t base = 0;
+        std::string kind;
+        for (size_t i = 0; i < segments_.size(); ++i) {
+            const SegmentBlock* block = segments_[i].block(name);
+            if (!block) continue;
+            if (kind.empty()) kind = block->kind;
+            if (block->kind != kind || block->first_row + block->rows <= first) continue;
+            if (block->first_row >= last) break;
+            if (selected.empty()) base = block->first_row;
+            selected.push_back(i);
+        }
+        Document doc = read(selected, 1, &name);
+        Block result(kind, name);
+        for (size_t i = 0; i < doc.blocks.size(); ++i) {
+            Block& block = doc.blocks[i];
+            if (block.kind != kind || block.name != name) continue;
+            result.fields = block.fields;
+            uint64_t begin = first > base ? first - base : 0;
+            uint64_t end = std::min<uint64_t>(last > base ? last - base : 0, block.rows.size());
+            for (uint64_t r = begin; r < end; ++r) result.rows.push_back(std::move(block.rows[r]));
+        }
+        return result;
+    }
+
+private:
+    std::shared_ptr<const std::string> owned_;
+    std::shared_ptr<MappedFile> file_;
+    const char* data_;
+    size_t size_;
+    std::string dictionary_;
+    std::vector<SegmentInfo> segments_;
+
+    Document read(const std::vector<size_t>& selected, size_t thread_count, const std::string* only) const {
+        for (size_t i = 0; i < selected.size(); ++i) {
+            if (selected[i] >= segments_.size()) throw ISONError("Segment index out of range");
+        }
+        detail::SegmentReadTask task;
+        task.data = data_;
+        task.dictionary = &dictionary_;
+        task.segments = &segments_;
+        task.selected = &selected;
+        task.only = only;
+        task.builders.resize(selected.size());
+        detail::parallel_for(selected.size(), thread_count, task);
+
+        Document doc;
+        std::map<std::string, size_t> index;
+        for (size_t i = 0; i < task.builders.size(); ++i) task.builders[i].merge_into(doc.blocks, index);
+        doc.reindex();
+        return doc;
+    }
+
+    void read_footer() {
+        const size_t header = sizeof(detail::segment_magic) + 1;
+        if (size_ < header + detail::segment_trailer_size ||
+            std::memcmp(data_, detail::segment_magic, sizeof(detail::segment_magic)) != 0 ||
+            std::memcmp(data_ + size_ - 4, detail::segment_magic, sizeof(detail::segment_magic)) != 0) {
+            throw ISONError("Invalid segmented ISONL: bad magic");
+        }
+        if (static_cast<uint8_t>(data_[4]) != detail::segment_version) {
+            throw ISONError("Unsupported segmented ISONL version");
+        }
+        const unsigned char* trailer = reinterpret_cast<const unsigned char*>(data_ + size_ - detail::segment_trailer_size);
+        size_t footer_size = static_cast<size_t>(trailer[0]) | (static_cast<size_t>(trailer[1]) << 8) |
+                             (static_cast<size_t>(trailer[2]) << 16) | (static_cast<size_t>(trailer[3]) << 24);
+        size_t payload_end = size_ - detail::segment_trailer_size;
+        if (footer_size > payload_end - header) throw ISONError("Invalid segmented ISONL: truncated");
+        payload_end -= footer_size;
+
+        detail::ByteReader in(data_ + payload_end, footer_size, "segmented ISONL");
+        dictionary_ = in.string();
+        size_t count = in.count();
+        segments_.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            SegmentInfo& info = segments_[i];
+            info.offset = in.varint();
+            info.stored_size = in.varint();
+            info.raw_size = in.varint();
+            info.first_line = in.varint();
+            info.compressed = (in.u8() & 1) != 0;
+            if (info.offset < header || info.offset > payload_end || info.stored_size > payload_end - info.offset ||
+                (!info.compressed && info.raw_size != info.stored_size) || info.first_line == 0 ||
+                info.first_line > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+                in.fail("bad segment entry");
+            }
+            info.blocks.resize(in.count());
+            for (size_t b = 0; b < info.blocks.size(); ++b) {
+                info.blocks[b].kind = in.string();
+                info.blocks[b].name = in.string();
+                info.blocks[b].first_row = in.varint();
+                info.blocks[b].rows = in.varint();
+            }
+        }
+        if (!in.at_end()) in.fail("trailing data");
+    }
+};
+
+// =============================================================================
+// Document Diffs
+// =============================================================================
+
+/**
+ * @brief Row changes to one block between two versions of a Document
+ *
+ * changed and removed index rows of the old block; removed is ascending.
+ * added holds rows of the new block by their new index, ascending, and is
+ * applied after the removals. fields gives the cell order dumps() writes.
+ */
+struct BlockDiff {
+    /** Index of the block in the old document */
+    size_t block;
+    std::string kind;
+    std::string name;
+    std::vector<std::string> fields;
+    std::vector<std::pair<size_t, Row> > changed;
+    std::vector<size_t> removed;
+    std::vector<std::pair<size_t, Row> > added;
+    bool summary_changed;
+    Optional<std::string> summary;
+
+    BlockDiff() : block(0), summary_changed(false) {}
+
+    bool empty() const { return changed.empty() && removed.empty() && added.empty() && !summary_changed; }
+};
+
+/**
+ * @brief Structural differences between two versions of a Document
+ *
+ * Blocks are matched by name, in order. A block whose kind or fields differ,
+ * or that moved past another matched block, is replaced whole: its old index
+ * goes in removed_blocks and the new block in added_blocks, by new index.
+ * Rows are matched by position once the rows both versions start and end
+ * with are skipped.
+ *
+ * dumps() writes one change per line:
+ *
+ *   @remove 3               drop old block 3
+ *   @block 0 table.users    row changes to old block 0
+ *   @fields id name         cell order of the rows that follow
+ *   = 2 7 Dana              old row 2 now reads "7 Dana"
+ *   - 5 2                   remove old rows 5 and 6
+ *   + 8 9 Eve               new row 8
+ *   @summary "3 users"      new summary (null clears it)
+ *   @add 1                  new block 1: ISON text up to a blank line
+ */
+struct DocumentDiff {
+    std::vector<size_t> removed_blocks;
+    std::vector<std::pair<size_t, Block> > added_blocks;
+    std::vector<BlockDiff> blocks;
+
+    bool empty() const { return removed_blocks.empty() && added_blocks.empty() && blocks.empty(); }
+
+    std::string dumps() const {
+        std::string out;
+        for (size_t i = 0; i < removed_blocks.size(); ++i) {
+            out += "@remove ";
+            detail::append_uint(out, removed_blocks[i]);
+            out += '\n';
+        }
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            const BlockDiff& diff = blocks[b];
+            out += "@block ";
+            detail::append_uint(out, diff.block);
+            out += ' ';
+            detail::append_ison_string(out, diff.kind + '.' + diff.name);
+            out += "\n@fields";
+            for (size_t f = 0; f < diff.fields.size(); ++f) {
+                out += ' ';
+                detail::append_ison_string(out, diff.fields[f]);
+            }
+            out += '\n';
+            for (size_t i = 0; i < diff.changed.size(); ++i) write_row(out, '=', diff.changed[i], diff.fields);
+            for (size_t i = 0; i < diff.removed.size();) {
+                size_t run = 1;
+                while (i + run < diff.removed.size() && diff.removed[i + run] == diff.removed[i] + run) ++run;
+                out += "- ";
+                detail::append_uint(out, diff.removed[i]);
+                out += ' ';
+                detail::append_uint(out, run);
+                out += '\n';
+                i += run;
+            }
+            for (size_t i = 0; i < diff.added.size(); ++i) write_row(out, '+', diff.added[i], diff.fields);
+            if (diff.summary_changed) {
+                out += "@summary ";
+                if (diff.summary.has_value()) detail::append_ison_string(out, diff.summary.value());
+                else out += "null";
+                out += '\n';
+            }
+        }
+        for (size_t i = 0; i < added_blocks.size(); ++i) {
+            out += "@add ";
+            detail::append_uint(out, added_blocks[i].first);
+            out += '\n';
+            write_block(out, added_blocks[i].second);
+            out += '\n';
+        }
+        return out;
+    }
+
+    /** Read dumps() text back; throws ISONSyntaxError on malformed lines */
+    static DocumentDiff loads(const std::string& text);
+
+private:
+    static void write_cells(std::string& out, const Row& row, const std::vector<std::string>& fields) {
+        for (size_t f = 0; f < fields.size(); ++f) {
+            if (f > 0) out += ' ';
+            Row::const_iterator it = row.find(fields[f]);
+            if (it == row.end()) out += "null";
+            else detail::append_ison_value(out, it->second);
+        }
+    }
+
+    static void write_row(std::string& out, char op, const std::pair<size_t, Row>& row,
+                          const std::vector<std::string>& fields) {
+        out += op;
+        out += ' ';
+        detail::append_uint(out, row.first);
+        if (!fields.empty()) out += ' ';
+        write_cells(out, row.second, fields);
+        out += '\n';
+    }
+
+    // Like IsonWriter, but quotes field names so any name reads back
+    static void write_block(std::string& out, const Block& block) {
+        out += block.kind + '.' + block.name + '\n';
+        for (size_t f = 0; f < block.fields.size(); ++f) {
+            if (f > 0) out += ' ';
+            const FieldInfo* info = f < block.field_info.size() ? &block.field_info[f] : NULL;
+            std::string field = block.fields[f];
+            if (info && info->type.has_value()) field += ':' + info->type.value();
+            detail::append_ison_string(out, field);
+        }
+        out += '\n';
+        for (size_t r = 0; r < block.rows.size(); ++r) {
+            size_t start = out.size();
+            write_cells(out, block.rows[r], block.fields);
+            StringView line = detail::trim_line(StringView(out.data() + start, out.size() - start));
+            bool structural = line.empty() || line[0] == '#' || (line.size() >= 3 && line.substr(0, 3) == "---") ||
+                              detail::looks_like_header(line);
+            Row::const_iterator first = block.fields.empty() ? block.rows[r].end() : block.rows[r].find(block.fields[0]);
+            if (structural && first != block.rows[r].end() && first->second.is_string()) {
+                // A bare first cell would read back as a comment, summary or header
+                out.resize(start);
+                out += '"';
+                detail::append_escaped(out, first->second.as_string());
+                out += '"';
+                std::vector<std::string> rest(block.fields.begin() + 1, block.fields.end());
+                if (!rest.empty()) out += ' ';
+                write_cells(out, block.rows[r], rest);
+            }
+            out += '\n';
+        }
+        if (block.summary.has_value()) out += "---\n" + block.summary.value() + '\n';
+    }
+};
+
+namespace detail {
+
+// Rebuilds a DocumentDiff from dumps() text, one line at a time
+struct DiffReader {
+    DocumentDiff diff;
+    int line_num;
+    bool adding;
+    int add_line;
+    std::string add_text;
+    Tokenizer tokenizer;
+    std::vector<Token> tokens;
+    StringView line;
+
+    DiffReader() : line_num(0), adding(false), add_line(0) {}
+
+    void operator()(StringView text) {
+        ++line_num;
+        line = text;
+        StringView stripped = trim_line(line);
+        if (adding) {
+            if (!stripped.empty()) {
+                add_text.append(line.data(), line.size());
+                add_text += '\n';
+                return;
+            }
+            finish();
+            return;
+        }
+        if (stripped.empty()) return;
+        tokenizer.reset(line, line_num);
+        tokenizer.tokenize(tokens);
+        StringView op = tokens[0].text;
+        if (op == "@remove") {
+            diff.removed_blocks.push_back(index(1));
+        } else if (op == "@block") {
+            diff.blocks.push_back(BlockDiff());
+            BlockDiff& block = diff.blocks.back();
+            block.block = index(1);
+            StringView header = token(2).text;
+            size_t dot_pos = header.find('.');
+            if (dot_pos == StringView::npos) fail("Invalid block header in diff", 2);
+            block.kind.assign(header.data(), dot_pos);
+            block.name.assign(header.data() + dot_pos + 1, header.size() - dot_pos - 1);
+        } else if (op == "@fields") {
+            BlockDiff& block = current();
+            block.fields.clear();
+            for (size_t i = 1; i < tokens.size(); ++i) {
+                block.fields.push_back(std::string(tokens[i].text.data(), tokens[i].text.size()));
+            }
+        } else if (op == "=" || op == "+") {
+            BlockDiff& block = current();
+            std::vector<std::pair<size_t, Row> >& rows = op == "=" ? block.changed : block.added;
+            rows.push_back(std::make_pair(index(1), Row()));
+            Row& row = rows.back().second;
+            for (size_t f = 0; f < block.fields.size(); ++f) {
+                row[block.fields[f]] = f + 2 < tokens.size()
+                    ? TypeInferrer::infer(tokens[f + 2].text, tokens[f + 2].quoted) : Value(nullptr);
+            }
+        } else if (op == "-") {
+            BlockDiff& block = current();
+            size_t first = index(1);
+            size_t count = index(2);
+            for (size_t i = 0; i < count; ++i) block.removed.push_back(first + i);
+        } else if (op == "@summary") {
+            BlockDiff& block = current();
+            const Token& value = token(1);
+            block.summary_changed = true;
+            if (!value.quoted && (value.text == "null" || value.text == "~")) {
+                block.summary = Optional<std::string>();
+            } else {
+                block.summary = std::string(value.text.data(), value.text.size());
+            }
+        } else if (op == "@add") {
+            diff.added_blocks.push_back(std::make_pair(index(1), Block()));
+            adding = true;
+            add_line = line_num;
+            add_text.clear();
+        } else {
+            fail("Unknown diff line '" + std::string(op.data(), op.size()) + "'", 0);
+        }
+    }
+
+    void finish() {
+        if (!adding) return;
+        adding = false;
+        Document doc = Parser(add_text).parse();
+        if (doc.blocks.size() != 1) {
+            throw ISONSyntaxError("@add must be followed by exactly one block", add_line, 0);
+        }
+        std::swap(diff.added_blocks.back().second, doc.blocks[0]);
+    }
+
+    BlockDiff& current() {
+        if (diff.blocks.empty()) fail("Row change outside an @block", 0);
+        return diff.blocks.back();
+    }
+
+    const Token& token(size_t i) {
+        if (i >= tokens.size()) fail("Diff line is missing a value", i);
+        return tokens[i];
+    }
+
+    size_t index(size_t i) {
+        const Token& t = token(i);
+        int64_t int_value;
+        double float_value;
+        if (t.quoted || parse_number(t.text, int_value, float_value) != NumberKind::Integer ||
+            int_value < 0) {
+            fail("Expected an index, got '" + std::string(t.text.data(), t.text.size()) + "'", i);
+        }
+        return static_cast<size_t>(int_value);
+    }
+
+    void fail(const std::string& message, size_t token_index) {
+        int col = 0;
+        if (token_index > 0 && token_index < tokens.size()) {
+            const char* at = tokens[token_index].text.data();
+            if (at >= line.data() && at <= line.data() + line.size()) col = static_cast<int>(at - line.data());
+        }
+        throw ISONSyntaxError(message, line_num, col);
+    }
+};
+
+inline bool same_value(const Value& a, const Value& b) {
+    if (a.type() != b.type()) return false;
+    if (a.is_float() && a.as_float() != a.as_float()) return b.as_float() != b.as_float();
+    return compare_values(a, b) == 0;
+}
+
+inline bool same_row(const Row& a, const Row& b) {
+    if (a.size() != b.size()) return false;
+    for (Row::const_iterator i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j) {
+        if (i->first != j->first || !same_value(i->second, j->second)) return false;
+    }
+    return true;
+}
+
+inline bool same_schema(const Block& a, const Block& b) {
+    if (a.kind != b.kind || a.fields != b.fields || a.field_info.size() != b.field_info.size()) return false;
+    for (size_t i = 0; i < a.field_info.size(); ++i) {
+        const FieldInfo& x = a.field_info[i];
+        const FieldInfo& y = b.field_info[i];
+        if (x.name != y.name || x.type.has_value() != y.type.has_value()) return false;
+        if (x.type.has_value() && x.type.value() != y.type.value()) return false;
+    }
+    return true;
+}
+
+// Diffs old rows [first, first + old_count) against their replacements
+inline void diff_rows(const Row* before, size_t old_count, const Row* after, size_t new_count, size_t first,
+                      BlockDiff& out) {
+    size_t head = 0;
+    while (head < old_count && head < new_count && same_row(before[head], after[head])) ++head;
+    size_t tail = 0;
+    while (tail < old_count - head && tail < new_count - head &&
+           same_row(before[old_count - 1 - tail], after[new_count - 1 - tail])) {
+        ++tail;
+    }
+    size_t old_mid = old_count - head - tail;
+    size_t new_mid = new_count - head - tail;
+    size_t common = std::min(old_mid, new_mid);
+    for (size_t i = head; i < head + common; ++i) {
+        if (!same_row(before[i], after[i])) out.changed.push_back(std::make_pair(first + i, after[i]));
+    }
+    for (size_t i = head + common; i < head + old_mid; ++i) out.removed.push_back(first + i);
+    for (size_t i = head + common; i < head + new_mid; ++i) out.added.push_back(std::make_pair(first + i, after[i]));
+}
+
+inline BlockDiff diff_block(size_t index, const Block& before, const Block& after) {
+    BlockDiff diff;
+    diff.block = index;
+    diff.kind = after.kind;
+    diff.name = after.name;
+    diff.fields = after.fields;
+    diff_rows(before.rows.empty() ? NULL : &before.rows[0], before.rows.size(),
+              after.rows.empty() ? NULL : &after.rows[0], after.rows.size(), 0, diff);
+    bool same_summary = before.summary.has_value() == after.summary.has_value() &&
+                        (!after.summary.has_value() || before.summary.value() == after.summary.value());
+    if (!same_summary) {
+        diff.summary_changed = true;
+        diff.summary = after.summary;
+    }
+    return diff;
+}
+
+// Diffs old blocks [first, first + old_count) against their replacements
+inline void diff_blocks(const Block* before, size_t old_count, const Block* after, size_t new_count, size_t first,
+                        DocumentDiff& out) {
+    std::map<std::string, std::pair<std::vector<size_t>, size_t> > by_name;
+    for (size_t i = 0; i < old_count; ++i) by_name[before[i].name].first.push_back(i);
+    std::vector<unsigned char> kept(old_count, 0);
+    size_t next = 0;
+    for (size_t j = 0; j < new_count; ++j) {
+        size_t match = static_cast<size_t>(-1);
+        std::map<std::string, std::pair<std::vector<size_t>, size_t> >::iterator it = by_name.find(after[j].name);
+        if (it != by_name.end()) {
+            std::vector<size_t>& candidates = it->second.first;
+            size_t& pos = it->second.second;
+            while (pos < candidates.size() && candidates[pos] < next) ++pos;
+            if (pos < candidates.size() && same_schema(before[candidates[pos]], after[j])) match = candidates[pos++];
+        }
+        if (match == static_cast<size_t>(-1)) {
+            out.added_blocks.push_back(std::make_pair(first + j, after[j]));
+            continue;
+        }
+        kept[match] = 1;
+        next = match + 1;
+        BlockDiff diff = diff_block(first + match, before[match], after[j]);
+        if (!diff.empty()) out.blocks.push_back(diff);
+    }
+    for (size_t i = 0; i < old_count; ++i) {
+        if (!kept[i]) out.removed_blocks.push_back(first + i);
+    }
+}
+
+inline ISONError diff_mismatch(const std::string& what) {
+    return ISONError("Diff does not apply: " + what);
+}
+
+inline std::string index_text(size_t index) {
+    std::string out;
+    append_uint(out, index);
+    return out;
+}
+
+// Throws unless every change in diff fits doc
+inline void check_diff(const Document& doc, const DocumentDiff& diff) {
+    for (size_t b = 0; b < diff.blocks.size(); ++b) {
+        const BlockDiff& change = diff.blocks[b];
+        if (change.block >= doc.blocks.size() || doc.blocks[change.block].name != change.name ||
+            doc.blocks[change.block].kind != change.kind) {
+            throw diff_mismatch("no block " + change.kind + "." + change.name + " at " + index_text(change.block));
+        }
+        size_t rows = doc.blocks[change.block].rows.size();
+        for (size_t i = 0; i < change.changed.size(); ++i) {
+            if (change.changed[i].first >= rows) throw diff_mismatch("row " + index_text(change.changed[i].first) +
+                                                                     " of " + change.name + " out of range");
+        }
+        for (size_t i = 0; i < change.removed.size(); ++i) {
+            if (change.removed[i] >= rows || (i > 0 && change.removed[i] <= change.removed[i - 1])) {
+                throw diff_mismatch("bad removed row " + index_text(change.removed[i]) + " of " + change.name);
+            }
+        }
+        rows -= change.removed.size();
+        for (size_t i = 0; i < change.added.size(); ++i) {
+            if (change.added[i].first > rows + i) {
+                throw diff_mismatch("added row " + index_text(change.added[i].first) + " of " + change.name +
+                                    " out of range");
+            }
+        }
+    }
+    size_t blocks = doc.blocks.size();
+    for (size_t i = 0; i < diff.removed_blocks.size(); ++i) {
+        if (diff.removed_blocks[i] >= doc.blocks.size() ||
+            (i > 0 && diff.removed_blocks[i] <= diff.removed_blocks[i - 1])) {
+            throw diff_mismatch("bad removed block " + index_text(diff.removed_blocks[i]));
+        }
+    }
+    blocks -= diff.removed_blocks.size();
+    for (size_t i = 0; i < diff.added_blocks.size(); ++i) {
+        if (diff.added_blocks[i].first > blocks + i) {
+            throw diff_mismatch("added block " + index_text(diff.added_blocks[i].first) + " out of range");
+        }
+    }
+}
+
+inline void apply_rows(Block& block, const BlockDiff& diff) {
+    std::vector<Row>& rows = block.rows;
+    for (size_t i = 0; i < diff.changed.size(); ++i) rows[diff.changed[i].first] = diff.changed[i].second;
+    for (size_t i = diff.removed.size(); i > 0;) {
+        size_t run = 1;
+        while (run < i && diff.removed[i - 1 - run] + run == diff.removed[i - 1]) ++run;
+        i -= run;
+        rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(diff.removed[i]),
+                   rows.begin() + static_cast<std::ptrdiff_t>(diff.removed[i] + run));
+    }
+    for (size_t i = 0; i < diff.added.size();) {
+        size_t run = 1;
+        while (i + run < diff.added.size() && diff.added[i + run].first == diff.added[i].first + run) ++run;
+        std::vector<Row> inserted;
+        inserted.reserve(run);
+        for (size_t r = i; r < i + run; ++r) inserted.push_back(diff.added[r].second);
+        rows.insert(rows.begin() + static_cast<std::ptrdiff_t>(diff.added[i].first), inserted.begin(), inserted.end());
+        i += run;
+    }
+    if (diff.summary_changed) block.summary = diff.summary;
+}
+
+} // namespace detail
+
+inline DocumentDiff DocumentDiff::loads(const std::string& text) {
+    detail::DiffReader reader;
+    detail::for_each_line(text.data(), text.size(), reader);
+    reader.finish();
+    return reader.diff;
+}
+
+/**
+ * @brief Changes that turn before into after (see DocumentDiff)
+ */
+inline DocumentDiff diff(const Document& before, const Document& after) {
+    DocumentDiff out;
+    detail::diff_blocks(before.blocks.empty() ? NULL : &before.blocks[0], before.blocks.size(),
+                        after.blocks.empty() ? NULL : &after.blocks[0], after.blocks.size(), 0, out);
+    return out;
+}
+
+/**
+ * @brief Apply a diff made against this version of doc
+ *
+ * The whole diff is checked first; if any change does not fit, ISONError is
+ * thrown and doc is left as it was.
+ */
+inline void apply_diff(Document& doc, const DocumentDiff& diff) {
+    detail::check_diff(doc, diff);
+    for (size_t b = 0; b < diff.blocks.size(); ++b) detail::apply_rows(doc.blocks[diff.blocks[b].block], diff.blocks[b]);
+    for (size_t i = diff.removed_blocks.size(); i > 0; --i) {
+        doc.blocks.erase(doc.blocks.begin() + static_cast<std::ptrdiff_t>(diff.removed_blocks[i - 1]));
+    }
+    for (size_t i = 0; i < diff.added_blocks.size(); ++i) {
+        doc.blocks.insert(doc.blocks.begin() + static_cast<std::ptrdiff_t>(diff.added_blocks[i].first),
+                          diff.added_blocks[i].second);
+    }
+    doc.reindex();
+}
+
+// =============================================================================
+// Incremental Parsing
+// =============================================================================
+
+/**
+ * @brief One replacement in a text: removed bytes at offset give way to inserted
+ */
+struct TextEdit {
+    size_t offset;
+    size_t removed;
+    std::string inserted;
+
+    TextEdit() : offset(0), removed(0) {}
+    TextEdit(size_t offset, size_t removed, const std::string& inserted)
+        : offset(offset), removed(removed), inserted(inserted) {}
+
+    /** The single edit that turns before into after, keeping their common prefix and suffix */
+    static TextEdit between(const std::string& before, const std::string& after) {
+        const size_t chunk = 4096;
+        size_t limit = std::min(before.size(), after.size());
+        size_t prefix = 0;
+        while (prefix + chunk <= limit && std::memcmp(before.data() + prefix, after.data() + prefix, chunk) == 0) {
+            prefix += chunk;
+        }
+        while (prefix < limit && before[prefix] == after[prefix]) ++prefix;
+        size_t suffix = 0;
+        while (suffix + chunk <= limit - prefix &&
+               std::memcmp(before.data() + before.size() - suffix - chunk,
+                           after.data() + after.size() - suffix - chunk, chunk) == 0) {
+            suffix += chunk;
+        }
+        while (suffix < limit - prefix && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) {
+            ++suffix;
+        }
+        return TextEdit(prefix, before.size() - prefix - suffix,
+                        after.substr(prefix, after.size() - prefix - suffix));
+    }
+};
+
+namespace detail {
+
+// Byte ranges of one block and its row lines
+struct BlockExtent {
+    size_t begin;         // start of the header line
+    size_t header_end;    // end of the header line, before its terminator
+    size_t end;           // start of the line that ended the block, or end of text
+    std::vector<std::pair<size_t, size_t> > rows;   // offset from begin and length of each row line
+};
+
+struct ExtentIndexer {
+    std::vector<BlockExtent>& blocks;
+    const char* base;
+    size_t size;
+    StringView current;
+    BlockLineParser<ExtentIndexer>* lines;
+
+    ExtentIndexer(std::vector<BlockExtent>& blocks, const char* base, size_t size)
+        : blocks(blocks), base(base), size(size), lines(NULL) {}
+
+    void begin_block(const std::string&, const std::string&) {
+        blocks.push_back(BlockExtent());
+        BlockExtent& block = blocks.back();
+        block.begin = static_cast<size_t>(current.data() - base);
+        block.header_end = block.begin + current.size();
+        block.end = size;
+    }
+    void fields(std::vector<FieldInfo>&) {}
+    void row(StringView line, size_t) {
+        BlockExtent& block = blocks.back();
+        block.rows.push_back(std::make_pair(static_cast<size_t>(line.data() - base) - block.begin, line.size()));
+    }
+    void summary(StringView) {}
+    void end_block() { blocks.back().end = static_cast<size_t>(current.data() - base); }
+
+    void operator()(StringView line) {
+        current = line;
+        lines->line(line);
+    }
+};
+
+inline void index_extents(const char* data, size_t size, std::vector<BlockExtent>& blocks) {
+    ExtentIndexer indexer(blocks, data, size);
+    BlockLineParser<ExtentIndexer> lines(indexer);
+    indexer.lines = &lines;
+    for_each_line(data, size, indexer);
+    indexer.current = StringView(data + size, 0);
+    lines.finish();
+}
+
+// Checks that no line is blank, a summary marker or a block header
+struct PlainRowLines {
+    bool rows_only;
+
+    PlainRowLines() : rows_only(true) {}
+
+    void operator()(StringView line) {
+        StringView stripped = trim_line(line);
+        if (stripped.empty() || (stripped.size() >= 3 && stripped.substr(0, 3) == "---") ||
+            looks_like_header(stripped)) {
+            rows_only = false;
+        }
+    }
+};
+
+struct ExtentBegin {
+    bool operator()(size_t offset, const BlockExtent& block) const { return offset < block.begin; }
+};
+
+struct ExtentBeginBefore {
+    bool operator()(const BlockExtent& block, size_t offset) const { return block.begin < offset; }
+};
+
+struct ExtentHeaderEnd {
+    bool operator()(const BlockExtent& block, size_t offset) const { return block.header_end < offset; }
+};
+
+struct RowOffset {
+    bool operator()(size_t offset, const std::pair<size_t, size_t>& row) const { return offset < row.first; }
+};
+
+} // namespace detail
+
+/**
+ * @brief A Document kept in step with edits to its source text
+ *
+ * An edit inside the data rows of one block re-tokenizes only the row lines
+ * it touches. Edits to headers, field lines, summaries or the lines between
+ * blocks re-parse the touched blocks, starting from the nearest unchanged
+ * header. When even that is not safe, or the region does not parse alone,
+ * the whole text is parsed again. Either way the result equals a full
+ * parse of the new text, and each edit returns the DocumentDiff it made.
+ *
+ * If the new text does not parse, edit() throws and nothing changes. Values
+ * decoded by edits are heap allocated even with ParseOptions::use_arena.
+ * Parse filters are not supported.
+ */
+class IncrementalDocument {
+public:
+    explicit IncrementalDocument(const std::string& text, const ParseOptions& options = ParseOptions())
+        : text_(text), options_(options), reparsed_(0) {
+        check_options();
+        doc_ = Parser(text_.data(), text_.size(), options_).parse();
+        detail::index_extents(text_.data(), text_.size(), extents_);
+        reparsed_ = text_.size();
+    }
+
+    /**
+     * @brief Adopt a Document already parsed from text; only indexes the text
+     */
+    IncrementalDocument(const Document& doc, const std::string& text, const ParseOptions& options = ParseOptions())
+        : doc_(doc), text_(text), options_(options), reparsed_(0) {
+        check_options();
+        detail::index_extents(text_.data(), text_.size(), extents_);
+        bool matches = extents_.size() == doc_.blocks.size();
+        for (size_t i = 0; matches && i < extents_.size(); ++i) {
+            matches = extents_[i].rows.size() == doc_.blocks[i].rows.size();
+        }
+        if (!matches) throw ISONError("Document was not parsed from this text");
+    }
+
+    const Document& document() const { return doc_; }
+    const std::string& text() const { return text_; }
+
+    /** Bytes of text the last edit tokenized again */
+    size_t reparsed_bytes() const { return reparsed_; }
+
+    DocumentDiff edit(size_t offset, size_t removed, const std::string& inserted) {
+        return edit(TextEdit(offset, removed, inserted));
+    }
+
+    DocumentDiff edit(const TextEdit& change) {
+        if (change.offset > text_.size() || change.removed > text_.size() - change.offset) {
+            throw ISONError("Edit out of range");
+        }
+        DocumentDiff diff;
+        if (change.removed == 0 && change.inserted.empty()) {
+            reparsed_ = 0;
+            return diff;
+        }
+        if (edit_rows(change, diff) || edit_blocks(change, diff)) return diff;
+        edit_all(change, diff);
+        return diff;
+    }
+
+    /** Replace the whole text; only the span between the common prefix and suffix is re-parsed */
+    DocumentDiff update(const std::string& text) { return edit(TextEdit::between(text_, text)); }
+
+private:
+    Document doc_;
+    std::string text_;
+    ParseOptions options_;
+    std::vector<detail::BlockExtent> extents_;
+    size_t reparsed_;
+
+    void check_options() const {
+        if (!options_.filter.empty()) throw ISONError("IncrementalDocument does not support parse filters");
+    }
+
+    // New text of old range [from, to), which holds the whole edit
+    std::string edited(size_t from, size_t to, const TextEdit& change) const {
+        size_t edit_end = change.offset + change.removed;
+        std::string out;
+        out.reserve(to - from - change.removed + change.inserted.size());
+        out.append(text_, from, change.offset - from);
+        out += change.inserted;
+        out.append(text_, edit_end, to - edit_end);
+        return out;
+    }
+
+    // Where old position pos, at or after the edit, lands in the new text
+    static size_t moved(size_t pos, const TextEdit& change) { return pos - change.removed + change.inserted.size(); }
+
+    void shift_blocks(size_t first, const TextEdit& change) {
+        for (size_t i = first; i < extents_.size(); ++i) {
+            extents_[i].begin = moved(extents_[i].begin, change);
+            extents_[i].header_end = moved(extents_[i].header_end, change);
+            extents_[i].end = moved(extents_[i].end, change);
+        }
+    }
+
+    // Edit confined to the row lines of one block: decode just those lines
+    bool edit_rows(const TextEdit& change, DocumentDiff& diff) {
+        size_t a = change.offset;
+        size_t b = change.offset + change.removed;
+        std::vector<detail::BlockExtent>::iterator it =
+            std::upper_bound(extents_.begin(), extents_.end(), a, detail::ExtentBegin());
+        if (it == extents_.begin()) return false;
+        size_t k = static_cast<size_t>(it - extents_.begin()) - 1;
+        detail::BlockExtent& extent = extents_[k];
+        if (extent.rows.empty()) return false;
+        size_t rows_begin = extent.begin + extent.rows.front().first;
+        size_t rows_end = extent.begin + extent.rows.back().first + extent.rows.back().second;
+        if (a < rows_begin || b > rows_end) return false;
+
+        size_t r0 = static_cast<size_t>(std::upper_bound(extent.rows.begin(), extent.rows.end(), a - extent.begin,
+                                                         detail::RowOffset()) - extent.rows.begin()) - 1;
+        size_t r1 = static_cast<size_t>(std::upper_bound(extent.rows.begin(), extent.rows.end(), b - extent.begin,
+                                                         detail::RowOffset()) - extent.rows.begin()) - 1;
+        size_t from = extent.begin + extent.rows[r0].first;
+        size_t to = std::max(b, extent.begin + extent.rows[r1].first + extent.rows[r1].second);
+        const void* nl = std::memchr(text_.data() + to, '\n', text_.size() - to);
+        to = nl ? static_cast<size_t>(static_cast<const char*>(nl) - text_.data()) : text_.size();
+
+        // Old and new lines must all be rows (or comments) for the block structure to hold
+        detail::PlainRowLines plain;
+        detail::for_each_line(text_.data() + from, to - from, plain);
+        if (!plain.rows_only) return false;
+        std::string lines = edited(from, to, change);
+        if (lines.empty() || lines[lines.size() - 1] == '\n') return false;
+        Block& block = doc_.blocks[k];
+        RowDecoder decoder(block, options_.type_hints, doc_.intern_pool.get(), lines.data());
+        try {
+            detail::for_each_line(lines.data(), lines.size(), decoder);
+        } catch (const ISONError&) {
+            return false;
+        }
+        if (!decoder.rows_only) return false;
+
+        size_t old_count = r1 - r0 + 1;
+        size_t new_count = decoder.rows.size();
+        BlockDiff rows_diff;
+        rows_diff.block = k;
+        rows_diff.kind = block.kind;
+        rows_diff.name = block.name;
+        rows_diff.fields = block.fields;
+        detail::diff_rows(&block.rows[r0], old_count, decoder.rows.data(), new_count, r0, rows_diff);
+
+        std::vector<std::pair<size_t, size_t> >& spans = decoder.spans;
+        for (size_t i = 0; i < spans.size(); ++i) spans[i].first += from - extent.begin;
+        if (change.inserted.size() != change.removed) {
+            for (size_t r = r1 + 1; r < extent.rows.size(); ++r) {
+                extent.rows[r].first = moved(extent.begin + extent.rows[r].first, change) - extent.begin;
+            }
+        }
+        if (new_count == old_count) {
+            for (size_t i = 0; i < new_count; ++i) {
+                std::swap(block.rows[r0 + i], decoder.rows[i]);
+                extent.rows[r0 + i] = spans[i];
+            }
+        } else {
+            std::vector<Row>::iterator pos = block.rows.erase(block.rows.begin() + static_cast<std::ptrdiff_t>(r0),
+                                                              block.rows.begin() + static_cast<std::ptrdiff_t>(r1 + 1));
+            block.rows.insert(pos, std::make_move_iterator(decoder.rows.begin()),
+                              std::make_move_iterator(decoder.rows.end()));
+            std::vector<std::pair<size_t, size_t> >::iterator span_pos =
+                extent.rows.erase(extent.rows.begin() + static_cast<std::ptrdiff_t>(r0),
+                                  extent.rows.begin() + static_cast<std::ptrdiff_t>(r1 + 1));
+            extent.rows.insert(span_pos, spans.begin(), spans.end());
+        }
+        extent.end = moved(extent.end, change);
+        shift_blocks(k + 1, change);
+        text_.replace(change.offset, change.removed, change.inserted);
+        reparsed_ = lines.size();
+        if (!rows_diff.empty()) diff.blocks.push_back(rows_diff);
+        return true;
+    }
+
+    // Re-parse from the last header before the edit through the first block after it
+    bool edit_blocks(const TextEdit& change, DocumentDiff& diff) {
+        size_t a = change.offset;
+        size_t b = change.offset + change.removed;
+        size_t first = static_cast<size_t>(std::lower_bound(extents_.begin(), extents_.end(), a,
+                                                            detail::ExtentHeaderEnd()) - extents_.begin());
+        size_t from = 0;
+        if (first > 0) from = extents_[--first].begin;
+        size_t last = static_cast<size_t>(std::lower_bound(extents_.begin(), extents_.end(), b,
+                                                           detail::ExtentBeginBefore()) - extents_.begin());
+        size_t to = last < extents_.size() ? extents_[last].end : text_.size();
+        size_t old_end = last < extents_.size() ? last + 1 : extents_.size();
+
+        std::string region = edited(from, to, change);
+        Document parsed;
+        std::vector<detail::BlockExtent> extents;
+        try {
+            ParseOptions options(options_);
+            options.intern_pool = doc_.intern_pool;
+            parsed = Parser(region.data(), region.size(), options).parse();
+            detail::index_extents(region.data(), region.size(), extents);
+        } catch (const ISONError&) {
+            return false;
+        }
+        // The first unchanged block after the edit must still begin where it did
+        if (last < extents_.size() &&
+            (extents.empty() || extents.back().begin != moved(extents_[last].begin, change) - from)) {
+            return false;
+        }
+
+        detail::diff_blocks(doc_.blocks.data() + first, old_end - first, parsed.blocks.data(),
+                            parsed.blocks.size(), first, diff);
+        for (size_t i = 0; i < extents.size(); ++i) {
+            extents[i].begin += from;
+            extents[i].header_end += from;
+            extents[i].end += from;
+        }
+        doc_.blocks.erase(doc_.blocks.begin() + static_cast<std::ptrdiff_t>(first),
+                          doc_.blocks.begin() + static_cast<std::ptrdiff_t>(old_end));
+        doc_.blocks.insert(doc_.blocks.begin() + static_cast<std::ptrdiff_t>(first),
+                           std::make_move_iterator(parsed.blocks.begin()),
+                           std::make_move_iterator(parsed.blocks.end()));
+        extents_.erase(extents_.begin() + static_cast<std::ptrdiff_t>(first),
+                       extents_.begin() + static_cast<std::ptrdiff_t>(old_end));
+        shift_blocks(first, change);
+        extents_.insert(extents_.begin() + static_cast<std::ptrdiff_t>(first), extents.begin(), extents.end());
+        doc_.reindex();
+        text_.replace(change.offset, change.removed, change.inserted);
+        reparsed_ = region.size();
+        return true;
+    }
+
+    void edit_all(const TextEdit& change, DocumentDiff& diff) {
+        std::string text(text_);
+        text.replace(change.offset, change.removed, change.inserted);
+        Document parsed = Parser(text.data(), text.size(), options_).parse();
+        std::vector<detail::BlockExtent> extents;
+        detail::index_extents(text.data(), text.size(), extents);
+        diff = ison::diff(doc_, parsed);
+        std::swap(doc_, parsed);
+        extents_.swap(extents);
+        text_.swap(text);
+        reparsed_ = text_.size();
+    }
+
+    // Decodes edited row lines; rows_only turns false at any line that is not a row or comment
+    struct RowDecoder {
+        const Block& block;
+        detail::HintedFields hinted;
+        detail::ValueFactory factory;
+        Tokenizer tokenizer;
+        std::vector<Token> tokens;
+        std::vector<Row> rows;
+        std::vector<std::pair<size_t, size_t> > spans;
+        const char* base;
+        bool rows_only;
+
+        RowDecoder(const Block& block, TypeHintMode hint_mode, InternPool* pool, const char* base)
+            : block(block), factory(std::shared_ptr<Arena>(), pool), base(base), rows_only(true) {
+            hinted.set(block.field_info, hint_mode);
+        }
+
+        void operator()(StringView line) {
+            if (!rows_only) return;
+            detail::PlainRowLines plain;
+            plain(line);
+            rows_only = plain.rows_only;
+            if (!rows_only || detail::trim_line(line)[0] == '#') return;
+            tokenizer.reset(line, 0);
+            tokenizer.tokenize(tokens);
+            rows.push_back(Row());
+            detail::fill_row(block.fields, hinted, tokens, rows.back(), factory, line, 0);
+            spans.push_back(std::make_pair(static_cast<size_t>(line.data() - base), line.size()));
+        }
+    };
+};
+
+// =============================================================================
+// Document Snapshots
+// =============================================================================
+
+/**
+ * @brief Immutable Document whose blocks are shared between versions
+ *
+ * Blocks are held as shared_ptr<const Block>. Copying a snapshot copies
+ * one pointer, and with_block(), without_block() and update() return a new
+ * snapshot that shares every block they leave alone (copy-on-write).
+ * Nothing reachable from a snapshot is modified after it is built, so any
+ * number of threads may read it without locking. Reading values through
+ * references (Value::get_reference(), as_string()) rather than copies
+ * leaves their reference counts untouched.
+ */
+class DocumentSnapshot {
+public:
+    typedef std::shared_ptr<const Block> BlockPtr;
+
+    DocumentSnapshot() : data_(empty_data()) {}
+
+    /** @brief Take over a Document's blocks without copying them */
+    explicit DocumentSnapshot(Document&& doc) {
+        std::shared_ptr<Data> data = std::make_shared<Data>();
+        data->blocks.reserve(doc.blocks.size());
+        for (size_t i = 0; i < doc.blocks.size(); ++i) {
+            doc.blocks[i].reindex_fields();
+            data->blocks.push_back(std::make_shared<Block>(std::move(doc.blocks[i])));
+        }
+        data->arena = doc.arena;
+        data->intern_pool = doc.intern_pool;
+        doc = Document();
+        data_ = finish(data);
+    }
+
+    explicit DocumentSnapshot(const Document& doc) {
+        std::shared_ptr<Data> data = std::make_shared<Data>();
+        data->blocks.reserve(doc.blocks.size());
+        for (size_t i = 0; i < doc.blocks.size(); ++i) data->blocks.push_back(freeze(Block(doc.blocks[i])));
+        data->arena = doc.arena;
+        data->intern_pool = doc.intern_pool;
+        data_ = finish(data);
+    }
+
+    size_t size() const { return data_->blocks.size(); }
+    bool empty() const { return data_->blocks.empty(); }
+
+    const Block& block(size_t index) const { return *data_->blocks[index]; }
+
+    /** @brief The shared block itself, e.g. to check whether two versions share it */
+    const BlockPtr& block_ptr(size_t index) const { return data_->blocks[index]; }
+
+    const Block* get(const std::string& name) const {
+        size_t i = data_->index.find(data_->blocks, detail::PointeeName(), name);
+        return i != detail::NameIndex::npos ? data_->blocks[i].get() : NULL;
+    }
+
+    const Block& operator[](const std::string& name) const {
+        const Block* b = get(name);
+        if (!b) throw ISONError("Block not found: " + name);
+        return *b;
+    }
+
+    bool has(const std::string& name) const { return get(name) != NULL; }
+
+    /**
+     * @brief Replace the first block named like block, or append it
+     */
+    DocumentSnapshot with_block(Block block) const { return with_block(freeze(std::move(block))); }
+
+    DocumentSnapshot with_block(const BlockPtr& block) const {
+        std::shared_ptr<Data> data = derive();
+        size_t i = data_->index.find(data_->blocks, detail::PointeeName(), block->name);
+        if (i != detail::NameIndex::npos) data->blocks[i] = block;
+        else data->blocks.push_back(block);
+        return DocumentSnapshot(finish(data));
+    }
+
+    /** @brief Drop the first block with this name (unchanged if there is none) */
+    DocumentSnapshot without_block(const std::string& name) const {
+        size_t i = data_->index.find(data_->blocks, detail::PointeeName(), name);
+        if (i == detail::NameIndex::npos) return *this;
+        std::shared_ptr<Data> data = derive();
+        data->blocks.erase(data->blocks.begin() + static_cast<std::ptrdiff_t>(i));
+        return DocumentSnapshot(finish(data));
+    }
+
+    /**
+     * @brief Copy one block, let fn(Block&) modify the copy, and share the rest
+     *
+     * Throws ISONError if there is no such block.
+     */
+    template<typename F>
+    DocumentSnapshot update(const std::string& name, F fn) const {
+        const Block* current = get(name);
+        if (!current) throw ISONError("Block not found: " + name);
+        Block copy(*current);
+        fn(copy);
+        return with_block(std::move(copy));
+    }
+
+    /** @brief A mutable deep copy */
+    Document to_document() const {
+        Document doc;
+        doc.blocks.reserve(size());
+        for (size_t i = 0; i < size(); ++i) doc.blocks.push_back(block(i));
+        doc.arena = data_->arena;
+        doc.intern_pool = data_->intern_pool;
+        doc.reindex();
+        return doc;
+    }
+
+private:
+    struct Data {
+        std::vector<BlockPtr> blocks;
+        detail::NameIndex index;
+        std::shared_ptr<Arena> arena;
+        std::shared_ptr<InternPool> intern_pool;
+    };
+
+    explicit DocumentSnapshot(const std::shared_ptr<const Data>& data) : data_(data) {}
+
+    static const std::shared_ptr<const Data>& empty_data() {
+        static const std::shared_ptr<const Data> empty = std::make_shared<Data>();
+        return empty;
+    }
+
+    static BlockPtr freeze(Block&& block) {
+        block.reindex_fields();
+        return std::make_shared<Block>(std::move(block));
+    }
+
+    // A mutable copy of the block list; the blocks themselves stay shared
+    std::shared_ptr<Data> derive() const {
+        std::shared_ptr<Data> data = std::make_shared<Data>();
+        data->blocks = data_->blocks;
+        data->arena = data_->arena;
+        data->intern_pool = data_->intern_pool;
+        return data;
+    }
+
+    static std::shared_ptr<const Data> finish(const std::shared_ptr<Data>& data) {
+        data->index.rebuild(data->blocks, detail::PointeeName());
+        return data;
+    }
+
+    std::shared_ptr<const Data> data_;
+};
+
+/**
+ * @brief Publishes the current DocumentSnapshot to many threads
+ *
+ * load() hands out the latest snapshot, store() replaces it, and update()
+ * derives the next version from the current one. Writers are serialized,
+ * so a store() during an update() lands after it rather than being
+ * overwritten. Readers only lock for the pointer exchange: they never wait
+ * for an update to be built, and read the snapshot they got without locking.
+ */
+class SnapshotCell {
+public:
+    SnapshotCell() {}
+    explicit SnapshotCell(const DocumentSnapshot& snapshot) : current_(snapshot) {}
+
+    DocumentSnapshot load() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_;
+    }
 
-        if (!needs_quote && looks_like_number(s)) {
-            needs_quote = true;
-        }
+    /**
+     * @brief Replace the snapshot; waits for an update() in progress
+     */
+    void store(const DocumentSnapshot& snapshot) {
+        std::lock_guard<std::mutex> writer(write_mutex_);
+        exchange(snapshot);
+    }
 
-        if (needs_quote) {
-            std::string escaped;
-            for (size_t i = 0; i < s.size(); ++i) {
-                char c = s[i];
-                switch (c) {
-                    case '\\': escaped += "\\\\"; break;
-                    case '"':  escaped += "\\\""; break;
-                    case '\n': escaped += "\\n"; break;
-                    case '\t': escaped += "\\t"; break;
-                    case '\r': escaped += "\\r"; break;
-                    default:   escaped += c; break;
-                }
-            }
-            return "\"" + escaped + "\"";
-        }
-        return s;
+    /**
+     * @brief Replace the snapshot with fn(current) and return it
+     */
+    template<typename F>
+    DocumentSnapshot update(F fn) {
+        std::lock_guard<std::mutex> writer(write_mutex_);
+        DocumentSnapshot next = fn(load());
+        exchange(next);
+        return next;
     }
 
-    static bool looks_like_number(const std::string& s) {
-        if (s.empty()) return false;
-        size_t start = (s[0] == '-') ? 1 : 0;
-        if (start == s.size()) return false;
-        for (size_t i = start; i < s.size(); ++i) {
-            if (s[i] != '.' && !std::isdigit(static_cast<unsigned char>(s[i]))) {
-                return false;
-            }
+private:
+    mutable std::mutex mutex_;
+    std::mutex write_mutex_;   // held by store() and update(), so neither loses the other's write
+    DocumentSnapshot current_;
+
+    void exchange(const DocumentSnapshot& snapshot) {
+        DocumentSnapshot previous = snapshot;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::swap(current_, previous);
         }
-        return true;
+        // The previous version, if this was its last owner, is freed outside the lock
     }
+
+    SnapshotCell(const SnapshotCell&);
+    SnapshotCell& operator=(const SnapshotCell&);
 };
 
 // =============================================================================
-// JSON Output
+// Asynchronous I/O
 // =============================================================================
 
-inline std::string Document::to_json(int indent) const {
-    std::string ind(static_cast<size_t>(indent), ' ');
-    std::ostringstream oss;
-
-    oss << "{\n";
-    for (size_t bi = 0; bi < blocks.size(); ++bi) {
-        const Block& block = blocks[bi];
-        oss << ind << "\"" << block.name << "\": [\n";
-
-        for (size_t ri = 0; ri < block.rows.size(); ++ri) {
-            const Row& row = block.rows[ri];
-            oss << ind << ind << "{\n";
-
-            size_t fi = 0;
-            for (Row::const_iterator it = row.begin(); it != row.end(); ++it, ++fi) {
-                oss << ind << ind << ind << "\"" << it->first << "\": ";
-
-                const Value& v = it->second;
-                switch (v.type()) {
-                    case ValueType::Null: oss << "null"; break;
-                    case ValueType::Bool: oss << (v.as_bool() ? "true" : "false"); break;
-                    case ValueType::Int: oss << v.as_int(); break;
-                    case ValueType::Float: oss << v.as_float(); break;
-                    case ValueType::String: oss << "\"" << v.as_string() << "\""; break;
-                    case ValueType::Reference: {
-                        std::shared_ptr<Reference> r = v.as_reference_ptr();
-                        oss << "\"" << (r ? r->to_ison() : "null") << "\"";
-                        break;
-                    }
-                }
-
-                if (fi < row.size() - 1) oss << ",";
-                oss << "\n";
-            }
-
-            oss << ind << ind << "}";
-            if (ri < block.rows.size() - 1) oss << ",";
-            oss << "\n";
+/**
+ * @brief Unbuffered file source for ReadAheadSource and StreamReader
+ */
+class FileSource : public ChunkSource {
+public:
+    explicit FileSource(const std::string& path) : path_(path), file_(std::fopen(path.c_str(), "rb")) {
+        if (!file_) {
+            throw ISONError("Could not open file: " + path);
         }
-
-        oss << ind << "]";
-        if (bi < blocks.size() - 1) oss << ",";
-        oss << "\n";
+        // Reads are large already; skip stdio's own buffer
+        std::setvbuf(file_, NULL, _IONBF, 0);
     }
-    oss << "}";
 
-    return oss.str();
-}
+    ~FileSource() { std::fclose(file_); }
 
-// =============================================================================
-// ISONL Support
-// =============================================================================
+    size_t read(char* buffer, size_t capacity) {
+        size_t n = std::fread(buffer, 1, capacity, file_);
+        if (n < capacity && std::ferror(file_)) {
+            throw ISONError("Could not read file: " + path_);
+        }
+        return n;
+    }
 
-struct ISONLRecord {
-    std::string kind;
-    std::string name;
-    std::vector<std::string> fields;
-    Row values;
+private:
+    std::string path_;
+    FILE* file_;
 
-    std::string to_block_key() const { return kind + "." + name; }
+    FileSource(const FileSource&);
+    FileSource& operator=(const FileSource&);
 };
 
-class ISONLParser {
+/**
+ * @brief Reads chunks from another source on a background thread
+ *
+ * Up to depth chunks are read ahead while the caller parses the current one,
+ * so I/O and parsing overlap. next() hands out each chunk in place (it stays
+ * valid until the following call); read() copies out of it instead. Use one
+ * or the other. An exception thrown by the source is rethrown by next() or
+ * read() once the chunks before it have been consumed.
+ */
+class ReadAheadSource : public ChunkSource {
 public:
-    Optional<ISONLRecord> parse_line(const std::string& line, int line_num = 0) {
-        std::string trimmed = line;
-        size_t start = trimmed.find_first_not_of(" \t\r\n");
-        if (start == std::string::npos) return Optional<ISONLRecord>();
-        size_t end = trimmed.find_last_not_of(" \t\r\n");
-        trimmed = trimmed.substr(start, end - start + 1);
-
-        if (trimmed.empty() || trimmed[0] == '#') return Optional<ISONLRecord>();
+    explicit ReadAheadSource(ChunkSource& source, size_t chunk_size = 1 << 20, size_t depth = 2)
+        : source_(source), chunk_size_(chunk_size > 0 ? chunk_size : 1),
+          buffers_((depth > 0 ? depth : 1) + 1), current_(0), has_current_(false),
+          data_(NULL), size_(0), offset_(0), done_(false), stop_(false) {
+        for (size_t i = 0; i < buffers_.size(); ++i) free_.push_back(i);
+        thread_ = std::thread(&ReadAheadSource::run, this);
+    }
 
-        std::vector<std::string> sections = split_by_pipe(trimmed);
-        if (sections.size() != 3) {
-            throw ISONSyntaxError("ISONL line must have 3 pipe-separated sections", line_num, 0);
+    ~ReadAheadSource() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
         }
+        cond_.notify_all();
+        thread_.join();
+    }
 
-        size_t dot_pos = sections[0].find('.');
-        if (dot_pos == std::string::npos) {
-            throw ISONSyntaxError("Invalid ISONL header", line_num, 0);
+    /** @brief Take the next chunk; false at the end of input */
+    bool next(const char*& data, size_t& size) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (has_current_) {
+            free_.push_back(current_);
+            has_current_ = false;
+            cond_.notify_all();
         }
+        while (ready_.empty() && !done_) cond_.wait(lock);
+        if (ready_.empty()) {
+            if (error_) {
+                std::exception_ptr error = error_;
+                error_ = std::exception_ptr();
+                std::rethrow_exception(error);
+            }
+            return false;
+        }
+        current_ = ready_.front();
+        ready_.pop_front();
+        has_current_ = true;
+        data = buffers_[current_].data.data();
+        size = buffers_[current_].size;
+        return true;
+    }
 
-        ISONLRecord record;
-        record.kind = sections[0].substr(0, dot_pos);
-        record.name = sections[0].substr(dot_pos + 1);
-
-        Tokenizer field_tokenizer(sections[1], line_num);
-        record.fields = field_tokenizer.tokenize();
+    size_t read(char* buffer, size_t capacity) {
+        while (offset_ == size_) {
+            if (!next(data_, size_)) {
+                size_ = offset_ = 0;
+                return 0;
+            }
+            offset_ = 0;
+        }
+        size_t n = std::min(capacity, size_ - offset_);
+        std::memcpy(buffer, data_ + offset_, n);
+        offset_ += n;
+        return n;
+    }
 
-        Tokenizer value_tokenizer(sections[2], line_num);
-        std::vector<std::string> raw_values = value_tokenizer.tokenize();
+private:
+    struct Buffer {
+        std::vector<char> data;
+        size_t size;
 
-        size_t pos = 0;
-        for (size_t i = 0; i < record.fields.size() && i < raw_values.size(); ++i) {
-            while (pos < sections[2].size() && (sections[2][pos] == ' ' || sections[2][pos] == '\t')) {
-                ++pos;
-            }
-            bool was_quoted = pos < sections[2].size() && sections[2][pos] == '"';
-            record.values[record.fields[i]] = TypeInferrer::infer(raw_values[i], was_quoted);
+        Buffer() : size(0) {}
+    };
 
-            if (was_quoted) {
-                ++pos;
-                while (pos < sections[2].size() && sections[2][pos] != '"') {
-                    if (sections[2][pos] == '\\') ++pos;
-                    ++pos;
+    void run() {
+        try {
+            for (;;) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    while (free_.empty() && !stop_) cond_.wait(lock);
+                    if (stop_) return;
+                    index = free_.back();
+                    free_.pop_back();
                 }
-                if (pos < sections[2].size()) ++pos;
-            } else {
-                pos += raw_values[i].size();
+                Buffer& buffer = buffers_[index];
+                if (buffer.data.empty()) buffer.data.resize(chunk_size_);
+                buffer.size = source_.read(&buffer.data[0], chunk_size_);
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (buffer.size == 0) {
+                    done_ = true;
+                    cond_.notify_all();
+                    return;
+                }
+                ready_.push_back(index);
+                cond_.notify_all();
             }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+            done_ = true;
+            cond_.notify_all();
         }
-
-        return record;
     }
 
-    Document parse_to_document(const std::string& text) {
-        std::vector<ISONLRecord> records;
-        std::istringstream stream(text);
-        std::string line;
-        int line_num = 0;
+    ChunkSource& source_;
+    size_t chunk_size_;
+    std::vector<Buffer> buffers_;
+    std::vector<size_t> free_;
+    std::deque<size_t> ready_;
+    size_t current_;
+    bool has_current_;
+    const char* data_;
+    size_t size_;
+    size_t offset_;
+    bool done_;
+    bool stop_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread thread_;
+
+    ReadAheadSource(const ReadAheadSource&);
+    ReadAheadSource& operator=(const ReadAheadSource&);
+};
 
-        while (std::getline(stream, line)) {
-            ++line_num;
-            Optional<ISONLRecord> record = parse_line(line, line_num);
-            if (record.has_value()) {
-                records.push_back(record.value());
-            }
-        }
+/**
+ * @brief Double-buffered sink that writes to another sink on a background thread
+ *
+ * Writes collect in a front buffer; once it holds buffer_size bytes it is
+ * swapped with the back buffer, which the writer thread drains into the
+ * wrapped sink while the caller keeps serializing. flush() waits for the
+ * writer, sync() also syncs the wrapped sink, and close() (or the
+ * destructor) writes what is left and stops the thread. An exception from
+ * the wrapped sink is rethrown by the next write(), flush() or close().
+ */
+class AsyncSink : public Sink {
+public:
+    explicit AsyncSink(Sink& sink, size_t buffer_size = 1 << 20)
+        : sink_(sink), buffer_size_(buffer_size > 0 ? buffer_size : 1),
+          pending_(false), stop_(false), closed_(false) {
+        front_.reserve(buffer_size_);
+        back_.reserve(buffer_size_);
+        thread_ = std::thread(&AsyncSink::run, this);
+    }
 
-        return records_to_document(records);
+    ~AsyncSink() {
+        try {
+            close();
+        } catch (...) {
+            // Destructors must not throw; call close() to see write errors
+        }
     }
 
-private:
-    std::vector<std::string> split_by_pipe(const std::string& line) {
-        std::vector<std::string> sections;
-        std::string current;
-        bool in_quotes = false;
-
-        for (size_t i = 0; i < line.size(); ++i) {
-            char c = line[i];
-            if (c == '"' && (i == 0 || line[i-1] != '\\')) {
-                in_quotes = !in_quotes;
-                current += c;
-            } else if (c == '|' && !in_quotes) {
-                size_t s = current.find_first_not_of(" \t");
-                size_t e = current.find_last_not_of(" \t");
-                sections.push_back(s != std::string::npos ? current.substr(s, e - s + 1) : "");
-                current.clear();
-            } else {
-                current += c;
-            }
+    void write(const char* data, size_t size) {
+        if (closed_) {
+            throw ISONError("Write to a closed AsyncSink");
         }
+        front_.append(data, size);
+        if (front_.size() >= buffer_size_) hand_off();
+    }
+
+    /** @brief Wait until everything written so far has reached the wrapped sink */
+    void flush() {
+        if (closed_) return;
+        hand_off();
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (pending_ && !error_) cond_.wait(lock);
+        if (error_) std::rethrow_exception(error_);
+    }
 
-        size_t s = current.find_first_not_of(" \t");
-        size_t e = current.find_last_not_of(" \t");
-        sections.push_back(s != std::string::npos ? current.substr(s, e - s + 1) : "");
+    void sync() {
+        if (closed_) return;
+        flush();
+        sink_.sync();
+    }
 
-        return sections;
+    /** @brief Write what is left and stop the writer thread */
+    void close() {
+        if (closed_) return;
+        closed_ = true;
+        std::exception_ptr error;
+        try {
+            hand_off();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        thread_.join();
+        if (!error) error = error_;
+        if (error) std::rethrow_exception(error);
     }
 
-    Document records_to_document(const std::vector<ISONLRecord>& records) {
-        std::map<std::string, std::vector<const ISONLRecord*> > blocks_map;
-        std::vector<std::string> block_order;
+private:
+    void hand_off() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (pending_ && !error_) cond_.wait(lock);
+        if (error_) std::rethrow_exception(error_);
+        if (front_.empty()) return;
+        front_.swap(back_);
+        pending_ = true;
+        cond_.notify_all();
+    }
 
-        for (size_t i = 0; i < records.size(); ++i) {
-            std::string key = records[i].to_block_key();
-            if (blocks_map.find(key) == blocks_map.end()) {
-                block_order.push_back(key);
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            while (!pending_ && !stop_) cond_.wait(lock);
+            if (!pending_) return;
+            // The caller leaves back_ alone while pending_ is set
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                sink_.write(back_.data(), back_.size());
+            } catch (...) {
+                error = std::current_exception();
             }
-            blocks_map[key].push_back(&records[i]);
+            back_.clear();
+            lock.lock();
+            pending_ = false;
+            error_ = error;
+            cond_.notify_all();
+            if (error) return;
         }
+    }
 
-        Document doc;
-        for (size_t i = 0; i < block_order.size(); ++i) {
-            const std::string& key = block_order[i];
-            const std::vector<const ISONLRecord*>& recs = blocks_map[key];
-            size_t dot_pos = key.find('.');
+    Sink& sink_;
+    size_t buffer_size_;
+    std::string front_;
+    std::string back_;
+    bool pending_;
+    bool stop_;
+    bool closed_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread thread_;
+
+    AsyncSink(const AsyncSink&);
+    AsyncSink& operator=(const AsyncSink&);
+};
 
-            Block block;
-            block.kind = key.substr(0, dot_pos);
-            block.name = key.substr(dot_pos + 1);
-            block.fields = recs[0]->fields;
+/**
+ * @brief Options for the pipelined file functions (load(), dump(), load_async(), ...)
+ */
+struct AsyncOptions {
+    /** @brief Bytes per read */
+    size_t chunk_size;
 
-            for (size_t j = 0; j < recs.size(); ++j) {
-                block.rows.push_back(recs[j]->values);
-            }
+    /** @brief Chunks read ahead of the parser */
+    size_t read_ahead;
 
-            doc.blocks.push_back(block);
-        }
+    /** @brief Bytes serialized before a write is handed to the writer thread */
+    size_t write_buffer;
 
-        return doc;
-    }
-};
+    /** @brief fsync output files before returning */
+    bool sync;
 
-class ISONLSerializer {
-public:
-    static std::string dumps(const Document& doc) {
-        std::ostringstream oss;
-        bool first = true;
+    AsyncOptions() : chunk_size(1 << 20), read_ahead(2), write_buffer(1 << 20), sync(false) {}
+};
 
-        for (size_t bi = 0; bi < doc.blocks.size(); ++bi) {
-            const Block& block = doc.blocks[bi];
-            std::string header = block.kind + "." + block.name;
+namespace detail {
 
-            std::string fields_str;
-            for (size_t i = 0; i < block.fields.size(); ++i) {
-                if (i > 0) fields_str += " ";
-                fields_str += block.fields[i];
-            }
-
-            for (size_t ri = 0; ri < block.rows.size(); ++ri) {
-                if (!first) oss << "\n";
-                first = false;
-
-                const Row& row = block.rows[ri];
-                std::string values_str;
-                for (size_t i = 0; i < block.fields.size(); ++i) {
-                    if (i > 0) values_str += " ";
-                    Row::const_iterator it = row.find(block.fields[i]);
-                    if (it != row.end()) {
-                        values_str += value_to_isonl(it->second);
-                    } else {
-                        values_str += "null";
-                    }
-                }
+inline Document load_pipelined(const std::string& path, const ParseOptions& options, const AsyncOptions& async) {
+    FileSource file(path);
+    ReadAheadSource chunks(file, async.chunk_size, async.read_ahead);
+    return Parser::parse_chunks(chunks, options);
+}
 
-                oss << header << "|" << fields_str << "|" << values_str;
-            }
-        }
+inline void dump_pipelined(const Document& doc, const std::string& path, bool align_columns,
+                           const AsyncOptions& async) {
+    FileSink file(path, false);
+    AsyncSink sink(file, async.write_buffer);
+    IsonWriter writer(sink, align_columns);
+    writer.write(doc);
+    writer.flush();
+    sink.close();
+    if (async.sync) file.sync();
+}
 
-        return oss.str();
-    }
+// Feeds a ReadAheadSource's chunks to a StreamParser
+inline void stream_pipelined(const std::string& path, BlockVisitor& visitor, const AsyncOptions& async) {
+    FileSource file(path);
+    ReadAheadSource chunks(file, async.chunk_size, async.read_ahead);
+    StreamParser parser(visitor);
+    const char* data;
+    size_t size;
+    while (chunks.next(data, size)) parser.feed(data, size);
+    parser.finish();
+}
 
-private:
-    static std::string value_to_isonl(const Value& v) {
-        switch (v.type()) {
-            case ValueType::Null: return "null";
-            case ValueType::Bool: return v.as_bool() ? "true" : "false";
-            case ValueType::Int: return std::to_string(v.as_int());
-            case ValueType::Float: {
-                std::ostringstream oss;
-                oss << v.as_float();
-                return oss.str();
-            }
-            case ValueType::String: return quote_if_needed(v.as_string());
-            case ValueType::Reference: {
-                std::shared_ptr<Reference> r = v.as_reference_ptr();
-                return r ? r->to_ison() : "null";
-            }
-        }
-        return "null";
-    }
-
-    static std::string quote_if_needed(const std::string& s) {
-        if (s.empty()) return "\"\"";
-
-        bool needs_quote = (s == "true" || s == "false" || s == "null" ||
-                           s[0] == ':' || s.find(' ') != std::string::npos ||
-                           s.find('\t') != std::string::npos ||
-                           s.find('"') != std::string::npos ||
-                           s.find('\n') != std::string::npos ||
-                           s.find('|') != std::string::npos);
-
-        if (needs_quote) {
-            std::string escaped;
-            for (size_t i = 0; i < s.size(); ++i) {
-                char c = s[i];
-                switch (c) {
-                    case '\\': escaped += "\\\\"; break;
-                    case '"':  escaped += "\\\""; break;
-                    case '\n': escaped += "\\n"; break;
-                    case '\t': escaped += "\\t"; break;
-                    case '\r': escaped += "\\r"; break;
-                    case '|':  escaped += "\\|"; break;
-                    default:   escaped += c; break;
-                }
-            }
-            return "\"" + escaped + "\"";
-        }
-        return s;
-    }
-};
+} // namespace detail
 
 // =============================================================================
 // Public API Functions
 // =============================================================================
 
-inline Document parse(const std::string& text) {
-    Parser parser(text);
+inline Document parse(const std::string& text, const ParseOptions& options = ParseOptions()) {
+    Parser parser(text.data(), text.size(), options);
+    return parser.parse();
+}
+
+/**
+ * @brief Parse a borrowed buffer without copying it
+ */
+inline Document parse(const char* data, size_t size, const ParseOptions& options = ParseOptions()) {
+    Parser parser(data, size, options);
     return parser.parse();
 }
 
+/**
+ * @brief Parse on multiple threads
+ *
+ * A sequential scan finds block boundaries and row offsets, then the rows
+ * are split into ranges and tokenized on thread_count threads (0 = one per
+ * hardware thread). The result is identical to parse(text).
+ */
+inline Document parse_parallel(const std::string& text, size_t thread_count = 0,
+                               const ParseOptions& options = ParseOptions()) {
+    return detail::parse_parallel(text.data(), text.size(), thread_count, options);
+}
+
+inline ColumnarDocument parse_columnar(const std::string& text, const ParseOptions& options = ParseOptions()) {
+    Parser parser(text.data(), text.size(), options);
+    return parser.parse_columnar();
+}
+
+inline ColumnarDocument parse_columnar(const char* data, size_t size, const ParseOptions& options = ParseOptions()) {
+    Parser parser(data, size, options);
+    return parser.parse_columnar();
+}
+
 inline Document loads(const std::string& text) {
     return parse(text);
 }
 
-inline Document load(const std::string& path) {
-    std::ifstream file(path.c_str());
+/**
+ * @brief Stream ISON from an input stream to a visitor with bounded memory
+ */
+inline void parse_stream(std::istream& in, BlockVisitor& visitor, size_t chunk_size = 65536) {
+    StreamParser parser(visitor);
+    std::vector<char> chunk(chunk_size > 0 ? chunk_size : 1);
+    while (in) {
+        in.read(&chunk[0], static_cast<std::streamsize>(chunk.size()));
+        std::streamsize n = in.gcount();
+        if (n <= 0) break;
+        parser.feed(chunk.data(), static_cast<size_t>(n));
+    }
+    parser.finish();
+}
+
+/**
+ * @brief Stream an ISON file to a visitor without loading it into memory
+ */
+inline void load_stream(const std::string& path, BlockVisitor& visitor) {
+    std::ifstream file(path.c_str(), std::ios::binary);
     if (!file.is_open()) {
         throw ISONError("Could not open file: " + path);
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return parse(buffer.str());
+    parse_stream(file, visitor);
+}
+
+/**
+ * @brief load_stream() with the next chunks read on a background thread while parsing
+ */
+inline void load_stream(const std::string& path, BlockVisitor& visitor, const AsyncOptions& async) {
+    detail::stream_pipelined(path, visitor, async);
+}
+
+inline Document load(const std::string& path, const ParseOptions& options = ParseOptions()) {
+    MappedFile file(path);
+    return parse(file.data(), file.size(), options);
+}
+
+/**
+ * @brief Load through a read-ahead pipeline instead of mapping the file
+ *
+ * Chunks are read on a background thread while the previous ones are
+ * parsed. Suits pipes, network file systems and files too large to map.
+ */
+inline Document load(const std::string& path, const ParseOptions& options, const AsyncOptions& async) {
+    return detail::load_pipelined(path, options, async);
+}
+
+/**
+ * @brief Run the pipelined load() on its own thread
+ */
+inline std::future<Document> load_async(const std::string& path, const ParseOptions& options = ParseOptions(),
+                                        const AsyncOptions& async = AsyncOptions()) {
+    return std::async(std::launch::async, &detail::load_pipelined, path, options, async);
+}
+
+inline Document load_parallel(const std::string& path, size_t thread_count = 0,
+                              const ParseOptions& options = ParseOptions()) {
+    MappedFile file(path);
+    return detail::parse_parallel(file.data(), file.size(), thread_count, options);
+}
+
+inline ColumnarDocument load_columnar(const std::string& path, const ParseOptions& options = ParseOptions()) {
+    MappedFile file(path);
+    return parse_columnar(file.data(), file.size(), options);
 }
 
 inline std::string dumps(const Document& doc, bool align_columns = false, const std::string& delimiter = " ") {
     return Serializer::dumps(doc, align_columns);
 }
 
+inline std::string dumps(const ColumnarDocument& doc, bool align_columns = false) {
+    std::string result;
+    IsonWriter writer(result, align_columns);
+    writer.write(doc);
+    return result;
+}
+
 inline void dump(const Document& doc, const std::string& path, bool align_columns = true) {
-    std::ofstream file(path.c_str());
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        throw ISONError("Could not open file for writing: " + path);
+    }
+    IsonWriter writer(file, align_columns);
+    writer.write(doc);
+}
+
+/**
+ * @brief Dump with double-buffered writes: a writer thread drains one buffer while the next is filled
+ */
+inline void dump(const Document& doc, const std::string& path, bool align_columns, const AsyncOptions& async) {
+    detail::dump_pipelined(doc, path, align_columns, async);
+}
+
+/**
+ * @brief Run the pipelined dump() on its own thread
+ *
+ * doc is not copied; keep it alive and unmodified until the future is ready.
+ */
+inline std::future<void> dump_async(const Document& doc, const std::string& path, bool align_columns = true,
+                                    const AsyncOptions& async = AsyncOptions()) {
+    return std::async(std::launch::async, &detail::dump_pipelined, std::cref(doc), path, align_columns, async);
+}
+
+/**
+ * @brief Serialize a snapshot block by block, without copying it into a Document
+ */
+inline std::string dumps(const DocumentSnapshot& snapshot, bool align_columns = false) {
+    std::string result;
+    {
+        IsonWriter writer(result, align_columns);
+        for (size_t i = 0; i < snapshot.size(); ++i) writer.write(snapshot.block(i));
+    }
+    return result;
+}
+
+inline ColumnarDocument load_binary_columnar(const std::string& path) {
+    MappedFile file(path);
+    return loads_binary_columnar(file.data(), file.size());
+}
+
+inline Document load_binary(const std::string& path) {
+    MappedFile file(path);
+    return loads_binary(file.data(), file.size());
+}
+
+inline void dump_binary(const Document& doc, const std::string& path, const BinaryOptions& options = BinaryOptions()) {
+    std::ofstream file(path.c_str(), std::ios::binary);
     if (!file.is_open()) {
         throw ISONError("Could not open file for writing: " + path);
     }
-    file << dumps(doc, align_columns);
+    std::string data = dumps_binary(doc, options);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
 }
 
 inline Document loads_isonl(const std::string& text) {
@@ -1223,13 +8896,167 @@ inline Document loads_isonl(const std::string& text) {
     return parser.parse_to_document(text);
 }
 
+inline Document load_isonl(const std::string& path) {
+    MappedFile file(path);
+    ISONLParser parser;
+    return parser.parse_to_document(file.data(), file.size());
+}
+
+/**
+ * @brief load_isonl() through a read-ahead pipeline (see the pipelined load())
+ */
+inline Document load_isonl(const std::string& path, const AsyncOptions& async) {
+    FileSource file(path);
+    ReadAheadSource chunks(file, async.chunk_size, async.read_ahead);
+    ISONLParser parser;
+    return parser.parse_chunks(chunks);
+}
+
+/**
+ * @brief Write a Document as ISONL with double-buffered writes; every record ends with a newline
+ */
+inline void dump_isonl(const Document& doc, const std::string& path, const AsyncOptions& async = AsyncOptions()) {
+    FileSink file(path, false);
+    AsyncSink sink(file, async.write_buffer);
+    {
+        ISONLWriter writer(sink);
+        writer.append(doc);
+        writer.close();
+    }
+    sink.close();
+    if (async.sync) file.sync();
+}
+
+inline Document loads_isonl_parallel(const std::string& text, size_t thread_count = 0) {
+    ISONLParser parser;
+    return parser.parse_to_document_parallel(text.data(), text.size(), thread_count);
+}
+
+inline Document load_isonl_parallel(const std::string& path, size_t thread_count = 0) {
+    MappedFile file(path);
+    ISONLParser parser;
+    return parser.parse_to_document_parallel(file.data(), file.size(), thread_count);
+}
+
 inline std::string dumps_isonl(const Document& doc) {
     return ISONLSerializer::dumps(doc);
 }
 
+/**
+ * @brief compress_isonl() of a Document's ISONL form
+ */
+inline std::string dumps_isonl_segmented(const Document& doc, const SegmentOptions& options = SegmentOptions()) {
+    return compress_isonl(dumps_isonl(doc), options);
+}
+
+/**
+ * @brief Open a compress_isonl() archive file; segments are read from the mapped file on demand
+ */
+inline SegmentedISONL load_isonl_segmented(const std::string& path) {
+    return SegmentedISONL(std::make_shared<MappedFile>(path));
+}
+
+/**
+ * @brief Convert ISON to ISONL in one streaming pass, without building a Document
+ */
 inline std::string ison_to_isonl(const std::string& ison_text) {
-    Document doc = parse(ison_text);
-    return dumps_isonl(doc);
+    std::string result;
+    {
+        ISONLWriter writer(&result);
+        detail::ISONLTranscoder transcoder(writer);
+        detail::stream_text(ison_text.data(), ison_text.size(), transcoder);
+    }
+    if (!result.empty()) result.erase(result.size() - 1);
+    return result;
+}
+
+inline void ison_to_isonl(std::istream& in, std::ostream& out) {
+    ISONLWriter writer(out);
+    detail::ISONLTranscoder transcoder(writer);
+    parse_stream(in, transcoder);
+    writer.close();
+}
+
+/**
+ * @brief ison_to_isonl() between files as a three-stage pipeline
+ *
+ * One thread reads ahead, the caller's thread parses and formats, and a
+ * third writes, so reading, conversion and writing overlap.
+ */
+inline void ison_to_isonl_file(const std::string& in_path, const std::string& out_path,
+                               const AsyncOptions& async = AsyncOptions()) {
+    FileSink file(out_path, false);
+    AsyncSink sink(file, async.write_buffer);
+    {
+        ISONLWriter writer(sink);
+        detail::ISONLTranscoder transcoder(writer);
+        detail::stream_pipelined(in_path, transcoder, async);
+        writer.close();
+    }
+    sink.close();
+    if (async.sync) file.sync();
+}
+
+/**
+ * @brief Convert ISON to JSON in one streaming pass; same layout as to_json()
+ */
+inline std::string ison_to_json(const std::string& ison_text, int indent = 2) {
+    std::string result;
+    JsonWriter writer(result, indent);
+    detail::JsonTranscoder transcoder(writer);
+    detail::stream_text(ison_text.data(), ison_text.size(), transcoder);
+    writer.finish();
+    return result;
+}
+
+inline void ison_to_json(std::istream& in, std::ostream& out, int indent = 2) {
+    JsonWriter writer(out, indent);
+    detail::JsonTranscoder transcoder(writer);
+    parse_stream(in, transcoder);
+    writer.finish();
+}
+
+/**
+ * @brief ison_to_json() between files, pipelined like ison_to_isonl_file()
+ */
+inline void ison_to_json_file(const std::string& in_path, const std::string& out_path, int indent = 2,
+                              const AsyncOptions& async = AsyncOptions()) {
+    FileSink file(out_path, false);
+    AsyncSink sink(file, async.write_buffer);
+    {
+        JsonWriter writer(sink, indent);
+        detail::JsonTranscoder transcoder(writer);
+        detail::stream_pipelined(in_path, transcoder, async);
+        writer.finish();
+    }
+    sink.close();
+    if (async.sync) file.sync();
+}
+
+/**
+ * @brief Convert a JSON object of row arrays to ISON in one streaming pass
+ *
+ * Each array becomes a table block and each nested object an object block.
+ * The first row's keys become the fields, and later rows may omit keys
+ * (written as null) but not add new ones. Nested objects and arrays inside
+ * a row are kept as compact JSON strings. With detect_references, strings
+ * like ":user:42" become references, as written by to_json(). Empty arrays
+ * have no fields and are skipped.
+ */
+inline std::string json_to_ison(const std::string& json_text, bool detect_references = true) {
+    std::string result;
+    IsonWriter writer(result);
+    detail::JsonReader reader(json_text.data(), json_text.size());
+    detail::transcode_json(reader, writer, detect_references);
+    return result;
+}
+
+inline void json_to_ison(std::istream& in, std::ostream& out, bool detect_references = true) {
+    IStreamSource source(in);
+    detail::JsonReader reader(source);
+    IsonWriter writer(out);
+    detail::transcode_json(reader, writer, detect_references);
+    writer.flush();
 }
 
 inline std::string isonl_to_ison(const std::string& isonl_text) {
@@ -1255,4 +9082,78 @@ inline const std::string& as_string(const Value& v) { return v.as_string(); }
 
 } // namespace ison
 
+// =============================================================================
+// Struct Binding Macros
+// =============================================================================
+
+#define ISON_PP_EXPAND(x) x
+#define ISON_PP_CAT(a, b) ISON_PP_CAT_I(a, b)
+#define ISON_PP_CAT_I(a, b) a##b
+#define ISON_PP_COUNT(...) ISON_PP_EXPAND(ISON_PP_COUNT_I(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define ISON_PP_COUNT_I(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...) N
+#define ISON_PP_FOR_EACH(m, ...) ISON_PP_EXPAND(ISON_PP_CAT(ISON_PP_FOR_EACH_, ISON_PP_COUNT(__VA_ARGS__))(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_1(m, x) m(x)
+#define ISON_PP_FOR_EACH_2(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_1(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_3(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_2(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_4(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_3(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_5(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_4(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_6(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_5(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_7(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_6(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_8(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_7(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_9(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_8(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_10(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_9(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_11(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_10(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_12(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_11(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_13(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_12(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_14(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_13(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_15(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_14(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_16(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_15(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_17(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_16(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_18(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_17(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_19(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_18(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_20(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_19(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_21(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_20(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_22(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_21(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_23(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_22(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_24(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_23(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_25(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_24(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_26(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_25(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_27(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_26(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_28(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_27(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_29(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_28(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_30(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_29(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_31(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_30(m, __VA_ARGS__))
+#define ISON_PP_FOR_EACH_32(m, x, ...) m(x) ISON_PP_EXPAND(ISON_PP_FOR_EACH_31(m, __VA_ARGS__))
+
+#define ISON_BIND_MEMBER_(member) ison_visitor(#member, ison_object.member);
+#define ISON_BIND_NAME_(member) #member,
+
+/**
+ * @brief Bind up to 32 members of a struct to the same-named ISON fields
+ *
+ *   struct User { int64_t id; std::string name; ison::Optional<std::string> email; };
+ *   ISON_BIND(User, id, name, email)
+ *
+ *   std::vector<User> users = ison::parse_into<std::vector<User> >(text);
+ *   std::string text = ison::dumps_from(users, "users");
+ *
+ * Use it at namespace scope, in the struct's namespace; the generated
+ * functions are found by argument-dependent lookup. The struct must be
+ * default constructible.
+ */
+#define ISON_BIND(Type, ...) \
+    template<typename ISONVisitor> \
+    inline void ison_bind_fields(Type& ison_object, ISONVisitor& ison_visitor) { \
+        ISON_PP_FOR_EACH(ISON_BIND_MEMBER_, __VA_ARGS__) \
+    } \
+    template<typename ISONVisitor> \
+    inline void ison_bind_fields(const Type& ison_object, ISONVisitor& ison_visitor) { \
+        ISON_PP_FOR_EACH(ISON_BIND_MEMBER_, __VA_ARGS__) \
+    } \
+    inline const char* const* ison_bind_names(const Type*, size_t& ison_count) { \
+        static const char* const ison_names[] = { ISON_PP_FOR_EACH(ISON_BIND_NAME_, __VA_ARGS__) }; \
+        ison_count = sizeof(ison_names) / sizeof(ison_names[0]); \
+        return ison_names; \
+    }
+
 #endif // ISON_PARSER_HPP
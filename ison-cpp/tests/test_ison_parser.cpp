@@ -16,6 +16,8 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <cstdio>
+#include <sstream>
 
 using namespace ison;
 
@@ -512,10 +514,2016 @@ content
     ASSERT_EQ(as_string(test[2].at("content")), "path\\to\\file");
 }
 
+// =============================================================================
+// Zero-copy Parsing Tests
+// =============================================================================
+
+TEST(parse_borrowed_buffer) {
+    const char buffer[] = "table.users\nid name\n1 Alice\n2 \"Bob Smith\"\n";
+    auto doc = parse(buffer, sizeof(buffer) - 1);
+
+    auto& users = doc["users"];
+    ASSERT_EQ(users.size(), 2);
+    ASSERT_EQ(as_int(users[0].at("id")), 1);
+    ASSERT_EQ(as_string(users[1].at("name")), "Bob Smith");
+}
+
+TEST(parse_crlf_line_endings) {
+    std::string ison = "table.users\r\nid name\r\n1 Alice\r\n\r\ntable.orders\r\nid\r\n7\r\n";
+    auto doc = parse(ison);
+
+    ASSERT_EQ(doc.size(), 2);
+    ASSERT_EQ(doc["users"].fields[1], "name");
+    ASSERT_EQ(as_string(doc["users"][0].at("name")), "Alice");
+    ASSERT_EQ(as_int(doc["orders"][0].at("id")), 7);
+}
+
+TEST(tokenizer_token_views) {
+    std::string line = "plain \"quoted text\" \"esc\\\"aped\" :ref";
+    Tokenizer tokenizer(line);
+    std::vector<Token> tokens;
+    tokenizer.tokenize(tokens);
+
+    ASSERT_EQ(tokens.size(), 4);
+    ASSERT(!tokens[0].quoted);
+    ASSERT(tokens[0].text == "plain");
+    ASSERT(tokens[0].text.data() == line.data());  // points into the line
+    ASSERT(tokens[1].quoted);
+    ASSERT(tokens[1].text == "quoted text");
+    ASSERT(tokens[1].text.data() == line.data() + 7);
+    ASSERT(tokens[2].quoted);
+    ASSERT(tokens[2].text == "esc\"aped");
+    ASSERT(!tokens[3].quoted);
+}
+
+// =============================================================================
+// Columnar Storage Tests
+// =============================================================================
+
+TEST(parse_columnar_typed_columns) {
+    std::string ison = R"(table.users
+id name score active manager
+1 Alice 9.5 true :user:10
+2 "Bob Smith" 7.25 false ~
+3 Carol null true :MEMBER_OF:11)";
+
+    auto doc = parse_columnar(ison);
+    auto& users = doc["users"];
+    ASSERT_EQ(users.size(), 3);
+    ASSERT_EQ(users.column_count(), 5);
+
+    const Column& id = users.column("id");
+    ASSERT(id.type() == ColumnType::Int);
+    ASSERT_EQ(id.int_at(2), 3);
+
+    const Column& name = users.column(users.column_index("name"));
+    ASSERT(name.type() == ColumnType::String);
+    ASSERT(name.string_at(1) == "Bob Smith");
+
+    const Column& score = users.column("score");
+    ASSERT(score.type() == ColumnType::Float);
+    ASSERT(score.is_null(2));
+    ASSERT_EQ(score.null_count(), 1);
+
+    const Column& manager = users.column("manager");
+    ASSERT(manager.type() == ColumnType::Reference);
+    ASSERT(manager.reference_id_at(0) == "10");
+    ASSERT_EQ(*manager.reference_type_at(0), "user");
+    ASSERT(manager.is_null(1));
+    ASSERT_EQ(*manager.reference_type_at(2), "MEMBER_OF");
+}
+
+TEST(columnar_mixed_column_fallback) {
+    std::string ison = R"(table.items
+value
+1
+two
+~
+3.5)";
+
+    auto doc = parse_columnar(ison);
+    const Column& value = doc["items"].column("value");
+    ASSERT(value.type() == ColumnType::Mixed);
+    ASSERT_EQ(value.int_at(0), 1);
+    ASSERT(value.string_at(1) == "two");
+    ASSERT(value.is_null(2));
+    ASSERT(is_float(value.get(3)));
+}
+
+TEST(columnar_row_compatibility) {
+    std::string ison = R"(table.users
+id name ref
+1 Alice :1
+2 Bob ~)";
+
+    auto doc = parse(ison);
+    ColumnarBlock columnar = ColumnarBlock::from_block(doc["users"]);
+    ASSERT_EQ(as_string(columnar.row(0).at("name")), "Alice");
+    ASSERT_EQ(as_reference(columnar.get(0, 2)).id, "1");
+
+    Block back = columnar.to_block();
+    ASSERT_EQ(back.size(), 2);
+    ASSERT(is_null(back[1].at("ref")));
+
+    std::string serialized = dumps(parse_columnar(ison));
+    ASSERT_EQ(serialized, dumps(doc));
+}
+
+// =============================================================================
+// Streaming Tests
+// =============================================================================
+
+struct CollectingVisitor : public BlockVisitor {
+    Document doc;
+
+    void on_block(const std::string& kind, const std::string& name) {
+        doc.blocks.push_back(Block(kind, name));
+    }
+    void on_fields(const std::vector<FieldInfo>& field_info) {
+        for (size_t i = 0; i < field_info.size(); ++i) {
+            doc.blocks.back().fields.push_back(field_info[i].name);
+        }
+        doc.blocks.back().field_info = field_info;
+    }
+    void on_row(const std::vector<Value>& values) {
+        Row row;
+        for (size_t i = 0; i < values.size(); ++i) row[doc.blocks.back().fields[i]] = values[i];
+        doc.blocks.back().rows.push_back(row);
+    }
+    void on_summary(const std::string& summary) { doc.blocks.back().summary = summary; }
+};
+
+TEST(stream_parser_byte_chunks) {
+    std::string ison = R"(# header comment
+table.users
+id name
+1 Alice
+2 "Bob \"B\" Smith"
+---
+2 users
+
+table.orders
+id user
+101 :1
+)";
+
+    CollectingVisitor visitor;
+    StreamParser parser(visitor);
+    for (size_t i = 0; i < ison.size(); ++i) parser.feed(&ison[i], 1);
+    parser.finish();
+
+    ASSERT_EQ(dumps(visitor.doc), dumps(parse(ison)));
+    ASSERT_EQ(visitor.doc["users"].summary.value(), "2 users");
+}
+
+TEST(stream_reader_next_row) {
+    std::string ison = "table.users\nid name\n1 Alice\n2 Bob\n\ntable.empty\nx\n\ntable.orders\nid\n101";
+    std::istringstream in(ison);
+    IStreamSource source(in);
+    StreamReader reader(source, 7);
+
+    ASSERT(reader.next_row());
+    ASSERT_EQ(reader.name(), "users");
+    ASSERT_EQ(as_int(reader.values()[0]), 1);
+    ASSERT(reader.next_row());
+    ASSERT_EQ(as_string(reader.row().at("name")), "Bob");
+    ASSERT(reader.next_row());
+    ASSERT_EQ(reader.name(), "orders");
+    ASSERT_EQ(reader.block_index(), 3);
+    ASSERT_EQ(as_int(reader.values()[0]), 101);
+    ASSERT(!reader.next_row());
+}
+
+TEST(stream_error_missing_fields) {
+    CollectingVisitor visitor;
+    StreamParser parser(visitor);
+    parser.feed("table.users\n");
+    try {
+        parser.finish();
+        ASSERT(false);
+    } catch (const ISONSyntaxError& e) {
+        ASSERT(std::string(e.what()).find("missing field definitions") != std::string::npos);
+    }
+}
+
+// =============================================================================
+// File Loading Tests
+// =============================================================================
+
+static void write_file(const std::string& path, const std::string& content) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << content;
+}
+
+TEST(load_mapped_file) {
+    const std::string path = "test_load_mapped.ison";
+    write_file(path, "table.users\nid name\n1 Alice\n2 Bob\n");
+
+    {
+        MappedFile file(path);
+        ASSERT(file.size() > 0);
+        ASSERT(file.view().substr(0, 11) == "table.users");
+    }
+
+    auto doc = load(path);
+    ASSERT_EQ(doc["users"].size(), 2);
+    ASSERT_EQ(as_string(doc["users"][1].at("name")), "Bob");
+
+    auto columnar = load_columnar(path);
+    ASSERT_EQ(columnar["users"].column("id").int_at(1), 2);
+    std::remove(path.c_str());
+}
+
+TEST(load_isonl_file) {
+    const std::string path = "test_load_mapped.isonl";
+    write_file(path, "table.users|id name|1 Alice\ntable.users|id name|2 Bob");
+
+    auto doc = load_isonl(path);
+    ASSERT_EQ(doc["users"].size(), 2);
+    std::remove(path.c_str());
+}
+
+TEST(load_empty_and_missing_file) {
+    const std::string path = "test_load_empty.ison";
+    write_file(path, "");
+    ASSERT_EQ(load(path).size(), 0);
+    std::remove(path.c_str());
+
+    try {
+        load("does_not_exist.ison");
+        ASSERT(false);
+    } catch (const ISONError& e) {
+        ASSERT(std::string(e.what()).find("Could not open file") != std::string::npos);
+    }
+}
+
+// =============================================================================
+// Parallel Parsing Tests
+// =============================================================================
+
+static std::string make_large_ison(size_t rows) {
+    std::string text = "# generated\ntable.users\nid name score active ref\n";
+    for (size_t i = 0; i < rows; ++i) {
+        text += std::to_string(i) + " \"User " + std::to_string(i) + "\" " +
+                std::to_string(i) + ".5 " + (i % 2 ? "true" : "false") + " :group:" + std::to_string(i % 7) + "\n";
+    }
+    text += "---\nsummary line\n\nobject.config\nkey value\nmode fast\n\ntable.events\nid kind\n";
+    for (size_t i = 0; i < rows / 2; ++i) {
+        text += std::to_string(i) + " " + (i % 3 ? "click" : "\"page view\"") + "\n";
+    }
+    return text;
+}
+
+TEST(parse_parallel_matches_sequential) {
+    std::string text = make_large_ison(5000);
+    Document sequential = parse(text);
+    Document parallel = parse_parallel(text, 4);
+
+    ASSERT_EQ(parallel.size(), 3);
+    ASSERT_EQ(parallel["users"].size(), 5000);
+    ASSERT_EQ(parallel["users"].summary.value(), "summary line");
+    ASSERT_EQ(dumps(parallel), dumps(sequential));
+    ASSERT_EQ(dumps(parse_parallel(text, 1)), dumps(sequential));
+}
+
+TEST(parse_parallel_reports_first_error) {
+    std::string text = make_large_ison(2000);
+    text += "1 \"unterminated\n\nbroken_header\nid\n";
+    try {
+        parse_parallel(text, 3);
+        ASSERT(false);
+    } catch (const ISONSyntaxError& e) {
+        ASSERT(std::string(e.what()).find("Unterminated") != std::string::npos);
+    }
+}
+
+TEST(parse_isonl_parallel_matches_sequential) {
+    std::string isonl;
+    for (size_t i = 0; i < 20000; ++i) {
+        if (i % 3 == 0) isonl += "table.events|id kind|" + std::to_string(i) + " \"a|b\"\n";
+        else isonl += "table.users|id name|" + std::to_string(i) + " user" + std::to_string(i) + "\n";
+        if (i == 15000) isonl += "# comment\n\nmeta.late|key|1\n";
+    }
+
+    Document sequential = loads_isonl(isonl);
+    Document parallel = loads_isonl_parallel(isonl, 4);
+
+    ASSERT_EQ(parallel.size(), 3);
+    ASSERT_EQ(parallel.blocks[0].name, "events");
+    ASSERT_EQ(parallel.blocks[2].name, "late");
+    ASSERT_EQ(as_string(parallel["events"][1].at("kind")), "a|b");
+    ASSERT_EQ(dumps_isonl(parallel), dumps_isonl(sequential));
+}
+
+TEST(parse_isonl_parallel_error_line) {
+    std::string isonl;
+    for (size_t i = 0; i < 10000; ++i) isonl += "table.users|id name|" + std::to_string(i) + " x\n";
+    isonl += "table.users|id\n";
+
+    try {
+        loads_isonl_parallel(isonl, 4);
+        ASSERT(false);
+    } catch (const ISONSyntaxError& e) {
+        ASSERT_EQ(e.line, 10001);
+    }
+}
+
 // =============================================================================
 // Main
 // =============================================================================
 
+// =============================================================================
+// SIMD Scanning Tests
+// =============================================================================
+
+static std::vector<std::string> tokenize_at(SimdLevel level, const std::string& line) {
+    SimdLevel previous = simd_level();
+    set_simd_level(level);
+    Tokenizer tokenizer(line, 1);
+    std::vector<std::string> tokens = tokenizer.tokenize();
+    set_simd_level(previous);
+    return tokens;
+}
+
+TEST(simd_tokenizer_matches_scalar) {
+    // Tokens and escapes land on both sides of the 16 and 32 byte lanes
+    std::string line = "a " + std::string(40, 'x') + "\t\"" + std::string(20, 'q') +
+                       "\\\"" + std::string(30, 'r') + "\\n\" :1 \"" + std::string(70, 's') +
+                       "\" " + std::string(15, 'y') + " \"\"";
+    std::vector<std::string> scalar = tokenize_at(SimdLevel::Scalar, line);
+    ASSERT_EQ(scalar.size(), 7);
+    ASSERT_EQ(scalar[1], std::string(40, 'x'));
+    ASSERT_EQ(scalar[2], std::string(20, 'q') + "\"" + std::string(30, 'r') + "\n");
+    ASSERT_EQ(scalar[4], std::string(70, 's'));
+    ASSERT_EQ(scalar[6], "");
+
+    SimdLevel levels[] = { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON };
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT(tokenize_at(levels[i], line) == scalar);
+    }
+}
+
+TEST(simd_unterminated_long_string) {
+    std::string line = "id \"" + std::string(100, 'z');
+    try {
+        Tokenizer(line, 3).tokenize();
+        ASSERT(false);
+    } catch (const ISONSyntaxError& e) {
+        ASSERT_EQ(e.line, 3);
+        ASSERT_EQ(e.col, 3);
+    }
+}
+
+TEST(simd_isonl_long_quoted_pipe) {
+    std::string text = "table.notes|id body|1 \"" + std::string(50, 'a') + "|" +
+                       std::string(50, 'b') + "\"\n";
+    auto doc = loads_isonl(text);
+    ASSERT_EQ(doc["notes"].rows[0].at("body").as_string(),
+              std::string(50, 'a') + "|" + std::string(50, 'b'));
+}
+
+// =============================================================================
+// Numeric Inference Tests
+// =============================================================================
+
+TEST(infer_integer_limits) {
+    ASSERT_EQ(TypeInferrer::infer("9223372036854775807").as_int(), INT64_MAX);
+    ASSERT_EQ(TypeInferrer::infer("-9223372036854775808").as_int(), INT64_MIN);
+    ASSERT_EQ(TypeInferrer::infer("007").as_int(), 7);
+    ASSERT_EQ(TypeInferrer::infer("-0").as_int(), 0);
+
+    Value overflow = TypeInferrer::infer("9223372036854775808");
+    ASSERT(overflow.is_float());
+    ASSERT_EQ(overflow.as_float(), 9223372036854775808.0);
+    ASSERT(TypeInferrer::infer("-123456789012345678901234").is_float());
+}
+
+TEST(infer_float_round_trip) {
+    const char* samples[] = {
+        "0.1", "3.14", "-2.5", "1.", ".5", "-.25", "0.000001",
+        "123456789.123456789", "3.14159265358979323846", "9007199254740993.0"
+    };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+        Value v = TypeInferrer::infer(samples[i]);
+        ASSERT(v.is_float());
+        ASSERT_EQ(v.as_float(), std::strtod(samples[i], NULL));
+    }
+}
+
+TEST(infer_non_numeric_tokens) {
+    const char* samples[] = { "-", ".", "1.2.3", "12a", "1e5", "+1", "nul", "truex", "~~", ":" };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+        Value v = TypeInferrer::infer(samples[i]);
+        ASSERT(v.is_string());
+        ASSERT_EQ(v.as_string(), samples[i]);
+    }
+    ASSERT(TypeInferrer::infer("~").is_null());
+    ASSERT(TypeInferrer::infer("42", true).is_string());
+}
+
+// =============================================================================
+// Arena Tests
+// =============================================================================
+
+struct CountedObject {
+    int* counter;
+    explicit CountedObject(int* counter) : counter(counter) {}
+    ~CountedObject() { ++*counter; }
+};
+
+TEST(arena_allocation) {
+    int destroyed = 0;
+    {
+        Arena arena(1024);
+        for (int i = 0; i < 100; ++i) arena.create<CountedObject>(&destroyed);
+        double* d = arena.create<double>(2.5);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(d) % alignof(double), 0u);
+        char* big = static_cast<char*>(arena.allocate(10000, 1));
+        std::memset(big, 'x', 10000);
+        ASSERT_EQ(*d, 2.5);
+        ASSERT(arena.bytes_used() >= 10000 + sizeof(double));
+        ASSERT(arena.bytes_reserved() >= arena.bytes_used());
+        ASSERT_EQ(destroyed, 0);
+    }
+    ASSERT_EQ(destroyed, 100);
+}
+
+TEST(parse_into_arena) {
+    std::string ison = "table.members\nid user team\n";
+    for (int i = 0; i < 1000; ++i) {
+        ison += std::to_string(i) + " :user:" + std::to_string(i) + " :MEMBER_OF:" + std::to_string(i % 7) + "\n";
+    }
+    ParseOptions options;
+    options.use_arena = true;
+    options.arena_block_size = 4096;
+
+    Value kept;
+    {
+        Document doc = parse(ison, options);
+        ASSERT(doc.arena);
+        ASSERT(doc.arena->bytes_used() > 0);
+        ASSERT_EQ(doc["members"].rows.size(), 1000);
+        const Reference& ref = as_reference(doc["members"].rows[5].at("team"));
+        ASSERT(ref.is_relationship());
+        ASSERT_EQ(ref.id, "5");
+        kept = doc["members"].rows[999].at("user");
+
+        Document parallel = parse_parallel(ison, 4, options);
+        ASSERT(parallel.arena);
+        ASSERT_EQ(as_reference(parallel["members"].rows[999].at("user")).id, "999");
+    }
+    // Values copied out of the document keep its arena alive
+    ASSERT_EQ(as_reference(kept).id, "999");
+    ASSERT(!parse(ison).arena);
+}
+
+// =============================================================================
+// Compact Value Tests
+// =============================================================================
+
+TEST(compact_value_copies_share_payload) {
+    ASSERT(sizeof(Value) <= 16);
+
+    Value a(std::string(100, 'x'));
+    Value b = a;
+    ASSERT_EQ(&a.as_string(), &b.as_string());
+    Value& alias = b;
+    b = alias;
+    a = Value(42);
+    ASSERT_EQ(a.as_int(), 42);
+    ASSERT_EQ(b.as_string(), std::string(100, 'x'));
+
+    Value moved(std::move(b));
+    ASSERT(b.is_null());
+    ASSERT_EQ(moved.as_string().size(), 100u);
+
+    auto ref = std::make_shared<Reference>("7", "user");
+    Value r(ref);
+    ASSERT_EQ(r.as_reference_ptr(), ref);
+    ASSERT_EQ(r.get_reference(), ref.get());
+    ASSERT(Value(std::shared_ptr<Reference>()).get_reference() == NULL);
+}
+
+TEST(arena_values_outlive_document) {
+    ParseOptions options;
+    options.use_arena = true;
+
+    Value name;
+    std::shared_ptr<Reference> ref;
+    {
+        Document doc = parse("table.users\nid name boss\n1 \"Alice Example With A Long Name\" :user:2\n", options);
+        name = doc["users"].rows[0].at("name");
+        ref = doc["users"].rows[0].at("boss").as_reference_ptr();
+    }
+    ASSERT_EQ(name.as_string(), "Alice Example With A Long Name");
+    ASSERT_EQ(ref->id, "2");
+    ASSERT_EQ(ref->type.value(), "user");
+}
+
+// Copies and drops arena values; each copy only counts on the value's own cell
+struct ArenaValueCopier {
+    const std::vector<Value>* values;
+    bool* ok;
+
+    void operator()() const {
+        for (int i = 0; i < 2000; ++i) {
+            std::vector<Value> copies(*values);
+            std::shared_ptr<Reference> ref = copies.back().as_reference_ptr();
+            if (copies[0].as_string() != "Alice Example With A Long Name" || ref->id != "2") *ok = false;
+        }
+    }
+};
+
+TEST(arena_values_shared_across_threads) {
+    ParseOptions options;
+    options.use_arena = true;
+
+    std::vector<Value> values;
+    {
+        Document doc = parse("table.users\nid name boss\n1 \"Alice Example With A Long Name\" :user:2\n", options);
+        const Row& row = doc["users"].rows[0];
+        values.push_back(row.at("name"));
+        values.push_back(row.at("boss"));
+    }
+    bool ok[4] = {true, true, true, true};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        ArenaValueCopier copier = {&values, &ok[t]};
+        threads.push_back(std::thread(copier));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    for (int t = 0; t < 4; ++t) ASSERT(ok[t]);
+
+    // The arena stays pinned until the last value pointing into it goes
+    std::shared_ptr<Reference> ref = values[1].as_reference_ptr();
+    values.clear();
+    ASSERT_EQ(ref->type.value(), "user");
+}
+
+// =============================================================================
+// Interning Tests
+// =============================================================================
+
+TEST(intern_pool_shares_values) {
+    InternPool pool(8, 3);
+    Value a = pool.string("active");
+    Value b = pool.string(std::string("active"));
+    ASSERT_EQ(&a.as_string(), &b.as_string());
+    ASSERT(pool.string("much too long").is_null());
+
+    Value r1 = pool.reference("MEMBER_OF:10");
+    ASSERT(r1.is_null());  // type longer than max_length
+    // References share their type whatever the id; ids take no entries
+    Value r2 = pool.reference("user:1");
+    Value r3 = pool.reference("user:2");
+    ASSERT_EQ(as_reference(r2).type.value(), "user");
+    ASSERT_EQ(as_reference(r3).id, "2");
+    ASSERT(as_reference(r2).type.is_shared());
+    ASSERT_EQ(&as_reference(r2).type.value(), &as_reference(r3).type.value());
+    ASSERT(!as_reference(pool.reference("7")).type.has_value());
+
+    // The relationship flag follows the type whenever it is set
+    Reference ref("1", "user");
+    ASSERT(!ref.is_relationship());
+    ref.type = "REPORTS_TO";
+    ASSERT(ref.is_relationship());
+    ref.type.reset();
+    ASSERT(!ref.is_relationship());
+
+    pool.string("x");
+    ASSERT_EQ(pool.size(), 3u);
+    ASSERT(pool.string("y").is_null());  // pool is full
+    ASSERT(!pool.string("x").is_null());
+}
+
+TEST(parse_with_shared_intern_pool) {
+    std::string ison = "table.members\nid status team rel\n";
+    for (int i = 0; i < 2000; ++i) {
+        ison += std::to_string(i) + (i % 2 ? " active" : " \"inactive\"") + " :team:" + std::to_string(i % 3) + " :MEMBER_OF:1\n";
+    }
+    ParseOptions options;
+    options.intern_pool = std::make_shared<InternPool>();
+
+    Document doc = parse(ison, options);
+    Document parallel = parse_parallel(ison, 4, options);
+    ASSERT(doc.intern_pool == options.intern_pool);
+
+    const Block& a = doc["members"];
+    const Block& b = parallel["members"];
+    ASSERT_EQ(&a.rows[1].at("status").as_string(), &b.rows[1999].at("status").as_string());
+    ASSERT_EQ(&a.rows[0].at("status").as_string(), &a.rows[2].at("status").as_string());
+    ASSERT_EQ(&as_reference(a.rows[0].at("team")).type.value(), &as_reference(b.rows[4].at("team")).type.value());
+    ASSERT_EQ(as_reference(b.rows[4].at("team")).id, "1");
+    ASSERT(as_reference(a.rows[7].at("rel")).is_relationship());
+    ASSERT(!as_reference(a.rows[7].at("team")).is_relationship());
+
+    options.intern_pool.reset();
+    options.intern = true;
+    Document own = parse(ison, options);
+    ASSERT(own.intern_pool && own.intern_pool != doc.intern_pool);
+    ASSERT_EQ(own.intern_pool->size(), 4u);  // two statuses, two reference types
+}
+
+// =============================================================================
+// Index Tests
+// =============================================================================
+
+TEST(document_block_index) {
+    std::string ison;
+    for (int i = 0; i < 300; ++i) ison += "table.t" + std::to_string(i) + "\nid\n" + std::to_string(i) + "\n\n";
+    ison += "table.t7\nid\n999\n";
+
+    Document doc = parse(ison);
+    ASSERT_EQ(doc.size(), 301);
+    ASSERT_EQ(as_int(doc["t250"][0].at("id")), 250);
+    ASSERT_EQ(as_int(doc["t7"][0].at("id")), 7);  // first block with a name wins
+    ASSERT(!doc.has("t300"));
+
+    // Appending directly falls back to a scan; add_block keeps the index
+    doc.blocks.push_back(Block("table", "extra"));
+    ASSERT(doc.has("extra"));
+    doc.add_block(Block("table", "added"));
+    ASSERT(doc.has("added"));
+
+    doc.blocks[0].name = "renamed";
+    doc.reindex();
+    ASSERT(doc.has("renamed"));
+    ASSERT(!doc.has("t0"));
+}
+
+TEST(block_index_survives_direct_edits) {
+    Document doc = parse("table.a\nid\n1\n\ntable.b\nid\n2\n");
+
+    // In-place assignment keeps the size the index was built for
+    doc.blocks[0] = Block("table", "c");
+    ASSERT(doc.has("c"));
+    ASSERT_EQ(doc.get("c"), &doc.blocks[0]);
+    ASSERT_EQ(doc["c"].name, "c");
+    ASSERT(!doc.has("a"));
+
+    // So does erasing one block and appending another
+    doc.blocks.erase(doc.blocks.begin());
+    doc.blocks.push_back(Block("table", "z"));
+    ASSERT_EQ(doc.get("z"), &doc.blocks[1]);
+    ASSERT_EQ(doc.get("b"), &doc.blocks[0]);
+
+    // Renaming a field without reindex_fields()
+    Block& b = doc["b"];
+    b.fields.push_back("name");
+    b.reindex_fields();
+    b.fields[0] = "w";
+    ASSERT_EQ(b.field_index("w"), 0u);
+    ASSERT_EQ(b.field_index("id"), Block::npos);
+    ASSERT_EQ(b.field_index("name"), 1u);
+
+    ColumnarDocument columnar = parse_columnar("table.users\nid name\n1 Alice\n");
+    columnar.blocks[0].fields[1] = "label";
+    ASSERT_EQ(columnar["users"].column_index("label"), 1u);
+    columnar.blocks[0].name = "people";
+    ASSERT(columnar.has("people"));
+}
+
+TEST(block_field_handles) {
+    auto doc = parse("table.users\nid name:string email\n1 Alice a@x\n2 Bob\n");
+    const Block& users = doc["users"];
+    size_t email = users.field_index("email");
+    ASSERT_EQ(email, 2u);
+    ASSERT_EQ(users.field_index("missing"), Block::npos);
+    ASSERT_EQ(users.get(0, email).as_string(), "a@x");
+    ASSERT(users.get(1, email).is_null());
+    ASSERT_EQ(users.get_field_type("name").value(), "string");
+
+    auto columnar = parse_columnar("table.users\nid name\n1 Alice\n2 Bob\n");
+    const ColumnarBlock& cols = columnar["users"];
+    size_t name = cols.column_index("name");
+    ASSERT_EQ(cols.get(1, name).as_string(), "Bob");
+    ASSERT_EQ(cols.column_index("missing"), ColumnarBlock::npos);
+}
+
+// =============================================================================
+// Reference Index Tests
+// =============================================================================
+
+TEST(reference_index_resolve) {
+    auto doc = parse(R"(table.users
+id name team manager
+101 Alice :MEMBER_OF:10 ~
+102 Bob :MEMBER_OF:20 :user:101
+
+table.teams
+id name
+10 Platform
+20 Search
+
+table.docs
+slug owner
+intro :person:102
+)");
+    ReferenceIndex index(doc);
+    RowRef alice = index.resolve(Reference("101", "user"));
+    ASSERT(alice.found());
+    ASSERT_EQ(alice.block->name, "users");
+    ASSERT_EQ(as_string(alice.get().at("name")), "Alice");
+
+    // No namespace: every block is searched
+    ASSERT_EQ(index.resolve(Reference("20")).block->name, "teams");
+    ASSERT(!index.resolve(Reference("999", "user")).found());
+    ASSERT(!index.resolve(Value(42)).found());
+
+    // Namespace mapping and custom key columns
+    const Value& owner = doc["docs"][0].at("owner");
+    ASSERT(index.resolve(owner).found());  // unknown namespace: searched everywhere
+    index.map_namespace("person", "teams");
+    ASSERT(!index.resolve(owner).found());
+    index.map_namespace("person", "users");
+    ASSERT_EQ(as_int(index.resolve(owner).get().at("id")), 102);
+    index.set_key_field("docs", "slug");
+    ASSERT(index.find("docs", "intro").found());
+
+    // Multi-hop: doc owner -> manager
+    RowRef bob = index.resolve(owner);
+    RowRef manager = index.resolve(bob.get().at("manager"));
+    ASSERT_EQ(as_string(manager.get().at("name")), "Alice");
+}
+
+TEST(reference_index_relationships) {
+    auto doc = parse(R"(table.people
+id knows works_at
+1 :KNOWS:2 :ORG:100
+2 :KNOWS:1 :ORG:999
+
+table.orgs
+id name
+100 Acme
+)");
+    ReferenceIndex index(doc);
+    index.build();
+    RowRef person = index.find("people", "1");
+    std::vector<Relationship> rels = index.relationships(person);
+    ASSERT_EQ(rels.size(), 2u);
+
+    std::vector<Relationship> knows = index.relationships(person, "KNOWS");
+    ASSERT_EQ(knows.size(), 1u);
+    ASSERT_EQ(*knows[0].field, "knows");
+    ASSERT_EQ(as_int(knows[0].target.get().at("id")), 2);
+
+    std::vector<Relationship> orgs = index.relationships(index.find("people", "2"), "ORG");
+    ASSERT_EQ(orgs.size(), 1u);
+    ASSERT(!orgs[0].target.found());
+}
+
+// =============================================================================
+// Writer Tests
+// =============================================================================
+
+TEST(writer_float_round_trip) {
+    Document doc;
+    Block block("table", "nums");
+    block.fields.push_back("x");
+    double values[] = {2.0, 0.1, 1.0 / 3.0, -1234.5678901234, 1e20, 1e-7};
+    for (double v : values) {
+        Row row;
+        row["x"] = Value(v);
+        block.rows.push_back(row);
+    }
+    doc.add_block(block);
+
+    std::string text = dumps(doc);
+    ASSERT(text.find("\n2.0\n") != std::string::npos);
+    ASSERT(text.find("100000000000000000000.0") != std::string::npos);
+
+    auto back = parse(text);
+    for (size_t i = 0; i < 6; ++i) {
+        const Value& v = back["nums"][i].at("x");
+        ASSERT(v.is_float());
+        ASSERT(v.as_float() == values[i]);
+    }
+}
+
+TEST(writer_aligned_output) {
+    auto doc = parse(R"(table.users
+id name ref
+1 Alice :user:2
+22 "Bob Smith" null
+---
+two users
+)");
+    std::string expected =
+        "table.users\n"
+        "id name ref\n"
+        "1  Alice       :user:2\n"
+        "22 \"Bob Smith\" null\n"
+        "---\n"
+        "two users";
+    ASSERT_EQ(dumps(doc, true), expected);
+    ASSERT_EQ(dumps(ColumnarDocument::from_document(doc), true), expected);
+}
+
+TEST(writer_buffers_and_streams) {
+    std::string text = "table.t\nid name\n";
+    for (int i = 0; i < 2000; ++i) {
+        text += std::to_string(i) + " \"name " + std::to_string(i) + "\"\n";
+    }
+    auto doc = parse(text + "\nobject.cfg\nkey\n\"\"\n");
+
+    std::string direct = "prefix:";
+    {
+        IsonWriter writer(direct);
+        writer.write(doc);
+    }
+    ASSERT_EQ(direct, "prefix:" + dumps(doc));
+
+    std::ostringstream out;
+    {
+        IsonWriter writer(out, false, 256);
+        writer.write(doc.blocks[0]);
+        writer.write(doc.blocks[1]);
+        writer.flush();
+        ASSERT_EQ(out.str(), dumps(doc));
+    }
+    ASSERT_EQ(out.str(), dumps(doc));
+}
+
+// =============================================================================
+// ISONL Writer Tests
+// =============================================================================
+
+TEST(isonl_writer_appends_records) {
+    std::string out;
+    ISONLWriter writer(&out);
+    std::vector<std::string> fields = {"id", "text", "code"};
+    size_t memory = writer.define_block("table", "memory", fields);
+    ASSERT_EQ(writer.define_block("table", "memory", fields), memory);
+
+    writer.append(memory, {Value(int64_t(1)), Value(std::string("a|b c")), Value(std::string("42"))});
+    writer.append("table", "memory", fields, {Value(int64_t(2))});
+    writer.append("table", "other", {"x"}, {Value(1.5)});
+
+    ASSERT_EQ(out,
+        "table.memory|id text code|1 \"a\\|b c\" \"42\"\n"
+        "table.memory|id text code|2 null null\n"
+        "table.other|x|1.5\n");
+
+    auto doc = loads_isonl(out);
+    ASSERT_EQ(doc["memory"].size(), 2u);
+    ASSERT_EQ(as_string(doc["memory"][0].at("text")), "a|b c");
+    ASSERT(doc["memory"][0].at("code").is_string());
+    ASSERT(doc["memory"][1].at("text").is_null());
+
+    writer.close();
+    bool threw = false;
+    try {
+        writer.append(memory, {Value(int64_t(3))});
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+}
+
+TEST(isonl_writer_batches_to_file) {
+    std::string path = "test_isonl_writer.isonl";
+    std::remove(path.c_str());
+
+    ISONLWriterOptions options;
+    options.flush_every = 10;
+    options.sync = SyncPolicy::OnFlush;
+    {
+        ISONLWriter writer(path, options);
+        for (int i = 0; i < 25; ++i) {
+            writer.append("table", "log", {"seq"}, {Value(int64_t(i))});
+        }
+        // Two batches are on disk, the last five records are still buffered
+        ASSERT_EQ(load_isonl(path)["log"].size(), 20u);
+    }
+    {
+        // Reopening appends to the existing file
+        ISONLWriter writer(path);
+        writer.append("table", "log", {"seq"}, {Value(int64_t(25))});
+    }
+
+    auto doc = load_isonl(path);
+    ASSERT_EQ(doc["log"].size(), 26u);
+    ASSERT_EQ(as_int(doc["log"][25].at("seq")), 25);
+    std::remove(path.c_str());
+}
+
+// =============================================================================
+// Transcoder Tests
+// =============================================================================
+
+TEST(transcode_ison_to_json) {
+    std::string text = "table.users\nid name ref\n1 \"Al \\\"x\\\"\" :user:2\n2 Bob null\n";
+    std::string json = ison_to_json(text);
+    ASSERT_EQ(json, parse(text).to_json());
+    ASSERT(json.find("\"name\": \"Al \\\"x\\\"\"") != std::string::npos);
+    ASSERT(json.find("\"ref\": \":user:2\"") != std::string::npos);
+
+    std::istringstream in(text);
+    std::ostringstream out;
+    ison_to_json(in, out, 0);
+    ASSERT_EQ(out.str(), ison_to_json(text, 0));
+}
+
+TEST(transcode_json_round_trip) {
+    auto doc = parse(R"(table.users
+id name team score
+1 "Alice Smith" :team:7 1.5
+2 Bob null 2.0
+
+object.config
+mode
+"12"
+)");
+    std::string back = json_to_ison(doc.to_json());
+    auto round = parse(back);
+    ASSERT_EQ(round.blocks.size(), 2u);
+    ASSERT_EQ(as_string(round["users"][0].at("name")), "Alice Smith");
+    ASSERT_EQ(as_reference(round["users"][0].at("team")).type.value(), "team");
+    ASSERT(round["users"][1].at("score").is_float());
+    ASSERT(round["config"][0].at("mode").is_string());
+
+    std::istringstream in(doc.to_json());
+    std::ostringstream out;
+    json_to_ison(in, out);
+    ASSERT_EQ(out.str(), back);
+}
+
+TEST(transcode_json_layouts_and_errors) {
+    std::string text = json_to_ison(
+        R"({"a": [{"x": 1e3, "y": [1, {"z": "q"}], "u": "é"}, {"u": "k"}], "o": {"q": -0.5}, "e": []})");
+    ASSERT_EQ(text,
+        "table.a\nx y u\n1000.0 \"[1,{\\\"z\\\":\\\"q\\\"}]\" \xc3\xa9\nnull null k\n\n"
+        "object.o\nq\n-0.5");
+
+    bool threw = false;
+    try {
+        json_to_ison("{\"a\": [{\"x\": 1},\n {\"y\": 2}]}");
+    } catch (const ISONSyntaxError& e) {
+        threw = true;
+        ASSERT_EQ(e.line, 2);
+    }
+    ASSERT(threw);
+
+    threw = false;
+    try {
+        json_to_ison("{\"a\": 5}");
+    } catch (const ISONSyntaxError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+}
+
+// True if json_to_ison() rejects the text with a message containing reason
+static bool json_rejected(const std::string& json, const char* reason) {
+    try {
+        json_to_ison(json);
+    } catch (const ISONSyntaxError& e) {
+        return std::string(e.what()).find(reason) != std::string::npos;
+    }
+    return false;
+}
+
+TEST(transcode_json_rejects_malformed) {
+    // Nested values are copied as text, but their brackets must still match
+    ASSERT(json_rejected("{\"t\": [{\"a\": {\"x\": 1]}]}", "Mismatched bracket"));
+    ASSERT(json_rejected("{\"t\": [{\"a\": [1}}]}", "Mismatched bracket"));
+    ASSERT_EQ(json_to_ison("{\"t\": [{\"a\": [{\"x\": [1]}]}]}"), "table.t\na\n\"[{\\\"x\\\":[1]}]\"");
+
+    // Surrogates must come in high-low pairs
+    ASSERT(json_rejected("{\"t\": [{\"s\": \"\\udc00\"}]}", "Unpaired surrogate"));
+    ASSERT(json_rejected("{\"t\": [{\"s\": \"a\\ude00\\ud83d\"}]}", "Unpaired surrogate"));
+    ASSERT(json_rejected("{\"t\": [{\"s\": \"\\ud83dx\"}]}", "Unpaired surrogate"));
+    ASSERT_EQ(json_to_ison("{\"t\": [{\"s\": \"\\ud83d\\ude00\"}]}"), "table.t\ns\n\xf0\x9f\x98\x80");
+
+    // Numbers follow the JSON grammar instead of whatever parse_number() takes
+    const char* bad_numbers[] = {"01", "-01", "1.", "-", "1.e3", "1e", "1e+", "--1", "1-2", "0x1", "1.5.2"};
+    for (size_t i = 0; i < sizeof(bad_numbers) / sizeof(bad_numbers[0]); ++i) {
+        ASSERT(json_rejected(std::string("{\"o\": {\"n\": ") + bad_numbers[i] + "}}", "JSON:"));
+    }
+    ASSERT_EQ(json_to_ison("{\"t\": [{\"a\": 0, \"b\": -0.5, \"c\": 1E+2, \"d\": -12e-1, \"e\": 10}]}"),
+              "table.t\na b c d e\n0 -0.5 100.0 -1.2 10");
+}
+
+TEST(transcode_ison_to_isonl) {
+    std::string text = "table.users\nid name\n1 Alice\n2 \"B|ob\"\n\nobject.cfg\nk\nv\n";
+    std::string isonl = ison_to_isonl(text);
+    ASSERT_EQ(isonl, dumps_isonl(parse(text)));
+
+    std::istringstream in(text);
+    std::ostringstream out;
+    ison_to_isonl(in, out);
+    ASSERT_EQ(out.str(), isonl + "\n");
+}
+
+// =============================================================================
+// Binary Format Tests
+// =============================================================================
+
+TEST(binary_round_trip) {
+    std::string text = "table.users\nid:int name:string team score mixed\n";
+    for (int i = 0; i < 300; ++i) {
+        text += std::to_string(i) + " \"user " + std::to_string(i % 7) + "\" " +
+                (i % 5 ? ":team:" + std::to_string(i % 3) : std::string("null")) + " " +
+                std::to_string(i * 0.1) + " " + (i % 2 ? "x" : "1") + "\n";
+    }
+    text += "---\nsummary\n\nobject.config\nempty quoted none\n\"\" \"a\\nb\" null\n";
+    auto doc = parse(text);
+    std::string expected = dumps(doc);
+
+    for (int mode = 0; mode < 4; ++mode) {
+        BinaryOptions options;
+        options.dictionary = (mode & 1) != 0;
+        options.compress = (mode & 2) != 0;
+        std::string bin = dumps_binary(doc, options);
+        ASSERT(bin.size() < text.size());
+        ASSERT_EQ(dumps(loads_binary(bin)), expected);
+
+        ColumnarDocument columns = loads_binary_columnar(bin);
+        ASSERT(columns["users"].column("id").type() == ColumnType::Int);
+        ASSERT(columns["users"].column("mixed").type() == ColumnType::Mixed);
+        ASSERT(columns["config"].column("none").is_null(0));
+        ASSERT_EQ(columns["users"].field_info[0].type.value(), "int");
+        ASSERT(columns["users"].get(3, 3).as_float() == 0.3);
+    }
+}
+
+TEST(binary_rejects_corrupt_input) {
+    auto doc = parse("table.t\nid name\n1 a\n2 b\n");
+    std::string bin = dumps_binary(doc);
+    ASSERT_EQ(dumps(loads_binary(bin)), dumps(doc));
+
+    int errors = 0;
+    std::string bad_magic = "X" + bin.substr(1);
+    std::vector<std::string> inputs = {"", bad_magic, bin.substr(0, bin.size() - 1), bin + "x"};
+    for (const std::string& input : inputs) {
+        try {
+            loads_binary(input);
+        } catch (const ISONError&) {
+            ++errors;
+        }
+    }
+    ASSERT_EQ(errors, 4);
+}
+
+TEST(lz_codec_round_trip) {
+    std::string text;
+    for (int i = 0; i < 2000; ++i) text += "row " + std::to_string(i % 40) + " value;";
+    std::string packed;
+    detail::lz_compress(text.data(), text.size(), packed);
+    ASSERT(packed.size() < text.size() / 4);
+    std::string unpacked;
+    detail::lz_decompress(packed.data(), packed.size(), unpacked, text.size());
+    ASSERT_EQ(unpacked, text);
+
+    std::string tiny;
+    detail::lz_compress("abc", 3, tiny);
+    std::string out;
+    detail::lz_decompress(tiny.data(), tiny.size(), out, 3);
+    ASSERT_EQ(out, "abc");
+
+    // A dictionary as history: matches may reach back into it
+    std::string dictionary = "table.logs|id level msg|\n";
+    std::string line = "table.logs|id level msg|1 info ok\n";
+    std::string window = dictionary + line;
+    std::string with_history;
+    detail::lz_compress(window.data() + dictionary.size(), line.size(), with_history, dictionary.size());
+    std::string without;
+    detail::lz_compress(line.data(), line.size(), without);
+    ASSERT(with_history.size() < without.size());
+    std::string restored = dictionary;
+    detail::lz_decompress(with_history.data(), with_history.size(), restored, line.size(), dictionary.size());
+    ASSERT_EQ(restored, window);
+}
+
+// =============================================================================
+// Type Hint Tests
+// =============================================================================
+
+TEST(type_hints_select_decoders) {
+    std::string text = "table.items\nid:int code:string price:float active:bool owner:ref note\n"
+                       "1 007 5 true :user:1 12\n"
+                       "2 true 2.5 false null ~\n";
+    ParseOptions options;
+    options.type_hints = TypeHintMode::Strict;
+
+    auto doc = parse(text, options);
+    const Row& first = doc["items"][0];
+    ASSERT(first.at("id").is_int());
+    ASSERT_EQ(as_string(first.at("code")), "007");
+    ASSERT(first.at("price").is_float());
+    ASSERT(first.at("price").as_float() == 5.0);
+    ASSERT(first.at("active").as_bool());
+    ASSERT_EQ(as_reference(first.at("owner")).id, "1");
+    ASSERT(first.at("note").is_int());  // untyped: inferred
+    ASSERT_EQ(as_string(doc["items"][1].at("code")), "true");
+    ASSERT(doc["items"][1].at("owner").is_null());
+
+    auto columns = parse_columnar(text, options);
+    ASSERT(columns["items"].column("code").type() == ColumnType::String);
+    ASSERT(columns["items"].column("price").type() == ColumnType::Float);
+    ASSERT_EQ(dumps(columns), dumps(doc));
+
+    // Without hints the same text infers numbers and booleans
+    ASSERT(parse(text)["items"][0].at("code").is_int());
+}
+
+TEST(type_hints_mismatch) {
+    std::string text = "table.t\nid:int name\n1 a\nx2 b\n";
+    ParseOptions options;
+    options.type_hints = TypeHintMode::Fallback;
+    auto doc = parse(text, options);
+    ASSERT_EQ(as_string(doc["t"][1].at("id")), "x2");
+
+    options.type_hints = TypeHintMode::Strict;
+    bool threw = false;
+    try {
+        parse(text, options);
+    } catch (const ISONSyntaxError& e) {
+        threw = true;
+        ASSERT_EQ(e.line, 4);
+        ASSERT_EQ(e.col, 0);
+        ASSERT(std::string(e.what()).find("expects int") != std::string::npos);
+    }
+    ASSERT(threw);
+
+    threw = false;
+    try {
+        parse_columnar("table.t\nflag:bool\n\"true\"\n", options);
+    } catch (const ISONSyntaxError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+}
+
+TEST(type_hints_parallel) {
+    std::string text = "table.t\nid:int code:string\n";
+    for (int i = 0; i < 3000; ++i) text += std::to_string(i) + " " + std::to_string(i * 7) + "\n";
+    ParseOptions options;
+    options.type_hints = TypeHintMode::Strict;
+    auto sequential = parse(text, options);
+    auto parallel = parse_parallel(text, 4, options);
+    ASSERT_EQ(dumps(parallel), dumps(sequential));
+    ASSERT(parallel["t"][2999].at("code").is_string());
+}
+
+// =============================================================================
+// Struct Binding Tests
+// =============================================================================
+
+namespace bound {
+
+struct User {
+    int64_t id;
+    std::string name;
+    Optional<std::string> email;
+    bool active;
+    double score;
+    Reference team;
+    uint8_t level;
+};
+
+ISON_BIND(User, id, name, email, active, score, team, level)
+
+struct Counter {
+    uint64_t hits;
+    uint32_t small;
+};
+
+ISON_BIND(Counter, hits, small)
+
+} // namespace bound
+
+TEST(bind_parse_into_structs) {
+    std::string text = "table.users\nname id:int active email score team level\n"
+                       "\"Alice Smith\" 1 true alice@example.com 1.5 :team:1 3\n"
+                       "Bob 2 false null 2 :9 255\n";
+    std::vector<bound::User> users = parse_into<std::vector<bound::User> >(text);
+    ASSERT_EQ(users.size(), 2u);
+    ASSERT_EQ(users[0].id, 1);
+    ASSERT_EQ(users[0].name, "Alice Smith");
+    ASSERT_EQ(users[0].email.value(), "alice@example.com");
+    ASSERT(users[0].active);
+    ASSERT(users[0].score == 1.5);
+    ASSERT_EQ(users[0].team.type.value(), "team");
+    ASSERT_EQ(users[0].team.id, "1");
+    ASSERT(!users[1].email.has_value());
+    ASSERT(users[1].score == 2.0);
+    ASSERT_EQ(users[1].level, 255);
+
+    // Missing columns keep their default; extra columns are ignored
+    users = parse_into<std::vector<bound::User> >("table.a\nid\n1\n\ntable.u\nextra id\nx 7\n", "u");
+    ASSERT_EQ(users.size(), 1u);
+    ASSERT_EQ(users[0].id, 7);
+    ASSERT(users[0].name.empty());
+    ASSERT(!users[0].active);
+}
+
+TEST(bind_round_trip) {
+    std::vector<bound::User> users(2);
+    users[0].id = 10;
+    users[0].name = "null";
+    users[0].email = std::string("a b");
+    users[0].score = 0.1;
+    users[0].team.id = "5";
+    users[1].id = -3;
+    users[1].active = true;
+    users[1].team.id = "6";
+
+    std::string text = dumps_from(users, "users");
+    ASSERT(text.find("id:int name:string email:string active:bool score:float team:ref level:int") !=
+           std::string::npos);
+    std::vector<bound::User> again = parse_into<std::vector<bound::User> >(text);
+    ASSERT_EQ(again.size(), 2u);
+    ASSERT_EQ(again[0].name, "null");
+    ASSERT_EQ(again[0].email.value(), "a b");
+    ASSERT(again[0].score == 0.1);
+    ASSERT_EQ(again[0].team.id, "5");
+    ASSERT_EQ(again[1].id, -3);
+    ASSERT(again[1].active);
+
+    // The same text through the dynamic parser, with the header's type hints
+    ParseOptions options;
+    options.type_hints = TypeHintMode::Strict;
+    ASSERT_EQ(as_string(parse(text, options)["users"][0].at("name")), "null");
+}
+
+TEST(bind_unsigned_full_range) {
+    std::vector<bound::Counter> counters(3);
+    counters[0].hits = std::numeric_limits<uint64_t>::max();
+    counters[0].small = std::numeric_limits<uint32_t>::max();
+    counters[1].hits = static_cast<uint64_t>(INT64_MAX) + 1;
+    counters[1].small = 0;
+    counters[2].hits = 0;
+    counters[2].small = 7;
+
+    std::string text = dumps_from(counters, "counters");
+    ASSERT(text.find("18446744073709551615") != std::string::npos);
+    std::vector<bound::Counter> again = parse_into<std::vector<bound::Counter> >(text);
+    ASSERT_EQ(again.size(), 3u);
+    ASSERT(again[0].hits == std::numeric_limits<uint64_t>::max());
+    ASSERT(again[0].small == std::numeric_limits<uint32_t>::max());
+    ASSERT(again[1].hits == static_cast<uint64_t>(INT64_MAX) + 1);
+    ASSERT(again[2].hits == 0u);
+    ASSERT(again[2].small == 7u);
+
+    // Negative, fractional and out-of-range values still do not fit
+    const char* bad[] = {"-1 0", "1.5 0", "18446744073709551616 0", "0 4294967296"};
+    for (size_t i = 0; i < 4; ++i) {
+        bool threw = false;
+        try {
+            parse_into<std::vector<bound::Counter> >(std::string("table.c\nhits small\n") + bad[i] + "\n");
+        } catch (const ISONSyntaxError&) {
+            threw = true;
+        }
+        ASSERT(threw);
+    }
+}
+
+TEST(bind_mismatch_errors) {
+    bool threw = false;
+    try {
+        parse_into<std::vector<bound::User> >("table.u\nid level\n1 2\n1 256\n");
+    } catch (const ISONSyntaxError& e) {
+        threw = true;
+        ASSERT_EQ(e.line, 4);
+        ASSERT_EQ(e.col, 2);
+        ASSERT(std::string(e.what()).find("Field 'level' expects int") != std::string::npos);
+    }
+    ASSERT(threw);
+
+    threw = false;
+    try {
+        parse_into<std::vector<bound::User> >("table.u\nactive\nyes\n");
+    } catch (const ISONSyntaxError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    threw = false;
+    try {
+        parse_into<std::vector<bound::User> >("table.u\nid\n1\n", "missing");
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+}
+
+// =============================================================================
+// Lazy Document Tests
+// =============================================================================
+
+TEST(lazy_decodes_on_access) {
+    std::string text = "table.users\nid name\n1 Alice\n2 Bob\n3 \"Carol Jones\"\n\n"
+                       "object.config\nkey value\ndebug true\n---\nsummary here\n";
+    LazyDocument lazy = parse_lazy(text);
+    ASSERT_EQ(lazy.size(), 2u);
+    ASSERT(lazy.has("config"));
+    ASSERT_EQ(lazy["users"].size(), 3u);
+    ASSERT_EQ(lazy["users"].fields()[1], "name");
+    ASSERT_EQ(lazy["config"].summary().value(), "summary here");
+    ASSERT_EQ(lazy["users"].decoded_count(), 0u);
+
+    ASSERT_EQ(as_string(lazy["users"][2].at("name")), "Carol Jones");
+    ASSERT_EQ(lazy["users"].decoded_count(), 1u);
+    ASSERT(lazy["users"].is_decoded(2));
+    ASSERT(!lazy["users"].is_decoded(0));
+    const Row* first = &lazy["users"].row(2);
+    ASSERT(first == &lazy["users"].row(2));  // cached
+
+    ASSERT_EQ(dumps(lazy.to_document()), dumps(parse(text)));
+
+    ParseOptions options;
+    options.cache_rows = false;
+    LazyDocument uncached = parse_lazy(text.data(), text.size(), options);
+    ASSERT_EQ(as_int(uncached["users"][0].at("id")), 1);
+    ASSERT_EQ(uncached["users"].decoded_count(), 0u);
+}
+
+TEST(lazy_errors_and_files) {
+    // Structural errors are found by the index pass
+    bool threw = false;
+    try {
+        parse_lazy("table.users\n");
+    } catch (const ISONSyntaxError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    // Value errors only surface for the rows that are read
+    ParseOptions options;
+    options.type_hints = TypeHintMode::Strict;
+    LazyDocument lazy = parse_lazy("table.t\nid:int\n1\nx\n", options);
+    ASSERT_EQ(as_int(lazy["t"][0].at("id")), 1);
+    threw = false;
+    try {
+        lazy["t"].row(1);
+    } catch (const ISONSyntaxError& e) {
+        threw = true;
+        ASSERT_EQ(e.line, 4);
+    }
+    ASSERT(threw);
+
+    threw = false;
+    try {
+        lazy["t"].row(5);
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    const std::string path = "test_load_lazy.ison";
+    write_file(path, "table.users\nid name\n1 Alice\n2 Bob\n");
+    {
+        LazyDocument mapped = load_lazy(path);
+        ASSERT_EQ(as_string(mapped["users"][1].at("name")), "Bob");
+    }
+    std::remove(path.c_str());
+}
+
+// =============================================================================
+// Parse Filter Tests
+// =============================================================================
+
+static const char* FILTER_TEXT =
+    "table.users\nid name status score\n"
+    "1 Alice active 10\n2 Bob idle 20\n3 \"Carol\" active 30.5\n4 Dan \"active\"\n\n"
+    "table.orders\nid user\n1 :user:1\n";
+
+TEST(filter_blocks_and_columns) {
+    ParseOptions options;
+    options.filter.keep_block("users").select("users", {"name", "missing", "id"});
+    auto doc = parse(FILTER_TEXT, options);
+    ASSERT_EQ(doc.size(), 1u);
+    ASSERT(!doc.has("orders"));
+    ASSERT_EQ(doc["users"].fields.size(), 2u);
+    ASSERT_EQ(doc["users"].fields[0], "name");
+    ASSERT_EQ(doc["users"].field_info[1].name, "id");
+    ASSERT_EQ(doc["users"].size(), 4u);
+    ASSERT_EQ(doc["users"][0].size(), 2u);
+    ASSERT_EQ(as_int(doc["users"][3].at("id")), 4);
+
+    auto columns = parse_columnar(FILTER_TEXT, options);
+    ASSERT_EQ(columns.blocks.size(), 1u);
+    ASSERT_EQ(dumps(columns), dumps(doc));
+}
+
+TEST(filter_row_predicates) {
+    ParseOptions options;
+    options.filter.where_equal("users", "status", Value("active"));
+    auto doc = parse(FILTER_TEXT, options);
+    ASSERT_EQ(doc["users"].size(), 3u);
+    ASSERT_EQ(as_string(doc["users"][1].at("name")), "Carol");
+    ASSERT_EQ(doc["orders"].size(), 1u);  // the predicate names another block
+
+    options.filter.where_range("users", "score", Value(15), Value());
+    doc = parse(FILTER_TEXT, options);
+    ASSERT_EQ(doc["users"].size(), 1u);
+    ASSERT(doc["users"][0].at("score").as_float() == 30.5);
+
+    ParseOptions any_block;
+    any_block.filter.where_not_equal("", "id", Value(1)).where_range("", "id", Value(), Value(3.0));
+    doc = parse(FILTER_TEXT, any_block);
+    ASSERT_EQ(doc["users"].size(), 2u);
+    ASSERT_EQ(doc["orders"].size(), 0u);
+
+    // Predicates see hinted values, and strict mismatches still throw
+    ParseOptions hinted;
+    hinted.type_hints = TypeHintMode::Strict;
+    hinted.filter.where_equal("t", "code", Value("007"));
+    ASSERT_EQ(parse("table.t\ncode:string\n007\n7\n", hinted)["t"].size(), 1u);
+    bool threw = false;
+    try {
+        hinted.filter.where_equal("t", "n", Value(1));
+        parse("table.t\ncode:string n:int\n007 x\n", hinted);
+    } catch (const ISONSyntaxError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+}
+
+TEST(filter_parallel_matches_sequential) {
+    std::string text = "table.t\nid kind payload\n";
+    for (int i = 0; i < 3000; ++i) {
+        text += std::to_string(i) + (i % 3 == 0 ? " a " : " b ") + "\"p" + std::to_string(i) + "\"\n";
+    }
+    text += "\ntable.skip\nx\n1\n";
+    ParseOptions options;
+    options.filter.keep_block("t").select("t", {"id"}).where_equal("t", "kind", Value("a"));
+    auto sequential = parse(text, options);
+    auto parallel = parse_parallel(text, 4, options);
+    ASSERT_EQ(sequential["t"].size(), 1000u);
+    ASSERT_EQ(dumps(parallel), dumps(sequential));
+}
+
+// =============================================================================
+// Instrumentation Tests
+// =============================================================================
+
+TEST(stats_parse_counts) {
+    std::string text = "table.users\nid name:string team\n1 \"Alice\" :team:1\n2 Bob :team:2\n3 \"Cy\" ~\n"
+                       "\ntable.skip\nx\n1\n2\n";
+    ParseStats stats;
+    ParseOptions options;
+    options.stats = &stats;
+    options.type_hints = TypeHintMode::Strict;
+    auto doc = parse(text, options);
+    ParseOptions plain;
+    plain.type_hints = TypeHintMode::Strict;
+    ASSERT_EQ(dumps(doc), dumps(parse(text, plain)));
+
+    ASSERT_EQ(stats.bytes, text.size());
+    ASSERT_EQ(stats.lines, 10u);
+    ASSERT_EQ(stats.rows, 5u);
+    ASSERT_EQ(stats.tokens, 11u);
+    ASSERT_EQ(stats.quoted_tokens, 2u);
+    ASSERT(std::fabs(stats.quoted_ratio() - 2.0 / 11.0) < 1e-12);
+    // 11 row entries + 3 names + 2 references
+    ASSERT_EQ(stats.allocations, 16u);
+    ASSERT_EQ(stats.blocks.size(), 2u);
+    ASSERT_EQ(stats.blocks[0].name, "users");
+    ASSERT_EQ(stats.blocks[0].rows, 3u);
+    ASSERT_EQ(stats.blocks[1].rows, 2u);
+
+    // Filtered rows and skipped blocks are counted, not kept
+    stats.clear();
+    options.filter.keep_block("users").where_equal("users", "id", Value(int64_t(2)));
+    doc = parse(text, options);
+    ASSERT_EQ(doc.size(), 1u);
+    ASSERT_EQ(doc["users"].size(), 1u);
+    ASSERT_EQ(stats.rows, 1u);
+    ASSERT_EQ(stats.blocks[0].skipped_rows, 2u);
+    ASSERT_EQ(stats.blocks[1].skipped_rows, 2u);
+
+    // Columnar parses count rows and blocks too
+    stats.clear();
+    options.filter = ParseFilter();
+    auto columns = parse_columnar(text, options);
+    ASSERT_EQ(columns["users"].size(), 3u);
+    ASSERT_EQ(stats.rows, 5u);
+    ASSERT_EQ(stats.allocations, 0u);
+}
+
+TEST(stats_isonl_and_serializer) {
+    std::string isonl = "table.a|id v|1 \"x\"\ntable.b|k|:r:1\n\ntable.a|id v|2 y\n";
+    ParseStats stats;
+    auto doc = ISONLParser(&stats).parse_to_document(isonl);
+    ASSERT_EQ(dumps(doc), dumps(loads_isonl(isonl)));
+    ASSERT_EQ(stats.bytes, isonl.size());
+    ASSERT_EQ(stats.lines, 4u);
+    ASSERT_EQ(stats.rows, 3u);
+    ASSERT_EQ(stats.tokens, 5u);
+    ASSERT_EQ(stats.quoted_tokens, 1u);
+    ASSERT_EQ(stats.blocks.size(), 2u);
+    ASSERT_EQ(stats.blocks[0].rows, 2u);
+    ASSERT_EQ(stats.blocks[1].rows, 1u);
+
+    SerializeStats out;
+    std::string text = Serializer::dumps(doc, false, out);
+    ASSERT_EQ(text, Serializer::dumps(doc, false));
+    ASSERT_EQ(out.bytes, text.size());
+    ASSERT_EQ(out.blocks, 2u);
+    ASSERT_EQ(out.rows, 3u);
+    ASSERT_EQ(out.cells, 5u);
+}
+
+// =============================================================================
+// Segmented ISONL Tests
+// =============================================================================
+
+static std::string segment_corpus() {
+    std::string text = "# archive\n";
+    for (int i = 0; i < 600; ++i) {
+        text += "table.logs|id level msg|" + std::to_string(i) + (i % 3 ? " info" : " warn") +
+                " \"handled | request " + std::to_string(i % 7) + "\"\n";
+        if (i % 100 == 0) text += "table.audit|id who|" + std::to_string(i) + " :user:" + std::to_string(i % 5) + "\n";
+    }
+    return text;
+}
+
+TEST(segmented_isonl_round_trip) {
+    std::string text = segment_corpus();
+    SegmentOptions options;
+    options.segment_size = 4096;
+    options.threads = 3;
+    std::string archive = compress_isonl(text, options);
+    ASSERT(archive.size() < text.size() / 3);
+
+    SegmentedISONL reader(archive);
+    ASSERT(reader.segment_count() > 4);
+    ASSERT_EQ(dumps(reader.read_all(4)), dumps(loads_isonl(text)));
+    std::string joined;
+    for (size_t i = 0; i < reader.segment_count(); ++i) joined += reader.segment_text(i);
+    ASSERT_EQ(joined, text);
+
+    // The footer says which segments hold a block and which rows they hold
+    std::vector<size_t> audit_segments = reader.segments_with("audit");
+    ASSERT_EQ(audit_segments.size(), 6u);
+    auto audit = reader.read_block("audit");
+    ASSERT_EQ(audit.size(), 1u);
+    ASSERT_EQ(audit["audit"].size(), 6u);
+    ASSERT_EQ(audit["audit"].rows[5].at("who").get_reference()->to_ison(), ":user:0");
+
+    const SegmentBlock* logs = reader.segment(1).block("logs");
+    ASSERT(logs != NULL);
+    ASSERT(logs->first_row > 0);
+    Block rows = reader.read_rows("logs", 250, 5);
+    ASSERT_EQ(rows.size(), 5u);
+    ASSERT_EQ(rows.rows[0].at("id").as_int(), 250);
+    ASSERT_EQ(as_string(rows.rows[4].at("msg")), "handled | request 2");
+    ASSERT_EQ(reader.read_rows("logs", 598, 10).size(), 2u);
+    // Counts past the end read to the end, without wrapping
+    Block tail = reader.read_rows("logs", 595, std::numeric_limits<uint64_t>::max());
+    ASSERT_EQ(tail.size(), 5u);
+    ASSERT_EQ(tail.rows[0].at("id").as_int(), 595);
+    ASSERT_EQ(reader.read_rows("logs", 0, std::numeric_limits<uint64_t>::max()).size(), 600u);
+    ASSERT_EQ(reader.read_rows("logs", std::numeric_limits<uint64_t>::max(), 10).size(), 0u);
+    ASSERT_EQ(reader.read_rows("missing", 0, 10).size(), 0u);
+
+    // Uncompressed, from a Document and from a file
+    options.compress = false;
+    SegmentedISONL stored(compress_isonl(text, options));
+    ASSERT(!stored.segment(0).compressed);
+    ASSERT_EQ(dumps(stored.read_all()), dumps(loads_isonl(text)));
+
+    const std::string path = "test_segmented.isonlz";
+    write_file(path, dumps_isonl_segmented(loads_isonl(text)));
+    {
+        SegmentedISONL mapped = load_isonl_segmented(path);
+        ASSERT_EQ(mapped.read_block("audit")["audit"].size(), 6u);
+    }
+    std::remove(path.c_str());
+
+    ASSERT_EQ(SegmentedISONL(compress_isonl("")).segment_count(), 0u);
+}
+
+TEST(segmented_isonl_errors) {
+    std::string text = segment_corpus();
+    SegmentOptions options;
+    options.segment_size = 4096;
+    std::string archive = compress_isonl(text, options);
+
+    bool threw = false;
+    try {
+        SegmentedISONL(archive.substr(0, archive.size() - 1));
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    std::string corrupt = archive;
+    corrupt[6] = static_cast<char>(corrupt[6] ^ 0x7F);
+    threw = false;
+    try {
+        SegmentedISONL(corrupt).read_all(1);
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    threw = false;
+    try {
+        compress_isonl("table.logs|id|1\ntable.logs|id\n");
+    } catch (const ISONSyntaxError& e) {
+        threw = std::string(e.what()).find("Line 2") != std::string::npos;
+    }
+    ASSERT(threw);
+
+    // Parse errors keep the line numbers of the whole archive
+    std::string bad = text + "table.logs|id level msg|1 \"unterminated\n";
+    threw = false;
+    try {
+        SegmentedISONL(compress_isonl(bad, options)).read_all(1);
+    } catch (const ISONSyntaxError& e) {
+        threw = std::string(e.what()).find("Line 608") != std::string::npos;
+    }
+    ASSERT(threw);
+}
+
+// =============================================================================
+// Incremental Parsing and Diff Tests
+// =============================================================================
+
+static const char* incremental_text =
+    "table.users\n"
+    "id:int name email\n"
+    "1 Alice alice@x.com\n"
+    "2 Bob bob@x.com\n"
+    "# comment\n"
+    "3 Carol carol@x.com\n"
+    "\n"
+    "object.config\n"
+    "key value\n"
+    "debug true\n";
+
+TEST(incremental_edits_match_full_parse) {
+    IncrementalDocument doc(incremental_text);
+    std::string text = incremental_text;
+
+    // A row edit only re-reads that row's line
+    size_t pos = text.find("Bob");
+    DocumentDiff diff = doc.edit(pos, 3, "Robert");
+    ASSERT_EQ(doc.reparsed_bytes(), std::string("2 Robert bob@x.com").size());
+    ASSERT_EQ(diff.blocks.size(), 1u);
+    ASSERT_EQ(diff.blocks[0].changed.size(), 1u);
+    ASSERT_EQ(diff.blocks[0].changed[0].first, 1u);
+    ASSERT_EQ(doc.document()["users"][1].at("name").as_string(), "Robert");
+
+    // Inserting a line adds a row
+    pos = doc.text().find("# comment");
+    diff = doc.edit(pos, 0, "4 Dana dana@x.com\n");
+    ASSERT_EQ(diff.blocks[0].added.size(), 1u);
+    ASSERT_EQ(diff.blocks[0].added[0].first, 2u);
+    ASSERT_EQ(doc.document()["users"].size(), 4u);
+    ASSERT_EQ(doc.document()["users"][3].at("id").as_int(), 3);
+
+    // Structural edits re-parse blocks: drop the separator and add a block
+    text = doc.text();
+    text.replace(text.find("\nobject.config"), 1, "");
+    text += "\ntable.tags\nname\nred\n";
+    diff = doc.update(text);
+    ASSERT_EQ(doc.text(), text);
+    ASSERT_EQ(Serializer::dumps(doc.document(), false), Serializer::dumps(parse(text), false));
+    ASSERT(doc.document().has("tags"));
+    ASSERT_EQ(diff.added_blocks.size(), 1u);
+
+    // A bad edit throws and leaves the document as it was
+    std::string before = doc.text();
+    bool threw = false;
+    try {
+        doc.edit(doc.text().find("red"), 0, "\"");
+    } catch (const ISONSyntaxError& e) {
+        threw = std::string(e.what()).find("Line 14") != std::string::npos;
+    }
+    ASSERT(threw);
+    ASSERT_EQ(doc.text(), before);
+    ASSERT_EQ(doc.document()["tags"][0].at("name").as_string(), "red");
+
+    // Random edits always agree with a full parse
+    unsigned seed = 7;
+    const char* pieces[] = {"\n", "x", " ", "5 Eve e@x\n", "table.new\na b\n", "---\n", "#c\n", "7", ":3"};
+    for (int step = 0; step < 300; ++step) {
+        seed = seed * 1103515245u + 12345u;
+        size_t offset = (seed >> 8) % (doc.text().size() + 1);
+        size_t removed = std::min<size_t>((seed >> 4) % 4, doc.text().size() - offset);
+        std::string next = doc.text();
+        next.replace(offset, removed, pieces[(seed >> 16) % 9]);
+        Document full;
+        try {
+            full = parse(next);
+        } catch (const ISONError&) {
+            continue;
+        }
+        Document previous = doc.document();
+        diff = doc.update(next);
+        ASSERT_EQ(Serializer::dumps(doc.document(), false), Serializer::dumps(full, false));
+        apply_diff(previous, diff);
+        ASSERT_EQ(Serializer::dumps(previous, false), Serializer::dumps(full, false));
+    }
+}
+
+TEST(document_diff_round_trip) {
+    Document before = parse(incremental_text);
+    std::string text = incremental_text;
+    text.replace(text.find("2 Bob"), 5, "2 \"Bob B\"");
+    text.replace(text.find("# comment\n"), 10, "");
+    text.replace(text.find("3 Carol carol@x.com\n"), 20, "");
+    text = "table.tags\nname\n\"~\"\n\n" + text + "---\nsettings\n";
+    Document after = parse(text);
+
+    DocumentDiff changes = diff(before, after);
+    ASSERT_EQ(changes.added_blocks.size(), 1u);
+    ASSERT_EQ(changes.added_blocks[0].first, 0u);
+    ASSERT_EQ(changes.blocks.size(), 2u);
+    ASSERT_EQ(changes.blocks[0].changed.size(), 1u);
+    ASSERT_EQ(changes.blocks[0].removed.size(), 1u);
+    ASSERT_EQ(changes.blocks[0].removed[0], 2u);
+    ASSERT(changes.blocks[1].summary_changed);
+
+    std::string patch = changes.dumps();
+    ASSERT(patch.find("- 2 1") != std::string::npos);
+    Document patched = before;
+    apply_diff(patched, DocumentDiff::loads(patch));
+    ASSERT_EQ(Serializer::dumps(patched, false), Serializer::dumps(after, false));
+    ASSERT(patched["tags"][0]["name"].is_string());
+    ASSERT(diff(after, patched).empty());
+
+    // A changed schema replaces the block
+    Document retyped = parse("table.users\nid name\n1 Alice\n");
+    changes = diff(before, retyped);
+    ASSERT_EQ(changes.removed_blocks.size(), 2u);
+    ASSERT_EQ(changes.added_blocks.size(), 1u);
+
+    // Diffs check that they fit before changing anything
+    Document other = parse("table.users\nid:int name email\n1 A a\n");
+    bool threw = false;
+    try {
+        apply_diff(other, diff(before, after));
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+    ASSERT_EQ(other.blocks.size(), 1u);
+
+    threw = false;
+    try {
+        DocumentDiff::loads("@block 0 table.users\n= x 1\n");
+    } catch (const ISONSyntaxError& e) {
+        threw = std::string(e.what()).find("Line 2") != std::string::npos;
+    }
+    ASSERT(threw);
+}
+
+// =============================================================================
+// Asynchronous I/O Tests
+// =============================================================================
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+struct FailingSource : public ChunkSource {
+    size_t calls;
+    FailingSource() : calls(0) {}
+    size_t read(char* buffer, size_t capacity) {
+        if (++calls > 2) throw ISONError("source failed");
+        std::memset(buffer, '\n', capacity);
+        return capacity;
+    }
+};
+
+struct FailingSink : public Sink {
+    void write(const char*, size_t) { throw ISONError("sink failed"); }
+};
+
+TEST(async_load_dump_match_blocking) {
+    std::string ison = "# orders\r\ntable.users\r\nid:int name\r\n";
+    for (int i = 0; i < 300; ++i) {
+        ison += std::to_string(i) + " \"user " + std::to_string(i) + "\"\r\n";
+    }
+    ison += "---\r\n300 users\r\n\r\nobject.config\r\nkey value\r\nmode fast\r\n\r\ntable.orders\r\nid user\r\n1 :user:7";
+    const std::string path = "test_async.ison";
+    const std::string out_path = "test_async_out.ison";
+    write_file(path, ison);
+
+    // Tiny chunks split lines (and CR/LF pairs) between chunks
+    AsyncOptions async;
+    async.chunk_size = 7;
+    async.write_buffer = 100;
+    Document expected = load(path);
+    ASSERT_EQ(dumps(load(path, ParseOptions(), async)), dumps(expected));
+    ASSERT_EQ(dumps(load_async(path, ParseOptions(), async).get()), dumps(expected));
+
+    CollectingVisitor visitor;
+    load_stream(path, visitor, async);
+    ASSERT_EQ(dumps(visitor.doc), dumps(expected));
+
+    dump(expected, out_path);
+    std::string blocking = read_file(out_path);
+    async.sync = true;
+    dump(expected, out_path, true, async);
+    ASSERT_EQ(read_file(out_path), blocking);
+    std::remove(out_path.c_str());
+    dump_async(expected, out_path, true, async).get();
+    ASSERT_EQ(read_file(out_path), blocking);
+
+    dump_isonl(expected, out_path, async);
+    ASSERT_EQ(read_file(out_path), dumps_isonl(expected) + "\n");
+    ASSERT_EQ(dumps(load_isonl(out_path, async)), dumps(load_isonl(out_path)));
+
+    ison_to_isonl_file(path, out_path, async);
+    ASSERT_EQ(read_file(out_path), ison_to_isonl(ison) + "\n");
+    ison_to_json_file(path, out_path, 2, async);
+    ASSERT_EQ(read_file(out_path), ison_to_json(ison));
+
+    std::remove(path.c_str());
+    std::remove(out_path.c_str());
+}
+
+TEST(async_pipeline_errors) {
+    // Chunks read before a source error are still delivered
+    FailingSource failing;
+    ReadAheadSource chunks(failing, 16, 4);
+    const char* data;
+    size_t size;
+    ASSERT(chunks.next(data, size));
+    ASSERT(chunks.next(data, size));
+    bool threw = false;
+    try {
+        chunks.next(data, size);
+    } catch (const ISONError& e) {
+        threw = std::string(e.what()) == "source failed";
+    }
+    ASSERT(threw);
+
+    FailingSink broken;
+    AsyncSink sink(broken, 4);
+    sink.write("abcdef", 6);
+    threw = false;
+    try {
+        sink.flush();
+    } catch (const ISONError& e) {
+        threw = std::string(e.what()) == "sink failed";
+    }
+    ASSERT(threw);
+
+    threw = false;
+    try {
+        load("missing_async.ison", ParseOptions(), AsyncOptions());
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    // A syntax error surfaces through the future
+    const std::string path = "test_async_bad.ison";
+    write_file(path, "table.users\n");
+    threw = false;
+    std::future<Document> pending = load_async(path);
+    try {
+        pending.get();
+    } catch (const ISONSyntaxError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+    std::remove(path.c_str());
+}
+
+// =============================================================================
+// Document Snapshot Tests
+// =============================================================================
+
+TEST(snapshot_shares_unchanged_blocks) {
+    std::string ison = "table.users\nid name\n1 Alice\n2 Bob\n\ntable.orders\nid user\n101 :user:1\n\n"
+                       "object.config\nkey value\nmode fast\n";
+    Document doc = parse(ison);
+    DocumentSnapshot v1(doc);
+    ASSERT_EQ(dumps(v1), dumps(doc));
+    ASSERT_EQ(v1.size(), 3u);
+    ASSERT_EQ(v1["orders"].rows[0].at("user").get_reference()->to_ison(), ":user:1");
+    ASSERT(v1.get("missing") == NULL);
+
+    struct AddUser {
+        void operator()(Block& users) const {
+            Row row;
+            row["id"] = Value(int64_t(3));
+            row["name"] = Value(std::string("Carol"));
+            users.rows.push_back(row);
+        }
+    };
+    DocumentSnapshot v2 = v1.update("users", AddUser());
+    ASSERT_EQ(v1["users"].size(), 2u);
+    ASSERT_EQ(v2["users"].size(), 3u);
+    ASSERT(v2.block_ptr(0) != v1.block_ptr(0));
+    ASSERT(v2.block_ptr(1) == v1.block_ptr(1));
+    ASSERT(v2.block_ptr(2) == v1.block_ptr(2));
+
+    Block audit("table", "audit");
+    audit.fields.push_back("id");
+    DocumentSnapshot v3 = v2.with_block(audit).without_block("orders");
+    ASSERT_EQ(v3.size(), 3u);
+    ASSERT(!v3.has("orders"));
+    ASSERT_EQ(v3.block(2).name, "audit");
+    ASSERT(v3.block_ptr(0) == v2.block_ptr(0));
+    ASSERT_EQ(v2.size(), 3u);
+
+    // Moving a Document in takes its blocks; to_document() copies back out
+    Document moved = parse(ison);
+    DocumentSnapshot taken(std::move(moved));
+    ASSERT(moved.blocks.empty());
+    Document copy = taken.to_document();
+    ASSERT_EQ(dumps(copy), dumps(doc));
+    copy["users"].rows.clear();
+    ASSERT_EQ(taken["users"].size(), 2u);
+
+    bool threw = false;
+    try {
+        v1.update("missing", AddUser());
+    } catch (const ISONError&) {
+        threw = true;
+    }
+    ASSERT(threw);
+    ASSERT(DocumentSnapshot().empty());
+}
+
+struct SnapshotReader {
+    const SnapshotCell* cell;
+    bool* consistent;
+
+    void operator()() const {
+        for (int i = 0; i < 2000; ++i) {
+            DocumentSnapshot snapshot = cell->load();
+            const Block& counter = snapshot["counter"];
+            // Every version is internally consistent: n rows numbered 0..n-1
+            for (size_t r = 0; r < counter.size(); ++r) {
+                if (counter.rows[r].at("n").as_int() != static_cast<int64_t>(r)) *consistent = false;
+            }
+        }
+    }
+};
+
+struct AppendCounterRow {
+    DocumentSnapshot operator()(const DocumentSnapshot& current) const {
+        return current.update("counter", *this);
+    }
+    void operator()(Block& counter) const {
+        Row row;
+        row["n"] = Value(static_cast<int64_t>(counter.size()));
+        counter.rows.push_back(row);
+    }
+};
+
+TEST(snapshot_cell_concurrent_readers) {
+    SnapshotCell cell(DocumentSnapshot(parse("table.counter\nn\n0\n")));
+    bool consistent[3] = {true, true, true};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        SnapshotReader reader = {&cell, &consistent[t]};
+        readers.push_back(std::thread(reader));
+    }
+    for (int i = 0; i < 200; ++i) cell.update(AppendCounterRow());
+    for (size_t t = 0; t < readers.size(); ++t) readers[t].join();
+    for (int t = 0; t < 3; ++t) ASSERT(consistent[t]);
+    ASSERT_EQ(cell.load()["counter"].size(), 201u);
+}
+
+// Holds the writer lock while a store() is attempted from another thread
+struct SlowAppend {
+    std::atomic<bool>* started;
+
+    DocumentSnapshot operator()(const DocumentSnapshot& current) const {
+        started->store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return AppendCounterRow()(current);
+    }
+};
+
+struct SlowUpdater {
+    SnapshotCell* cell;
+    std::atomic<bool>* started;
+
+    void operator()() const {
+        SlowAppend append = {started};
+        cell->update(append);
+    }
+};
+
+TEST(snapshot_cell_store_waits_for_update) {
+    SnapshotCell cell(DocumentSnapshot(parse("table.counter\nn\n0\n")));
+    std::atomic<bool> started(false);
+    SlowUpdater updater = {&cell, &started};
+    std::thread writer(updater);
+    while (!started.load()) std::this_thread::yield();
+
+    // Lands after the update instead of being overwritten by it
+    cell.store(DocumentSnapshot(parse("table.counter\nn\n42\n")));
+    writer.join();
+    ASSERT_EQ(cell.load()["counter"].size(), 1u);
+    ASSERT_EQ(cell.load()["counter"].rows[0].at("n").as_int(), 42);
+}
+
 int main() {
     std::cout << "=== ISON C++ Parser Tests ===" << std::endl;
     std::cout << "Version: " << ison::VERSION << std::endl;
@@ -577,6 +2585,126 @@ int main() {
     RUN_TEST(empty_table);
     RUN_TEST(special_characters_in_values);
 
+    // Zero-copy parsing
+    RUN_TEST(parse_borrowed_buffer);
+    RUN_TEST(parse_crlf_line_endings);
+    RUN_TEST(tokenizer_token_views);
+
+    // Columnar storage
+    RUN_TEST(parse_columnar_typed_columns);
+    RUN_TEST(columnar_mixed_column_fallback);
+    RUN_TEST(columnar_row_compatibility);
+
+    // Streaming
+    RUN_TEST(stream_parser_byte_chunks);
+    RUN_TEST(stream_reader_next_row);
+    RUN_TEST(stream_error_missing_fields);
+
+    // File loading
+    RUN_TEST(load_mapped_file);
+    RUN_TEST(load_isonl_file);
+    RUN_TEST(load_empty_and_missing_file);
+
+    // Parallel parsing
+    RUN_TEST(parse_parallel_matches_sequential);
+    RUN_TEST(parse_parallel_reports_first_error);
+    RUN_TEST(parse_isonl_parallel_matches_sequential);
+    RUN_TEST(parse_isonl_parallel_error_line);
+
+    // SIMD scanning
+    RUN_TEST(simd_tokenizer_matches_scalar);
+    RUN_TEST(simd_unterminated_long_string);
+    RUN_TEST(simd_isonl_long_quoted_pipe);
+
+    // Numeric inference
+    RUN_TEST(infer_integer_limits);
+    RUN_TEST(infer_float_round_trip);
+    RUN_TEST(infer_non_numeric_tokens);
+
+    // Arena allocation
+    RUN_TEST(arena_allocation);
+    RUN_TEST(parse_into_arena);
+
+    // Compact values
+    RUN_TEST(compact_value_copies_share_payload);
+    RUN_TEST(arena_values_outlive_document);
+    RUN_TEST(arena_values_shared_across_threads);
+
+    // Interning
+    RUN_TEST(intern_pool_shares_values);
+    RUN_TEST(parse_with_shared_intern_pool);
+
+    // Name indexes
+    RUN_TEST(document_block_index);
+    RUN_TEST(block_index_survives_direct_edits);
+    RUN_TEST(block_field_handles);
+
+    // Reference index
+    RUN_TEST(reference_index_resolve);
+    RUN_TEST(reference_index_relationships);
+
+    // Writer
+    RUN_TEST(writer_float_round_trip);
+    RUN_TEST(writer_aligned_output);
+    RUN_TEST(writer_buffers_and_streams);
+
+    // ISONL writer
+    RUN_TEST(isonl_writer_appends_records);
+    RUN_TEST(isonl_writer_batches_to_file);
+
+    // Transcoders
+    RUN_TEST(transcode_ison_to_json);
+    RUN_TEST(transcode_json_round_trip);
+    RUN_TEST(transcode_json_layouts_and_errors);
+    RUN_TEST(transcode_json_rejects_malformed);
+    RUN_TEST(transcode_ison_to_isonl);
+
+    // Binary format
+    RUN_TEST(binary_round_trip);
+    RUN_TEST(binary_rejects_corrupt_input);
+    RUN_TEST(lz_codec_round_trip);
+
+    // Type hints
+    RUN_TEST(type_hints_select_decoders);
+    RUN_TEST(type_hints_mismatch);
+    RUN_TEST(type_hints_parallel);
+
+    // Struct binding
+    RUN_TEST(bind_parse_into_structs);
+    RUN_TEST(bind_round_trip);
+    RUN_TEST(bind_unsigned_full_range);
+    RUN_TEST(bind_mismatch_errors);
+
+    // Lazy documents
+    RUN_TEST(lazy_decodes_on_access);
+    RUN_TEST(lazy_errors_and_files);
+
+    // Parse filters
+    RUN_TEST(filter_blocks_and_columns);
+    RUN_TEST(filter_row_predicates);
+    RUN_TEST(filter_parallel_matches_sequential);
+
+    // Instrumentation
+    RUN_TEST(stats_parse_counts);
+    RUN_TEST(stats_isonl_and_serializer);
+
+    // Segmented ISONL
+    RUN_TEST(segmented_isonl_round_trip);
+    RUN_TEST(segmented_isonl_errors);
+
+    // Incremental parsing and diffs
+    RUN_TEST(incremental_edits_match_full_parse);
+    RUN_TEST(document_diff_round_trip);
+
+    // Asynchronous I/O
+    RUN_TEST(async_load_dump_match_blocking);
+    RUN_TEST(async_pipeline_errors);
+
+    // Document snapshots
+    RUN_TEST(snapshot_shares_unchanged_blocks);
+    RUN_TEST(snapshot_cell_concurrent_readers);
+    RUN_TEST(snapshot_cell_store_waits_for_update);
+
     std::cout << std::endl;
     std::cout << "=== Results ===" << std::endl;
     std::cout << "Passed: " << tests_passed << std::endl;
@@ -0,0 +1,65 @@
+/**
+ * @file basic.cpp
+ * @brief ISONantic example: defining a schema and validating parsed ISON
+ *
+ * Compile and run:
+ *   g++ -std=c++17 -I../include -I../../ison-cpp/include basic.cpp -o basic -pthread
+ *   ./basic
+ */
+
+#include "isonantic_ison.hpp"  // isonantic.hpp plus ison-cpp document support
+#include <iostream>
+
+using namespace isonantic;
+
+int main() {
+    // Define schema
+    auto user_schema = table("users")
+        .field("id", integer().required())
+        .field("name", string().min(1).max(100))
+        .field("email", string().email())
+        .field("active", boolean().default_value(true));
+
+    std::string ison_text = R"(table.users
+id name email active
+1 Alice alice@example.com true
+2 Bob bob@example.com ~)";
+
+    // Parse ISON
+    auto doc = ison::parse(ison_text);
+
+    // Validate
+    try {
+        auto users = validate(user_schema, doc);
+
+        // Access validated data
+        for (const auto& user : users) {
+            std::cout << user.get_int("id").value()
+                      << ": " << user.get_string("name").value()
+                      << (user.get_bool("active").value() ? " (active)" : "")
+                      << std::endl;
+        }
+    } catch (const ValidationError& e) {
+        std::cerr << "Validation failed:" << std::endl;
+        for (const auto& err : e.errors) {
+            std::cerr << "  " << err.field << ": " << err.message << std::endl;
+        }
+        return 1;
+    }
+
+    // Validate without exceptions, collecting every failure
+    std::string bad_text = R"(table.users
+id name email
+1 Alice not-an-email
+~ Bob bob@example.com)";
+
+    ValidationErrors errors;
+    if (!check(user_schema, ison::parse(bad_text), errors)) {
+        std::cout << errors.count() << " error(s):" << std::endl;
+        for (const auto& err : user_schema.describe(errors)) {
+            std::cout << "  " << err.field << ": " << err.message << std::endl;
+        }
+    }
+
+    return 0;
+}
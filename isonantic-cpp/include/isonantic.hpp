@@ -15,6 +15,8 @@
  *       .field("email", string().email());
  *
  *   auto result = schema.validate(doc);
+ *
+ * To validate ison-cpp documents, include isonantic_ison.hpp instead.
  */
 
 #ifndef ISONANTIC_HPP
@@ -30,6 +32,13 @@
 #include <stdexcept>
 #include <regex>
 #include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 namespace isonantic {
 
@@ -231,6 +240,259 @@ enum class FieldType {
     Null
 };
 
+// =============================================================================
+// Error Codes
+// =============================================================================
+
+/**
+ * Reason a value failed validation
+ */
+enum class ErrorCode : uint8_t {
+    None,
+    Required,
+    ExpectedString,
+    ExpectedInteger,
+    ExpectedNumber,
+    ExpectedBoolean,
+    ExpectedReference,
+    ExpectedNull,
+    StringTooShort,
+    StringTooLong,
+    InvalidEmail,
+    BelowMin,
+    AboveMax,
+    NotPositive,
+    NotNegative
+};
+
+/**
+ * Error recorded without throwing: row index, schema field index and code
+ */
+struct PlanError {
+    size_t row;
+    size_t field;
+    ErrorCode code;
+};
+
+/**
+ * Preallocated buffer that validation plans write errors into
+ *
+ * Errors past the capacity are counted but not stored.
+ */
+class ValidationErrors {
+public:
+    explicit ValidationErrors(size_t capacity = 256) : capacity_(capacity), count_(0) {
+        errors_.reserve(std::min(capacity, static_cast<size_t>(4096)));
+    }
+
+    void add(size_t row, size_t field, ErrorCode code) {
+        ++count_;
+        if (errors_.size() < capacity_) errors_.push_back(PlanError{row, field, code});
+    }
+
+    void clear() {
+        errors_.clear();
+        count_ = 0;
+    }
+
+    bool empty() const { return count_ == 0; }
+    size_t count() const { return count_; }
+    size_t size() const { return errors_.size(); }
+    bool truncated() const { return count_ > errors_.size(); }
+
+    const PlanError& operator[](size_t index) const { return errors_[index]; }
+    auto begin() const { return errors_.begin(); }
+    auto end() const { return errors_.end(); }
+
+private:
+    std::vector<PlanError> errors_;
+    size_t capacity_;
+    size_t count_;
+};
+
+/**
+ * Counters for validation runs, accumulated until clear()
+ *
+ * validate_parallel() fills the one attached through BatchOptions::stats,
+ * counting every error it finds, including those past max_errors. After
+ * check() or a ValidationPlan, record() tallies an errors buffer instead;
+ * errors past its capacity then add to errors only.
+ */
+struct ValidationStats {
+    size_t rows = 0;                    // rows checked
+    size_t failed_rows = 0;             // rows with at least one error
+    size_t errors = 0;
+    std::vector<size_t> field_errors;   // by schema field index
+    std::vector<size_t> code_errors;    // by ErrorCode
+    uint64_t elapsed_ns = 0;
+
+    void clear() { *this = ValidationStats(); }
+
+    size_t errors_for(ErrorCode code) const {
+        size_t i = static_cast<size_t>(code);
+        return i < code_errors.size() ? code_errors[i] : 0;
+    }
+
+    size_t errors_for_field(size_t field) const {
+        return field < field_errors.size() ? field_errors[field] : 0;
+    }
+
+    /** Add a run over rows_checked rows whose errors are in row order */
+    template<typename It>
+    void tally(It first, It last, size_t rows_checked) {
+        rows += rows_checked;
+        bool any = false;
+        size_t last_row = 0;
+        for (; first != last; ++first) {
+            const PlanError& e = *first;
+            ++errors;
+            if (e.field >= field_errors.size()) field_errors.resize(e.field + 1);
+            ++field_errors[e.field];
+            size_t code = static_cast<size_t>(e.code);
+            if (code >= code_errors.size()) code_errors.resize(code + 1);
+            ++code_errors[code];
+            if (!any || e.row != last_row) ++failed_rows;
+            any = true;
+            last_row = e.row;
+        }
+    }
+
+    void record(const ValidationErrors& found, size_t rows_checked) {
+        tally(found.begin(), found.end(), rows_checked);
+        errors += found.count() - found.size();
+    }
+};
+
+// =============================================================================
+// Cells
+// =============================================================================
+
+enum class CellKind : uint8_t {
+    Missing,
+    Null,
+    Bool,
+    Int,
+    Float,
+    String,
+    Reference
+};
+
+/**
+ * Non-owning view of one table cell, as the constraint checks read it
+ *
+ * Table views (see validate_parallel()) hand cells out in this form, so a
+ * schema can check any storage without converting it to Value first.
+ */
+struct Cell {
+    CellKind kind = CellKind::Missing;
+    int64_t int_value = 0;      // Int, and Bool as 0 / 1
+    double float_value = 0;     // Float
+    std::string_view text;      // String
+
+    static Cell missing() { return Cell(); }
+    static Cell null() { return of(CellKind::Null); }
+    static Cell boolean(bool b) { Cell c = of(CellKind::Bool); c.int_value = b; return c; }
+    static Cell integer(int64_t i) { Cell c = of(CellKind::Int); c.int_value = i; return c; }
+    static Cell floating(double d) { Cell c = of(CellKind::Float); c.float_value = d; return c; }
+    static Cell string(std::string_view s) { Cell c = of(CellKind::String); c.text = s; return c; }
+    static Cell reference() { return of(CellKind::Reference); }
+
+private:
+    static Cell of(CellKind kind) { Cell c; c.kind = kind; return c; }
+};
+
+namespace detail {
+
+/**
+ * Field constraints flattened for checking: absent limits become bounds
+ * that always pass, so each check is a plain comparison
+ */
+struct CompiledField {
+    FieldType type = FieldType::Null;
+    bool required = false;
+    const Value* default_value = nullptr;
+    size_t min_length = 0;
+    size_t max_length = std::numeric_limits<size_t>::max();
+    bool email = false;
+    double min = -std::numeric_limits<double>::infinity();
+    double max = std::numeric_limits<double>::infinity();
+    bool positive = false;
+    bool negative = false;
+    size_t column = 0;
+};
+
+inline ErrorCode check_number(const CompiledField& f, double n) {
+    if (n < f.min) return ErrorCode::BelowMin;
+    if (n > f.max) return ErrorCode::AboveMax;
+    if (f.positive && n <= 0) return ErrorCode::NotPositive;
+    if (f.negative && n >= 0) return ErrorCode::NotNegative;
+    return ErrorCode::None;
+}
+
+/**
+ * Check one cell without throwing
+ */
+inline ErrorCode check_cell(const CompiledField& f, const Cell& c) {
+    if (c.kind == CellKind::Missing || c.kind == CellKind::Null) {
+        return f.required && !f.default_value ? ErrorCode::Required : ErrorCode::None;
+    }
+    switch (f.type) {
+        case FieldType::String:
+            if (c.kind != CellKind::String) return ErrorCode::ExpectedString;
+            if (c.text.length() < f.min_length) return ErrorCode::StringTooShort;
+            if (c.text.length() > f.max_length) return ErrorCode::StringTooLong;
+            if (f.email && c.text.find('@') == std::string_view::npos) return ErrorCode::InvalidEmail;
+            return ErrorCode::None;
+        case FieldType::Integer:
+            if (c.kind != CellKind::Int) return ErrorCode::ExpectedInteger;
+            return check_number(f, static_cast<double>(c.int_value));
+        case FieldType::Float:
+            if (c.kind == CellKind::Float) return check_number(f, c.float_value);
+            if (c.kind == CellKind::Int) return check_number(f, static_cast<double>(c.int_value));
+            return ErrorCode::ExpectedNumber;
+        case FieldType::Boolean:
+            return c.kind == CellKind::Bool ? ErrorCode::None : ErrorCode::ExpectedBoolean;
+        case FieldType::Reference:
+            return c.kind == CellKind::Reference ? ErrorCode::None : ErrorCode::ExpectedReference;
+        case FieldType::Null:
+            return ErrorCode::ExpectedNull;
+    }
+    return ErrorCode::None;
+}
+
+inline Cell cell_of(const Value* v) {
+    if (!v) return Cell::missing();
+    switch (v->index()) {
+        case 0: return Cell::null();
+        case 1: return Cell::boolean(std::get<bool>(*v));
+        case 2: return Cell::integer(std::get<int64_t>(*v));
+        case 3: return Cell::floating(std::get<double>(*v));
+        case 4: return Cell::string(std::get<std::string>(*v));
+        default: return Cell::reference();
+    }
+}
+
+/**
+ * Check one value (nullptr when the field is missing) without throwing
+ */
+inline ErrorCode check_value(const CompiledField& f, const Value* v) {
+    return check_cell(f, cell_of(v));
+}
+
+/**
+ * Rewrite a value that passed check_value() into its validated form:
+ * defaults for missing values, integers widened for float fields
+ */
+inline void normalize_value(const CompiledField& f, Value& v) {
+    if (is_null(v)) {
+        if (f.default_value) v = *f.default_value;
+    } else if (f.type == FieldType::Float) {
+        if (const int64_t* i = std::get_if<int64_t>(&v)) v = static_cast<double>(*i);
+    }
+}
+
+} // namespace detail
+
 // =============================================================================
 // Field Schema
 // =============================================================================
@@ -247,100 +509,60 @@ public:
     FieldSchema(const std::string& n, FieldType t) : name(n), type(t) {}
 
     Value validate(const std::optional<Value>& input) const {
-        // Handle missing value
-        if (!input || is_null(*input)) {
-            if (default_value) {
-                return *default_value;
-            }
-            if (required_) {
-                throw ValidationError(name, "Field is required");
-            }
-            return nullptr;
-        }
-
-        const Value& v = *input;
-
-        // Type validation
-        switch (type) {
-            case FieldType::String: {
-                auto s = get_as<std::string>(v);
-                if (!s) {
-                    throw ValidationError(name, "Expected string");
-                }
-                validate_string(*s);
-                return v;
-            }
-            case FieldType::Integer: {
-                auto i = get_as<int64_t>(v);
-                if (!i) {
-                    throw ValidationError(name, "Expected integer");
-                }
-                validate_number(static_cast<double>(*i));
-                return v;
-            }
-            case FieldType::Float: {
-                std::optional<double> f;
-                if (auto d = get_as<double>(v)) {
-                    f = d;
-                } else if (auto i = get_as<int64_t>(v)) {
-                    f = static_cast<double>(*i);
-                }
-                if (!f) {
-                    throw ValidationError(name, "Expected number");
-                }
-                validate_number(*f);
-                return Value(*f);
-            }
-            case FieldType::Boolean: {
-                if (!get_as<bool>(v)) {
-                    throw ValidationError(name, "Expected boolean");
-                }
-                return v;
-            }
-            case FieldType::Reference: {
-                if (!get_as<Reference>(v)) {
-                    throw ValidationError(name, "Expected reference");
-                }
-                return v;
-            }
-            case FieldType::Null: {
-                if (!is_null(v)) {
-                    throw ValidationError(name, "Expected null");
-                }
-                return v;
-            }
+        detail::CompiledField f = compile();
+        ErrorCode code = detail::check_value(f, input ? &*input : nullptr);
+        if (code != ErrorCode::None) {
+            throw ValidationError(name, error_message(code));
         }
+        Value v = input ? *input : Value(nullptr);
+        detail::normalize_value(f, v);
         return v;
     }
 
-private:
-    void validate_string(const std::string& s) const {
-        if (string_constraints.min_length && s.length() < *string_constraints.min_length) {
-            throw ValidationError(name,
-                "String must be at least " + std::to_string(*string_constraints.min_length) + " characters");
-        }
-        if (string_constraints.max_length && s.length() > *string_constraints.max_length) {
-            throw ValidationError(name,
-                "String must be at most " + std::to_string(*string_constraints.max_length) + " characters");
-        }
-        if (string_constraints.email && s.find('@') == std::string::npos) {
-            throw ValidationError(name, "Invalid email format");
-        }
+    /**
+     * Constraints flattened for validation plans
+     */
+    detail::CompiledField compile() const {
+        detail::CompiledField f;
+        f.type = type;
+        f.required = required_;
+        f.default_value = default_value ? &*default_value : nullptr;
+        if (string_constraints.min_length) f.min_length = *string_constraints.min_length;
+        if (string_constraints.max_length) f.max_length = *string_constraints.max_length;
+        f.email = string_constraints.email;
+        if (number_constraints.min) f.min = *number_constraints.min;
+        if (number_constraints.max) f.max = *number_constraints.max;
+        f.positive = number_constraints.positive;
+        f.negative = number_constraints.negative;
+        return f;
     }
 
-    void validate_number(double n) const {
-        if (number_constraints.min && n < *number_constraints.min) {
-            throw ValidationError(name, "Value must be >= " + std::to_string(*number_constraints.min));
-        }
-        if (number_constraints.max && n > *number_constraints.max) {
-            throw ValidationError(name, "Value must be <= " + std::to_string(*number_constraints.max));
-        }
-        if (number_constraints.positive && n <= 0) {
-            throw ValidationError(name, "Value must be positive");
-        }
-        if (number_constraints.negative && n >= 0) {
-            throw ValidationError(name, "Value must be negative");
+    /**
+     * Message for an error code, as ValidationError reports it
+     */
+    std::string error_message(ErrorCode code) const {
+        switch (code) {
+            case ErrorCode::None: return "";
+            case ErrorCode::Required: return "Field is required";
+            case ErrorCode::ExpectedString: return "Expected string";
+            case ErrorCode::ExpectedInteger: return "Expected integer";
+            case ErrorCode::ExpectedNumber: return "Expected number";
+            case ErrorCode::ExpectedBoolean: return "Expected boolean";
+            case ErrorCode::ExpectedReference: return "Expected reference";
+            case ErrorCode::ExpectedNull: return "Expected null";
+            case ErrorCode::StringTooShort:
+                return "String must be at least " + std::to_string(string_constraints.min_length.value_or(0)) +
+                       " characters";
+            case ErrorCode::StringTooLong:
+                return "String must be at most " + std::to_string(string_constraints.max_length.value_or(0)) +
+                       " characters";
+            case ErrorCode::InvalidEmail: return "Invalid email format";
+            case ErrorCode::BelowMin: return "Value must be >= " + std::to_string(number_constraints.min.value_or(0));
+            case ErrorCode::AboveMax: return "Value must be <= " + std::to_string(number_constraints.max.value_or(0));
+            case ErrorCode::NotPositive: return "Value must be positive";
+            case ErrorCode::NotNegative: return "Value must be negative";
         }
+        return "";
     }
 };
 
@@ -444,11 +666,17 @@ public:
 // Table Schema
 // =============================================================================
 
+class ValidationPlan;
+struct BatchOptions;
+
 class TableSchema {
     std::string name_;
     std::vector<FieldSchema> fields_;
 
 public:
+    using Rows = std::vector<std::map<std::string, Value>>;
+    using Document = std::map<std::string, Rows>;
+
     explicit TableSchema(const std::string& name) : name_(name) {}
 
     template<typename Builder>
@@ -457,52 +685,385 @@ public:
         return *this;
     }
 
-    ValidatedTable validate(const std::map<std::string, std::vector<std::map<std::string, Value>>>& doc) const {
+    ValidatedTable validate(const Document& doc) const {
+        const Rows& rows = table_rows(doc);
         ValidatedTable result(name_);
+        result.rows.reserve(rows.size());
+
+        std::vector<detail::CompiledField> compiled = compile_fields();
+        std::vector<size_t> order = name_order();
+        ValidationErrors errors(std::numeric_limits<size_t>::max());
+        std::vector<const Value*> values(fields_.size());
+
+        std::vector<ErrorCode> codes(fields_.size());
+
+        for (size_t row_idx = 0; row_idx < rows.size(); ++row_idx) {
+            find_values(rows[row_idx], order, values);
+            for (size_t i = 0; i < compiled.size(); ++i) {
+                codes[i] = detail::check_value(compiled[i], values[i]);
+                if (codes[i] != ErrorCode::None) errors.add(row_idx, i, codes[i]);
+            }
+            // Insert in name order so each insertion lands at the end of the map
+            ValidatedRow validated_row;
+            for (size_t k = 0; k < order.size(); ++k) {
+                size_t i = order[k];
+                if (codes[i] != ErrorCode::None) continue;
+                Value v = values[i] ? *values[i] : Value(nullptr);
+                detail::normalize_value(compiled[i], v);
+                validated_row.fields.insert_or_assign(validated_row.fields.end(), fields_[i].name, std::move(v));
+            }
+            result.rows.push_back(std::move(validated_row));
+        }
+
+        if (!errors.empty()) {
+            throw ValidationError(describe(errors));
+        }
+        return result;
+    }
+
+    /**
+     * Validate without throwing or copying rows; returns true if every row passes
+     *
+     * A missing table is still reported by throwing ValidationError.
+     */
+    bool check(const Document& doc, ValidationErrors& errors) const {
+        const Rows& rows = table_rows(doc);
+        std::vector<detail::CompiledField> compiled = compile_fields();
+        std::vector<size_t> order = name_order();
+        std::vector<const Value*> values(fields_.size());
+        size_t before = errors.count();
+
+        for (size_t row_idx = 0; row_idx < rows.size(); ++row_idx) {
+            find_values(rows[row_idx], order, values);
+            for (size_t i = 0; i < compiled.size(); ++i) {
+                ErrorCode code = detail::check_value(compiled[i], values[i]);
+                if (code != ErrorCode::None) errors.add(row_idx, i, code);
+            }
+        }
+        return errors.count() == before;
+    }
+
+    /**
+     * Resolve the schema against a column layout once, for positional rows
+     */
+    ValidationPlan compile(const std::vector<std::string>& columns) const;
+
+    /**
+     * check() on a thread pool, with optional early exit; see validate_parallel()
+     */
+    bool check_parallel(const Document& doc, ValidationErrors& errors, const BatchOptions& options) const;
+
+    /**
+     * Field errors ("[row].field": message) for errors found by check() or a plan
+     */
+    std::vector<FieldError> describe(const ValidationErrors& errors) const {
+        std::vector<FieldError> result;
+        result.reserve(errors.size());
+        for (const PlanError& e : errors) {
+            const FieldSchema& f = fields_[e.field];
+            result.push_back({"[" + std::to_string(e.row) + "]." + f.name, f.error_message(e.code)});
+        }
+        return result;
+    }
 
+    const std::string& name() const { return name_; }
+    const std::vector<FieldSchema>& fields() const { return fields_; }
+
+private:
+    const Rows& table_rows(const Document& doc) const {
         auto it = doc.find(name_);
         if (it == doc.end()) {
             throw ValidationError("", "Missing table: " + name_);
         }
+        return it->second;
+    }
 
-        std::vector<FieldError> all_errors;
+    std::vector<detail::CompiledField> compile_fields() const {
+        std::vector<detail::CompiledField> compiled;
+        compiled.reserve(fields_.size());
+        for (const auto& f : fields_) compiled.push_back(f.compile());
+        return compiled;
+    }
 
-        for (size_t row_idx = 0; row_idx < it->second.size(); ++row_idx) {
-            const auto& row = it->second[row_idx];
-            ValidatedRow validated_row;
+    // Field indices sorted by name, so each row map is matched in one merge pass
+    std::vector<size_t> name_order() const {
+        std::vector<size_t> order(fields_.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [this](size_t a, size_t b) { return fields_[a].name < fields_[b].name; });
+        return order;
+    }
 
-            for (const auto& field_schema : fields_) {
-                std::optional<Value> value;
-                auto field_it = row.find(field_schema.name);
-                if (field_it != row.end()) {
-                    value = field_it->second;
-                }
+    void find_values(const std::map<std::string, Value>& row, const std::vector<size_t>& order,
+                     std::vector<const Value*>& values) const {
+        auto it = row.begin();
+        for (size_t k = 0; k < order.size(); ++k) {
+            const std::string& name = fields_[order[k]].name;
+            while (it != row.end() && it->first < name) ++it;
+            values[order[k]] = it != row.end() && it->first == name ? &it->second : nullptr;
+        }
+    }
+};
 
-                try {
-                    validated_row.fields[field_schema.name] = field_schema.validate(value);
-                } catch (const ValidationError& e) {
-                    for (const auto& err : e.errors) {
-                        all_errors.push_back({
-                            "[" + std::to_string(row_idx) + "]." + err.field,
-                            err.message
-                        });
-                    }
-                }
+// =============================================================================
+// Validation Plans
+// =============================================================================
+
+/**
+ * TableSchema resolved against a column layout
+ *
+ * Field schemas are mapped to column indices once; check() then runs the
+ * constraints over positional rows in a flat loop and records failures in a
+ * ValidationErrors buffer instead of throwing. validate_in_place() also
+ * applies defaults and float widening to the rows themselves. Schema fields
+ * missing from the layout are appended to it (see columns()).
+ */
+class ValidationPlan {
+public:
+    ValidationPlan(const TableSchema& schema, const std::vector<std::string>& columns)
+        : schema_(schema), columns_(columns), input_width_(columns.size()) {
+        const auto& fields = schema_.fields();
+        compiled_.reserve(fields.size());
+        // Compiled from the plan's own copy, so defaults point into it
+        for (const auto& f : fields) {
+            detail::CompiledField c = f.compile();
+            auto it = std::find(columns_.begin(), columns_.end(), f.name);
+            c.column = static_cast<size_t>(it - columns_.begin());
+            if (it == columns_.end()) columns_.push_back(f.name);
+            compiled_.push_back(c);
+        }
+    }
+
+    ValidationPlan(const ValidationPlan& other) : ValidationPlan(other.schema_, other.input_columns()) {}
+    ValidationPlan& operator=(const ValidationPlan&) = delete;
+
+    /** Layout of validated rows: the input columns, then schema fields they lacked */
+    const std::vector<std::string>& columns() const { return columns_; }
+    const TableSchema& schema() const { return schema_; }
+
+    bool check_row(const std::vector<Value>& row, size_t row_index, ValidationErrors& errors) const {
+        bool ok = true;
+        for (size_t i = 0; i < compiled_.size(); ++i) {
+            const detail::CompiledField& f = compiled_[i];
+            ErrorCode code = detail::check_value(f, f.column < row.size() ? &row[f.column] : nullptr);
+            if (code != ErrorCode::None) {
+                errors.add(row_index, i, code);
+                ok = false;
             }
+        }
+        return ok;
+    }
 
-            result.rows.push_back(std::move(validated_row));
+    /** Check rows without modifying them; returns true if all pass */
+    bool check(const std::vector<std::vector<Value>>& rows, ValidationErrors& errors) const {
+        bool ok = true;
+        for (size_t r = 0; r < rows.size(); ++r) {
+            ok = check_row(rows[r], r, errors) && ok;
         }
+        return ok;
+    }
 
-        if (!all_errors.empty()) {
-            throw ValidationError(all_errors);
+    /**
+     * Check rows and rewrite them as validated rows, widened to columns()
+     *
+     * Values that fail are left as they were.
+     */
+    bool validate_in_place(std::vector<std::vector<Value>>& rows, ValidationErrors& errors) const {
+        bool ok = true;
+        for (size_t r = 0; r < rows.size(); ++r) {
+            std::vector<Value>& row = rows[r];
+            if (row.size() < columns_.size()) row.resize(columns_.size(), Value(nullptr));
+            for (size_t i = 0; i < compiled_.size(); ++i) {
+                const detail::CompiledField& f = compiled_[i];
+                Value& cell = row[f.column];
+                ErrorCode code = detail::check_value(f, &cell);
+                if (code != ErrorCode::None) {
+                    errors.add(r, i, code);
+                    ok = false;
+                } else {
+                    detail::normalize_value(f, cell);
+                }
+            }
         }
+        return ok;
+    }
 
-        return result;
+    std::vector<FieldError> describe(const ValidationErrors& errors) const { return schema_.describe(errors); }
+
+private:
+    TableSchema schema_;
+    std::vector<detail::CompiledField> compiled_;
+    std::vector<std::string> columns_;
+    size_t input_width_;
+
+    std::vector<std::string> input_columns() const {
+        return std::vector<std::string>(columns_.begin(), columns_.begin() + static_cast<std::ptrdiff_t>(input_width_));
     }
+};
 
-    const std::string& name() const { return name_; }
+inline ValidationPlan TableSchema::compile(const std::vector<std::string>& columns) const {
+    return ValidationPlan(*this, columns);
+}
+
+// =============================================================================
+// Parallel Validation
+// =============================================================================
+
+/**
+ * Positional rows (one Value per column) as a table view
+ */
+class RowsView {
+public:
+    RowsView(const std::vector<std::vector<Value>>& rows, const std::vector<std::string>& columns)
+        : rows_(rows), columns_(columns) {}
+
+    size_t row_count() const { return rows_.size(); }
+
+    size_t resolve(const std::string& field) const {
+        auto it = std::find(columns_.begin(), columns_.end(), field);
+        return it != columns_.end() ? static_cast<size_t>(it - columns_.begin()) : npos;
+    }
+
+    Cell cell(size_t row, size_t column) const {
+        const auto& values = rows_[row];
+        return column < values.size() ? detail::cell_of(&values[column]) : Cell::missing();
+    }
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    const std::vector<std::vector<Value>>& rows_;
+    const std::vector<std::string>& columns_;
+};
+
+/**
+ * Row maps (the TableSchema::Document shape) as a table view
+ */
+class MapRowsView {
+public:
+    explicit MapRowsView(const TableSchema::Rows& rows) : rows_(rows) {}
+
+    size_t row_count() const { return rows_.size(); }
+
+    size_t resolve(const std::string& field) {
+        names_.push_back(field);
+        return names_.size() - 1;
+    }
+
+    Cell cell(size_t row, size_t column) const {
+        const auto& values = rows_[row];
+        auto it = values.find(names_[column]);
+        return detail::cell_of(it != values.end() ? &it->second : nullptr);
+    }
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    const TableSchema::Rows& rows_;
+    std::vector<std::string> names_;
+};
+
+/**
+ * Options for validate_parallel()
+ */
+struct BatchOptions {
+    /** Worker threads, the calling thread included; 0 = one per hardware thread */
+    size_t threads = 0;
+    /** Rows per task */
+    size_t chunk_rows = 4096;
+    /** Stop once this many errors are found (0 = no limit) */
+    size_t max_errors = 0;
+    /** Counters to add this run to; not owned, null to disable */
+    ValidationStats* stats = nullptr;
 };
 
+/**
+ * Validate a table view on a thread pool
+ *
+ * A table view is taken by value and provides:
+ *
+ *   size_t row_count() const;
+ *   size_t resolve(const std::string& field);   // column, or npos when absent
+ *   Cell cell(size_t row, size_t column) const; // called concurrently
+ *
+ * Rows are split into chunks of chunk_rows, claimed in order by the
+ * workers; each worker collects errors locally, and the chunks' errors are
+ * merged into errors in row order. With max_errors, no new chunks are
+ * started once that many errors are found, and errors receives exactly the
+ * first max_errors errors in row order. Returns true if no row failed.
+ */
+template<typename Table>
+bool validate_parallel(const TableSchema& schema, Table table, ValidationErrors& errors,
+                       const BatchOptions& options = BatchOptions()) {
+    std::vector<detail::CompiledField> compiled;
+    for (const auto& f : schema.fields()) {
+        compiled.push_back(f.compile());
+        compiled.back().column = table.resolve(f.name);
+    }
+
+    const size_t rows = table.row_count();
+    const size_t chunk = options.chunk_rows > 0 ? options.chunk_rows : 1;
+    const size_t chunks = (rows + chunk - 1) / chunk;
+    std::vector<std::vector<PlanError>> found(chunks);
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> total(0);
+    std::atomic<size_t> checked(0);
+    const Table& view = table;
+    const auto started = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        while (options.max_errors == 0 || total.load() < options.max_errors) {
+            size_t c = next.fetch_add(1);
+            if (c >= chunks) return;
+            std::vector<PlanError>& local = found[c];
+            size_t end = std::min(rows, (c + 1) * chunk);
+            for (size_t r = c * chunk; r < end; ++r) {
+                for (size_t i = 0; i < compiled.size(); ++i) {
+                    const detail::CompiledField& f = compiled[i];
+                    Cell cell = f.column != Table::npos ? view.cell(r, f.column) : Cell::missing();
+                    ErrorCode code = detail::check_cell(f, cell);
+                    if (code != ErrorCode::None) local.push_back(PlanError{r, i, code});
+                }
+            }
+            total.fetch_add(local.size());
+            checked.fetch_add(end - c * chunk);
+        }
+    };
+
+    size_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    if (threads > chunks) threads = chunks;
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    if (options.stats) {
+        for (size_t c = 0; c < chunks; ++c) options.stats->tally(found[c].begin(), found[c].end(), 0);
+        options.stats->rows += checked.load();
+        options.stats->elapsed_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+    }
+
+    // Claimed chunks form a prefix, so the first max_errors errors are all here
+    size_t limit = options.max_errors ? options.max_errors : std::numeric_limits<size_t>::max();
+    size_t added = 0;
+    for (size_t c = 0; c < chunks && added < limit; ++c) {
+        for (size_t e = 0; e < found[c].size() && added < limit; ++e, ++added) {
+            errors.add(found[c][e].row, found[c][e].field, found[c][e].code);
+        }
+    }
+    return added == 0;
+}
+
+/**
+ * Validate a document's table on a thread pool; see validate_parallel()
+ */
+inline bool TableSchema::check_parallel(const Document& doc, ValidationErrors& errors,
+                                        const BatchOptions& options = BatchOptions()) const {
+    return validate_parallel(*this, MapRowsView(table_rows(doc)), errors, options);
+}
+
 // =============================================================================
 // Convenience Functions
 // =============================================================================
@@ -0,0 +1,372 @@
+/**
+ * @file isonantic_ison.hpp
+ * @brief ISONantic validation of ison-cpp documents
+ *
+ * Validates the blocks of ison::Document and ison::ColumnarDocument in
+ * place, and while parsing. Include it wherever ISONantic is used with
+ * ison-cpp; isonantic.hpp itself does not depend on ison-cpp or on
+ * include order.
+ *
+ * Usage:
+ *   #include "isonantic_ison.hpp"
+ *   using namespace isonantic;
+ *
+ *   ison::Document doc = ison::load("users.ison");
+ *   ValidatedTable users = validate(schema, doc);
+ */
+
+#ifndef ISONANTIC_ISON_HPP
+#define ISONANTIC_ISON_HPP
+
+#include "ison_parser.hpp"
+#include "isonantic.hpp"
+
+namespace isonantic {
+
+// =============================================================================
+// Cells and Values
+// =============================================================================
+
+namespace detail {
+
+inline Cell cell_of(const ison::Value& v) {
+    switch (v.type()) {
+        case ison::ValueType::Null: return Cell::null();
+        case ison::ValueType::Bool: return Cell::boolean(v.as_bool());
+        case ison::ValueType::Int: return Cell::integer(v.as_int());
+        case ison::ValueType::Float: return Cell::floating(v.as_float());
+        case ison::ValueType::String: return Cell::string(v.as_string());
+        case ison::ValueType::Reference: return Cell::reference();
+    }
+    return Cell::missing();
+}
+
+inline Value from_ison(const ison::Value& v) {
+    switch (v.type()) {
+        case ison::ValueType::Null: return nullptr;
+        case ison::ValueType::Bool: return v.as_bool();
+        case ison::ValueType::Int: return v.as_int();
+        case ison::ValueType::Float: return v.as_float();
+        case ison::ValueType::String: return v.as_string();
+        case ison::ValueType::Reference: {
+            const ison::Reference& ref = ison::as_reference(v);
+            return ref.type.has_value() ? Reference(ref.id, ref.type.value()) : Reference(ref.id);
+        }
+    }
+    return nullptr;
+}
+
+inline ison::Value to_ison(const Value& v) {
+    switch (v.index()) {
+        case 1: return ison::Value(std::get<bool>(v));
+        case 2: return ison::Value(static_cast<long long>(std::get<int64_t>(v)));
+        case 3: return ison::Value(std::get<double>(v));
+        case 4: return ison::Value(std::get<std::string>(v));
+        case 5: {
+            const Reference& ref = std::get<Reference>(v);
+            return ison::Value(ref.type ? std::make_shared<ison::Reference>(ref.id, *ref.type)
+                                        : std::make_shared<ison::Reference>(ref.id));
+        }
+        default: return ison::Value(nullptr);
+    }
+}
+
+// Builds a Document from stream events, checking the schema's block row by row
+class ValidatingBuilder : public ison::BlockVisitor {
+public:
+    ValidatingBuilder(ison::Document& doc, const TableSchema& schema, ValidationErrors& errors, bool drop_invalid)
+        : doc_(doc), schema_(schema), errors_(errors), drop_invalid_(drop_invalid), active_(false), found_(false),
+          row_index_(0) {}
+
+    void on_block(const std::string& kind, const std::string& name) override {
+        doc_.blocks.push_back(ison::Block(kind, name));
+        active_ = !found_ && name == schema_.name();
+        found_ = found_ || active_;
+        row_index_ = 0;
+    }
+
+    void on_fields(const std::vector<ison::FieldInfo>& field_info) override {
+        ison::Block& block = doc_.blocks.back();
+        block.field_info = field_info;
+        for (const auto& info : field_info) block.fields.push_back(info.name);
+        if (!active_) return;
+
+        compiled_.clear();
+        defaults_.clear();
+        for (const auto& f : schema_.fields()) {
+            compiled_.push_back(f.compile());
+            auto it = std::find(block.fields.begin(), block.fields.end(), f.name);
+            compiled_.back().column = static_cast<size_t>(it - block.fields.begin());
+            defaults_.push_back(f.default_value ? to_ison(*f.default_value) : ison::Value(nullptr));
+            // Defaults of absent fields need a column to land in
+            if (it == block.fields.end() && f.default_value) {
+                block.fields.push_back(f.name);
+                block.field_info.push_back(ison::FieldInfo(f.name));
+            }
+        }
+    }
+
+    void on_row(const std::vector<ison::Value>& values) override {
+        ison::Block& block = doc_.blocks.back();
+        size_t row_index = row_index_++;
+        bool ok = true;
+        if (active_) {
+            codes_.resize(compiled_.size());
+            for (size_t i = 0; i < compiled_.size(); ++i) {
+                const CompiledField& f = compiled_[i];
+                Cell cell = f.column < values.size() ? cell_of(values[f.column]) : Cell::missing();
+                codes_[i] = check_cell(f, cell);
+                if (codes_[i] != ErrorCode::None) {
+                    errors_.add(row_index, i, codes_[i]);
+                    ok = false;
+                }
+            }
+            if (!ok && drop_invalid_) return;
+        }
+
+        block.rows.push_back(ison::Row());
+        ison::Row& row = block.rows.back();
+        for (size_t i = 0; i < values.size(); ++i) row[block.fields[i]] = values[i];
+        if (!active_) return;
+
+        // Like ValidationPlan::validate_in_place(): each passing field is
+        // normalized, failing ones are left as parsed
+        for (size_t i = 0; i < compiled_.size(); ++i) {
+            const CompiledField& f = compiled_[i];
+            if (codes_[i] != ErrorCode::None) continue;
+            if (f.type == FieldType::Float && f.column < values.size() && values[f.column].is_int()) {
+                row[block.fields[f.column]] = ison::Value(static_cast<double>(values[f.column].as_int()));
+            } else if (f.default_value && (f.column >= values.size() || values[f.column].is_null())) {
+                row[schema_.fields()[i].name] = defaults_[i];
+            }
+        }
+    }
+
+    void on_summary(const std::string& summary) override { doc_.blocks.back().summary = summary; }
+
+    bool found() const { return found_; }
+
+private:
+    ison::Document& doc_;
+    const TableSchema& schema_;
+    ValidationErrors& errors_;
+    bool drop_invalid_;
+    bool active_;
+    bool found_;
+    size_t row_index_;
+    std::vector<CompiledField> compiled_;
+    std::vector<ison::Value> defaults_;
+    std::vector<ErrorCode> codes_;
+};
+
+} // namespace detail
+
+// =============================================================================
+// Table Views
+// =============================================================================
+
+/**
+ * ison::Block rows as a table view: cells are read from the parsed values in place
+ */
+class BlockView {
+public:
+    explicit BlockView(const ison::Block& block) : block_(block) {}
+
+    size_t row_count() const { return block_.rows.size(); }
+
+    size_t resolve(const std::string& field) const {
+        size_t index = block_.field_index(field);
+        return index != ison::Block::npos ? index : npos;
+    }
+
+    Cell cell(size_t row, size_t column) const { return detail::cell_of(block_.get(row, column)); }
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    const ison::Block& block_;
+};
+
+/**
+ * ison::ColumnarBlock as a table view: cells are read from the typed
+ * columns, without materializing values
+ */
+class ColumnarView {
+public:
+    explicit ColumnarView(const ison::ColumnarBlock& block) : block_(block) {}
+
+    size_t row_count() const { return block_.size(); }
+
+    size_t resolve(const std::string& field) const {
+        size_t index = block_.column_index(field);
+        return index != ison::ColumnarBlock::npos ? index : npos;
+    }
+
+    Cell cell(size_t row, size_t column) const {
+        const ison::Column& col = block_.column(column);
+        if (col.type() == ison::ColumnType::Mixed) {
+            ison::ValueType type = col.get(row).type();
+            if (type == ison::ValueType::String) return Cell::string(text(col.string_at(row)));
+            return detail::cell_of(col.get(row));
+        }
+        if (col.is_null(row)) return Cell::null();
+        switch (col.type()) {
+            case ison::ColumnType::Bool: return Cell::boolean(col.bool_at(row));
+            case ison::ColumnType::Int: return Cell::integer(col.int_at(row));
+            case ison::ColumnType::Float: return Cell::floating(col.float_at(row));
+            case ison::ColumnType::String: return Cell::string(text(col.string_at(row)));
+            case ison::ColumnType::Reference: return Cell::reference();
+            default: return Cell::null();
+        }
+    }
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    const ison::ColumnarBlock& block_;
+
+    static std::string_view text(ison::StringView s) { return std::string_view(s.data(), s.size()); }
+};
+
+// =============================================================================
+// Document Validation
+// =============================================================================
+
+/**
+ * Validate the block named like the schema in a columnar document, on a thread pool
+ */
+inline bool validate_parallel(const TableSchema& schema, const ison::ColumnarDocument& doc, ValidationErrors& errors,
+                              const BatchOptions& options = BatchOptions()) {
+    const ison::ColumnarBlock* block = doc.get(schema.name());
+    if (!block) {
+        throw ValidationError("", "Missing table: " + schema.name());
+    }
+    return validate_parallel(schema, ColumnarView(*block), errors, options);
+}
+
+namespace detail {
+
+inline const ison::Block& ison_table(const ison::Document& doc, const std::string& name) {
+    const ison::Block* block = doc.get(name);
+    if (!block) {
+        throw ValidationError("", "Missing table: " + name);
+    }
+    return *block;
+}
+
+} // namespace detail
+
+/**
+ * Validate the schema's block of a parsed ison::Document in place
+ */
+inline bool validate_parallel(const TableSchema& schema, const ison::Document& doc, ValidationErrors& errors,
+                              const BatchOptions& options = BatchOptions()) {
+    return validate_parallel(schema, BlockView(detail::ison_table(doc, schema.name())), errors, options);
+}
+
+/**
+ * Check an ison::Document's block without exceptions or copies
+ *
+ * A missing table is still reported by throwing ValidationError.
+ */
+inline bool check(const TableSchema& schema, const ison::Document& doc, ValidationErrors& errors) {
+    BatchOptions sequential;
+    sequential.threads = 1;
+    return validate_parallel(schema, BlockView(detail::ison_table(doc, schema.name())), errors, sequential);
+}
+
+/**
+ * Validate an ison::Document's block; only the validated rows are copied out
+ */
+inline ValidatedTable validate(const TableSchema& schema, const ison::Document& doc) {
+    const ison::Block& block = detail::ison_table(doc, schema.name());
+    const std::vector<FieldSchema>& fields = schema.fields();
+    ValidatedTable result(schema.name());
+    result.rows.reserve(block.rows.size());
+
+    std::vector<detail::CompiledField> compiled;
+    compiled.reserve(fields.size());
+    for (const auto& f : fields) {
+        compiled.push_back(f.compile());
+        compiled.back().column = block.field_index(f.name);
+    }
+    // Inserted in name order so each insertion lands at the end of the row map
+    std::vector<size_t> order(fields.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&fields](size_t a, size_t b) { return fields[a].name < fields[b].name; });
+    ValidationErrors errors(std::numeric_limits<size_t>::max());
+    std::vector<ErrorCode> codes(fields.size());
+    BlockView view(block);
+
+    for (size_t row_idx = 0; row_idx < block.rows.size(); ++row_idx) {
+        for (size_t i = 0; i < compiled.size(); ++i) {
+            const detail::CompiledField& f = compiled[i];
+            Cell cell = f.column != ison::Block::npos ? view.cell(row_idx, f.column) : Cell::missing();
+            codes[i] = detail::check_cell(f, cell);
+            if (codes[i] != ErrorCode::None) errors.add(row_idx, i, codes[i]);
+        }
+        ValidatedRow validated_row;
+        for (size_t k = 0; k < order.size(); ++k) {
+            size_t i = order[k];
+            if (codes[i] != ErrorCode::None) continue;
+            const detail::CompiledField& f = compiled[i];
+            Value v = f.column != ison::Block::npos ? detail::from_ison(block.get(row_idx, f.column)) : Value(nullptr);
+            detail::normalize_value(f, v);
+            validated_row.fields.insert_or_assign(validated_row.fields.end(), fields[i].name, std::move(v));
+        }
+        result.rows.push_back(std::move(validated_row));
+    }
+
+    if (!errors.empty()) {
+        throw ValidationError(schema.describe(errors));
+    }
+    return result;
+}
+
+// =============================================================================
+// Validating Parsers
+// =============================================================================
+
+/**
+ * Parse ISON and validate the schema's block in the same pass
+ *
+ * Each row of the block is checked as soon as it is decoded, and defaults
+ * and float widening are applied to the parsed values, so the document
+ * comes back validated without a second copy of the data. Failures go to
+ * errors, with row indices counting every row of the block; with
+ * drop_invalid, failing rows are left out. Schema fields the block lacks
+ * are appended to it when they have a default.
+ */
+inline ison::Document parse_validated(const std::string& text, const TableSchema& schema, ValidationErrors& errors,
+                                      bool drop_invalid = false) {
+    ison::Document doc;
+    detail::ValidatingBuilder builder(doc, schema, errors, drop_invalid);
+    ison::StreamParser parser(builder);
+    parser.feed(text);
+    parser.finish();
+    if (!builder.found()) {
+        throw ValidationError("", "Missing table: " + schema.name());
+    }
+    doc.reindex();
+    return doc;
+}
+
+/**
+ * parse_validated() over a file, streamed with bounded read buffers
+ */
+inline ison::Document load_validated(const std::string& path, const TableSchema& schema, ValidationErrors& errors,
+                                     bool drop_invalid = false) {
+    ison::Document doc;
+    detail::ValidatingBuilder builder(doc, schema, errors, drop_invalid);
+    ison::load_stream(path, builder);
+    if (!builder.found()) {
+        throw ValidationError("", "Missing table: " + schema.name());
+    }
+    doc.reindex();
+    return doc;
+}
+
+} // namespace isonantic
+
+#endif // ISONANTIC_ISON_HPP
@@ -0,0 +1,716 @@
+/**
+ * @file test_isonantic.cpp
+ * @brief Tests for ISONantic validation
+ *
+ * Compile and run:
+ *   g++ -std=c++17 -I../include -I../../ison-cpp/include -DISONANTIC_TEST_HAVE_ISON \
+ *       test_isonantic.cpp -o test_isonantic -pthread
+ *   ./test_isonantic
+ *
+ * Or with CMake:
+ *   mkdir build && cd build
+ *   cmake .. && make
+ *   ./test_isonantic
+ */
+
+#include "isonantic.hpp"
+#ifdef ISONANTIC_TEST_HAVE_ISON
+#include "isonantic_ison.hpp"
+#endif
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace isonantic;
+
+// Test counter
+int tests_passed = 0;
+int tests_failed = 0;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    try { \
+        test_##name(); \
+        std::cout << "PASSED" << std::endl; \
+        tests_passed++; \
+    } catch (const std::exception& e) { \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+        tests_failed++; \
+    } \
+} while(0)
+
+#define ASSERT(cond) do { \
+    if (!(cond)) throw std::runtime_error("Assertion failed: " #cond); \
+} while(0)
+
+#define ASSERT_EQ(a, b) do { \
+    if ((a) != (b)) throw std::runtime_error("Assertion failed: " #a " == " #b); \
+} while(0)
+
+// Schema shared by most tests
+static TableSchema user_schema() {
+    return table("users")
+        .field("id", integer().required().positive())
+        .field("name", string().min(2).max(8))
+        .field("email", string().email())
+        .field("age", integer().min(0).max(150))
+        .field("active", boolean().default_value(true));
+}
+
+static std::map<std::string, Value> user(int64_t id, const std::string& name, const std::string& email) {
+    std::map<std::string, Value> row;
+    row["id"] = id;
+    row["name"] = name;
+    row["email"] = email;
+    return row;
+}
+
+// =============================================================================
+// Error Codes and Messages
+// =============================================================================
+
+TEST(error_codes_and_messages) {
+    TableSchema schema = user_schema();
+    TableSchema::Document doc;
+    auto& rows = doc["users"];
+    rows.push_back(user(1, "Alice", "alice@example.com"));
+    rows.push_back(user(2, "B", "bob@example.com"));             // name too short
+    rows.push_back(user(3, "Carol", "carol"));                   // bad email
+    rows.push_back(user(-4, "Dave", "dave@example.com"));        // not positive
+    rows.push_back(user(5, "Eve", "eve@example.com"));
+    rows.back()["age"] = int64_t(200);                           // above max
+    rows.push_back(user(6, "Frankenstein", "frank@example.com")); // name too long
+    rows.back()["age"] = std::string("old");                     // wrong type
+    rows.push_back(std::map<std::string, Value>());              // id missing
+
+    ValidationErrors errors;
+    ASSERT(!schema.check(doc, errors));
+    ASSERT_EQ(errors.count(), 7u);
+
+    // Errors are in row order, then schema field order
+    ASSERT_EQ(errors[0].row, 1u);
+    ASSERT(errors[0].code == ErrorCode::StringTooShort);
+    ASSERT_EQ(errors[0].field, 1u);
+    ASSERT(errors[1].code == ErrorCode::InvalidEmail);
+    ASSERT(errors[2].code == ErrorCode::NotPositive);
+    ASSERT(errors[3].code == ErrorCode::AboveMax);
+    ASSERT_EQ(errors[4].row, 5u);
+    ASSERT(errors[4].code == ErrorCode::StringTooLong);
+    ASSERT(errors[5].code == ErrorCode::ExpectedInteger);
+    ASSERT_EQ(errors[5].field, 3u);
+    ASSERT_EQ(errors[6].row, 6u);
+    ASSERT(errors[6].code == ErrorCode::Required);
+
+    auto described = schema.describe(errors);
+    ASSERT_EQ(described.size(), 7u);
+    ASSERT_EQ(described[0].field, "[1].name");
+    ASSERT_EQ(described[0].message, "String must be at least 2 characters");
+    ASSERT_EQ(described[1].field, "[2].email");
+    ASSERT_EQ(described[1].message, "Invalid email format");
+    ASSERT_EQ(described[2].field, "[3].id");
+    ASSERT_EQ(described[2].message, "Value must be positive");
+    ASSERT_EQ(described[3].field, "[4].age");
+    ASSERT_EQ(described[3].message, "Value must be <= " + std::to_string(150.0));
+    ASSERT_EQ(described[4].message, "String must be at most 8 characters");
+    ASSERT_EQ(described[5].field, "[5].age");
+    ASSERT_EQ(described[5].message, "Expected integer");
+    ASSERT_EQ(described[6].field, "[6].id");
+    ASSERT_EQ(described[6].message, "Field is required");
+}
+
+TEST(validate_throws_with_paths) {
+    TableSchema schema = user_schema();
+    TableSchema::Document doc;
+    doc["users"].push_back(user(1, "Alice", "alice@example.com"));
+    doc["users"].push_back(user(2, "Bob", "bob"));
+    doc["users"].push_back(std::map<std::string, Value>());
+
+    bool thrown = false;
+    try {
+        schema.validate(doc);
+    } catch (const ValidationError& e) {
+        thrown = true;
+        ASSERT_EQ(e.errors.size(), 2u);
+        ASSERT_EQ(e.errors[0].field, "[1].email");
+        ASSERT_EQ(e.errors[1].field, "[2].id");
+        ASSERT_EQ(std::string(e.what()),
+                  "Validation failed with 2 error(s)\n"
+                  "  - [1].email: Invalid email format\n"
+                  "  - [2].id: Field is required");
+    }
+    ASSERT(thrown);
+
+    // A single field reports its own name
+    FieldSchema age = integer().min(0).build("age");
+    thrown = false;
+    try {
+        age.validate(Value(int64_t(-1)));
+    } catch (const ValidationError& e) {
+        thrown = true;
+        ASSERT_EQ(std::string(e.what()), "age: Value must be >= " + std::to_string(0.0));
+    }
+    ASSERT(thrown);
+
+    // Valid rows come back with defaults applied
+    doc["users"].resize(1);
+    ValidatedTable users = schema.validate(doc);
+    ASSERT_EQ(users.size(), 1u);
+    ASSERT_EQ(users[0].get_int("id").value(), 1);
+    ASSERT_EQ(users[0].get_string("name").value(), "Alice");
+    ASSERT_EQ(users[0].get_bool("active").value(), true);
+}
+
+// =============================================================================
+// No-Throw Validation
+// =============================================================================
+
+TEST(check_does_not_throw) {
+    TableSchema schema = user_schema();
+    TableSchema::Document doc;
+    for (int64_t i = 0; i < 5; ++i) doc["users"].push_back(user(-i, "Name", "x"));
+
+    // Capacity bounds what is stored, not what is counted
+    ValidationErrors errors(3);
+    bool ok = true;
+    bool thrown = false;
+    try {
+        ok = schema.check(doc, errors);
+    } catch (const std::exception&) {
+        thrown = true;
+    }
+    ASSERT(!thrown);
+    ASSERT(!ok);
+    ASSERT_EQ(errors.count(), 10u);   // a non-positive id and a bad email per row
+    ASSERT_EQ(errors.size(), 3u);
+    ASSERT(errors.truncated());
+    ASSERT_EQ(schema.describe(errors).size(), 3u);
+
+    // A buffer keeps collecting across calls until cleared
+    TableSchema::Document good;
+    good["users"].push_back(user(1, "Alice", "alice@example.com"));
+    ASSERT(schema.check(good, errors));
+    ASSERT_EQ(errors.count(), 10u);
+    errors.clear();
+    ASSERT(errors.empty());
+    ASSERT(!errors.truncated());
+
+    ValidationStats stats;
+    ASSERT(!schema.check(doc, errors));
+    stats.record(errors, 5);
+    ASSERT_EQ(stats.rows, 5u);
+    ASSERT_EQ(stats.errors, 10u);
+    // Only the stored errors are broken down
+    ASSERT_EQ(stats.failed_rows, 2u);
+    ASSERT_EQ(stats.errors_for(ErrorCode::InvalidEmail), 1u);
+
+    // A missing table is still an exception
+    thrown = false;
+    try {
+        schema.check(TableSchema::Document(), errors);
+    } catch (const ValidationError& e) {
+        thrown = true;
+        ASSERT_EQ(e.errors[0].message, "Missing table: users");
+    }
+    ASSERT(thrown);
+}
+
+TEST(plan_check_positional_rows) {
+    TableSchema schema = user_schema();
+    ValidationPlan plan = schema.compile({"name", "id", "email"});
+
+    std::vector<std::vector<Value>> rows = {
+        {std::string("Alice"), int64_t(1), std::string("alice@example.com")},
+        {std::string("Bob"), nullptr, std::string("bob@example.com")},
+        {std::string("Carol"), int64_t(3)},
+    };
+    ValidationErrors errors;
+    ASSERT(!plan.check(rows, errors));
+    ASSERT_EQ(errors.count(), 1u);
+    ASSERT_EQ(errors[0].row, 1u);
+    ASSERT(errors[0].code == ErrorCode::Required);
+    ASSERT_EQ(plan.describe(errors)[0].field, "[1].id");
+
+    // check() leaves the rows alone
+    ASSERT_EQ(rows[2].size(), 2u);
+
+    errors.clear();
+    ASSERT(plan.check_row(rows[0], 0, errors));
+    ASSERT(errors.empty());
+}
+
+// =============================================================================
+// In-Place Validation
+// =============================================================================
+
+TEST(plan_validate_in_place) {
+    TableSchema schema = table("scores")
+        .field("id", integer().required())
+        .field("score", floating().min(0.0))
+        .field("comment", string())
+        .field("active", boolean().default_value(true));
+    ValidationPlan plan = schema.compile({"id", "comment", "score"});
+
+    // Fields missing from the layout are appended
+    ASSERT_EQ(plan.columns().size(), 4u);
+    ASSERT_EQ(plan.columns()[1], "comment");
+    ASSERT_EQ(plan.columns()[3], "active");
+
+    const std::string long_comment(200, 'x');
+    std::vector<std::vector<Value>> rows = {
+        {int64_t(1), long_comment, int64_t(7)},
+        {int64_t(2), std::string("ok"), double(-1.5), false},
+        {nullptr, std::string("no id"), 2.5},
+    };
+    const std::vector<Value>* first_row = &rows[0];
+    const char* comment_data = std::get<std::string>(rows[0][1]).data();
+
+    ValidationErrors errors;
+    ASSERT(!plan.validate_in_place(rows, errors));
+    ASSERT_EQ(errors.count(), 2u);
+    ASSERT_EQ(plan.describe(errors)[0].field, "[1].score");
+    ASSERT_EQ(plan.describe(errors)[1].field, "[2].id");
+
+    // Rows are rewritten where they are, not copied
+    ASSERT(&rows[0] == first_row);
+    ASSERT(std::get<std::string>(rows[0][1]).data() == comment_data);
+
+    // Widened to the plan's layout, ints widened to floats, defaults applied
+    ASSERT_EQ(rows[0].size(), 4u);
+    ASSERT(std::holds_alternative<double>(rows[0][2]));
+    ASSERT_EQ(std::get<double>(rows[0][2]), 7.0);
+    ASSERT_EQ(std::get<bool>(rows[0][3]), true);
+    ASSERT_EQ(std::get<bool>(rows[1][3]), false);
+
+    // Failing values are left as they were
+    ASSERT_EQ(std::get<double>(rows[1][2]), -1.5);
+    ASSERT(is_null(rows[2][0]));
+
+    // Validated rows pass a second time without changes
+    errors.clear();
+    rows.pop_back();
+    rows[1][2] = 1.5;
+    ASSERT(plan.validate_in_place(rows, errors));
+    ASSERT(std::get<std::string>(rows[0][1]).data() == comment_data);
+}
+
+// =============================================================================
+// Parallel Validation
+// =============================================================================
+
+static TableSchema batch_schema() {
+    return table("events")
+        .field("id", integer().required().positive())
+        .field("email", string().email())
+        .field("score", floating().min(0.0));
+}
+
+// Rows with failures scattered over all three fields
+static std::vector<std::vector<Value>> batch_rows(size_t count) {
+    std::vector<std::vector<Value>> rows;
+    rows.reserve(count);
+    for (size_t r = 0; r < count; ++r) {
+        std::vector<Value> row;
+        row.push_back(r % 7 == 0 ? int64_t(0) : static_cast<int64_t>(r + 1));
+        row.push_back(std::string(r % 11 == 0 ? "nobody" : "user@example.com"));
+        row.push_back(r % 13 == 0 ? -1.0 : static_cast<double>(r));
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+static bool same_errors(const ValidationErrors& a, const ValidationErrors& b, size_t count) {
+    if (a.size() < count || b.size() < count) return false;
+    for (size_t i = 0; i < count; ++i) {
+        if (a[i].row != b[i].row || a[i].field != b[i].field || a[i].code != b[i].code) return false;
+    }
+    return true;
+}
+
+TEST(parallel_errors_in_row_order) {
+    TableSchema schema = batch_schema();
+    const std::vector<std::string> columns = {"id", "email", "score"};
+    auto rows = batch_rows(5000);
+
+    ValidationErrors expected(100000);
+    ASSERT(!schema.compile(columns).check(rows, expected));
+    ASSERT(expected.count() > 1000);
+
+    const size_t thread_counts[] = {1, 2, 3, 8};
+    const size_t chunk_sizes[] = {1, 64, 1000};
+    for (size_t threads : thread_counts) {
+        for (size_t chunk_rows : chunk_sizes) {
+            BatchOptions options;
+            options.threads = threads;
+            options.chunk_rows = chunk_rows;
+            ValidationErrors errors(100000);
+            ASSERT(!validate_parallel(schema, RowsView(rows, columns), errors, options));
+            ASSERT_EQ(errors.count(), expected.count());
+            ASSERT(same_errors(errors, expected, expected.count()));
+        }
+    }
+
+    // Row maps go through the same pool
+    TableSchema::Document doc;
+    for (const auto& row : rows) {
+        std::map<std::string, Value> values;
+        for (size_t c = 0; c < columns.size(); ++c) values[columns[c]] = row[c];
+        doc["events"].push_back(values);
+    }
+    BatchOptions options;
+    options.threads = 4;
+    options.chunk_rows = 100;
+    ValidationErrors errors(100000);
+    ASSERT(!schema.check_parallel(doc, errors, options));
+    ASSERT_EQ(errors.count(), expected.count());
+    ASSERT(same_errors(errors, expected, expected.count()));
+
+    // Clean input passes on every thread count
+    std::vector<std::vector<Value>> clean = {{int64_t(1), std::string("a@b.co"), 0.5}};
+    errors.clear();
+    options.threads = 8;
+    ASSERT(validate_parallel(schema, RowsView(clean, columns), errors, options));
+    ASSERT(errors.empty());
+}
+
+TEST(parallel_max_errors_prefix) {
+    TableSchema schema = batch_schema();
+    const std::vector<std::vector<Value>> rows = batch_rows(5000);
+    const std::vector<std::string> columns = {"id", "email", "score"};
+
+    ValidationErrors expected(100000);
+    schema.compile(columns).check(rows, expected);
+
+    const size_t thread_counts[] = {1, 2, 4, 8};
+    const size_t limits[] = {1, 25, 333};
+    for (size_t threads : thread_counts) {
+        for (size_t limit : limits) {
+            BatchOptions options;
+            options.threads = threads;
+            options.chunk_rows = 16;
+            options.max_errors = limit;
+            ValidationStats stats;
+            options.stats = &stats;
+            ValidationErrors errors(100000);
+            ASSERT(!validate_parallel(schema, RowsView(rows, columns), errors, options));
+            ASSERT_EQ(errors.count(), limit);
+            ASSERT(same_errors(errors, expected, limit));
+            // Stats count what the claimed chunks found, past the limit too
+            ASSERT(stats.errors >= limit);
+            ASSERT(stats.rows < rows.size());
+        }
+    }
+
+    // A limit above the total returns everything
+    BatchOptions options;
+    options.threads = 4;
+    options.max_errors = expected.count() + 1;
+    ValidationErrors errors(100000);
+    validate_parallel(schema, RowsView(rows, columns), errors, options);
+    ASSERT_EQ(errors.count(), expected.count());
+}
+
+#ifdef ISONANTIC_TEST_HAVE_ISON
+TEST(columnar_view_matches_rows) {
+    TableSchema schema = batch_schema();
+
+    // Nulls, a missing id and strings in the float column (a Mixed column)
+    std::string text = "table.events\nid email score\n";
+    for (size_t r = 0; r < 2000; ++r) {
+        text += r % 17 == 0 ? "~" : std::to_string(r % 7 == 0 ? 0 : r + 1);
+        text += r % 11 == 0 ? " nobody" : " user@example.com";
+        text += r % 19 == 0 ? " n/a" : r % 13 == 0 ? " -1.5" : r % 23 == 0 ? " ~" : " " + std::to_string(r) + ".5";
+        text += "\n";
+    }
+    ison::Document doc = ison::parse(text);
+    ison::ColumnarDocument columnar = ison::parse_columnar(text);
+    ASSERT(columnar.get("events")->column(2).type() == ison::ColumnType::Mixed);
+
+    ValidationErrors expected(100000);
+    ASSERT(!check(schema, doc, expected));
+    ASSERT(expected.count() > 500);
+
+    const size_t thread_counts[] = {1, 3, 8};
+    for (size_t threads : thread_counts) {
+        BatchOptions options;
+        options.threads = threads;
+        options.chunk_rows = 32;
+        ValidationErrors rows_errors(100000);
+        ValidationErrors columnar_errors(100000);
+        ASSERT(!validate_parallel(schema, doc, rows_errors, options));
+        ASSERT(!validate_parallel(schema, columnar, columnar_errors, options));
+        ASSERT_EQ(rows_errors.count(), expected.count());
+        ASSERT_EQ(columnar_errors.count(), expected.count());
+        ASSERT(same_errors(rows_errors, expected, expected.count()));
+        ASSERT(same_errors(columnar_errors, expected, expected.count()));
+    }
+
+    // Both report a missing table the same way
+    TableSchema other = table("missing").field("id", integer());
+    ValidationErrors errors;
+    bool thrown = false;
+    try {
+        validate_parallel(other, columnar, errors);
+    } catch (const ValidationError& e) {
+        thrown = true;
+        ASSERT_EQ(e.errors[0].message, "Missing table: missing");
+    }
+    ASSERT(thrown);
+}
+#endif
+
+#ifdef ISONANTIC_TEST_HAVE_ISON
+// =============================================================================
+// Fused Parse and Validate
+// =============================================================================
+
+static TableSchema fused_schema() {
+    return table("users")
+        .field("id", integer().required().positive())
+        .field("name", string().min(2))
+        .field("score", floating())
+        .field("active", boolean().default_value(true))
+        .field("tier", string().default_value("free"));
+}
+
+// A parsed value against a validated one
+static bool same_value(const ison::Value& a, const Value& b) {
+    switch (a.type()) {
+        case ison::ValueType::Null: return is_null(b);
+        case ison::ValueType::Bool: return std::holds_alternative<bool>(b) && std::get<bool>(b) == a.as_bool();
+        case ison::ValueType::Int: return std::holds_alternative<int64_t>(b) && std::get<int64_t>(b) == a.as_int();
+        case ison::ValueType::Float: return std::holds_alternative<double>(b) && std::get<double>(b) == a.as_float();
+        case ison::ValueType::String:
+            return std::holds_alternative<std::string>(b) && std::get<std::string>(b) == a.as_string();
+        case ison::ValueType::Reference: return std::holds_alternative<Reference>(b);
+    }
+    return false;
+}
+
+TEST(parse_validated_matches_parse_then_validate) {
+    TableSchema schema = fused_schema();
+    const std::string text = R"(table.teams
+id name
+10 Red
+
+# users follow
+table.users
+id name score active
+1 Alice 9.5 true
+2 Bob 7 ~
+3 Carol ~ false
+
+table.orders
+id user
+100 :1)";
+
+    ValidationErrors errors;
+    ison::Document fused = parse_validated(text, schema, errors);
+    ASSERT(errors.empty());
+
+    ison::Document parsed = ison::parse(text);
+    ValidatedTable expected = validate(schema, parsed);
+
+    // Other blocks are parsed as usual
+    ASSERT_EQ(fused.size(), parsed.size());
+    ASSERT_EQ(fused.get("teams")->rows.size(), parsed.get("teams")->rows.size());
+    ASSERT(fused.get("orders")->rows[0].at("user").is_reference());
+
+    const ison::Block& users = *fused.get("users");
+    ASSERT_EQ(users.rows.size(), expected.size());
+    for (size_t r = 0; r < users.rows.size(); ++r) {
+        for (const auto& f : schema.fields()) {
+            Value want = expected[r].get(f.name).value();
+            ASSERT(same_value(users.rows[r].at(f.name), want));
+        }
+    }
+
+    // The same failures as check() over the parsed document
+    const std::string bad = R"(table.users
+id name score
+1 A 1.0
+~ Bob 2.0
+-3 Carol x
+4 Dave 4)";
+    ValidationErrors fused_errors;
+    ValidationErrors check_errors;
+    parse_validated(bad, schema, fused_errors);
+    ASSERT(!check(schema, ison::parse(bad), check_errors));
+    ASSERT_EQ(fused_errors.count(), 4u);
+    ASSERT_EQ(fused_errors.count(), check_errors.count());
+    for (size_t i = 0; i < check_errors.size(); ++i) {
+        ASSERT_EQ(fused_errors[i].row, check_errors[i].row);
+        ASSERT_EQ(fused_errors[i].field, check_errors[i].field);
+        ASSERT(fused_errors[i].code == check_errors[i].code);
+    }
+}
+
+TEST(parse_validated_drop_invalid) {
+    TableSchema schema = fused_schema();
+    const std::string text = R"(table.users
+id name score active
+1 Alice 1 ~
+0 Bob 2 ~
+3 Carol 3 ~
+4 D 4 ~
+5 Eve 5 false)";
+
+    ValidationErrors errors;
+    ison::Document kept = parse_validated(text, schema, errors);
+    ASSERT_EQ(errors.count(), 2u);
+    const ison::Block& all = *kept.get("users");
+    ASSERT_EQ(all.rows.size(), 5u);
+    // In failing rows, only the failing fields are left as parsed
+    ASSERT_EQ(all.rows[1].at("id").as_int(), 0);
+    ASSERT(all.rows[1].at("score").is_float());
+    ASSERT_EQ(all.rows[1].at("active").as_bool(), true);
+    ASSERT_EQ(all.rows[1].at("tier").as_string(), "free");
+    ASSERT_EQ(all.rows[3].at("name").as_string(), "D");
+    ASSERT_EQ(all.rows[3].at("active").as_bool(), true);
+
+    // Rows are shaped as a plan's validate_in_place() leaves them
+    ValidationPlan plan = schema.compile(all.fields);
+    std::vector<std::vector<Value>> rows;
+    const ison::Document parsed = ison::parse(text);
+    for (const auto& parsed_row : parsed.get("users")->rows) {
+        std::vector<Value> row;
+        for (const auto& name : all.fields) {
+            auto it = parsed_row.find(name);
+            if (it == parsed_row.end() || it->second.is_null()) row.push_back(nullptr);
+            else if (it->second.is_int()) row.push_back(it->second.as_int());
+            else if (it->second.is_bool()) row.push_back(it->second.as_bool());
+            else row.push_back(it->second.as_string());
+        }
+        rows.push_back(row);
+    }
+    ValidationErrors plan_errors;
+    plan.validate_in_place(rows, plan_errors);
+    ASSERT_EQ(plan_errors.count(), errors.count());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        for (size_t c = 0; c < all.fields.size(); ++c) {
+            ASSERT(same_value(all.rows[r].at(all.fields[c]), rows[r][c]));
+        }
+    }
+
+    errors.clear();
+    ison::Document dropped = parse_validated(text, schema, errors, true);
+    // Row indices still count every row of the block
+    ASSERT_EQ(errors.count(), 2u);
+    ASSERT_EQ(errors[0].row, 1u);
+    ASSERT(errors[0].code == ErrorCode::NotPositive);
+    ASSERT_EQ(errors[1].row, 3u);
+    ASSERT(errors[1].code == ErrorCode::StringTooShort);
+    ASSERT_EQ(schema.describe(errors)[1].field, "[3].name");
+
+    const ison::Block& users = *dropped.get("users");
+    ASSERT_EQ(users.rows.size(), 3u);
+    ASSERT_EQ(users.rows[0].at("id").as_int(), 1);
+    ASSERT_EQ(users.rows[1].at("id").as_int(), 3);
+    ASSERT_EQ(users.rows[2].at("id").as_int(), 5);
+    ASSERT_EQ(users.get(2, users.field_index("active")).as_bool(), false);
+}
+
+TEST(parse_validated_applies_defaults) {
+    TableSchema schema = fused_schema();
+    const std::string text = R"(table.users
+id name score active
+1 Alice 3 ~
+2 Bob 2.5 false)";
+
+    ValidationErrors errors;
+    ison::Document doc = parse_validated(text, schema, errors);
+    ASSERT(errors.empty());
+
+    // The absent field with a default gets a column
+    const ison::Block& users = *doc.get("users");
+    ASSERT_EQ(users.fields.size(), 5u);
+    ASSERT_EQ(users.fields[4], "tier");
+    ASSERT_EQ(users.field_info.size(), 5u);
+    ASSERT(users.field_index("tier") == 4u);
+
+    ASSERT_EQ(users.rows[0].at("active").as_bool(), true);
+    ASSERT_EQ(users.rows[1].at("active").as_bool(), false);
+    ASSERT_EQ(users.rows[0].at("tier").as_string(), "free");
+    ASSERT_EQ(users.rows[1].at("tier").as_string(), "free");
+
+    // Ints in a float field are widened
+    ASSERT(users.rows[0].at("score").is_float());
+    ASSERT_EQ(users.rows[0].at("score").as_float(), 3.0);
+
+    // So the document validates as-is and serializes with the defaults
+    ASSERT(check(schema, doc, errors));
+    ASSERT(ison::dumps(doc).find("free") != std::string::npos);
+}
+
+TEST(parse_validated_error_lines) {
+    TableSchema schema = fused_schema();
+
+    // Syntax errors report the line of the text they occur on
+    const std::string broken = "table.users\nid name\n1 Alice\n2 \"Bob\n3 Carol\n";
+    ValidationErrors errors;
+    bool thrown = false;
+    try {
+        parse_validated(broken, schema, errors);
+    } catch (const ison::ISONSyntaxError& e) {
+        thrown = true;
+        ASSERT_EQ(e.line, 4);
+    }
+    ASSERT(thrown);
+
+    // Validation errors report rows, whatever lines they are on
+    const std::string spaced = "# header\ntable.users\nid name\n1 Alice\n# comment\n# another\n0 Bob\n3 C\n";
+    errors.clear();
+    ison::Document doc = parse_validated(spaced, schema, errors);
+    ASSERT_EQ(errors.count(), 2u);
+    ASSERT_EQ(errors[0].row, 1u);
+    ASSERT_EQ(errors[1].row, 2u);
+    auto described = schema.describe(errors);
+    ASSERT_EQ(described[0].field, "[1].id");
+    ASSERT_EQ(described[1].field, "[2].name");
+
+    // A missing block is reported once the whole text is read
+    thrown = false;
+    try {
+        parse_validated("table.teams\nid\n1\n", schema, errors);
+    } catch (const ValidationError& e) {
+        thrown = true;
+        ASSERT_EQ(e.errors[0].message, "Missing table: users");
+    }
+    ASSERT(thrown);
+}
+#endif
+
+int main() {
+    std::cout << "=== ISONantic Tests ===" << std::endl << std::endl;
+
+    // Error codes and messages
+    RUN_TEST(error_codes_and_messages);
+    RUN_TEST(validate_throws_with_paths);
+
+    // No-throw validation
+    RUN_TEST(check_does_not_throw);
+    RUN_TEST(plan_check_positional_rows);
+
+    // In-place validation
+    RUN_TEST(plan_validate_in_place);
+
+    // Parallel validation
+    RUN_TEST(parallel_errors_in_row_order);
+    RUN_TEST(parallel_max_errors_prefix);
+#ifdef ISONANTIC_TEST_HAVE_ISON
+    RUN_TEST(columnar_view_matches_rows);
+
+    // Fused parse and validate
+    RUN_TEST(parse_validated_matches_parse_then_validate);
+    RUN_TEST(parse_validated_drop_invalid);
+    RUN_TEST(parse_validated_applies_defaults);
+    RUN_TEST(parse_validated_error_lines);
+#endif
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << tests_passed << std::endl;
+    std::cout << "Failed: " << tests_failed << std::endl;
+
+    return tests_failed > 0 ? 1 : 0;
+}